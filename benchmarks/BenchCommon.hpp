@@ -0,0 +1,155 @@
+/**
+ * Shared helpers for the benchmark programs: a wall-clock timer and the
+ * grammars used by the examples, so every benchmark measures the same
+ * workloads.
+ */
+
+#ifndef BENCH_COMMON_HPP
+#define BENCH_COMMON_HPP
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <sys/time.h>
+#include "Grammar.hpp"
+#include "AST.hpp"
+
+namespace bench {
+
+/**
+ * @brief Returns a monotonic-enough wall clock in seconds.
+ */
+inline double now() {
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) * 1e-6;
+}
+
+/**
+ * @brief One benchmark workload: a grammar, a start rule and inputs.
+ */
+struct Workload {
+    std::string name;
+    std::string rule;
+    std::vector<std::string> inputs;
+};
+
+/// Mini protocol from examples/example_mini_protocol.cpp
+inline void buildMiniProtocol(Grammar& g) {
+    g.addRule("<letter> ::= 'a' ... 'z' | 'A' ... 'Z'");
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<nick-char> ::= <letter> | <digit> | '_' | '-'");
+    g.addRule("<nickname> ::= <letter> { <nick-char> }");
+    g.addRule("<space> ::= ' ' { ' ' }");
+    g.addRule("<text-char> ::= ( 0x21 ... 0x7E )");
+    g.addRule("<text> ::= <text-char> { <text-char> | ' ' }");
+    g.addRule("<crlf> ::= '\r' '\n'");
+    g.addRule("<message> ::= 'MSG' <space> <nickname> <space> ':' <text> <crlf>");
+}
+
+inline Workload miniProtocolWorkload() {
+    Workload w;
+    w.name = "mini-protocol";
+    w.rule = "<message>";
+    w.inputs.push_back("MSG alice :Hello there!\r\n");
+    w.inputs.push_back("MSG bob_123 :status update\r\n");
+    w.inputs.push_back("MSG Zed-9 :the quick brown fox jumps over the lazy dog 0123456789\r\n");
+    w.inputs.push_back("MSG x :short\r\n");
+    return w;
+}
+
+/// IRC nicknames from examples/example_irc_nickname.cpp
+inline void buildIrcNickname(Grammar& g) {
+    g.addRule("<letter> ::= 'a' ... 'z' | 'A' ... 'Z'");
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<special> ::= '_' | '-' | '[' | ']' | '\\\\'");
+    g.addRule("<nick-char> ::= <letter> | <digit> | <special>");
+    g.addRule("<nickname> ::= <letter> { <nick-char> }");
+}
+
+inline Workload ircNicknameWorkload() {
+    Workload w;
+    w.name = "irc-nickname";
+    w.rule = "<nickname>";
+    w.inputs.push_back("alice");
+    w.inputs.push_back("Bob_42");
+    w.inputs.push_back("user[away]");
+    w.inputs.push_back("a-very-long-nickname-with-digits-0123456789");
+    return w;
+}
+
+/// HTTP-like requests from examples/example_first_set.cpp
+inline void buildHttpRequest(Grammar& g) {
+    g.addRule("<space> ::= ' ' { ' ' }");
+    g.addRule("<path-char> ::= ( 'a' ... 'z' 'A' ... 'Z' '0' ... '9' '/' '.' '_' '-' )");
+    g.addRule("<path> ::= '/' <path-char> { <path-char> }");
+    g.addRule("<command-get> ::= 'GET' <space> <path>");
+    g.addRule("<command-post> ::= 'POST' <space> <path>");
+    g.addRule("<command-put> ::= 'PUT' <space> <path>");
+    g.addRule("<command-delete> ::= 'DELETE' <space> <path>");
+    g.addRule("<command-ping> ::= 'PING'");
+    g.addRule("<request> ::= <command-get> | <command-post> | <command-put> | <command-delete> | <command-ping>");
+}
+
+inline Workload httpRequestWorkload() {
+    Workload w;
+    w.name = "http-request";
+    w.rule = "<request>";
+    w.inputs.push_back("GET /index.html");
+    w.inputs.push_back("POST /api/data");
+    w.inputs.push_back("PUT /upload/file.bin");
+    w.inputs.push_back("DELETE /resource/42");
+    w.inputs.push_back("PING");
+    return w;
+}
+
+/// Numbers from examples/example_sequences.cpp
+inline void buildNumbers(Grammar& g) {
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<sign> ::= '+' | '-'");
+    g.addRule("<integer> ::= [ <sign> ] <digit> { <digit> }");
+    g.addRule("<hex-digit> ::= ( '0' ... '9' 'a' ... 'f' 'A' ... 'F' )");
+    g.addRule("<hex-number> ::= '0' 'x' <hex-digit> { <hex-digit> }");
+    g.addRule("<number> ::= <hex-number> | <integer>");
+}
+
+inline Workload numbersWorkload() {
+    Workload w;
+    w.name = "numbers";
+    w.rule = "<number>";
+    w.inputs.push_back("12345");
+    w.inputs.push_back("-987654321");
+    w.inputs.push_back("0xDEADbeef");
+    w.inputs.push_back("+0");
+    return w;
+}
+
+/**
+ * @brief Prints one result line: label, total time and per-parse cost.
+ */
+inline void report(const std::string& label, double seconds, size_t parses) {
+    std::cout << "  " << std::left << std::setw(28) << label
+              << std::right << std::fixed << std::setprecision(3)
+              << std::setw(9) << seconds * 1000.0 << " ms"
+              << std::setw(10) << std::setprecision(1)
+              << (parses ? seconds * 1e9 / static_cast<double>(parses) : 0.0)
+              << " ns/parse" << std::endl;
+}
+
+/**
+ * @brief Structural equality of two ASTs (symbols, matched text, shape).
+ */
+inline bool sameTree(const ASTNode* a, const ASTNode* b) {
+    if (!a || !b) return a == b;
+    if (a->symbol != b->symbol || a->matched != b->matched) return false;
+    if (a->children.size() != b->children.size()) return false;
+    for (size_t i = 0; i < a->children.size(); ++i) {
+        if (!sameTree(a->children[i], b->children[i])) return false;
+    }
+    return true;
+}
+
+} // namespace bench
+
+#endif
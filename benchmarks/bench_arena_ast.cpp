@@ -0,0 +1,76 @@
+/**
+ * Benchmark: heap-allocated vs. arena-allocated AST
+ *
+ * Parses the example workloads with parse()+delete and with
+ * parse(..., arena)+arena.reset(), counting global operator new calls
+ * per parse alongside the time per parse.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <new>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+#include "Arena.hpp"
+
+static size_t allocations = 0;
+
+void* operator new(std::size_t size) throw(std::bad_alloc) {
+    ++allocations;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) throw() {
+    std::free(p);
+}
+
+static void runWorkload(void (*build)(Grammar&), const bench::Workload& w, int rounds) {
+    Grammar g;
+    build(g);
+    BNFParser parser(g.finalize());
+    Arena arena(16 * 1024);
+    size_t parses = static_cast<size_t>(rounds) * w.inputs.size();
+
+    size_t before = allocations;
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            size_t consumed = 0;
+            delete parser.parse(w.rule, w.inputs[i], consumed);
+        }
+    }
+    double tHeap = bench::now() - start;
+    size_t heapAllocs = allocations - before;
+
+    before = allocations;
+    start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            size_t consumed = 0;
+            parser.parse(w.rule, w.inputs[i], consumed, arena);
+            arena.reset();
+        }
+    }
+    double tArena = bench::now() - start;
+    size_t arenaAllocs = allocations - before;
+
+    std::cout << w.name << std::endl;
+    bench::report("new/delete AST", tHeap, parses);
+    std::cout << "    " << static_cast<double>(heapAllocs) / parses << " allocations/parse" << std::endl;
+    bench::report("arena AST", tArena, parses);
+    std::cout << "    " << static_cast<double>(arenaAllocs) / parses << " allocations/parse" << std::endl;
+    std::cout << "  speedup: " << (tArena > 0 ? tHeap / tArena : 0.0) << "x" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::cout << "=== Arena AST Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    runWorkload(bench::buildMiniProtocol, bench::miniProtocolWorkload(), rounds);
+    runWorkload(bench::buildIrcNickname, bench::ircNicknameWorkload(), rounds);
+    runWorkload(bench::buildHttpRequest, bench::httpRequestWorkload(), rounds);
+    runWorkload(bench::buildNumbers, bench::numbersWorkload(), rounds);
+    return 0;
+}
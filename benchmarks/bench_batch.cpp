@@ -0,0 +1,90 @@
+/**
+ * Benchmark: parse() per input vs. parseBatch()
+ *
+ * Many short inputs, one start rule. The per-input loop pays for a rule
+ * lookup, a heap tree with copied text and its deletion on every call;
+ * parseBatch() looks the rule up once, recycles node storage between
+ * inputs and returns all trees flattened into one reusable BatchResult.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <new>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+#include "BatchResult.hpp"
+
+static size_t allocations = 0;
+
+void* operator new(std::size_t size) throw(std::bad_alloc) {
+    ++allocations;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) throw() {
+    std::free(p);
+}
+
+static void runWorkload(void (*build)(Grammar&), const bench::Workload& w, int rounds) {
+    Grammar g;
+    build(g);
+    BNFParser parser(g.finalize());
+
+    // One batch holds every input of the workload 64 times over
+    std::vector<std::string> batch;
+    for (int k = 0; k < 64; ++k)
+        batch.insert(batch.end(), w.inputs.begin(), w.inputs.end());
+    size_t parses = static_cast<size_t>(rounds) * batch.size();
+
+    BatchResult out;
+    parser.parseBatch(w.rule, batch, out);
+    for (size_t i = 0; i < batch.size(); ++i) {
+        size_t consumed = 0;
+        ASTNode* expected = parser.parse(w.rule, batch[i], consumed);
+        ASTNode* rebuilt = out.toAST(i, batch[i]);
+        if (!bench::sameTree(expected, rebuilt)) {
+            std::cerr << "Mismatch on '" << batch[i] << "'" << std::endl;
+            std::exit(1);
+        }
+        delete expected;
+        delete rebuilt;
+    }
+
+    size_t before = allocations;
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < batch.size(); ++i) {
+            size_t consumed = 0;
+            delete parser.parse(w.rule, batch[i], consumed);
+        }
+    }
+    double tSingle = bench::now() - start;
+    size_t singleAllocs = allocations - before;
+
+    before = allocations;
+    start = bench::now();
+    for (int r = 0; r < rounds; ++r)
+        parser.parseBatch(w.rule, batch, out);
+    double tBatch = bench::now() - start;
+    size_t batchAllocs = allocations - before;
+
+    std::cout << w.name << " (" << batch.size() << " inputs per batch)" << std::endl;
+    bench::report("parse() + delete", tSingle, parses);
+    std::cout << "    " << static_cast<double>(singleAllocs) / parses << " allocations/parse" << std::endl;
+    bench::report("parseBatch()", tBatch, parses);
+    std::cout << "    " << static_cast<double>(batchAllocs) / parses << " allocations/parse" << std::endl;
+    std::cout << "  speedup: " << (tBatch > 0 ? tSingle / tBatch : 0.0) << "x" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 300;
+    std::cout << "=== Batch Parse Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    runWorkload(bench::buildMiniProtocol, bench::miniProtocolWorkload(), rounds);
+    runWorkload(bench::buildIrcNickname, bench::ircNicknameWorkload(), rounds);
+    runWorkload(bench::buildHttpRequest, bench::httpRequestWorkload(), rounds);
+    runWorkload(bench::buildNumbers, bench::numbersWorkload(), rounds);
+    return 0;
+}
@@ -0,0 +1,90 @@
+/**
+ * Benchmark: per-byte repetitions vs. collapsed run scanning
+ *
+ * Mini-protocol messages with long text payloads spend most of their time
+ * in `{ <text-char> | ' ' }`, one parseRepeat iteration, symbol call and
+ * node per byte. setCollapseRuns(true) matches such repetitions with one
+ * ByteRun scan. The raw scanner is also timed against its scalar loop.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+#include "ByteRun.hpp"
+
+static bench::Workload longMessages() {
+    bench::Workload w;
+    w.name = "mini-protocol, long payloads";
+    w.rule = "<message>";
+    const char* nicks[] = { "alice", "bob_123", "Zed-9", "x" };
+    for (int i = 0; i < 4; ++i) {
+        std::ostringstream oss;
+        oss << "MSG " << nicks[i] << " :";
+        for (int k = 0; k < 40 * (i + 1); ++k) oss << "payload-" << k << ' ';
+        oss << "end\r\n";
+        w.inputs.push_back(oss.str());
+    }
+    return w;
+}
+
+static double timeParses(const BNFParser& parser, const bench::Workload& w, int rounds) {
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            size_t consumed = 0;
+            delete parser.parse(w.rule, w.inputs[i], consumed);
+        }
+    }
+    return bench::now() - start;
+}
+
+static void runParses(const bench::Workload& w, int rounds) {
+    Grammar g;
+    bench::buildMiniProtocol(g);
+    const CompiledGrammar& cg = g.finalize();
+    BNFParser perByte(cg);
+    BNFParser runs(cg);
+    runs.setCollapseRuns(true);
+    size_t parses = static_cast<size_t>(rounds) * w.inputs.size();
+
+    double tByte = timeParses(perByte, w, rounds);
+    double tRuns = timeParses(runs, w, rounds);
+    std::cout << w.name << std::endl;
+    bench::report("per-byte repetition nodes", tByte, parses);
+    bench::report("setCollapseRuns(true)", tRuns, parses);
+    std::cout << "  speedup: " << (tRuns > 0 ? tByte / tRuns : 0.0) << "x" << std::endl;
+}
+
+static void runScanner(int rounds) {
+    std::bitset<256> printable;
+    for (int c = 0x21; c <= 0x7E; ++c) printable.set(c);
+    ByteRun run(printable);
+    std::string buffer(4096, 'a');
+    buffer += ' ';
+
+    size_t total = 0;
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) total += run.scanScalar(buffer.data(), buffer.size());
+    double tScalar = bench::now() - start;
+    start = bench::now();
+    for (int r = 0; r < rounds; ++r) total += run.scan(buffer.data(), buffer.size());
+    double tVector = bench::now() - start;
+
+    std::cout << "ByteRun over 4 KiB (" << (ByteRun::vectorized() ? "vector" : "scalar only")
+              << ", checksum " << total << ")" << std::endl;
+    bench::report("scanScalar()", tScalar, rounds);
+    bench::report("scan()", tVector, rounds);
+    std::cout << "  speedup: " << (tVector > 0 ? tScalar / tVector : 0.0) << "x" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 2000;
+    std::cout << "=== Byte Run Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    runParses(bench::miniProtocolWorkload(), rounds * 10);
+    runParses(longMessages(), rounds);
+    runScanner(rounds * 50);
+    return 0;
+}
@@ -0,0 +1,67 @@
+/**
+ * Benchmark: linked (finalized) grammar vs. lazy lookups
+ *
+ * Parses the example grammars' inputs with a BNFParser over a plain
+ * Grammar (name lookups, quote stripping and FIRST cache on the hot path)
+ * and over the CompiledGrammar returned by Grammar::finalize().
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+#include "CompiledGrammar.hpp"
+
+static double timeParses(const BNFParser& parser, const bench::Workload& w, int rounds) {
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            size_t consumed = 0;
+            ASTNode* ast = parser.parse(w.rule, w.inputs[i], consumed);
+            delete ast;
+        }
+    }
+    return bench::now() - start;
+}
+
+static void runWorkload(void (*build)(Grammar&), const bench::Workload& w, int rounds) {
+    Grammar plain;
+    build(plain);
+    Grammar linked;
+    build(linked);
+
+    BNFParser lazy(plain);
+    BNFParser fast(linked.finalize());
+
+    for (size_t i = 0; i < w.inputs.size(); ++i) {
+        size_t c1 = 0, c2 = 0;
+        ASTNode* a = lazy.parse(w.rule, w.inputs[i], c1);
+        ASTNode* b = fast.parse(w.rule, w.inputs[i], c2);
+        if (c1 != c2 || !bench::sameTree(a, b)) {
+            std::cerr << "Mismatch on '" << w.inputs[i] << "'" << std::endl;
+            std::exit(1);
+        }
+        delete a;
+        delete b;
+    }
+
+    size_t parses = static_cast<size_t>(rounds) * w.inputs.size();
+    double tLazy = timeParses(lazy, w, rounds);
+    double tFast = timeParses(fast, w, rounds);
+
+    std::cout << w.name << std::endl;
+    bench::report("unlinked Grammar", tLazy, parses);
+    bench::report("CompiledGrammar", tFast, parses);
+    std::cout << "  speedup: " << (tFast > 0 ? tLazy / tFast : 0.0) << "x" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::cout << "=== Compiled Grammar Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    runWorkload(bench::buildMiniProtocol, bench::miniProtocolWorkload(), rounds);
+    runWorkload(bench::buildIrcNickname, bench::ircNicknameWorkload(), rounds);
+    runWorkload(bench::buildHttpRequest, bench::httpRequestWorkload(), rounds);
+    runWorkload(bench::buildNumbers, bench::numbersWorkload(), rounds);
+    return 0;
+}
@@ -0,0 +1,74 @@
+/**
+ * Benchmark: regular rules scanned by their DFA
+ *
+ * Compares recognize() through the rule bodies with recognize() through
+ * the minimized DFAs CompiledGrammar builds for regular rules, and a full
+ * parse() with a parse() that collapses regular rules into leaves. Linked
+ * grammar, recursive engine.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+
+static double timeRuns(const BNFParser& parser, const bench::Workload& w, int rounds,
+                       bool tree, size_t& total) {
+    total = 0;
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            size_t consumed = 0;
+            if (tree) delete parser.parse(w.rule, w.inputs[i], consumed);
+            else parser.recognize(w.rule, w.inputs[i], consumed);
+            total += consumed;
+        }
+    }
+    return bench::now() - start;
+}
+
+static void runWorkload(void (*build)(Grammar&), const bench::Workload& w, int rounds) {
+    Grammar g;
+    build(g);
+    const CompiledGrammar& cg = g.finalize();
+    size_t parses = static_cast<size_t>(rounds) * w.inputs.size();
+
+    std::cout << w.name << ": " << cg.getRegularRules().size() << " of "
+              << cg.getRules().size() << " rules compiled to DFAs" << std::endl;
+
+    BNFParser bodies(cg), dfa(cg), full(cg), collapsed(cg);
+    bodies.setRegularDfa(false);
+    collapsed.setCollapseRegular(true);
+
+    size_t t1 = 0, t2 = 0;
+    double tBodies = timeRuns(bodies, w, rounds, false, t1);
+    double tDfa = timeRuns(dfa, w, rounds, false, t2);
+    if (t1 != t2) {
+        std::cerr << "DFA consumed " << t2 << " bytes, rule bodies " << t1 << std::endl;
+        std::exit(1);
+    }
+    bench::report("recognize() rule bodies", tBodies, parses);
+    bench::report("recognize() DFA", tDfa, parses);
+    std::cout << "  speedup: " << (tDfa > 0 ? tBodies / tDfa : 0.0) << "x" << std::endl;
+
+    double tFull = timeRuns(full, w, rounds, true, t1);
+    double tCollapsed = timeRuns(collapsed, w, rounds, true, t2);
+    if (t1 != t2) {
+        std::cerr << "Collapsed parse consumed " << t2 << " bytes, full parse " << t1 << std::endl;
+        std::exit(1);
+    }
+    bench::report("parse() full tree", tFull, parses);
+    bench::report("parse() regular leaves", tCollapsed, parses);
+    std::cout << "  speedup: " << (tCollapsed > 0 ? tFull / tCollapsed : 0.0) << "x" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::cout << "=== Regular Rule DFA Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    runWorkload(bench::buildMiniProtocol, bench::miniProtocolWorkload(), rounds);
+    runWorkload(bench::buildIrcNickname, bench::ircNicknameWorkload(), rounds);
+    runWorkload(bench::buildHttpRequest, bench::httpRequestWorkload(), rounds);
+    runWorkload(bench::buildNumbers, bench::numbersWorkload(), rounds);
+    return 0;
+}
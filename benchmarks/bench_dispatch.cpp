@@ -0,0 +1,90 @@
+/**
+ * Benchmark: FIRST-byte dispatch tables for alternatives
+ *
+ * Token grammars with dozens of branches: without tables every branch's
+ * FIRST set is tested against the lookahead byte; with them the byte
+ * indexes the list of viable branches directly. Both engines, linked
+ * grammar, parse()+delete and recognize().
+ */
+
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+
+// One branch per byte in [first, first + count): 'c' <digits>
+static void buildTokens(Grammar& g, char first, int count) {
+    g.addRule("<digits> ::= ( '0' ... '9' ) { ( '0' ... '9' ) }");
+    std::ostringstream oss;
+    oss << "<token> ::= ";
+    for (int i = 0; i < count; ++i) {
+        if (i) oss << " | ";
+        oss << "'" << static_cast<char>(first + i) << "' <digits>";
+    }
+    g.addRule(oss.str());
+    g.addRule("<stream> ::= <token> { ';' <token> }");
+}
+
+static std::string tokenStream(char first, int count, int tokens) {
+    std::ostringstream oss;
+    for (int i = 0; i < tokens; ++i) {
+        if (i) oss << ';';
+        oss << static_cast<char>(first + (i * 7) % count) << (i % 1000);
+    }
+    return oss.str();
+}
+
+static double timeRuns(const BNFParser& parser, const std::string& input, int rounds, bool tree) {
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        size_t consumed = 0;
+        if (tree) delete parser.parse("<stream>", input, consumed);
+        else parser.recognize("<stream>", input, consumed);
+    }
+    return bench::now() - start;
+}
+
+static void runCase(int branches, int rounds) {
+    Grammar g;
+    buildTokens(g, 'A', branches);
+    const CompiledGrammar& cg = g.finalize();
+    std::string input = tokenStream('A', branches, 200);
+
+    std::cout << branches << " alternatives, 200 tokens" << std::endl;
+    for (int e = 0; e < 2; ++e) {
+        BNFParser linear(cg), table(cg);
+        linear.setDispatch(false);
+        BNFParser::Engine engine = e ? BNFParser::ENGINE_ITERATIVE : BNFParser::ENGINE_RECURSIVE;
+        linear.setEngine(engine);
+        table.setEngine(engine);
+
+        size_t c1 = 0, c2 = 0;
+        linear.recognize("<stream>", input, c1);
+        table.recognize("<stream>", input, c2);
+        if (c1 != c2 || c1 != input.size()) {
+            std::cerr << "Mismatch: " << c1 << " vs " << c2 << std::endl;
+            std::exit(1);
+        }
+
+        const char* name = e ? "iterative" : "recursive";
+        for (int tree = 1; tree >= 0; --tree) {
+            double tLinear = timeRuns(linear, input, rounds, tree != 0);
+            double tTable = timeRuns(table, input, rounds, tree != 0);
+            std::cout << "  " << name << (tree ? " parse()" : " recognize()") << std::endl;
+            bench::report("  FIRST test per branch", tLinear, rounds);
+            bench::report("  dispatch table", tTable, rounds);
+            std::cout << "    speedup: " << (tTable > 0 ? tLinear / tTable : 0.0) << "x" << std::endl;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 2000;
+    std::cout << "=== Dispatch Table Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    runCase(8, rounds);
+    runCase(24, rounds);
+    runCase(58, rounds);
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * Benchmark: Earley engine
+ *
+ * Three workloads. A left-recursive expression grammar of growing size,
+ * which only the Earley engine can parse; chart items per byte should
+ * stay flat. Its nodes are zero-copy, since copied `matched` strings
+ * along a left-recursive spine would cost quadratic memory on their own.
+ * A JSON subset, comparing the Earley engine with the recursive
+ * backtracking engine on the same trees. An ambiguous grammar on which
+ * backtracking takes exponential time and Earley does not.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+
+static void buildExpr(Grammar& g) {
+    g.addRule("<expr> ::= <expr> '+' <term> | <expr> '-' <term> | <term>");
+    g.addRule("<term> ::= <term> '*' <factor> | <factor>");
+    g.addRule("<factor> ::= '0' ... '9' | '(' <expr> ')'");
+}
+
+static std::string exprInput(size_t terms) {
+    std::string s = "1";
+    for (size_t i = 1; i < terms; ++i) {
+        s += "+-*"[i % 3];
+        s += i % 7 == 0 ? "(2*3)" : "4";
+    }
+    return s;
+}
+
+static void buildJson(Grammar& g) {
+    g.addRule("<value> ::= <object> | <array> | <number> | <string> | 'true' | 'false' | 'null'");
+    g.addRule("<object> ::= '{' <ws> [ <member> { ',' <ws> <member> } ] '}'");
+    g.addRule("<member> ::= <string> <ws> ':' <ws> <value> <ws>");
+    g.addRule("<array> ::= '[' <ws> [ <value> <ws> { ',' <ws> <value> <ws> } ] ']'");
+    g.addRule("<number> ::= [ '-' ] <digit> { <digit> }");
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<string> ::= '\"' { <char> } '\"'");
+    g.addRule("<char> ::= ( 0x20 ... 0x21 0x23 ... 0x7E )");
+    g.addRule("<ws> ::= { ' ' }");
+}
+
+static bench::Workload jsonWorkload() {
+    bench::Workload w;
+    w.name = "json";
+    w.rule = "<value>";
+    w.inputs.push_back("{\"id\": 42, \"name\": \"alice\", \"tags\": [\"a\", \"b\"], \"ok\": true}");
+    w.inputs.push_back("[1, 2, 3, -4, 5, 6, 7, 8, 9, 10]");
+    w.inputs.push_back("{\"a\": {\"b\": {\"c\": [null, false, {\"d\": \"e\"}]}}}");
+    w.inputs.push_back("\"plain string value\"");
+    return w;
+}
+
+static double timeRuns(const BNFParser& parser, const bench::Workload& w, int rounds,
+                       BNFParser::Engine engine, size_t& total) {
+    total = 0;
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            size_t consumed = 0;
+            delete parser.parse(w.rule, w.inputs[i], consumed, engine);
+            total += consumed;
+        }
+    }
+    return bench::now() - start;
+}
+
+static void runExpressions(int rounds) {
+    Grammar g;
+    buildExpr(g);
+    BNFParser parser(g.finalize());
+    parser.setZeroCopy(true);
+    std::cout << "left-recursive expressions (Earley only)" << std::endl;
+
+    for (size_t terms = 250; terms <= 64000; terms *= 4) {
+        bench::Workload w;
+        w.rule = "<expr>";
+        w.inputs.push_back(exprInput(terms));
+        int runs = rounds / static_cast<int>(terms / 250) + 1;
+        parser.resetStats();
+        size_t total = 0;
+        double t = timeRuns(parser, w, runs, BNFParser::ENGINE_EARLEY, total);
+        size_t bytes = w.inputs[0].size();
+        if (total != static_cast<size_t>(runs) * bytes) {
+            std::cerr << "Earley consumed " << total << " bytes, expected "
+                      << static_cast<size_t>(runs) * bytes << std::endl;
+            std::exit(1);
+        }
+        std::cout << "  " << bytes << " bytes: "
+                  << static_cast<double>(parser.getStats().earleyItems) / runs / bytes
+                  << " items/byte, "
+                  << t * 1e9 / runs / bytes << " ns/byte" << std::endl;
+    }
+}
+
+static void runJson(int rounds) {
+    Grammar g;
+    buildJson(g);
+    BNFParser parser(g.finalize());
+    bench::Workload w = jsonWorkload();
+    size_t parses = static_cast<size_t>(rounds) * w.inputs.size();
+    std::cout << "json" << std::endl;
+
+    for (size_t i = 0; i < w.inputs.size(); ++i) {
+        size_t c1 = 0, c2 = 0;
+        ASTNode* a = parser.parse(w.rule, w.inputs[i], c1, BNFParser::ENGINE_RECURSIVE);
+        ASTNode* b = parser.parse(w.rule, w.inputs[i], c2, BNFParser::ENGINE_EARLEY);
+        bool same = c1 == c2 && bench::sameTree(a, b);
+        delete a;
+        delete b;
+        if (!same) {
+            std::cerr << "Earley tree differs on input " << i << std::endl;
+            std::exit(1);
+        }
+    }
+
+    size_t t1 = 0, t2 = 0;
+    double tRec = timeRuns(parser, w, rounds, BNFParser::ENGINE_RECURSIVE, t1);
+    double tEarley = timeRuns(parser, w, rounds, BNFParser::ENGINE_EARLEY, t2);
+    bench::report("parse() recursive", tRec, parses);
+    bench::report("parse() earley", tEarley, parses);
+    std::cout << "    earley / recursive: " << (tRec > 0 ? tEarley / tRec : 0.0) << "x" << std::endl;
+}
+
+static void runAmbiguous() {
+    Grammar g;
+    g.addRule("<x> ::= 'a' <x> | 'a' <x> 'b' | 'a'");
+    BNFParser parser(g.finalize());
+    std::cout << "ambiguous <x> on a^n b^(n/2)" << std::endl;
+
+    for (size_t n = 8; n <= 20; n += 4) {
+        bench::Workload w;
+        w.rule = "<x>";
+        w.inputs.push_back(std::string(n, 'a') + std::string(n / 2, 'b'));
+        size_t t1 = 0, t2 = 0;
+        double tRec = timeRuns(parser, w, 1, BNFParser::ENGINE_RECURSIVE, t1);
+        double tEarley = timeRuns(parser, w, 1, BNFParser::ENGINE_EARLEY, t2);
+        if (t1 != t2) {
+            std::cerr << "Earley consumed " << t2 << " bytes, recursive " << t1 << std::endl;
+            std::exit(1);
+        }
+        std::cout << "  n=" << n << ":" << std::endl;
+        bench::report("  parse() recursive", tRec, 1);
+        bench::report("  parse() earley", tEarley, 1);
+    }
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 2000;
+    std::cout << "=== Earley Engine Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    runExpressions(rounds);
+    runJson(rounds);
+    runAmbiguous();
+    return 0;
+}
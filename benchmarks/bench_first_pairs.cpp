@@ -0,0 +1,99 @@
+/**
+ * Benchmark: FIRST_2 pruning of alternative branches
+ *
+ * IRC-style commands that share their first letter (PRIVMSG, PING, PONG,
+ * PART, PASS, ...) each carry parameters, so they are sequences rather
+ * than keyword alternatives. One-byte FIRST lets every command with the
+ * same initial through; FIRST_2 also checks the second byte. Linked
+ * grammar, both engines, parse()+delete and recognize().
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+
+static void buildCommands(Grammar& g) {
+    g.addRule("<space> ::= ' ' { ' ' }");
+    g.addRule("<param> ::= ( 0x21 ... 0x39 0x3B ... 0x7E ) { ( 0x21 ... 0x7E ) }");
+    g.addRule("<trailing> ::= ':' { ( 0x20 ... 0x7E ) }");
+    g.addRule("<params> ::= { <space> <param> } [ <space> <trailing> ]");
+    const char* names[] = { "PRIVMSG", "PING", "PONG", "PART", "PASS", "NICK", "NOTICE",
+                            "NAMES", "JOIN", "KICK", "KILL", "MODE", "MOTD", "QUIT",
+                            "TOPIC", "TIME", "WHO", "WHOIS", "WALLOPS", "USER" };
+    std::string alt = "<command> ::= ";
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        if (i) alt += " | ";
+        alt += "'" + std::string(names[i]) + "' <params>";
+    }
+    g.addRule(alt);
+    g.addRule("<line> ::= <command> '\r' '\n'");
+}
+
+static bench::Workload commandsWorkload() {
+    bench::Workload w;
+    w.name = "irc commands";
+    w.rule = "<line>";
+    w.inputs.push_back("PRIVMSG #chan :hello there\r\n");
+    w.inputs.push_back("PONG irc.example.net\r\n");
+    w.inputs.push_back("PASS secret\r\n");
+    w.inputs.push_back("NOTICE bob :ping\r\n");
+    w.inputs.push_back("NAMES #chan\r\n");
+    w.inputs.push_back("KILL eve :spam\r\n");
+    w.inputs.push_back("WHOIS alice\r\n");
+    w.inputs.push_back("TIME\r\n");
+    return w;
+}
+
+static double timeRuns(const BNFParser& parser, const bench::Workload& w, int rounds,
+                       bool tree, size_t& total) {
+    total = 0;
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            size_t consumed = 0;
+            if (tree) delete parser.parse(w.rule, w.inputs[i], consumed);
+            else parser.recognize(w.rule, w.inputs[i], consumed);
+            total += consumed;
+        }
+    }
+    return bench::now() - start;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::cout << "=== FIRST_2 Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    Grammar g;
+    buildCommands(g);
+    const CompiledGrammar& cg = g.finalize();
+    bench::Workload w = commandsWorkload();
+    size_t parses = static_cast<size_t>(rounds) * w.inputs.size();
+
+    for (int e = 0; e < 2; ++e) {
+        BNFParser first(cg), pairs(cg);
+        pairs.setFirstPairs(true);
+        BNFParser::Engine engine = e ? BNFParser::ENGINE_ITERATIVE : BNFParser::ENGINE_RECURSIVE;
+        first.setEngine(engine);
+        pairs.setEngine(engine);
+
+        const char* name = e ? "iterative" : "recursive";
+        for (int tree = 1; tree >= 0; --tree) {
+            size_t t1 = 0, t2 = 0;
+            pairs.resetStats();
+            double tFirst = timeRuns(first, w, rounds, tree != 0, t1);
+            double tPairs = timeRuns(pairs, w, rounds, tree != 0, t2);
+            if (t1 != t2) {
+                std::cerr << "FIRST_2 consumed " << t2 << " bytes, FIRST " << t1 << std::endl;
+                return 1;
+            }
+            std::cout << "  " << name << (tree ? " parse()" : " recognize()") << std::endl;
+            bench::report("  FIRST", tFirst, parses);
+            bench::report("  FIRST_2", tPairs, parses);
+            std::cout << "    branches pruned per parse: "
+                      << static_cast<double>(pairs.getStats().pairPrunes) / parses
+                      << ", speedup: " << (tPairs > 0 ? tFirst / tPairs : 0.0) << "x" << std::endl;
+        }
+    }
+    return 0;
+}
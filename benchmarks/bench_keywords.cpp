@@ -0,0 +1,115 @@
+/**
+ * Benchmark: keyword tries for alternatives of literals
+ *
+ * A command rule of 150 literal keywords, matched three ways: comparing
+ * every FIRST-viable literal in turn, comparing only the literals listed
+ * by the dispatch table, and one walk of the keyword trie. Both engines,
+ * linked grammar, parse()+delete and recognize().
+ */
+
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <vector>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+
+static const char* const COMMANDS[] = {
+    "ADMIN", "AWAY", "CAP", "CNOTICE", "CPRIVMSG", "CONNECT", "DIE", "ENCAP",
+    "ERROR", "HELP", "INFO", "INVITE", "ISON", "JOIN", "KICK", "KILL", "KNOCK",
+    "LINKS", "LIST", "LUSERS", "MODE", "MOTD", "NAMES", "NICK", "NOTICE",
+    "OPER", "PART", "PASS", "PING", "PONG", "PRIVMSG", "QUIT", "REHASH",
+    "RESTART", "RULES", "SERVER", "SERVICE", "SERVLIST", "SQUERY", "SQUIT",
+    "SETNAME", "SILENCE", "STATS", "SUMMON", "TIME", "TOPIC", "TRACE", "USER",
+    "USERHOST", "USERIP", "USERS", "VERSION", "WALLOPS", "WATCH", "WHO",
+    "WHOIS", "WHOWAS", "AUTHENTICATE", "BATCH", "CHATHISTORY", "TAGMSG",
+    "MONITOR", "ACCOUNT", "CHGHOST", "REDACT", "MARKREAD"
+};
+
+// The IRC commands above plus synthetic ones sharing their prefixes
+static std::vector<std::string> keywordList() {
+    std::vector<std::string> words(COMMANDS, COMMANDS + sizeof(COMMANDS) / sizeof(COMMANDS[0]));
+    const char* stems[] = { "SET", "GET", "LIST", "WHO", "PRIV", "NOTE" };
+    for (size_t i = 0; words.size() < 150; ++i) {
+        std::ostringstream oss;
+        oss << stems[i % 6] << static_cast<char>('A' + (i / 6) % 26) << static_cast<char>('A' + i % 7);
+        words.push_back(oss.str());
+    }
+    return words;
+}
+
+static void buildCommands(Grammar& g, const std::vector<std::string>& words) {
+    std::ostringstream oss;
+    oss << "<command> ::= ";
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (i) oss << " | ";
+        oss << "'" << words[i] << "'";
+    }
+    g.addRule(oss.str());
+    g.addRule("<stream> ::= <command> { ' ' <command> }");
+}
+
+static std::string commandStream(const std::vector<std::string>& words, int count) {
+    std::ostringstream oss;
+    for (int i = 0; i < count; ++i) {
+        if (i) oss << ' ';
+        oss << words[(static_cast<size_t>(i) * 37) % words.size()];
+    }
+    return oss.str();
+}
+
+static double timeRuns(const BNFParser& parser, const std::string& input, int rounds, bool tree) {
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        size_t consumed = 0;
+        if (tree) delete parser.parse("<stream>", input, consumed);
+        else parser.recognize("<stream>", input, consumed);
+    }
+    return bench::now() - start;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 2000;
+    std::cout << "=== Keyword Trie Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    std::vector<std::string> words = keywordList();
+    Grammar g;
+    buildCommands(g, words);
+    const CompiledGrammar& cg = g.finalize();
+    std::string input = commandStream(words, 200);
+    std::cout << words.size() << " keywords, 200 commands" << std::endl;
+
+    for (int e = 0; e < 2; ++e) {
+        BNFParser linear(cg), table(cg), trie(cg);
+        linear.setDispatch(false);
+        linear.setKeywordTries(false);
+        table.setKeywordTries(false);
+        BNFParser::Engine engine = e ? BNFParser::ENGINE_ITERATIVE : BNFParser::ENGINE_RECURSIVE;
+        linear.setEngine(engine);
+        table.setEngine(engine);
+        trie.setEngine(engine);
+
+        size_t c1 = 0, c2 = 0, c3 = 0;
+        linear.recognize("<stream>", input, c1);
+        table.recognize("<stream>", input, c2);
+        trie.recognize("<stream>", input, c3);
+        if (c1 != c2 || c1 != c3 || c1 != input.size()) {
+            std::cerr << "Mismatch: " << c1 << ", " << c2 << ", " << c3 << std::endl;
+            return 1;
+        }
+
+        const char* name = e ? "iterative" : "recursive";
+        for (int tree = 1; tree >= 0; --tree) {
+            double tLinear = timeRuns(linear, input, rounds, tree != 0);
+            double tTable = timeRuns(table, input, rounds, tree != 0);
+            double tTrie = timeRuns(trie, input, rounds, tree != 0);
+            std::cout << "  " << name << (tree ? " parse()" : " recognize()") << std::endl;
+            bench::report("  compare per branch", tLinear, rounds);
+            bench::report("  dispatch table", tTable, rounds);
+            bench::report("  keyword trie", tTrie, rounds);
+            std::cout << "    speedup vs per branch: " << (tTrie > 0 ? tLinear / tTrie : 0.0)
+                      << "x, vs dispatch: " << (tTrie > 0 ? tTable / tTrie : 0.0) << "x" << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,183 @@
+/**
+ * Benchmark: LALR(1) engine
+ *
+ * A JSON subset, the mini protocol and HTTP requests, all conflict-free.
+ * Compares the recursive and iterative backtracking engines with the
+ * shift-reduce engine on parse()+delete and recognize(), after checking
+ * that all three build the same trees. The backtracking engines scan
+ * regular rules with DFAs, so recognize() is also timed with
+ * setRegularDfa(false). Linked grammar.
+ *
+ * A left-recursive expression grammar that backtracking cannot parse,
+ * comparing the shift-reduce engine with the Earley engine. Its nodes are
+ * zero-copy, as in bench_earley.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+#include "LalrTable.hpp"
+
+static void buildJson(Grammar& g) {
+    g.addRule("<value> ::= <object> | <array> | <number> | <string> | 'true' | 'false' | 'null'");
+    g.addRule("<object> ::= '{' <ws> [ <member> { ',' <ws> <member> } ] '}'");
+    g.addRule("<member> ::= <string> <ws> ':' <ws> <value> <ws>");
+    g.addRule("<array> ::= '[' <ws> [ <value> <ws> { ',' <ws> <value> <ws> } ] ']'");
+    g.addRule("<number> ::= [ '-' ] <digit> { <digit> }");
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<string> ::= '\"' { <char> } '\"'");
+    g.addRule("<char> ::= ( 0x20 ... 0x21 0x23 ... 0x7E )");
+    g.addRule("<ws> ::= { ' ' }");
+}
+
+static bench::Workload jsonWorkload() {
+    bench::Workload w;
+    w.name = "json";
+    w.rule = "<value>";
+    w.inputs.push_back("{\"id\": 42, \"name\": \"alice\", \"tags\": [\"a\", \"b\"], \"ok\": true}");
+    w.inputs.push_back("[1, 2, 3, -4, 5, 6, 7, 8, 9, 10]");
+    w.inputs.push_back("{\"a\": {\"b\": {\"c\": [null, false, {\"d\": \"e\"}]}}}");
+    w.inputs.push_back("\"plain string value\"");
+    return w;
+}
+
+static void buildExpr(Grammar& g) {
+    g.addRule("<expr> ::= <expr> '+' <term> | <expr> '-' <term> | <term>");
+    g.addRule("<term> ::= <term> '*' <factor> | <factor>");
+    g.addRule("<factor> ::= '0' ... '9' | '(' <expr> ')'");
+}
+
+static std::string exprInput(size_t terms) {
+    std::string s = "1";
+    for (size_t i = 1; i < terms; ++i) {
+        s += "+-*"[i % 3];
+        s += i % 7 == 0 ? "(2*3)" : "4";
+    }
+    return s;
+}
+
+static double timeRuns(const BNFParser& parser, const bench::Workload& w, int rounds,
+                       bool tree, size_t& total) {
+    total = 0;
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            size_t consumed = 0;
+            if (tree) delete parser.parse(w.rule, w.inputs[i], consumed);
+            else parser.recognize(w.rule, w.inputs[i], consumed);
+            total += consumed;
+        }
+    }
+    return bench::now() - start;
+}
+
+static void runWorkload(void (*build)(Grammar&), const bench::Workload& w, int rounds) {
+    Grammar g;
+    build(g);
+    const CompiledGrammar& cg = g.finalize();
+    size_t parses = static_cast<size_t>(rounds) * w.inputs.size();
+
+    LalrTable table(g);
+    std::cout << w.name << ": ";
+    table.report(std::cout);
+
+    BNFParser recursive(cg), iterative(cg), bodies(cg), lalr(cg);
+    iterative.setEngine(BNFParser::ENGINE_ITERATIVE);
+    bodies.setRegularDfa(false);
+    lalr.setEngine(BNFParser::ENGINE_LALR);
+
+    for (size_t i = 0; i < w.inputs.size(); ++i) {
+        size_t c1 = 0, c2 = 0;
+        ASTNode* a = recursive.parse(w.rule, w.inputs[i], c1);
+        ASTNode* b = lalr.parse(w.rule, w.inputs[i], c2);
+        bool same = c1 == c2 && bench::sameTree(a, b);
+        delete a;
+        delete b;
+        if (!same) {
+            std::cerr << "LALR tree differs on input " << i << std::endl;
+            std::exit(1);
+        }
+    }
+
+    for (int tree = 1; tree >= 0; --tree) {
+        size_t t1 = 0, t2 = 0, t3 = 0;
+        double tRec = timeRuns(recursive, w, rounds, tree != 0, t1);
+        double tIter = timeRuns(iterative, w, rounds, tree != 0, t2);
+        lalr.resetStats();
+        double tLalr = timeRuns(lalr, w, rounds, tree != 0, t3);
+        if (t1 != t2 || t1 != t3) {
+            std::cerr << "LALR consumed " << t3 << " bytes, backtracking " << t1 << std::endl;
+            std::exit(1);
+        }
+        std::string call = tree ? "  parse() " : "  recognize() ";
+        bench::report(call + "recursive", tRec, parses);
+        bench::report(call + "iterative", tIter, parses);
+        double tBodies = 0;
+        if (!tree) {
+            size_t t4 = 0;
+            tBodies = timeRuns(bodies, w, rounds, false, t4);
+            if (t4 != t3) {
+                std::cerr << "LALR consumed " << t3 << " bytes, no DFA " << t4 << std::endl;
+                std::exit(1);
+            }
+            bench::report(call + "no DFA", tBodies, parses);
+        }
+        bench::report(call + "lalr", tLalr, parses);
+        std::cout << "    speedup over recursive: " << (tLalr > 0 ? tRec / tLalr : 0.0)
+                  << "x, over iterative: " << (tLalr > 0 ? tIter / tLalr : 0.0) << "x";
+        if (!tree)
+            std::cout << ", over no DFA: " << (tLalr > 0 ? tBodies / tLalr : 0.0) << "x";
+        std::cout << ", " << static_cast<double>(lalr.getStats().reductions) / static_cast<double>(t3)
+                  << " reductions/byte" << std::endl;
+    }
+}
+
+static void runExpressions(int rounds) {
+    Grammar g;
+    buildExpr(g);
+    BNFParser parser(g.finalize());
+    parser.setZeroCopy(true);
+    std::cout << "left-recursive expressions: ";
+    LalrTable(g).report(std::cout);
+
+    for (size_t terms = 250; terms <= 16000; terms *= 4) {
+        bench::Workload w;
+        w.rule = "<expr>";
+        w.inputs.push_back(exprInput(terms));
+        int runs = rounds / static_cast<int>(terms * 4) + 1;
+        size_t bytes = w.inputs[0].size();
+
+        size_t c1 = 0, c2 = 0;
+        ASTNode* a = parser.parse(w.rule, w.inputs[0], c1, BNFParser::ENGINE_EARLEY);
+        ASTNode* b = parser.parse(w.rule, w.inputs[0], c2, BNFParser::ENGINE_LALR);
+        bool same = c1 == bytes && c2 == bytes && bench::sameTree(a, b);
+        delete a;
+        delete b;
+        if (!same) {
+            std::cerr << "LALR tree differs from Earley at " << bytes << " bytes" << std::endl;
+            std::exit(1);
+        }
+
+        parser.setEngine(BNFParser::ENGINE_EARLEY);
+        size_t t1 = 0, t2 = 0;
+        double tEarley = timeRuns(parser, w, runs, true, t1);
+        parser.setEngine(BNFParser::ENGINE_LALR);
+        double tLalr = timeRuns(parser, w, runs, true, t2);
+        std::cout << "  " << bytes << " bytes: earley "
+                  << tEarley * 1e9 / runs / bytes << " ns/byte, lalr "
+                  << tLalr * 1e9 / runs / bytes << " ns/byte, speedup "
+                  << (tLalr > 0 ? tEarley / tLalr : 0.0) << "x" << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::cout << "=== LALR(1) Engine Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    runWorkload(buildJson, jsonWorkload(), rounds);
+    runWorkload(bench::buildMiniProtocol, bench::miniProtocolWorkload(), rounds);
+    runWorkload(bench::buildHttpRequest, bench::httpRequestWorkload(), rounds);
+    runExpressions(rounds);
+    return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * Benchmark: LL(1) predictive parsing
+ *
+ * A JSON subset that is LL(1) as written, and the mini protocol. Compares
+ * the backtracking parser with setPredictive(true) on parse()+delete and
+ * recognize(). Predictive mode runs rule bodies instead of DFAs, so
+ * recognize() is also timed with setRegularDfa(false). Linked grammar,
+ * both engines.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+#include "LL1Analysis.hpp"
+
+static void buildJson(Grammar& g) {
+    g.addRule("<value> ::= <object> | <array> | <number> | <string> | 'true' | 'false' | 'null'");
+    g.addRule("<object> ::= '{' <ws> [ <member> { ',' <ws> <member> } ] '}'");
+    g.addRule("<member> ::= <string> <ws> ':' <ws> <value> <ws>");
+    g.addRule("<array> ::= '[' <ws> [ <value> <ws> { ',' <ws> <value> <ws> } ] ']'");
+    g.addRule("<number> ::= [ '-' ] <digit> { <digit> }");
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<string> ::= '\"' { <char> } '\"'");
+    g.addRule("<char> ::= ( 0x20 ... 0x21 0x23 ... 0x7E )");
+    g.addRule("<ws> ::= { ' ' }");
+}
+
+static bench::Workload jsonWorkload() {
+    bench::Workload w;
+    w.name = "json";
+    w.rule = "<value>";
+    w.inputs.push_back("{\"id\": 42, \"name\": \"alice\", \"tags\": [\"a\", \"b\"], \"ok\": true}");
+    w.inputs.push_back("[1, 2, 3, -4, 5, 6, 7, 8, 9, 10]");
+    w.inputs.push_back("{\"a\": {\"b\": {\"c\": [null, false, {\"d\": \"e\"}]}}}");
+    w.inputs.push_back("\"plain string value\"");
+    return w;
+}
+
+static double timeRuns(const BNFParser& parser, const bench::Workload& w, int rounds,
+                       bool tree, size_t& total) {
+    total = 0;
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            size_t consumed = 0;
+            if (tree) delete parser.parse(w.rule, w.inputs[i], consumed);
+            else parser.recognize(w.rule, w.inputs[i], consumed);
+            total += consumed;
+        }
+    }
+    return bench::now() - start;
+}
+
+static void runWorkload(void (*build)(Grammar&), const bench::Workload& w, int rounds) {
+    Grammar g;
+    build(g);
+    const CompiledGrammar& cg = g.finalize();
+    size_t parses = static_cast<size_t>(rounds) * w.inputs.size();
+
+    LL1Analysis ll1(g);
+    std::cout << w.name << ": ";
+    ll1.report(std::cout);
+
+    for (int e = 0; e < 2; ++e) {
+        BNFParser::Engine engine = e ? BNFParser::ENGINE_ITERATIVE : BNFParser::ENGINE_RECURSIVE;
+        BNFParser backtrack(cg), bodies(cg), predict(cg);
+        backtrack.setEngine(engine);
+        bodies.setEngine(engine);
+        predict.setEngine(engine);
+        bodies.setRegularDfa(false);
+        predict.setPredictive(true);
+        std::cout << "  " << (e ? "iterative" : "recursive") << std::endl;
+
+        size_t t1 = 0, t2 = 0, t3 = 0;
+        double tBack = timeRuns(backtrack, w, rounds, true, t1);
+        double tPredict = timeRuns(predict, w, rounds, true, t2);
+        if (t1 != t2) {
+            std::cerr << "Predictive parse consumed " << t2 << " bytes, backtracking " << t1 << std::endl;
+            std::exit(1);
+        }
+        bench::report("  parse() backtracking", tBack, parses);
+        bench::report("  parse() predictive", tPredict, parses);
+        std::cout << "    speedup: " << (tPredict > 0 ? tBack / tPredict : 0.0) << "x" << std::endl;
+
+        tBack = timeRuns(backtrack, w, rounds, false, t1);
+        double tBodies = timeRuns(bodies, w, rounds, false, t2);
+        tPredict = timeRuns(predict, w, rounds, false, t3);
+        if (t1 != t3 || t2 != t3) {
+            std::cerr << "Predictive recognize consumed " << t3 << " bytes, backtracking " << t1 << std::endl;
+            std::exit(1);
+        }
+        bench::report("  recognize() backtracking", tBack, parses);
+        bench::report("  recognize() no DFA", tBodies, parses);
+        bench::report("  recognize() predictive", tPredict, parses);
+        std::cout << "    speedup over no DFA: " << (tPredict > 0 ? tBodies / tPredict : 0.0)
+                  << "x, over backtracking: " << (tPredict > 0 ? tBack / tPredict : 0.0) << "x"
+                  << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::cout << "=== LL(1) Predictive Parsing Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    runWorkload(buildJson, jsonWorkload(), rounds);
+    runWorkload(bench::buildMiniProtocol, bench::miniProtocolWorkload(), rounds);
+    return 0;
+}
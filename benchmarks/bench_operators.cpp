@@ -0,0 +1,115 @@
+/**
+ * Benchmark: operator tables against one rule per precedence level
+ *
+ * A filter-style expression language with five precedence levels, written
+ * once as the usual chain of rules (`<or> ::= <and> { '||' <and> }`, ...)
+ * and once as a single rule with an operator table. Every operand of the
+ * level grammar passes through one rule call per level; the operator rule
+ * reads it with one call and builds its binary tree by precedence
+ * climbing. Both are parsed and recognized by the recursive engine on
+ * inputs of about 2k to 150k bytes; node counts compare the trees, and
+ * the Earley engine checks that the table rule folds to the same tree.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+
+static void buildLevels(Grammar& g) {
+    g.addRule("<or> ::= <and> { '||' <and> }");
+    g.addRule("<and> ::= <cmp> { '&&' <cmp> }");
+    g.addRule("<cmp> ::= <sum> { <cmpop> <sum> }");
+    g.addRule("<cmpop> ::= '==' | '<' | '>'");
+    g.addRule("<sum> ::= <prod> { <addop> <prod> }");
+    g.addRule("<addop> ::= '+' | '-'");
+    g.addRule("<prod> ::= <atom> { <mulop> <atom> }");
+    g.addRule("<mulop> ::= '*' | '/'");
+    g.addRule("<atom> ::= <num> | '(' <or> ')'");
+    g.addRule("<num> ::= ( '0' ... '9' ) { ( '0' ... '9' ) }");
+}
+
+static void buildTable(Grammar& g) {
+    g.addOperatorRule("<or> ::= <atom>",
+                      "left '||' | left '&&' | left '==' '<' '>' | left '+' '-' | left '*' '/'");
+    g.addRule("<atom> ::= <num> | '(' <or> ')'");
+    g.addRule("<num> ::= ( '0' ... '9' ) { ( '0' ... '9' ) }");
+}
+
+static std::string filterInput(size_t terms) {
+    static const char* const ops[] = { "+", "*", "==", "&&", "-", "<", "||", "/" };
+    std::string s = "12";
+    for (size_t i = 1; i < terms; ++i) {
+        s += ops[i % 8];
+        s += i % 5 == 0 ? "(3+45*6)" : "78";
+    }
+    return s;
+}
+
+static size_t countNodes(const ASTNode* n) {
+    if (!n) return 0;
+    size_t count = 1;
+    for (size_t i = 0; i < n->children.size(); ++i)
+        count += countNodes(n->children[i]);
+    return count;
+}
+
+static double timeRuns(const BNFParser& parser, const std::string& input, int runs, bool tree) {
+    double start = bench::now();
+    for (int r = 0; r < runs; ++r) {
+        size_t consumed = 0;
+        if (tree) delete parser.parse("<or>", input, consumed);
+        else parser.recognize("<or>", input, consumed);
+        if (consumed != input.size()) {
+            std::cerr << "consumed " << consumed << " of " << input.size() << " bytes" << std::endl;
+            std::exit(1);
+        }
+    }
+    return bench::now() - start;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 200000;
+    std::cout << "=== Operator Table Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    Grammar levels, table;
+    buildLevels(levels);
+    buildTable(table);
+    BNFParser chain(levels.finalize()), climbing(table.finalize());
+    chain.setZeroCopy(true);
+    climbing.setZeroCopy(true);
+
+    for (size_t terms = 500; terms <= 32000; terms *= 4) {
+        std::string input = filterInput(terms);
+        size_t bytes = input.size();
+        int runs = rounds / static_cast<int>(terms) + 1;
+
+        size_t c0 = 0, c1 = 0, c2 = 0;
+        ASTNode* a = chain.parse("<or>", input, c0);
+        ASTNode* b = climbing.parse("<or>", input, c1);
+        ASTNode* folded = climbing.parse("<or>", input, c2, BNFParser::ENGINE_EARLEY);
+        if (c0 != bytes || c1 != bytes || c2 != bytes || !bench::sameTree(b, folded)) {
+            std::cerr << "operator rule differs at " << bytes << " bytes" << std::endl;
+            std::exit(1);
+        }
+        std::cout << "  " << bytes << " bytes, nodes: levels " << countNodes(a)
+                  << ", table " << countNodes(b) << std::endl;
+        delete a;
+        delete b;
+        delete folded;
+
+        for (int tree = 1; tree >= 0; --tree) {
+            double tLevels = timeRuns(chain, input, runs, tree != 0);
+            double tTable = timeRuns(climbing, input, runs, tree != 0);
+            std::cout << "    " << (tree ? "parse()" : "recognize()") << " ns/byte: levels "
+                      << tLevels * 1e9 / runs / bytes << ", table " << tTable * 1e9 / runs / bytes
+                      << ", speedup " << (tTable > 0 ? tLevels / tTable : 0.0) << "x" << std::endl;
+        }
+    }
+
+    climbing.resetStats();
+    size_t consumed = 0;
+    climbing.recognize("<or>", filterInput(2000), consumed);
+    std::cout << "operators climbed for 2000 terms: " << climbing.getStats().climbs << std::endl;
+    return 0;
+}
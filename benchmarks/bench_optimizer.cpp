@@ -0,0 +1,113 @@
+/**
+ * Benchmark: grammar optimizer passes
+ *
+ * Builds each workload grammar unoptimized, with each pass alone and with
+ * all passes, then times parse()+delete on the same inputs. Fused classes
+ * replace an alternative and its branch nodes with one bitmap test; merged
+ * literals replace a sequence of one-byte terminals with one compare;
+ * factored alternatives match a shared prefix once; inlining removes the
+ * symbol call and wrapper node of small rules.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+#include "GrammarOptimizer.hpp"
+
+static double timeParses(void (*build)(Grammar&), const bench::Workload& w, int rounds,
+                         GrammarOptimizer* opt, size_t expected) {
+    Grammar g;
+    g.setOptimizer(opt);
+    build(g);
+    BNFParser parser(g.finalize());
+
+    size_t consumed = 0, total = 0;
+    for (size_t i = 0; i < w.inputs.size(); ++i) {
+        delete parser.parse(w.rule, w.inputs[i], consumed);
+        total += consumed;
+    }
+    if (total != expected) {
+        std::cerr << "Optimized grammar consumed " << total << " bytes, expected "
+                  << expected << std::endl;
+        std::exit(1);
+    }
+
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            delete parser.parse(w.rule, w.inputs[i], consumed);
+        }
+    }
+    return bench::now() - start;
+}
+
+static size_t consumedTotal(void (*build)(Grammar&), const bench::Workload& w) {
+    Grammar g;
+    build(g);
+    BNFParser parser(g.finalize());
+    size_t consumed = 0, total = 0;
+    for (size_t i = 0; i < w.inputs.size(); ++i) {
+        delete parser.parse(w.rule, w.inputs[i], consumed);
+        total += consumed;
+    }
+    return total;
+}
+
+static void runWorkload(void (*build)(Grammar&), const bench::Workload& w, int rounds) {
+    std::cout << w.name << std::endl;
+    size_t parses = static_cast<size_t>(rounds) * w.inputs.size();
+    size_t expected = consumedTotal(build, w);
+
+    double tNone = timeParses(build, w, rounds, 0, expected);
+    for (int p = 0; p < GrammarOptimizer::PASS_COUNT; ++p) {
+        GrammarOptimizer single;
+        single.setAllPasses(false);
+        single.setPass(static_cast<GrammarOptimizer::Pass>(p), true);
+        double t = timeParses(build, w, rounds, &single, expected);
+        if (p == 0) bench::report("unoptimized", tNone, parses);
+        bench::report(GrammarOptimizer::passName(static_cast<GrammarOptimizer::Pass>(p)), t, parses);
+    }
+    GrammarOptimizer all;
+    double tAll = timeParses(build, w, rounds, &all, expected);
+
+    std::cout << "  all passes: " << all.getStats().rewrites[GrammarOptimizer::PASS_FUSE_CHAR_CLASSES]
+              << " fused, " << all.getStats().rewrites[GrammarOptimizer::PASS_MERGE_LITERALS]
+              << " merged, " << all.getStats().rewrites[GrammarOptimizer::PASS_FACTOR_PREFIXES]
+              << " factored, " << all.getStats().rewrites[GrammarOptimizer::PASS_INLINE_RULES]
+              << " inlined" << std::endl;
+    bench::report("all passes", tAll, parses);
+    std::cout << "  speedup: " << (tAll > 0 ? tNone / tAll : 0.0) << "x" << std::endl;
+}
+
+// Commands whose variants share a long prefix
+static void buildCommands(Grammar& g) {
+    g.addRule("<space> ::= ' ' { ' ' }");
+    g.addRule("<word> ::= ( 'a' ... 'z' '#' ) { ( 'a' ... 'z' '0' ... '9' ) }");
+    g.addRule("<text> ::= { ( 0x20 ... 0x7E ) }");
+    g.addRule("<privmsg> ::= 'PRIVMSG' <space> <word> { ',' <word> } <space> ':' <text>"
+              " | 'PRIVMSG' <space> <word> { ',' <word> } <space> <word>"
+              " | 'PRIVMSG' <space> <word> { ',' <word> }");
+}
+
+static bench::Workload commandsWorkload() {
+    bench::Workload w;
+    w.name = "privmsg variants";
+    w.rule = "<privmsg>";
+    w.inputs.push_back("PRIVMSG #chan,#other,#third :hello there, how is everyone?");
+    w.inputs.push_back("PRIVMSG alice,bob,carol dave");
+    w.inputs.push_back("PRIVMSG #one,#two,#three,#four,#five");
+    return w;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::cout << "=== Grammar Optimizer Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    runWorkload(bench::buildMiniProtocol, bench::miniProtocolWorkload(), rounds);
+    runWorkload(bench::buildIrcNickname, bench::ircNicknameWorkload(), rounds);
+    runWorkload(bench::buildHttpRequest, bench::httpRequestWorkload(), rounds);
+    runWorkload(bench::buildNumbers, bench::numbersWorkload(), rounds);
+    runWorkload(buildCommands, commandsWorkload(), rounds);
+    return 0;
+}
@@ -0,0 +1,84 @@
+/**
+ * Benchmark: ordered (PEG) choice versus longest match
+ *
+ * Longest match keeps trying the viable branches of an alternative after
+ * one has matched; ordered choice stops at the first match. The grammars
+ * below list their most specific branches first, so both modes accept
+ * the same bytes and only the work differs. Linked grammar, recursive
+ * engine, parse()+delete and recognize().
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+
+// Statements whose branches share a leading identifier
+static void buildStatements(Grammar& g) {
+    g.addRule("<ident> ::= ( 'a' ... 'z' ) { ( 'a' ... 'z' '0' ... '9' '_' ) }");
+    g.addRule("<number> ::= ( '0' ... '9' ) { ( '0' ... '9' ) }");
+    g.addRule("<value> ::= <ident> '(' [ <args> ] ')' | <ident> '[' <value> ']' | <ident> | <number>");
+    g.addRule("<args> ::= <value> { ',' <value> }");
+    g.addRule("<stmt> ::= <ident> '=' <value> ';' | <ident> '+' '=' <value> ';' | <value> ';'");
+    g.addRule("<block> ::= <stmt> { <stmt> }");
+}
+
+static bench::Workload statementsWorkload() {
+    bench::Workload w;
+    w.name = "statements";
+    w.rule = "<block>";
+    w.inputs.push_back("x=f(a,b[i],g(c));y+=x;h(y,z[k[j]]);");
+    w.inputs.push_back("total=sum(items[n],count);print(total);n+=1;");
+    w.inputs.push_back("a=b;c=d(e);f[g]=h;");
+    return w;
+}
+
+static double timeRuns(const BNFParser& parser, const bench::Workload& w, int rounds,
+                       bool tree, size_t& total) {
+    total = 0;
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            size_t consumed = 0;
+            if (tree) delete parser.parse(w.rule, w.inputs[i], consumed);
+            else parser.recognize(w.rule, w.inputs[i], consumed);
+            total += consumed;
+        }
+    }
+    return bench::now() - start;
+}
+
+static void runWorkload(void (*build)(Grammar&), const bench::Workload& w, int rounds) {
+    Grammar g;
+    build(g);
+    const CompiledGrammar& cg = g.finalize();
+    BNFParser longest(cg), ordered(cg);
+    ordered.setOrderedChoice(true);
+    size_t parses = static_cast<size_t>(rounds) * w.inputs.size();
+
+    std::cout << w.name << std::endl;
+    for (int tree = 1; tree >= 0; --tree) {
+        size_t t1 = 0, t2 = 0;
+        double tLongest = timeRuns(longest, w, rounds, tree != 0, t1);
+        double tOrdered = timeRuns(ordered, w, rounds, tree != 0, t2);
+        if (t1 != t2) {
+            std::cerr << "Modes consumed " << t1 << " and " << t2 << " bytes" << std::endl;
+            std::exit(1);
+        }
+        std::cout << (tree ? "  parse()" : "  recognize()") << std::endl;
+        bench::report("  longest match", tLongest, parses);
+        bench::report("  ordered choice", tOrdered, parses);
+        std::cout << "    speedup: " << (tOrdered > 0 ? tLongest / tOrdered : 0.0) << "x" << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::cout << "=== Ordered Choice Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    runWorkload(bench::buildMiniProtocol, bench::miniProtocolWorkload(), rounds);
+    runWorkload(bench::buildHttpRequest, bench::httpRequestWorkload(), rounds);
+    runWorkload(bench::buildNumbers, bench::numbersWorkload(), rounds);
+    runWorkload(buildStatements, statementsWorkload(), rounds);
+    return 0;
+}
@@ -0,0 +1,75 @@
+/**
+ * Benchmark: ParallelParser throughput for 1..N worker threads
+ *
+ * A large batch of independent protocol messages is parsed with a single
+ * BNFParser::parseBatch() call and with ParallelParser at increasing
+ * thread counts. Throughput only scales with the number of cores the
+ * machine actually has; the online core count is printed first.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <sstream>
+#include <unistd.h>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+#include "ParallelParser.hpp"
+
+static void runWorkload(void (*build)(Grammar&), const bench::Workload& w,
+                        size_t copies, size_t maxThreads, int rounds) {
+    Grammar g;
+    build(g);
+    const CompiledGrammar& cg = g.finalize();
+
+    std::vector<std::string> batch;
+    for (size_t k = 0; k < copies; ++k)
+        batch.insert(batch.end(), w.inputs.begin(), w.inputs.end());
+    size_t parses = static_cast<size_t>(rounds) * batch.size();
+
+    BNFParser single(cg);
+    BatchResult out;
+    single.parseBatch(w.rule, batch, out);
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r)
+        single.parseBatch(w.rule, batch, out);
+    double tSingle = bench::now() - start;
+
+    std::cout << w.name << " (" << batch.size() << " inputs per batch)" << std::endl;
+    bench::report("parseBatch(), no pool", tSingle, parses);
+
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        ParallelParser pp(cg, threads);
+        size_t accepted = pp.parseAll(w.rule, batch);
+        if (accepted == 0) {
+            std::cerr << "No input accepted" << std::endl;
+            std::exit(1);
+        }
+        start = bench::now();
+        size_t steals = 0;
+        for (int r = 0; r < rounds; ++r) {
+            pp.parseAll(w.rule, batch);
+            steals += pp.getSteals();
+        }
+        double t = bench::now() - start;
+
+        std::ostringstream label;
+        label << threads << " thread" << (threads > 1 ? "s" : "");
+        bench::report(label.str(), t, parses);
+        std::cout << "    " << static_cast<double>(parses) / t / 1e6 << " M parses/s, "
+                  << "speedup " << (t > 0 ? tSingle / t : 0.0) << "x, "
+                  << steals / static_cast<size_t>(rounds) << " steals/batch" << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 20;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t maxThreads = argc > 2 ? static_cast<size_t>(std::atoi(argv[2]))
+                                 : static_cast<size_t>(cores > 4 ? cores : 4);
+    std::cout << "=== Parallel Parser Benchmark (" << rounds << " rounds, "
+              << cores << " cores online) ===" << std::endl;
+
+    runWorkload(bench::buildMiniProtocol, bench::miniProtocolWorkload(), 5000, maxThreads, rounds);
+    runWorkload(bench::buildHttpRequest, bench::httpRequestWorkload(), 5000, maxThreads, rounds);
+    return 0;
+}
@@ -0,0 +1,65 @@
+/**
+ * Benchmark: recognize() vs. parse()+delete
+ *
+ * Validation-only callers (e.g. IRC nickname checks) need a yes/no answer
+ * and the consumed length. This compares building and deleting the AST
+ * with the recognizer entry point, which creates no nodes.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+
+static void runWorkload(void (*build)(Grammar&), const bench::Workload& w, int rounds) {
+    Grammar g;
+    build(g);
+    BNFParser parser(g.finalize());
+    size_t parses = static_cast<size_t>(rounds) * w.inputs.size();
+
+    for (size_t i = 0; i < w.inputs.size(); ++i) {
+        size_t c1 = 0, c2 = 0;
+        ASTNode* ast = parser.parse(w.rule, w.inputs[i], c1);
+        bool ok = parser.recognize(w.rule, w.inputs[i], c2);
+        if ((ast != 0) != ok || c1 != c2) {
+            std::cerr << "Mismatch on '" << w.inputs[i] << "'" << std::endl;
+            std::exit(1);
+        }
+        delete ast;
+    }
+
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            size_t consumed = 0;
+            delete parser.parse(w.rule, w.inputs[i], consumed);
+        }
+    }
+    double tParse = bench::now() - start;
+
+    start = bench::now();
+    size_t accepted = 0;
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            size_t consumed = 0;
+            if (parser.recognize(w.rule, w.inputs[i], consumed)) ++accepted;
+        }
+    }
+    double tRecognize = bench::now() - start;
+
+    std::cout << w.name << " (" << accepted << " accepted)" << std::endl;
+    bench::report("parse() + delete", tParse, parses);
+    bench::report("recognize()", tRecognize, parses);
+    std::cout << "  speedup: " << (tRecognize > 0 ? tParse / tRecognize : 0.0) << "x" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::cout << "=== Recognizer Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    runWorkload(bench::buildIrcNickname, bench::ircNicknameWorkload(), rounds);
+    runWorkload(bench::buildMiniProtocol, bench::miniProtocolWorkload(), rounds);
+    runWorkload(bench::buildHttpRequest, bench::httpRequestWorkload(), rounds);
+    runWorkload(bench::buildNumbers, bench::numbersWorkload(), rounds);
+    return 0;
+}
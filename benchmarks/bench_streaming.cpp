@@ -0,0 +1,91 @@
+/**
+ * Benchmark: streaming session vs. re-parsing on every chunk
+ *
+ * Messages arrive in small chunks. Without a session a server has to
+ * re-parse the whole buffered message each time a chunk arrives until the
+ * parse succeeds, so the work grows with (message length / chunk size).
+ * A ParseSession resumes where it stopped and touches each byte once.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+#include "ParseSession.hpp"
+
+static void runWorkload(void (*build)(Grammar&), const bench::Workload& w,
+                        size_t chunk, int rounds) {
+    Grammar g;
+    build(g);
+    BNFParser parser(g.finalize());
+    parser.setEngine(BNFParser::ENGINE_ITERATIVE);
+    size_t parses = static_cast<size_t>(rounds) * w.inputs.size();
+
+    // Sanity check: both strategies produce the same tree
+    for (size_t i = 0; i < w.inputs.size(); ++i) {
+        size_t consumed = 0;
+        ASTNode* expected = parser.parse(w.rule, w.inputs[i], consumed);
+        ParseSession session(parser, w.rule);
+        session.feed(w.inputs[i]);
+        ASTNode* streamed = session.takeResult();
+        if (!bench::sameTree(expected, streamed)) {
+            std::cerr << "Mismatch on '" << w.inputs[i] << "'" << std::endl;
+            std::exit(1);
+        }
+        delete expected;
+        delete streamed;
+    }
+
+    double start = bench::now();
+    size_t complete = 0;
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            const std::string& msg = w.inputs[i];
+            std::string buffer;
+            for (size_t off = 0; off < msg.size(); off += chunk) {
+                buffer.append(msg, off, chunk);
+                size_t consumed = 0;
+                ASTNode* ast = parser.parse(w.rule, buffer, consumed);
+                if (ast) {
+                    ++complete;
+                    delete ast;
+                    break;
+                }
+            }
+        }
+    }
+    double tReparse = bench::now() - start;
+
+    ParseSession session(parser, w.rule);
+    start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            const std::string& msg = w.inputs[i];
+            for (size_t off = 0; off < msg.size(); off += chunk) {
+                size_t n = msg.size() - off < chunk ? msg.size() - off : chunk;
+                if (session.feed(msg.data() + off, n) == ParseSession::COMPLETE) {
+                    delete session.takeResult();
+                    break;
+                }
+            }
+        }
+    }
+    double tSession = bench::now() - start;
+
+    std::cout << w.name << " (" << chunk << "-byte chunks, " << complete / static_cast<size_t>(rounds)
+              << " messages)" << std::endl;
+    bench::report("re-parse per chunk", tReparse, parses);
+    bench::report("ParseSession", tSession, parses);
+    std::cout << "  speedup: " << (tSession > 0 ? tReparse / tSession : 0.0) << "x" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 5000;
+    std::cout << "=== Streaming Session Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    // CRLF-terminated messages complete without finish(), as on a live connection
+    runWorkload(bench::buildMiniProtocol, bench::miniProtocolWorkload(), 1, rounds / 4 + 1);
+    runWorkload(bench::buildMiniProtocol, bench::miniProtocolWorkload(), 4, rounds);
+    runWorkload(bench::buildMiniProtocol, bench::miniProtocolWorkload(), 16, rounds);
+    return 0;
+}
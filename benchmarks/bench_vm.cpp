@@ -0,0 +1,65 @@
+/**
+ * Benchmark: Bytecode VM vs. tree-walking interpreter
+ *
+ * Parses the example grammars' inputs repeatedly with BNFParser and with
+ * VMParser, checks that both produce identical trees, and reports the
+ * time per parse for each engine.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+#include "VMParser.hpp"
+
+template <typename Parser>
+static double timeParses(const Parser& parser, const bench::Workload& w, int rounds) {
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            size_t consumed = 0;
+            ASTNode* ast = parser.parse(w.rule, w.inputs[i], consumed);
+            delete ast;
+        }
+    }
+    return bench::now() - start;
+}
+
+static void runWorkload(void (*build)(Grammar&), const bench::Workload& w, int rounds) {
+    Grammar g;
+    build(g);
+    BNFParser tree(g);
+    VMParser vm(g);
+
+    for (size_t i = 0; i < w.inputs.size(); ++i) {
+        size_t c1 = 0, c2 = 0;
+        ASTNode* a = tree.parse(w.rule, w.inputs[i], c1);
+        ASTNode* b = vm.parse(w.rule, w.inputs[i], c2);
+        if (c1 != c2 || !bench::sameTree(a, b)) {
+            std::cerr << "Mismatch on '" << w.inputs[i] << "'" << std::endl;
+            std::exit(1);
+        }
+        delete a;
+        delete b;
+    }
+
+    size_t parses = static_cast<size_t>(rounds) * w.inputs.size();
+    double tTree = timeParses(tree, w, rounds);
+    double tVm = timeParses(vm, w, rounds);
+
+    std::cout << w.name << " (" << vm.getProgram().code.size() << " instructions)" << std::endl;
+    bench::report("tree-walking BNFParser", tTree, parses);
+    bench::report("bytecode VMParser", tVm, parses);
+    std::cout << "  speedup: " << (tVm > 0 ? tTree / tVm : 0.0) << "x" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::cout << "=== Bytecode VM Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    runWorkload(bench::buildMiniProtocol, bench::miniProtocolWorkload(), rounds);
+    runWorkload(bench::buildIrcNickname, bench::ircNicknameWorkload(), rounds);
+    runWorkload(bench::buildHttpRequest, bench::httpRequestWorkload(), rounds);
+    runWorkload(bench::buildNumbers, bench::numbersWorkload(), rounds);
+    return 0;
+}
@@ -0,0 +1,76 @@
+/**
+ * Benchmark: copied vs. zero-copy matched text
+ *
+ * Copy mode stores each node's matched text in ASTNode::matched, so a byte
+ * is copied once per tree level above it. Zero-copy mode records only the
+ * [begin, end) span. The nested-list workload makes the tree deep enough
+ * for the copying to dominate.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include "BenchCommon.hpp"
+#include "BNFParser.hpp"
+
+static double timeParses(const BNFParser& parser, const bench::Workload& w, int rounds) {
+    double start = bench::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < w.inputs.size(); ++i) {
+            size_t consumed = 0;
+            delete parser.parse(w.rule, w.inputs[i], consumed);
+        }
+    }
+    return bench::now() - start;
+}
+
+static void runWorkload(void (*build)(Grammar&), const bench::Workload& w, int rounds) {
+    Grammar g;
+    build(g);
+    const CompiledGrammar& cg = g.finalize();
+    BNFParser copying(cg);
+    BNFParser zc(cg);
+    zc.setZeroCopy(true);
+    zc.setEngine(BNFParser::ENGINE_ITERATIVE);
+    copying.setEngine(BNFParser::ENGINE_ITERATIVE);
+
+    size_t parses = static_cast<size_t>(rounds) * w.inputs.size();
+    double tCopy = timeParses(copying, w, rounds);
+    double tZero = timeParses(zc, w, rounds);
+
+    std::cout << w.name << std::endl;
+    bench::report("copied matched text", tCopy, parses);
+    bench::report("zero-copy spans", tZero, parses);
+    std::cout << "  speedup: " << (tZero > 0 ? tCopy / tZero : 0.0) << "x" << std::endl;
+}
+
+// Right-recursive list: every item adds three tree levels
+static void buildNestedList(Grammar& g) {
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<item> ::= <digit> { <digit> }");
+    g.addRule("<list> ::= <item> [ ',' <list> ]");
+}
+
+static bench::Workload nestedListWorkload() {
+    bench::Workload w;
+    w.name = "nested-list (500 items)";
+    w.rule = "<list>";
+    std::ostringstream oss;
+    for (int i = 0; i < 500; ++i) {
+        if (i) oss << ',';
+        oss << 1000 + i;
+    }
+    w.inputs.push_back(oss.str());
+    return w;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 20000;
+    std::cout << "=== Zero-Copy AST Benchmark (" << rounds << " rounds) ===" << std::endl;
+
+    runWorkload(bench::buildMiniProtocol, bench::miniProtocolWorkload(), rounds);
+    runWorkload(bench::buildIrcNickname, bench::ircNicknameWorkload(), rounds);
+    runWorkload(bench::buildHttpRequest, bench::httpRequestWorkload(), rounds);
+    runWorkload(buildNestedList, nestedListWorkload(), rounds / 100 + 1);
+    return 0;
+}
@@ -14,8 +14,13 @@
  */
 struct ASTNode {
     std::string symbol;                 ///< Symbol name or node type
-    std::string matched;                ///< Text matched by this node
+    std::string matched;                ///< Text matched by this node (empty in zero-copy parses)
     std::vector<ASTNode*> children;     ///< Child nodes in the parse tree
+    bool pooled;                        ///< Owned by an Arena or a parser's batch pool
+    unsigned refs;                      ///< Owners of a shared heap node besides the first
+    size_t begin;                       ///< Offset of the match in *source
+    size_t end;                         ///< Offset one past the match in *source
+    const std::string* source;          ///< Parsed input of a zero-copy node, otherwise null
 
     /**
      * @brief Constructs an AST node with the given symbol name.
@@ -24,7 +29,21 @@ struct ASTNode {
     ASTNode(const std::string& s);
 
     /**
-     * @brief Destructor that recursively deletes all child nodes.
+     * @brief Returns the text matched by this node.
+     *
+     * Zero-copy nodes read the [begin, end) span of the parsed input,
+     * which must still be alive; other nodes return `matched`.
+     * @return Copy of the matched text
+     */
+    std::string text() const;
+
+    /**
+     * @brief Destructor that deletes the whole subtree.
+     *
+     * Descendants are released with an explicit worklist, so deeply
+     * nested trees do not exhaust the call stack. Pooled nodes never
+     * release their children; the owning Arena or pool destroys every node.
+     * A descendant with other owners (`refs`) loses one owner instead.
      */
     ~ASTNode();
 };
@@ -9,22 +9,48 @@
  *
  * Allocations are not individually freed; memory is released when the arena
  * is destroyed or reset(). Suitable for AST/Expression lifetimes.
+ *
+ * Objects that own heap memory of their own can register a cleanup
+ * function, which runs (in reverse registration order) on reset() and on
+ * destruction. reset() keeps the blocks for reuse.
  */
 class Arena {
 public:
+    /// Cleanup callback invoked with the registered object.
+    typedef void (*Cleanup)(void* object);
+
     explicit Arena(std::size_t blockSize = 4096);
     ~Arena();
 
     void* allocate(std::size_t size, std::size_t alignment = sizeof(void*));
 
+    /**
+     * @brief Registers a cleanup to run before the memory is recycled.
+     * @param fn Function to call
+     * @param object Argument passed to fn
+     */
+    void addCleanup(Cleanup fn, void* object);
+
     void reset();
 
+    /**
+     * @brief Returns the total size of all blocks owned by the arena.
+     */
+    std::size_t capacity() const;
+
 private:
     struct Block { char* data; std::size_t used; std::size_t size; };
+    struct CleanupEntry { Cleanup fn; void* object; };
     std::vector<Block> blocks;
+    std::vector<CleanupEntry> cleanups;
+    std::size_t current;          ///< Index of the block being filled
     std::size_t defaultBlockSize;
 
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+
     void addBlock(std::size_t minSize);
+    void runCleanups();
 };
 
 #endif // ARENA_HPP
@@ -2,9 +2,23 @@
 #define BNF_PARSER_HPP
 
 #include "Grammar.hpp"
+#include "CompiledGrammar.hpp"
 #include "AST.hpp"
+#include "Arena.hpp"
+#include "BatchResult.hpp"
+#include "ByteRun.hpp"
+#include "Dfa.hpp"
+#include "DispatchTable.hpp"
+#include "EarleyChart.hpp"
+#include "FirstPairs.hpp"
+#include "FirstSets.hpp"
+#include "KeywordTrie.hpp"
+#include "LalrTable.hpp"
+#include "LL1Analysis.hpp"
+#include "OperatorTable.hpp"
 #include <string>
 #include <map>
+#include <vector>
 #include <bitset>
 
 /**
@@ -13,15 +27,84 @@
  * Takes a grammar and input text, then attempts to parse the input according
  * to the grammar rules, producing an AST representing the parsed structure.
  * Uses recursive descent parsing with backtracking for alternatives.
+ *
+ * Left-recursive rules (`<expr> ::= <expr> '+' <term> | <term>`) are
+ * grown from a seed: a call that reaches its own rule again at the same
+ * position gets the rule's best match so far, starting with failure, and
+ * the body is parsed again until the match stops getting longer. Those
+ * later rounds only try the branches that can call the rule first, so the
+ * branches that do not recurse are parsed once.
+ *
+ * Optionally runs in packrat mode: the result of every (rule, position)
+ * pair is memoized for the duration of one parse() call, so that a rule
+ * retried by an enclosing alternative is never parsed twice at the same
+ * offset. A hit shares the stored subtree instead of copying it, so a
+ * memoized parse does linear work and a tree may hold a node twice (heap
+ * nodes count their owners, see ASTNode::refs). The memo table is bounded by a configurable byte budget.
+ *
+ * When built from a CompiledGrammar (or from a Grammar that has already
+ * been finalized) the parser reads symbol targets, decoded literals and
+ * FIRST sets straight from the linked expression nodes. Several parsers
+ * may then share one grammar across threads, one parser per thread.
+ *
+ * Two engines produce the same AST: the default recursive descent engine,
+ * and an iterative engine that keeps its continuation state in a reusable
+ * heap stack of frames. The iterative engine is independent of the thread
+ * stack size and can enforce a maximum nesting depth. Two more engines
+ * work from tables built on first use: Earley accepts any context-free
+ * grammar (see ENGINE_EARLEY), and an LALR(1) shift-reduce parser runs
+ * in linear time without backtracking (see ENGINE_LALR).
  */
 class BNFParser {
 public:
+    /**
+     * @brief Counters collected across parse() calls until resetStats().
+     */
+    struct ParseStats {
+        size_t memoHits;       ///< Rule results served from the memo table
+        size_t memoMisses;     ///< Memoized rules that had to be parsed
+        size_t memoStores;     ///< Results recorded in the memo table
+        size_t memoRejected;   ///< Results dropped because the memo cap was reached
+        size_t memoPeakBytes;  ///< Largest memo footprint reached by one parse
+        size_t peakDepth;      ///< Deepest frame stack of the iterative engine
+        size_t depthAborts;    ///< Parses aborted by the depth limit
+        size_t pairPrunes;     ///< Branches that passed FIRST but were skipped by FIRST_2
+        size_t predictions;    ///< Decisions taken by LL(1) prediction
+        size_t earleyItems;    ///< Items added to Earley charts
+        size_t reductions;     ///< Reductions done by the LALR(1) engine
+        size_t seedGrowths;    ///< Times a left-recursive rule's match grew
+        size_t climbs;         ///< Operators read by precedence climbing
+        size_t nodesBuilt;     ///< AST nodes created, including those of losing branches
+        size_t decisions;      ///< Choices replayed by two-phase parses
+
+        ParseStats();
+    };
+
+    /**
+     * @brief Parsing engine selected with setEngine().
+     */
+    enum Engine {
+        ENGINE_RECURSIVE,   ///< Recursive descent on the C++ call stack
+        ENGINE_ITERATIVE,   ///< Explicit, heap-allocated frame stack
+        ENGINE_EARLEY,      ///< Earley chart parser (see EarleyChart)
+        ENGINE_LALR         ///< Shift-reduce parser over LALR(1) tables (see LalrTable)
+    };
+
+    /// Default byte budget of the packrat memo table.
+    static const size_t DEFAULT_MEMO_LIMIT = 16 * 1024 * 1024;
+
     /**
      * @brief Constructs a parser for the given grammar.
      * @param g The grammar containing the parsing rules
      */
     BNFParser(const Grammar& g);
 
+    /**
+     * @brief Constructs a parser over a linked grammar.
+     * @param cg The result of Grammar::finalize()
+     */
+    explicit BNFParser(const CompiledGrammar& cg);
+
     /**
      * @brief Destructor for cleanup.
      */
@@ -38,15 +121,455 @@ public:
 				const std::string& input,
 				size_t& consumed) const;
 
+    /**
+     * @brief Parses input with the given engine for this call only.
+     *
+     * ENGINE_EARLEY accepts every context-free grammar, including left
+     * recursion (`<expr> ::= <expr> '+' <term>`) and ambiguity, in at most
+     * cubic time and linear time on most unambiguous grammars. It matches
+     * the longest prefix the rule derives, where backtracking may fail
+     * instead (e.g. `{ 'a' } 'a'` on "aa"). The AST has the same node
+     * shapes; an ambiguous input yields one of its trees (see
+     * EarleyChart). Ordered choice, prediction, memoization, DFAs, run
+     * collapsing and the depth limit do not apply to it, and streaming
+     * sessions always use the iterative engine.
+     *
+     * ENGINE_LALR parses in linear time with one stack entry per pending
+     * symbol and no backtracking. On a grammar without LALR(1) conflicts
+     * (see LalrTable::report()) it builds the tree the other engines build
+     * whenever the whole match is unambiguous. Where a conflict was
+     * resolved, the parse follows the resolution; if that makes it reduce
+     * in a loop (hidden left recursion, `<c> ::= <c> | 'a'`), the loop is
+     * cut off as if the byte had no action. It accepts the longest prefix
+     * up to the first byte that cannot continue a match, and does not
+     * fall back to shorter ones: `'x' | 'x' 'y' 'z'` fails on "xy".
+     * The same options as for ENGINE_EARLEY do not apply.
+     * @param ruleName Name of the grammar rule to use as starting point
+     * @param input The text to parse
+     * @param consumed Output parameter for the number of characters consumed
+     * @param e Engine for this call; setEngine() is unaffected
+     * @return Pointer to the root AST node, or nullptr if parsing failed
+     */
+    ASTNode* parse(const std::string& ruleName,
+                   const std::string& input,
+                   size_t& consumed,
+                   Engine e) const;
+
+    /**
+     * @brief Parses input, allocating the whole AST from an arena.
+     *
+     * Nodes are constructed in @p arena and registered for cleanup, so the
+     * tree (including discarded alternatives) is released by a single
+     * arena.reset() or by destroying the arena. The returned tree must not
+     * be deleted.
+     * @param ruleName Name of the grammar rule to use as starting point
+     * @param input The text to parse
+     * @param consumed Output parameter for the number of characters consumed
+     * @param arena Storage for the AST nodes
+     * @return Pointer to the root AST node, or nullptr if parsing failed
+     */
+    ASTNode* parse(const std::string& ruleName,
+                   const std::string& input,
+                   size_t& consumed,
+                   Arena& arena) const;
+
+    /**
+     * @brief Checks whether input matches a rule without building an AST.
+     *
+     * Runs the same grammar semantics as parse() with the selected engine
+     * but creates no nodes. With a finalized grammar and memoization off,
+     * a recognize() call performs no heap allocation once the parser's
+     * internal stacks and caches have grown to the needed size.
+     * @param ruleName Name of the grammar rule to use as starting point
+     * @param input The text to check
+     * @param consumed Output parameter for the number of characters consumed
+     * @return true if the rule matched a prefix of the input
+     */
+    bool recognize(const std::string& ruleName,
+                   const std::string& input,
+                   size_t& consumed) const;
+
+    /**
+     * @brief Checks whether input matches a rule with the given engine.
+     * @param ruleName Name of the grammar rule to use as starting point
+     * @param input The text to check
+     * @param consumed Output parameter for the number of characters consumed
+     * @param e Engine for this call; setEngine() is unaffected
+     * @return true if the rule matched a prefix of the input
+     */
+    bool recognize(const std::string& ruleName,
+                   const std::string& input,
+                   size_t& consumed,
+                   Engine e) const;
+
+    /**
+     * @brief Parses many inputs with the same start rule.
+     *
+     * The rule is looked up once, and the parser's scratch stacks and node
+     * storage are reused from one input to the next. Trees are returned
+     * flattened into @p out (see BatchResult), as spans into the inputs,
+     * so the inputs must stay alive while the spans are read. Options such
+     * as the engine and memoization apply as for parse().
+     * @param ruleName Name of the grammar rule to use as starting point
+     * @param inputs First of @p count inputs
+     * @param count Number of inputs
+     * @param out Receives one entry per input, in input order
+     * @return Number of inputs that matched
+     */
+    size_t parseBatch(const std::string& ruleName,
+                      const std::string* inputs,
+                      size_t count,
+                      BatchResult& out) const;
+    size_t parseBatch(const std::string& ruleName,
+                      const std::vector<std::string>& inputs,
+                      BatchResult& out) const;
+
+    /**
+     * @brief Enables or disables packrat memoization for all rules.
+     * @param enabled true to memoize rule results (default: false)
+     */
+    void setMemoization(bool enabled);
+
+    /**
+     * @brief Sets the byte budget of the memo table.
+     *
+     * Once a parse reaches the budget, further results are no longer
+     * recorded (they are counted in ParseStats::memoRejected). The budget
+     * covers memo entries, the per-position index and the choices kept for
+     * two-phase parsing; stored subtrees are part of the tree being built.
+     * @param bytes Maximum memo footprint per parse() call
+     */
+    void setMemoLimit(size_t bytes);
+
+    /**
+     * @brief Overrides memoization for a single rule.
+     *
+     * Allows opting a rule in while global memoization is off, or opting
+     * a cheap rule out while it is on.
+     * @param ruleName Name of the rule (e.g. "<word>")
+     * @param enabled true to memoize the rule, false to never memoize it
+     */
+    void setRuleMemoization(const std::string& ruleName, bool enabled);
+
+    /**
+     * @brief Switches all alternatives to ordered (PEG) choice.
+     *
+     * By default an alternative tries every viable branch and keeps the
+     * longest match. With ordered choice the first branch that matches
+     * wins and the branches after it are not evaluated, which can change
+     * the result: `'a' | 'a' 'b'` then matches only "a" of "ab".
+     * @param enabled true for ordered choice (default: false, longest match)
+     */
+    void setOrderedChoice(bool enabled);
+
+    /**
+     * @brief Overrides the choice semantics for the alternatives of one rule.
+     *
+     * Applies to the alternatives written in the rule's own body, not to
+     * the rules it references. An alternative that an interned grammar
+     * shares between rules follows the first of those rules.
+     * @param ruleName Name of the rule (e.g. "<command>")
+     * @param enabled true for ordered choice, false for longest match
+     */
+    void setRuleOrderedChoice(const std::string& ruleName, bool enabled);
+
+    /**
+     * @brief Selects the parsing engine.
+     * @param e Engine to use for subsequent parse() calls (default: ENGINE_RECURSIVE)
+     */
+    void setEngine(Engine e);
+
+    /**
+     * @brief Returns the selected parsing engine.
+     */
+    Engine getEngine() const;
+
+    /**
+     * @brief Limits the frame stack of the iterative engine.
+     *
+     * Every grammar construct being matched occupies one frame. A parse
+     * that would exceed the limit is aborted, reported on std::cerr and
+     * counted in ParseStats::depthAborts; parse() then returns nullptr.
+     * @param frames Maximum number of frames, or 0 for no limit (default)
+     */
+    void setMaxDepth(size_t frames);
+
+    /**
+     * @brief Enables zero-copy ASTs.
+     *
+     * Every node records the [begin, end) offsets of its match. In
+     * zero-copy mode ASTNode::matched is left empty and nodes point at the
+     * parsed input instead (ASTNode::source); ASTNode::text() then reads
+     * the span on demand, so the input string must outlive the tree.
+     * @param enabled true to skip filling ASTNode::matched (default: false)
+     */
+    void setZeroCopy(bool enabled);
+
+    /**
+     * @brief Reports runs of a single byte class as one node.
+     *
+     * A repetition whose body always matches exactly one byte from a
+     * fixed class (e.g. `{ <text-char> }` with `<text-char> ::= ( 0x21 ...
+     * 0x7E )`) is then matched with one vectorized scan (see ByteRun) and
+     * yields a single `<char-run>` leaf spanning the run, instead of a
+     * `<rep>` node with a subtree per byte. recognize() always scans runs.
+     * @param enabled true to collapse runs (default: false)
+     */
+    void setCollapseRuns(bool enabled);
+
+    /**
+     * @brief Selects alternative branches through byte-indexed tables.
+     *
+     * An alternative with at least DispatchTable::MIN_BRANCHES branches
+     * then looks up the branches whose FIRST set holds the lookahead byte,
+     * instead of testing every branch. Linked grammars carry the tables
+     * (see CompiledGrammar); otherwise they are built on first use.
+     * @param enabled true to use dispatch tables (default: true)
+     */
+    void setDispatch(bool enabled);
+
+    /**
+     * @brief Matches alternatives made only of literals through a trie.
+     *
+     * An alternative of at least KeywordTrie::MIN_KEYWORDS terminal
+     * branches (e.g. `'PRIVMSG' | 'NOTICE' | 'JOIN' | ...`) then finds its
+     * longest matching literal in one pass over the input, instead of
+     * comparing each literal in turn. The result and tree are unchanged.
+     * @param enabled true to use keyword tries (default: true)
+     */
+    void setKeywordTries(bool enabled);
+
+    /**
+     * @brief Matches regular rules with their DFA where no subtree is needed.
+     *
+     * Rules that CompiledGrammar compiled to a Dfa (see
+     * CompiledGrammar::getRegularRules()) are then scanned in one pass by
+     * recognize(), and by parse() with setCollapseRegular(). Streaming
+     * sessions and unlinked grammars always use the rule bodies.
+     * @param enabled true to use DFAs (default: true)
+     */
+    void setRegularDfa(bool enabled);
+
+    /**
+     * @brief Reports each regular rule as one leaf.
+     *
+     * parse() then scans a rule that has a Dfa and yields a node named
+     * after the rule, spanning its match, with no children. The consumed
+     * length is the same as with the full subtree.
+     * @param enabled true to collapse regular rules (default: false)
+     */
+    void setCollapseRegular(bool enabled);
+
+    /**
+     * @brief Prunes alternative branches on the next two bytes (FIRST_2).
+     *
+     * A branch that passes the one-byte FIRST test is then also skipped
+     * when no match of it can start with the next two input bytes, e.g.
+     * `'NOTICE'` on "NICK". The analysis (see FirstPairs) runs on first
+     * use. Skipped branches are counted in ParseStats::pairPrunes.
+     * @param enabled true to use FIRST_2 (default: false)
+     */
+    void setFirstPairs(bool enabled);
+
+    /**
+     * @brief Parses LL(1) decision points predictively.
+     *
+     * Alternatives, optionals and repetitions that LL1Analysis classifies
+     * as deterministic then take the one way the lookahead byte selects,
+     * without trying the others. The choice is committed: when the
+     * selected branch or body fails, the construct fails instead of falling
+     * back to another branch or to the empty match. Conflicting points
+     * keep backtracking. When the whole grammar is LL(1) (see
+     * LL1Analysis::isLL1()), input that the start rule matches as a whole
+     * gives the same tree as with backtracking; otherwise, and on malformed
+     * input, a committed failure can change the result, e.g. fail where
+     * backtracking would accept a shorter prefix. In this mode
+     * rules are never scanned by their Dfa, and streaming sessions always
+     * backtrack. Decisions taken are counted in ParseStats::predictions.
+     * @param enabled true for predictive parsing (default: false)
+     */
+    void setPredictive(bool enabled);
+
+    /**
+     * @brief Build the tree in a second pass from the choices of a first.
+     *
+     * parse() with the recursive engine then recognizes the input first,
+     * creating no nodes and logging only the choices that won: the branch
+     * of each alternative that backtracks, whether each optional matched,
+     * the iteration count of each repetition, the operator of each
+     * precedence-climbing step and the growth rounds of each
+     * left-recursive call. A second pass replays that log and allocates
+     * exactly the nodes of the final tree, so the subtrees of losing
+     * branches and failed sequences are never built. The tree is the one
+     * parse() builds otherwise. This pays when inputs backtrack a lot, at
+     * the cost of matching the winning path twice. ParseStats counts the
+     * work of both passes, and ParseStats::decisions the choices replayed.
+     * recognize(), the other engines and streaming sessions are unchanged.
+     * @param enabled true to parse in two passes (default: false)
+     */
+    void setTwoPhase(bool enabled);
+
+    /**
+     * @brief Returns the counters accumulated since the last resetStats().
+     */
+    const ParseStats& getStats() const;
+
+    /**
+     * @brief Clears all accumulated counters.
+     */
+    void resetStats();
+
 private:
-    struct FirstInfo {
-        std::bitset<256> chars;
-        bool nullable;
-        FirstInfo() : nullable(false) {}
+    /**
+     * @brief Memoized outcome of one rule at one input position.
+     */
+    struct MemoEntry {
+        const Rule* rule;   ///< Rule that was parsed
+        bool ok;            ///< Whether the rule matched
+        size_t end;         ///< Position after the match
+        ASTNode* node;      ///< Resulting subtree, shared with the trees that use it
+        size_t logBegin;    ///< Two-phase recording: first choice in memoChoices
+        size_t logCount;    ///< Two-phase recording: number of choices of the match
+        MemoEntry* next;    ///< Next entry recorded at the same position
+    };
+
+    /**
+     * @brief Continuation of one construct in the iterative engine.
+     */
+    struct Frame {
+        Expression* expr;   ///< Construct being matched
+        const Rule* rule;   ///< Resolved rule (EXPR_SYMBOL)
+        bool memo;          ///< Whether the rule result is memoized
+        bool any;           ///< Whether a branch matched (EXPR_ALTERNATIVE)
+        bool committed;     ///< Choice made by LL(1) prediction, no fallback
+        bool grows;         ///< The rule is left-recursive and grows from a seed (EXPR_SYMBOL)
+        size_t start;       ///< Position where the construct began
+        size_t index;       ///< Current child or branch
+        size_t mark;        ///< Best end (alternative), iteration start (repeat) or heads below the rule (symbol)
+        size_t low;         ///< Caller's lowest seed used, saved while the rule runs (EXPR_SYMBOL)
+        ASTNode* node;      ///< Partial node, or best branch of an alternative
+    };
+
+    /**
+     * @brief Left-recursive rule being grown from a seed at one position.
+     */
+    struct GrowEntry {
+        const Rule* rule;   ///< Rule being grown
+        size_t start;       ///< Position of the call
+        bool ok;            ///< Whether the seed matched
+        size_t end;         ///< End of the seed
+        ASTNode* node;      ///< Seed tree, handed to calls of the rule at `start`
+    };
+
+    /**
+     * @brief Operator read by precedence climbing whose right operand is
+     * not complete yet.
+     */
+    struct ClimbOp {
+        const OperatorTable::Operator* op; ///< Operator and its level
+        size_t begin;       ///< Position of the operator's text
+    };
+
+    /**
+     * @brief Entry of the LALR(1) engine's stack: one shifted byte or
+     * reduced symbol.
+     */
+    struct LalrEntry {
+        unsigned state;     ///< State reached after this entry
+        bool open;          ///< `node` is a repetition whose span is still growing
+        size_t begin;       ///< Start of the entry's span
+        ASTNode* node;      ///< Node of the symbol, or null
+    };
+
+    /**
+     * @brief Cached run scanner of one repetition.
+     */
+    struct RunInfo {
+        bool eligible;      ///< The body is a single byte class
+        ByteRun run;        ///< Scanner for that class
+        RunInfo() : eligible(false) {}
     };
 
     const Grammar& grammar;  ///< Reference to the grammar rules
-    mutable std::map<Expression*, FirstInfo> firstCache; ///< FIRST-set memo
+    const CompiledGrammar* compiled; ///< Linked grammar, or null for lazy lookups
+    mutable FirstSets* firstSets; ///< FIRST sets of an unlinked grammar, created on first use
+    mutable std::map<const Expression*, RunInfo> runCache; ///< Run scanners of an unlinked grammar
+    mutable std::map<const Expression*, DispatchTable> dispatchCache; ///< Tables of an unlinked grammar
+    mutable std::map<const Expression*, KeywordTrie> keywordCache; ///< Tries of an unlinked grammar
+
+    bool memoEnabled;                              ///< Global packrat switch
+    size_t memoLimit;                              ///< Memo byte budget per parse
+    std::map<std::string, bool> memoOverrides;     ///< Per-rule opt-in/opt-out
+    mutable std::map<const Rule*, bool> memoDecisions; ///< Resolved per-rule switch
+    mutable std::vector<MemoEntry*> memoTable;     ///< Entries indexed by position
+    mutable Arena memoArena;                       ///< Storage for memo entries
+    mutable size_t memoBytes;                      ///< Current memo footprint
+    mutable ParseStats stats;                      ///< Accumulated counters
+
+    bool orderedEnabled;                           ///< Global ordered-choice switch
+    std::map<std::string, bool> orderedOverrides;  ///< Per-rule ordered/longest choice
+    mutable std::map<const Expression*, bool> orderedDecisions; ///< Resolved per-alternative switch
+    mutable bool orderedResolved;                  ///< orderedDecisions is filled
+
+    Engine engine;                                 ///< Selected engine (setEngine())
+    size_t maxDepth;                               ///< Frame limit (0 = none)
+    mutable std::vector<Frame> frames;             ///< Iterative engine stack
+    mutable std::vector<ASTNode*> childStack;      ///< Children of open sequences/repetitions
+    mutable std::vector<GrowEntry> growing;        ///< Left-recursive calls being grown, innermost last
+    mutable size_t growLow;                        ///< Lowest head whose seed the current rule used
+    mutable std::vector<const ASTNode*> seedSearch; ///< Worklist of holdsNode()
+    mutable std::map<const Rule*, Expression*> entryCalls; ///< Calls of left-recursive start rules
+    mutable std::map<const Rule*, Expression*> seedBodies; ///< Growth bodies of an unlinked grammar
+    mutable std::vector<ASTNode*> climbOperands;   ///< Operands of open operator rules
+    mutable std::vector<ClimbOp> climbOps;         ///< Operators of open operator rules
+    mutable Arena* astArena;                       ///< AST storage of the current parse, or null
+    bool zeroCopy;                                 ///< Leave ASTNode::matched empty
+    bool collapseRuns;                             ///< Single-class repetitions as one node
+    bool dispatch;                                 ///< Use DispatchTable for large alternatives
+    bool keywordTries;                             ///< Use KeywordTrie for literal alternatives
+    bool regularDfa;                               ///< Use Rule::dfa where no subtree is needed
+    bool collapseRegular;                          ///< Regular rules as one leaf in parse()
+    bool pairPruning;                              ///< Skip branches on FIRST_2
+    mutable FirstPairs* pairAnalysis;              ///< FIRST_2 analysis, created on first use
+    bool predictive;                               ///< Take LL(1) decisions without backtracking
+    mutable LL1Analysis* ll1;                      ///< LL(1) analysis, created on first use
+    mutable EarleyChart* earley;                   ///< Earley engine, created on first use
+    mutable std::vector<EarleyChart::Step> earleySteps; ///< Derivation of the current Earley parse
+    mutable std::vector<ASTNode*> earleyNodes;     ///< Node built for each derivation step
+    mutable LalrTable* lalr;                       ///< LALR(1) tables, created on first use
+    mutable std::vector<LalrEntry> lalrStack;      ///< Shift-reduce stack of the current parse
+    mutable bool noTree;                           ///< recognize(): create no nodes
+    bool twoPhase;                                 ///< parse(): build from a logged first pass
+    mutable bool recording;                        ///< First pass of a two-phase parse
+    mutable bool replaying;                        ///< Second pass: choices come from decisionLog
+    mutable std::vector<size_t> decisionLog;       ///< Winning choices, in preorder of the tree
+    mutable size_t replayAt;                       ///< Next choice to replay
+    mutable std::vector<size_t> memoChoices;       ///< Choices of the memoized matches
+    mutable bool streaming;                        ///< A ParseSession is running the engine
+    mutable bool streamOpen;                       ///< More input may follow (ParseSession)
+    mutable std::vector<ASTNode*> nodePool;        ///< parseBatch() node storage
+    mutable size_t poolUsed;                       ///< Pool nodes handed out for this input
+    mutable bool batching;                         ///< parseBatch(): record spans only
+
+    friend class ParseSession;
+
+    /**
+     * @brief Outcome of one run of the iterative engine loop.
+     */
+    enum RunState {
+        RUN_DONE,        ///< The start construct finished (result in ok/node)
+        RUN_SUSPENDED,   ///< A leaf needs more input (streaming only)
+        RUN_ABORTED      ///< The depth limit was exceeded
+    };
+
+    BNFParser(const BNFParser&);
+    BNFParser& operator=(const BNFParser&);
+
+    bool run(const std::string& ruleName, const std::string& input,
+             size_t& consumed, ASTNode*& root, Engine e) const;
+    bool runRule(const Rule* r, const std::string& input,
+                 size_t& consumed, ASTNode*& root, Engine e) const;
+    const Rule* findRule(const std::string& ruleName) const;
 
     /**
      * @brief Removes surrounding quotes from a string.
@@ -120,6 +643,65 @@ private:
                           size_t& pos,
                           ASTNode*& outNode) const;
 
+    /**
+     * @brief Parses an alternative whose branches share a leading prefix.
+     *
+     * The prefix (Expression::factorPrefix elements) is matched once and
+     * only the remaining elements are tried per branch. The tree is built
+     * as parseAlternative() would build it.
+     * @param expr The alternative expression to parse
+     * @param input The input text
+     * @param pos Current position in input (updated during parsing)
+     * @param outNode Output parameter for the generated AST node
+     * @return true if parsing succeeded, false otherwise
+     */
+    bool parseFactored(Expression* expr,
+                       const std::string& input,
+                       size_t& pos,
+                       ASTNode*& outNode) const;
+
+    /**
+     * @brief Parses an LL(1) alternative through its predicted branch.
+     *
+     * No other branch is tried; the tree is built as parseAlternative()
+     * would build it.
+     * @param expr The alternative expression to parse
+     * @param branch Branch selected by the lookahead, or LL1Analysis::NONE
+     * @param input The input text
+     * @param pos Current position in input (updated during parsing)
+     * @param outNode Output parameter for the generated AST node
+     * @return true if the predicted branch matched, false otherwise
+     */
+    bool parsePredicted(Expression* expr,
+                        size_t branch,
+                        const std::string& input,
+                        size_t& pos,
+                        ASTNode*& outNode) const;
+
+    /**
+     * @brief Matches an alternative of literals with its KeywordTrie.
+     *
+     * Builds the `<alt>` node over the winning terminal exactly as
+     * parseAlternative() would.
+     * @param expr The alternative expression to parse
+     * @param trie Trie of the alternative's literals
+     * @param ordered true for the first matching literal, false for the longest
+     * @param input The input text
+     * @param pos Current position in input (updated during parsing)
+     * @param outNode Output parameter for the generated AST node
+     * @return true if a literal matched, false otherwise
+     */
+    bool matchKeyword(Expression* expr,
+                      const KeywordTrie* trie,
+                      bool ordered,
+                      const std::string& input,
+                      size_t& pos,
+                      ASTNode*& outNode) const;
+
+    // Choice semantics of an alternative
+    bool orderedChoice(const Expression* alt) const;
+    void resolveOrdered(const Expression* expr, bool ordered) const;
+
     /**
      * @brief Parses optional expressions (zero or one occurrence).
      * @param expr The optional expression to parse
@@ -172,11 +754,101 @@ private:
                         size_t& pos,
                         ASTNode*& outNode) const;
 
-    // FIRST-set computation with memoization
-    const FirstInfo& computeFirst(Expression* expr) const;
-    void mergeFirst(FirstInfo& dst, const FirstInfo& src) const;
-    void addChar(FirstInfo& fi, unsigned char c) const;
-    std::string terminalFirstString(Expression* expr) const;
+    // AST node allocation (heap or astArena)
+    ASTNode* newNode(const std::string& symbol) const;
+    ASTNode* cloneNode(const ASTNode* node) const;
+    ASTNode* shareNode(ASTNode* node) const;
+    void discard(ASTNode* node) const;
+    bool byteClass(Expression* expr, std::bitset<256>& out, int depth) const;
+    const ByteRun* runClass(Expression* repeat) const;
+    bool matchRun(Expression* expr, const std::string& input,
+                  size_t& pos, ASTNode*& outNode) const;
+    ASTNode* poolNode(const std::string& symbol) const;
+    void attach(ASTNode* parent, ASTNode* child) const;
+    void setSpan(ASTNode* node, const std::string& input,
+                 size_t begin, size_t end) const;
+
+    // Earley engine
+    bool parseEarley(const Rule* r, const std::string& input,
+                     size_t& pos, ASTNode*& outNode) const;
+    ASTNode* spanNode(const Expression* expr, const std::string& input,
+                      size_t begin, size_t end) const;
+
+    // LALR(1) engine
+    bool parseLalr(const Rule* r, const std::string& input,
+                   size_t& pos, ASTNode*& outNode) const;
+    ASTNode* reduceLalr(const LalrTable::Production& prod, size_t base,
+                        const std::string& input, size_t pos) const;
+    void closeLalr(size_t at, const std::string& input, size_t end) const;
+
+    // Iterative engine
+    bool parseIterative(Expression* root,
+                        const std::string& input,
+                        size_t& pos,
+                        ASTNode*& outNode) const;
+    RunState runFrames(const std::string& input, size_t& pos,
+                       Expression*& callee, bool& calling,
+                       bool& ok, ASTNode*& node) const;
+    RunState resumeStream(std::vector<Frame>& stack, std::vector<GrowEntry>*& heads,
+                          bool open, const std::string& input, size_t& pos,
+                          Expression*& callee, bool& calling,
+                          bool& ok, ASTNode*& node) const;
+    bool needsInput(const Expression* expr, const std::string& input, size_t pos) const;
+    bool startFrame(Expression* expr, const std::string& input, size_t& pos,
+                    Expression*& callee, bool& ok, ASTNode*& node) const;
+    bool resumeFrame(const std::string& input, size_t& pos,
+                     Expression*& callee, bool& ok, ASTNode*& node) const;
+    bool nextBranch(Frame& f, const std::string& input) const;
+    bool branchViable(Expression* branch, bool hasChar, unsigned char look) const;
+    bool pairViable(Expression* branch, const std::string& input, size_t pos) const;
+    const LL1Analysis::Decision* prediction(const Expression* expr) const;
+    const DispatchTable* dispatchTable(Expression* alt) const;
+    const KeywordTrie* keywordTrie(Expression* alt) const;
+    const Dfa* ruleDfa(const Rule* rule) const;
+    bool scanRule(const Dfa* dfa, const std::string& symbol, const std::string& input,
+                  size_t& pos, ASTNode*& outNode) const;
+    void pushFrame(Expression* expr, size_t pos) const;
+    void unwindFrames() const;
+
+    // Seed growing of left-recursive rules
+    bool leftRecursive(const Rule* r) const;
+    size_t growHead(const Rule* r, size_t pos) const;
+    bool useSeed(size_t head, size_t& pos, ASTNode*& outNode) const;
+    void beginGrow(const Rule* r, size_t pos) const;
+    bool growStep(bool ok, size_t end, ASTNode* node) const;
+    bool holdsNode(const ASTNode* tree, const ASTNode* node) const;
+    bool endGrow(size_t& pos, ASTNode*& node) const;
+    void pinSeed(ASTNode* node, bool pinned) const;
+    void releaseSeeds(std::vector<GrowEntry>& heads) const;
+    Expression* seedBody(const Rule* r) const;
+    Expression* entryExpr(const Rule* r) const;
+    ASTNode* entryNode(const Rule* r, ASTNode* node) const;
+
+    // Operator rules
+    bool parseOperators(const Rule* r, const std::string& input, size_t& pos,
+                        ASTNode*& outNode) const;
+    void applyClimb(const std::string& input) const;
+    ASTNode* operatorTree(const Rule* r, ASTNode* body) const;
+
+    // Packrat memo table helpers
+    bool memoizes(const Rule* r) const;
+    void memoBegin(size_t inputSize) const;
+    void memoEnd() const;
+    MemoEntry* memoLookup(const Rule* r, size_t pos) const;
+    void memoStore(const Rule* r, size_t pos, bool ok, size_t end,
+                   ASTNode* node, size_t logFrom) const;
+
+    // Two-phase parsing
+    bool parseTwoPhase(Expression* start, const std::string& input, size_t& pos,
+                       ASTNode*& root) const;
+    bool replayAlternative(Expression* expr, const std::string& input, size_t& pos,
+                           ASTNode*& outNode) const;
+    size_t nextDecision() const;
+    bool dispatchExpression(Expression* expr, const std::string& input, size_t& pos,
+                            ASTNode*& outNode) const;
+
+    // FIRST sets of an unlinked grammar
+    const FirstSets::Info& computeFirst(Expression* expr) const;
 };
 
 #endif
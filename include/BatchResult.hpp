@@ -0,0 +1,94 @@
+#ifndef BATCH_RESULT_HPP
+#define BATCH_RESULT_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "AST.hpp"
+
+/**
+ * @brief One node of a flattened AST.
+ *
+ * The children of a node occupy consecutive slots of BatchResult::nodes,
+ * starting at firstChild. A null child of a sequence is kept as a slot
+ * whose symbol is BatchResult::NONE.
+ */
+struct FlatNode {
+    size_t symbol;       ///< Index into BatchResult::symbols, or NONE
+    size_t begin;        ///< Offset of the match in the input
+    size_t end;          ///< Offset after the match
+    size_t firstChild;   ///< Index of the first child in BatchResult::nodes
+    size_t childCount;   ///< Number of children
+};
+
+/**
+ * @brief Results of BNFParser::parseBatch() in contiguous storage.
+ *
+ * All trees of a batch share one node array and one symbol table; nodes
+ * hold spans into the caller's inputs instead of copied text. Reusing a
+ * BatchResult across batches keeps its capacity, so a steady stream of
+ * batches stops allocating once the arrays have grown.
+ */
+class BatchResult {
+public:
+    /// Marks a missing node or symbol.
+    static const size_t NONE = static_cast<size_t>(-1);
+
+    /**
+     * @brief Outcome for one input of the batch.
+     */
+    struct Entry {
+        bool ok;          ///< Whether the start rule matched
+        size_t consumed;  ///< Number of characters consumed
+        size_t root;      ///< Index of the root node, or NONE
+    };
+
+    std::vector<Entry> entries;        ///< One entry per input, in input order
+    std::vector<FlatNode> nodes;       ///< Nodes of all trees
+    std::vector<std::string> symbols;  ///< Distinct node symbols
+
+    /**
+     * @brief Returns the number of inputs in the batch.
+     */
+    size_t size() const { return entries.size(); }
+
+    /**
+     * @brief Returns the symbol of a node ("" for a null child).
+     */
+    const std::string& symbolOf(const FlatNode& node) const;
+
+    /**
+     * @brief Returns the text a node matched in its input.
+     * @param node Node of the tree
+     * @param input The input the tree was parsed from
+     */
+    std::string text(const FlatNode& node, const std::string& input) const;
+
+    /**
+     * @brief Rebuilds an ASTNode tree for one input.
+     * @param index Input index in the batch
+     * @param input The input the tree was parsed from
+     * @return Heap tree owned by the caller, or nullptr if the input failed
+     */
+    ASTNode* toAST(size_t index, const std::string& input) const;
+
+    /**
+     * @brief Drops all results but keeps the allocated capacity.
+     */
+    void clear();
+
+    /**
+     * @brief Appends a flattened copy of a tree and returns its root index.
+     */
+    size_t append(const ASTNode* root);
+
+private:
+    std::vector<size_t> symbolSlots;    ///< Open-addressing index into symbols
+    std::vector<const ASTNode*> queue;  ///< Scratch for append()
+
+    size_t intern(const std::string& symbol);
+    void rehash(size_t slots);
+    ASTNode* expand(size_t index, const std::string& input) const;
+};
+
+#endif // BATCH_RESULT_HPP
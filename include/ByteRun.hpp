@@ -0,0 +1,70 @@
+#ifndef BYTE_RUN_HPP
+#define BYTE_RUN_HPP
+
+#include <cstddef>
+#include <bitset>
+
+struct Expression;
+
+/**
+ * @brief A 256-bit byte class prepared for scanning runs of member bytes.
+ *
+ * Classes made of at most MAX_RANGES contiguous byte ranges (letters,
+ * digits, printable ASCII, ...) are tested 16 or 32 bytes at a time with
+ * SIMD range compares: SSE2 on every x86-64 CPU, AVX2 when the running
+ * CPU supports it. Other classes, and other architectures, use a scalar
+ * bitmap lookup per byte.
+ */
+class ByteRun {
+public:
+    /// Largest number of ranges tested with vector compares.
+    static const int MAX_RANGES = 4;
+
+    ByteRun();
+
+    /**
+     * @brief Prepares a class for scanning.
+     * @param bits Member bytes
+     */
+    explicit ByteRun(const std::bitset<256>& bits);
+
+    /**
+     * @brief Prepares the class of a repetition whose body always matches
+     * exactly one byte: a range, class or one-byte literal, an alternative
+     * of those, or a rule that is one.
+     * @param repeat EXPR_REPEAT node of a linked grammar
+     * @param run Receives the scanner of the body's bytes
+     * @return false, leaving `run` unchanged, if the body does not qualify
+     */
+    static bool fromRepeat(const Expression* repeat, ByteRun& run);
+
+    /**
+     * @brief Returns the length of the longest prefix made of member bytes.
+     * @param data Bytes to scan
+     * @param size Number of bytes available
+     */
+    size_t scan(const char* data, size_t size) const;
+
+    /**
+     * @brief Same result as scan(), one bitmap lookup per byte.
+     */
+    size_t scanScalar(const char* data, size_t size) const;
+
+    /**
+     * @brief Returns the number of ranges, or -1 if the class is scanned bytewise.
+     */
+    int rangeCount() const { return ranges; }
+
+    /**
+     * @brief Returns whether scan() uses vector instructions on this machine.
+     */
+    static bool vectorized();
+
+private:
+    std::bitset<256> bits;
+    int ranges;                       ///< Number of ranges in lo/hi, or -1
+    unsigned char lo[MAX_RANGES];     ///< First byte of each range
+    unsigned char hi[MAX_RANGES];     ///< Last byte of each range
+};
+
+#endif // BYTE_RUN_HPP
@@ -0,0 +1,142 @@
+#ifndef BYTECODE_COMPILER_HPP
+#define BYTECODE_COMPILER_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <bitset>
+#include <iostream>
+#include "Grammar.hpp"
+#include "FirstSets.hpp"
+
+/**
+ * @brief One instruction of the parsing VM.
+ *
+ * Operands are interpreted per opcode; unused operands are zero.
+ */
+struct Instruction {
+    /**
+     * @brief Operation codes understood by VMParser.
+     *
+     * - OP_HALT: successful end of the program.
+     * - OP_CHAR: match byte a, emitting a leaf node with symbol b.
+     * - OP_CLASS: match a byte of class a, emitting a leaf node with symbol b.
+     * - OP_LITERAL: match literal a, emitting a leaf node with symbol b.
+     * - OP_CALL: call the rule body at address a.
+     * - OP_RET: return from a rule body.
+     * - OP_CHOICE: push a backtrack entry that resumes at address a.
+     * - OP_COMMIT: drop the top backtrack entry and jump to address a.
+     * - OP_JUMP: continue at address a.
+     * - OP_FAIL: backtrack to the most recent entry.
+     * - OP_TEST: jump to address b unless the lookahead byte is in class a.
+     * - OP_PROGRESS: fail if nothing was consumed since the top entry.
+     * - OP_ALT_BEGIN: open a longest-match choice producing node symbol a.
+     * - OP_ALT_RECORD: keep the current branch if it is the longest so far,
+     *   then resume at the next branch.
+     * - OP_ALT_END: continue after the longest branch, or fail.
+     * - OP_CAPTURE_OPEN: open an AST node with symbol a.
+     * - OP_CAPTURE_CLOSE: close the innermost open AST node.
+     */
+    enum OpCode {
+        OP_HALT,
+        OP_CHAR,
+        OP_CLASS,
+        OP_LITERAL,
+        OP_CALL,
+        OP_RET,
+        OP_CHOICE,
+        OP_COMMIT,
+        OP_JUMP,
+        OP_FAIL,
+        OP_TEST,
+        OP_PROGRESS,
+        OP_ALT_BEGIN,
+        OP_ALT_RECORD,
+        OP_ALT_END,
+        OP_CAPTURE_OPEN,
+        OP_CAPTURE_CLOSE
+    };
+
+    OpCode op;  ///< Operation to perform
+    int a;      ///< First operand
+    int b;      ///< Second operand
+
+    Instruction(OpCode o, int x = 0, int y = 0);
+};
+
+/**
+ * @brief Linear instruction stream produced from a Grammar.
+ *
+ * Literals, byte classes and node symbols are stored once in side tables
+ * and referenced by index from the instructions.
+ */
+struct BytecodeProgram {
+    std::vector<Instruction> code;              ///< Instruction stream
+    std::vector<std::string> literals;          ///< Multi-byte literals
+    std::vector<std::bitset<256> > classes;     ///< Byte classes (match and test)
+    std::vector<std::string> symbols;           ///< AST node symbols
+    std::vector<bool> keepsNull;                ///< Per symbol: keeps empty children
+    std::vector<const OperatorTable*> operators; ///< Per symbol: table of an operator rule, or null
+    std::map<std::string, int> entries;         ///< Rule name -> body address
+    std::map<std::string, const OperatorTable*> operatorRules; ///< Rule name -> its operator table
+    std::vector<std::string> unsupported;       ///< Left-recursive rules, compiled to fail
+
+    /**
+     * @brief Returns the body address of a rule.
+     * @param ruleName Name of the rule
+     * @return Address of the first instruction, or -1 if unknown
+     */
+    int entryPoint(const std::string& ruleName) const;
+
+    /**
+     * @brief Writes a human-readable listing of the program.
+     * @param os Output stream
+     */
+    void dump(std::ostream& os) const;
+};
+
+/**
+ * @brief Lowers a Grammar into a BytecodeProgram.
+ *
+ * Every rule body becomes a subroutine ending in OP_RET. Alternatives keep
+ * the longest-match semantics of BNFParser and are guarded by FIRST-set
+ * tests; when the branches' FIRST sets are disjoint at most one branch can
+ * match, so the choice compiles to a plain test-and-jump chain. Repetitions
+ * and optionals use choice/commit pairs. A left-recursive rule is reported
+ * on std::cerr and compiled to a body that always fails.
+ */
+class BytecodeCompiler {
+public:
+    /**
+     * @brief Creates a compiler for the given grammar.
+     * @param g Grammar to compile (must be complete)
+     */
+    explicit BytecodeCompiler(const Grammar& g);
+
+    /**
+     * @brief Compiles every rule of the grammar.
+     * @param out Program to fill (previous content is discarded)
+     */
+    void compile(BytecodeProgram& out);
+
+private:
+    const Grammar& grammar;                   ///< Source grammar
+    FirstSets first;                          ///< Lookahead sets for OP_TEST
+    BytecodeProgram* prog;                    ///< Program being built
+    std::map<std::string, int> symbolIndex;   ///< Symbol table lookup
+    std::map<std::string, int> literalIndex;  ///< Literal table lookup
+    std::vector<size_t> callFixups;           ///< OP_CALL sites to resolve
+    std::vector<std::string> callTargets;     ///< Rule name per fixup
+
+    int emit(Instruction::OpCode op, int a = 0, int b = 0);
+    int here() const;
+    void patch(int at, int target);
+    int internSymbol(const std::string& s, bool keepsNull);
+    int internLiteral(const std::string& s);
+    int internClass(const std::bitset<256>& bits);
+    void emitTest(const Expression* expr, std::vector<int>& jumps);
+    bool isDeterministic(const Expression* alt);
+    void compileExpr(const Expression* expr);
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef COMPILED_GRAMMAR_HPP
+#define COMPILED_GRAMMAR_HPP
+
+#include <string>
+#include <map>
+#include <vector>
+#include "Grammar.hpp"
+#include "ByteRun.hpp"
+#include "Dfa.hpp"
+#include "DispatchTable.hpp"
+#include "KeywordTrie.hpp"
+
+/**
+ * @brief Frozen, linked view of a Grammar produced by Grammar::finalize().
+ *
+ * Linking resolves every EXPR_SYMBOL to its Rule, decodes every terminal
+ * literal and stores FIRST/nullable data in each Expression node, so a
+ * parser needs no name lookups, string decoding or lazily filled caches
+ * while parsing. Large alternatives also get a DispatchTable, and
+ * alternatives made only of literals a KeywordTrie, repetitions of one
+ * byte class a ByteRun, and regular rules a minimized Dfa (Rule::dfa). Left-recursive rules are flagged
+ * (Rule::leftRecursive) and get the branches their later growth rounds try
+ * (Rule::seedBody). A CompiledGrammar is never modified after construction
+ * and may be shared by any number of BNFParser instances on different
+ * threads.
+ *
+ * The object is owned by the Grammar that created it and lives as long
+ * as that Grammar.
+ */
+class CompiledGrammar {
+public:
+    /**
+     * @brief Finds a rule by name using the prebuilt index.
+     * @param name The name of the rule to find
+     * @return Pointer to the rule, or nullptr if not found
+     */
+    const Rule* getRule(const std::string& name) const;
+
+    /**
+     * @brief Returns all rules in definition order.
+     */
+    const std::vector<Rule*>& getRules() const { return grammar.getRules(); }
+
+    /**
+     * @brief Returns the grammar this object was linked from.
+     */
+    const Grammar& getGrammar() const { return grammar; }
+
+    /**
+     * @brief Returns the rules compiled to a Dfa, in definition order.
+     */
+    const std::vector<std::string>& getRegularRules() const { return regular; }
+
+    /**
+     * @brief Returns the left-recursive rules, in definition order.
+     */
+    const std::vector<std::string>& getLeftRecursiveRules() const { return leftRecursive; }
+
+    ~CompiledGrammar();
+
+private:
+    friend class Grammar;
+
+    explicit CompiledGrammar(const Grammar& g);
+    CompiledGrammar(const CompiledGrammar&);
+    CompiledGrammar& operator=(const CompiledGrammar&);
+
+    const Grammar& grammar;                          ///< Source grammar
+    std::map<std::string, const Rule*> index;        ///< Rules by name
+    std::vector<DispatchTable*> tables;              ///< Tables referenced by Expression::dispatch
+    std::vector<KeywordTrie*> tries;                 ///< Tries referenced by Expression::keywords
+    std::vector<Dfa*> dfas;                          ///< Scanners referenced by Rule::dfa
+    std::vector<ByteRun*> runs;                      ///< Scanners referenced by Expression::run
+    std::vector<std::string> regular;                ///< Names of the rules with a Dfa
+    std::vector<std::string> leftRecursive;          ///< Names of the left-recursive rules
+    std::vector<Expression*> seedBodies;             ///< Alternatives referenced by Rule::seedBody
+};
+
+#endif
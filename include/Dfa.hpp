@@ -0,0 +1,68 @@
+#ifndef DFA_HPP
+#define DFA_HPP
+
+#include <cstddef>
+#include <vector>
+
+struct Rule;
+
+/**
+ * @brief Minimized byte-level DFA of a regular rule.
+ *
+ * A rule qualifies when it reaches no rule on a reference cycle and every
+ * decision in its (inlined) body is fixed by the next byte: alternative
+ * branches have disjoint FIRST sets, and the body of an optional or a
+ * repetition can neither match empty nor start with a byte that may
+ * follow it. The backtracking parser then matches exactly the longest
+ * prefix in the rule's language, which is what match() returns, so the
+ * DFA can stand in for the rule wherever no subtree is needed.
+ *
+ * Built from a linked grammar (see CompiledGrammar): Thompson NFA, subset
+ * construction over byte classes, then Moore minimization. State 0 is the
+ * dead state.
+ */
+class Dfa {
+public:
+    /// Largest DFA, in states, that is kept.
+    static const size_t MAX_STATES = 512;
+
+    /// Largest NFA, in states, that is determinized.
+    static const size_t MAX_NFA_STATES = 4096;
+
+    /// Result of match() when no prefix is accepted.
+    static const size_t NO_MATCH = static_cast<size_t>(-1);
+
+    Dfa();
+
+    /**
+     * @brief Builds the DFA of a rule of a linked grammar.
+     * @param rule The rule
+     * @param dfa Empty DFA that receives the tables
+     * @return false if the rule is not regular in the sense above, or too large
+     */
+    static bool fromRule(const Rule* rule, Dfa& dfa);
+
+    /**
+     * @brief Returns the length of the longest accepted prefix, or NO_MATCH.
+     */
+    size_t match(const char* data, size_t size) const;
+
+    /**
+     * @brief Returns the number of states, including the dead state.
+     */
+    size_t states() const { return accepting.size(); }
+
+    /**
+     * @brief Returns the number of byte equivalence classes.
+     */
+    size_t byteClasses() const { return classCount; }
+
+private:
+    unsigned char classOf[256];        ///< Byte class of each byte
+    size_t classCount;                 ///< Number of byte classes
+    std::vector<unsigned> next;        ///< Transition per state and class (0 = dead)
+    std::vector<char> accepting;       ///< Whether each state accepts
+    unsigned start;                    ///< Start state
+};
+
+#endif // DFA_HPP
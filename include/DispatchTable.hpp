@@ -0,0 +1,66 @@
+#ifndef DISPATCH_TABLE_HPP
+#define DISPATCH_TABLE_HPP
+
+#include <cstddef>
+#include <bitset>
+#include <vector>
+
+/**
+ * @brief Maps a lookahead byte to the viable branches of an alternative.
+ *
+ * Built from the FIRST/nullable data of each branch: a branch is listed
+ * under every byte in its FIRST set, and a nullable branch under every
+ * byte and under END_OF_INPUT. Lists are in branch order, so trying them
+ * in order keeps the first-branch-wins rule for equal-length matches.
+ */
+class DispatchTable {
+public:
+    /// Smallest alternative for which a table beats testing each branch.
+    static const size_t MIN_BRANCHES = 4;
+
+    /// Key used when no lookahead byte is available.
+    static const size_t END_OF_INPUT = 256;
+
+    DispatchTable();
+
+    /**
+     * @brief Appends the next branch. A null branch passes an empty set and false.
+     * @param first Bytes the branch can start with
+     * @param nullable Whether the branch can match the empty string
+     */
+    void addBranch(const std::bitset<256>& first, bool nullable);
+
+    /**
+     * @brief Builds the table once every branch was added.
+     */
+    void finish();
+
+    /**
+     * @brief Returns the number of viable branches for a byte or END_OF_INPUT.
+     */
+    size_t count(size_t key) const { return offsets[key + 1] - offsets[key]; }
+
+    /**
+     * @brief Returns the n-th viable branch for a byte or END_OF_INPUT.
+     */
+    size_t branch(size_t key, size_t n) const { return list[offsets[key] + n]; }
+
+    /**
+     * @brief Returns the first viable branch at or after `from`, or the
+     * number of branches if there is none.
+     */
+    size_t next(size_t key, size_t from) const;
+
+    /**
+     * @brief Returns the number of branches added.
+     */
+    size_t branches() const { return firsts.size(); }
+
+private:
+    std::vector<std::bitset<256> > firsts;  ///< FIRST set per branch
+    std::vector<bool> nullables;            ///< Nullable flag per branch
+    std::vector<unsigned> offsets;          ///< Start of each key's list (257 keys + end)
+    std::vector<unsigned> list;             ///< Branch indices, grouped by key
+};
+
+#endif // DISPATCH_TABLE_HPP
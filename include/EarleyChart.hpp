@@ -0,0 +1,188 @@
+#ifndef EARLEY_CHART_HPP
+#define EARLEY_CHART_HPP
+
+#include <bitset>
+#include <map>
+#include <string>
+#include <vector>
+#include "Grammar.hpp"
+
+/**
+ * @brief Earley recognizer over a grammar, with derivations read from its chart.
+ *
+ * The grammar is translated once into a context-free grammar with one
+ * nonterminal per rule and per sequence, alternative, optional and
+ * repetition. A repetition becomes `X ::= X body | ε`; left recursion is
+ * Earley's cheap case. Empty derivations are handled when an item is
+ * predicted (Aycock/Horspool), and a production is only predicted when it
+ * can start with the next byte or is nullable.
+ *
+ * recognize() accepts any context-free grammar, including left-recursive
+ * and ambiguous ones, and finds the longest prefix the start rule derives.
+ * It runs in O(n^3) time for an input of n bytes, O(n^2) on unambiguous
+ * grammars, and O(n) on most deterministic grammars. Right recursion is
+ * the exception: it stays quadratic without Leo's items.
+ *
+ * derive() reads one derivation back from the chart as a list of steps.
+ * Within a fixed span, an alternative takes its first branch that derives
+ * the span, and a sequence or repetition gives its last element or
+ * iteration the shortest span it can have. Every iteration is non-empty.
+ * The grammar must not change after construction.
+ */
+class EarleyChart {
+public:
+    /// Returned by recognize() when no prefix matches; also marks "no parent".
+    static const size_t NO_MATCH = static_cast<size_t>(-1);
+
+    /**
+     * @brief One expression matched over a span, in preorder.
+     */
+    struct Step {
+        const Expression* expr;  ///< Matched expression
+        size_t begin;            ///< Start of the span
+        size_t end;              ///< End of the span (exclusive)
+        size_t parent;           ///< Index of the enclosing step, or NO_MATCH for the root
+    };
+
+    /**
+     * @brief Translates the given grammar.
+     * @param g Grammar to recognize
+     */
+    explicit EarleyChart(const Grammar& g);
+
+    /**
+     * @brief Fills the chart for `input` from a start rule.
+     *
+     * The input must stay alive and unchanged until the last derive()
+     * call for this chart.
+     * @param start Rule to match from position 0
+     * @param input Text to recognize
+     * @return End of the longest matching prefix, or NO_MATCH
+     */
+    size_t recognize(const Rule* start, const std::string& input);
+
+    /**
+     * @brief Reads a derivation of the start rule's body over [0, end).
+     * @param start Rule passed to the last recognize()
+     * @param end A prefix length returned by recognize()
+     * @param out Receives the steps in preorder; cleared first
+     */
+    void derive(const Rule* start, size_t end, std::vector<Step>& out) const;
+
+    /**
+     * @brief Returns the number of items in the chart of the last recognize().
+     */
+    size_t itemCount() const { return items; }
+
+private:
+    /**
+     * @brief Nonterminal or terminal of the translated grammar.
+     */
+    struct Symbol {
+        const Rule* rule;          ///< Rule of a rule symbol, or null
+        bool terminal;             ///< Matched directly against the input
+        bool literalTerm;          ///< Terminal: `literal` (true) or `bytes` (false)
+        std::string literal;       ///< Text of a literal terminal
+        std::bitset<256> bytes;    ///< Bytes of a one-byte terminal
+        bool nullable;             ///< Derives the empty string
+        std::bitset<256> first;    ///< Bytes a non-empty match can start with
+        size_t firstProd;          ///< First production of a nonterminal
+        size_t prodCount;          ///< Number of productions
+    };
+
+    /**
+     * @brief Production with its right-hand side in `rhs`.
+     */
+    struct Production {
+        size_t lhs;                ///< Symbol being defined
+        size_t rhsBegin;           ///< Offset of the right-hand side in `rhs`
+        size_t size;               ///< Number of right-hand side symbols
+        size_t slot;               ///< Slot of the dot before the first symbol
+        bool nullable;             ///< All right-hand side symbols are nullable
+        std::bitset<256> first;    ///< Bytes a non-empty match can start with
+    };
+
+    /**
+     * @brief Position of the dot in a production (an LR(0) item).
+     */
+    struct Slot {
+        size_t prod;               ///< Production
+        size_t dot;                ///< Symbols before the dot
+        size_t next;               ///< Symbol after the dot, or NO_MATCH when complete
+    };
+
+    /**
+     * @brief Earley item: a slot and the position its production started at.
+     */
+    struct Item {
+        size_t slot;
+        size_t origin;
+    };
+
+    /**
+     * @brief Entry of the item index: an item or completion of one set.
+     */
+    struct Key {
+        size_t pos;                ///< Earley set
+        size_t slot;               ///< Slot, or a completion marker; NO_MATCH if free
+        size_t origin;             ///< Origin position
+        size_t seq;                ///< Insertion order within the parse
+    };
+
+    /**
+     * @brief Pending derivation of one expression over a span.
+     */
+    struct Task {
+        const Expression* expr;
+        size_t begin;
+        size_t end;
+        size_t bound;              ///< Chosen completions must be older than this
+        size_t parent;
+    };
+
+    const Grammar& grammar;                          ///< Translated grammar
+    std::vector<Symbol> symbols;                     ///< Terminals and nonterminals
+    std::vector<Production> prods;                   ///< Productions, contiguous per symbol
+    std::vector<size_t> rhs;                         ///< Right-hand sides
+    std::vector<Slot> slots;                         ///< Dotted productions
+    std::map<const Expression*, size_t> exprSymbol;  ///< Symbol of each expression
+    std::map<const Rule*, size_t> ruleSymbol;        ///< Symbol of each rule
+    size_t failSymbol;                               ///< Nonterminal without productions
+
+    const std::string* text;                         ///< Input of the last recognize()
+    std::vector<std::vector<Item> > sets;            ///< Earley sets, one per position
+    std::vector<size_t> predicted;                   ///< Last position + 1 each symbol was predicted at
+    std::vector<Key> index;                          ///< Open-addressing item index
+    size_t used;                                     ///< Occupied index entries
+    size_t items;                                    ///< Items in the chart
+    size_t horizon;                                  ///< Last set that holds items
+    size_t startSymbol;                              ///< Start rule of the last recognize()
+    size_t accepted;                                 ///< Longest accepted prefix so far
+
+    EarleyChart(const EarleyChart&);
+    EarleyChart& operator=(const EarleyChart&);
+
+    size_t addSymbol(const Rule* rule);
+    size_t symbolOf(const Expression* expr);
+    void addProduction(size_t lhs, const std::vector<size_t>& right);
+    void solve();
+
+    static Key blankKey();
+    size_t lookup(size_t pos, size_t slot, size_t origin) const;
+    bool insert(size_t pos, size_t slot, size_t origin);
+    void grow();
+    void add(size_t pos, size_t slot, size_t origin);
+    void process(size_t pos);
+
+    size_t symbolAt(const Expression* expr) const;
+    size_t completion(size_t sym, size_t begin, size_t end) const;
+    bool matches(size_t sym, size_t begin, size_t end) const;
+    void endings(size_t sym, size_t begin, size_t end, std::vector<size_t>& out) const;
+    bool splitSequence(size_t prod, size_t k, size_t begin, size_t end, size_t whole,
+                       size_t bound, std::vector<size_t>& cuts) const;
+    void expand(const Task& task, std::vector<Step>& out, std::vector<Task>& todo) const;
+    void deriveEmpty(const Expression* expr, size_t pos, size_t parent,
+                     std::vector<Step>& out, std::vector<const Expression*>& path) const;
+};
+
+#endif
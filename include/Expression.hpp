@@ -5,6 +5,11 @@
 #include <vector>
 #include <bitset>
 
+struct Rule;
+class DispatchTable;
+class KeywordTrie;
+class ByteRun;
+
 /**
  * @brief Represents a single character range.
  * 
@@ -78,6 +83,39 @@ struct Expression {
         return charBitmap.test(static_cast<size_t>(c));
     }
 
+    // ===== Optimizer data, set by GrammarOptimizer =====
+    // For EXPR_ALTERNATIVE: number of leading elements that every branch
+    // shares (a branch that is not a sequence is one element); 0 if none
+    size_t factorPrefix;
+
+    // ===== Link data, filled in by Grammar::finalize() =====
+    // For EXPR_SYMBOL: the referenced rule, or null if it is undefined
+    const Rule* rule;
+    // For EXPR_TERMINAL: the literal with surrounding quotes removed
+    std::string literal;
+    // FIRST bytes of this expression and whether it can match empty
+    std::bitset<256> first;
+    bool nullable;
+    // For EXPR_ALTERNATIVE with at least DispatchTable::MIN_BRANCHES
+    // branches: viable branches per lookahead byte, owned by the
+    // CompiledGrammar; null otherwise
+    const DispatchTable* dispatch;
+    // For EXPR_ALTERNATIVE of at least KeywordTrie::MIN_KEYWORDS terminal
+    // branches: trie of their literals, owned by the CompiledGrammar;
+    // null otherwise
+    const KeywordTrie* keywords;
+    // For EXPR_REPEAT whose body always matches one byte: scanner of the
+    // body's class, owned by the CompiledGrammar; null otherwise
+    const ByteRun* run;
+
+    /**
+     * @brief Returns the text matched by an EXPR_TERMINAL node.
+     *
+     * Surrounding single or double quotes are removed if still present.
+     * @return The literal to match
+     */
+    std::string terminalText() const;
+
     /**
      * @brief Constructs an Expression of the given type.
      *
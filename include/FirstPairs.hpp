@@ -0,0 +1,105 @@
+#ifndef FIRST_PAIRS_HPP
+#define FIRST_PAIRS_HPP
+
+#include <bitset>
+#include <map>
+#include <vector>
+#include "Grammar.hpp"
+
+/**
+ * @brief FIRST_2 analysis: the first two bytes an expression can match.
+ *
+ * For every expression the analysis records whether it can match the
+ * empty string, which bytes it can match as a one-byte word, and which
+ * byte pairs can start a longer match. A branch that has none of these
+ * for the next input bytes cannot match there. Like FirstSets, rule
+ * results are a least fixpoint over all rules, so recursive rules
+ * terminate. Literals that never match (empty ones) contribute nothing.
+ * The grammar must not change after the first query.
+ */
+class FirstPairs {
+public:
+    /**
+     * @brief Set of byte pairs, stored as one 256-bit row per first byte in use.
+     */
+    class PairSet {
+    public:
+        PairSet();
+
+        /**
+         * @brief Returns true if the pair (first, second) is in the set.
+         */
+        bool test(unsigned char first, unsigned char second) const {
+            return rowOf[first] && rows[rowOf[first] - 1].test(second);
+        }
+
+        /**
+         * @brief Adds every pair (first, s) with s in `seconds`.
+         */
+        void add(unsigned char first, const std::bitset<256>& seconds);
+
+        /**
+         * @brief Adds every pair of another set.
+         */
+        void merge(const PairSet& other);
+
+        /**
+         * @brief Returns the bytes that start at least one pair.
+         */
+        const std::bitset<256>& firsts() const { return used; }
+
+        bool operator==(const PairSet& other) const;
+        bool operator!=(const PairSet& other) const { return !(*this == other); }
+
+    private:
+        unsigned short rowOf[256];           ///< Row of each first byte plus one, 0 if none
+        std::vector<std::bitset<256> > rows; ///< Second bytes per used first byte
+        std::bitset<256> used;               ///< First bytes with a row
+    };
+
+    /**
+     * @brief FIRST_2 of one expression.
+     */
+    struct Info {
+        bool nullable;            ///< The empty string can match
+        std::bitset<256> singles; ///< Bytes that match as a whole one-byte word
+        PairSet pairs;            ///< First two bytes of longer matches
+
+        Info();
+
+        /**
+         * @brief Whether a match can start with the given bytes.
+         * @param first First byte
+         * @param second Second byte, or null if the input ends after `first`
+         */
+        bool admits(unsigned char first, const unsigned char* second) const {
+            if (nullable || singles.test(first)) return true;
+            return second && pairs.test(first, *second);
+        }
+    };
+
+    /**
+     * @brief Creates the analysis for the given grammar.
+     * @param g Grammar to analyse
+     */
+    explicit FirstPairs(const Grammar& g);
+
+    /**
+     * @brief Returns FIRST_2 of an expression.
+     * @param expr Expression to query (null is treated as never matching)
+     * @return Cached analysis result
+     */
+    const Info& of(const Expression* expr);
+
+private:
+    const Grammar& grammar;                      ///< Analysed grammar
+    std::map<const Rule*, Info> ruleInfo;        ///< Fixpoint per rule
+    std::map<const Expression*, Info> exprInfo;  ///< Per-expression cache
+    bool solved;                                 ///< Whether the fixpoint ran
+    Info empty;                                  ///< Result for null
+
+    void solve();
+    Info compute(const Expression* expr) const;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef FIRST_SETS_HPP
+#define FIRST_SETS_HPP
+
+#include <bitset>
+#include <map>
+#include <set>
+#include <vector>
+#include "Grammar.hpp"
+
+/**
+ * @brief FIRST-set and nullability analysis over a whole grammar.
+ *
+ * Rule-level results are computed as a least fixpoint over all rules, so
+ * recursive (including left-recursive) rules terminate. Results for
+ * individual expressions are derived from the rule table and cached.
+ * The same tables tell which rules are left-recursive.
+ * The grammar must not change after the first query.
+ */
+class FirstSets {
+public:
+    /**
+     * @brief FIRST bytes of an expression and whether it can match empty.
+     */
+    struct Info {
+        std::bitset<256> chars;  ///< Bytes that can start a match
+        bool nullable;           ///< Whether the empty string can match
+
+        Info();
+    };
+
+    /**
+     * @brief Creates the analysis for the given grammar.
+     * @param g Grammar to analyse
+     */
+    explicit FirstSets(const Grammar& g);
+
+    /**
+     * @brief Returns FIRST/nullable of an expression.
+     * @param expr Expression to query (null is treated as never matching)
+     * @return Cached analysis result
+     */
+    const Info& of(const Expression* expr);
+
+    /**
+     * @brief Returns FIRST/nullable of a rule's right-hand side.
+     * @param rule Rule to query
+     * @return Analysis result for the rule
+     */
+    const Info& ofRule(const Rule* rule);
+
+    /**
+     * @brief Whether a rule can call itself before consuming input.
+     *
+     * Follows the symbols a body can start with, skipping nullable
+     * elements, so direct (`<e> ::= <e> '+' <t>`), indirect and hidden
+     * (`<h> ::= [ 'x' ] <h> 'b'`) left recursion are all found.
+     * @param rule Rule to query
+     * @return true if the rule is left-recursive
+     */
+    bool leftRecursive(const Rule* rule);
+
+    /**
+     * @brief Whether a match of an expression can call a rule before
+     * consuming input.
+     * @param expr Expression to query
+     * @param target Rule to look for
+     */
+    bool reachesFirst(const Expression* expr, const Rule* target);
+
+    /**
+     * @brief Body to parse once a left-recursive rule has a seed.
+     *
+     * A branch that cannot call the rule before consuming input matches
+     * the same text with any seed, so after the first round it cannot give
+     * a longer match. The result is a new alternative of the other
+     * branches; it shares them with the rule, so its `children` must be
+     * cleared before it is deleted.
+     * @param rule Left-recursive rule
+     * @return The new alternative, or null if the body is not an
+     *         alternative or if all or none of its branches can call the
+     *         rule first
+     */
+    Expression* seedBody(const Rule* rule);
+
+private:
+    const Grammar& grammar;                      ///< Analysed grammar
+    std::map<const Rule*, Info> ruleInfo;        ///< Fixpoint per rule
+    std::map<const Expression*, Info> exprInfo;  ///< Per-expression cache
+    bool solved;                                 ///< Whether the fixpoint ran
+    std::set<const Rule*> leftRec;               ///< Left-recursive rules
+    std::map<const Rule*, std::vector<const Rule*> > leftGraph; ///< Calls each rule can make first
+    bool cornersFound;                           ///< Whether leftRec is filled
+    Info empty;                                  ///< Result for null/unknown
+
+    void solve();
+    Info compute(const Expression* expr) const;
+    void findLeftRecursion();
+    void leftCalls(const Expression* expr, std::vector<const Rule*>& out);
+};
+
+#endif
@@ -8,6 +8,11 @@
 #include "ExpressionInterner.hpp"
 #include "Arena.hpp"
 
+class CompiledGrammar;
+class GrammarOptimizer;
+class Dfa;
+class OperatorTable;
+
 /**
  * @brief Represents a single grammar rule.
  * 
@@ -17,6 +22,10 @@
 struct Rule {
 	std::string name;       ///< Name of the rule (left-hand side)
 	Expression* rootExpr;   ///< Root expression node (right-hand side)
+	const OperatorTable* operators; ///< Operators of a rule added by Grammar::addOperatorRule(), or null
+	const Dfa* dfa;         ///< Link data: scanner of a regular rule, or null
+	bool leftRecursive;     ///< Link data: the rule can call itself before consuming input
+	Expression* seedBody;   ///< Link data: body once a left-recursive rule has a seed, or null
 
 	/**
 	 * @brief Constructs an empty rule.
@@ -55,6 +64,25 @@ public:
 	 */
 	void addRule(const std::string& ruleText);
 
+	/**
+	 * @brief Adds an expression rule defined by an operator table.
+	 *
+	 * The rule matches an operand followed by any number of operator and
+	 * operand pairs, and its tree is built by precedence (see
+	 * OperatorTable):
+	 * `addOperatorRule("<expr> ::= <unary>", "left '+' '-' | left '*' '/' | right '^'")`.
+	 * The optimizer leaves the rule's body alone and never inlines it.
+	 * @param ruleText Rule name and operand, in format "name ::= expression"
+	 * @param table Precedence levels separated by '|', loosest first, each
+	 *        `left` or `right` followed by its operator literals
+	 */
+	void addOperatorRule(const std::string& ruleText, const std::string& table);
+
+	/**
+	 * @brief Whether any rule was added with addOperatorRule().
+	 */
+	bool hasOperatorRules() const { return !operatorTables.empty(); }
+
 	/**
 	 * @brief Retrieves a rule by name.
 	 * @param name The name of the rule to find
@@ -62,6 +90,27 @@ public:
 	 */
 	Rule* getRule(const std::string& name) const;
 
+	/**
+	 * @brief Returns all rules in definition order.
+	 * @return Read-only view of the rule list
+	 */
+	const std::vector<Rule*>& getRules() const { return rules; }
+
+	/**
+	 * @brief Links the grammar and freezes it.
+	 *
+	 * Resolves symbol references, decodes terminal literals and stores
+	 * FIRST/nullable data in every expression. Afterwards addRule() is
+	 * rejected. Calling finalize() again returns the same object.
+	 * @return The linked grammar, owned by this Grammar
+	 */
+	const CompiledGrammar& finalize();
+
+	/**
+	 * @brief Returns the linked grammar, or nullptr before finalize().
+	 */
+	const CompiledGrammar* getCompiled() const { return compiled; }
+
 	/**
 	 * @brief Attach an arena to allocate rules/expressions. Optional.
 	 * When set, created nodes should be allocated from the arena.
@@ -73,7 +122,16 @@ public:
 	 */
 	void setInterner(ExpressionInterner* i) { interner = i; }
 
+	/**
+	 * @brief Attach an optimizer that rewrites each rule after it is parsed (optional).
+	 * Rule passes apply to rules added after the call; grammar passes
+	 * such as inlining run over all rules in finalize().
+	 */
+	void setOptimizer(GrammarOptimizer* o) { optimizer = o; }
+
 private:
+	friend class GrammarOptimizer;
+
 	Rule* createRule();
 	Expression* createExpr(Expression::Type type);
 	Expression* internIfEnabled(Expression* expr);
@@ -120,8 +178,20 @@ private:
 	 */
 	unsigned char tokenToChar(const Token& t) const;
 
+	/**
+	 * @brief Splits "LHS ::= RHS" into a trimmed name and its expression text.
+	 * @return false if the text has no "::="
+	 */
+	bool splitRule(const std::string& ruleText, std::string& name, std::string& rhs) const;
+
 	std::vector<Rule*> rules;   ///< Collection of grammar rules
+	std::vector<OperatorTable*> operatorTables; ///< Tables referenced by Rule::operators
 	Arena* arena;               ///< Optional arena for allocations (nullable)
 	ExpressionInterner* interner; ///< Optional interner for deduplication
+	GrammarOptimizer* optimizer; ///< Optional rewrite passes run by addRule()
+	CompiledGrammar* compiled;  ///< Linked view, set by finalize()
+
+	Grammar(const Grammar&);
+	Grammar& operator=(const Grammar&);
 };
 #endif
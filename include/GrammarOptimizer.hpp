@@ -0,0 +1,149 @@
+#ifndef GRAMMAR_OPTIMIZER_HPP
+#define GRAMMAR_OPTIMIZER_HPP
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "Expression.hpp"
+
+class Grammar;
+struct Rule;
+
+/**
+ * @brief Rewrites rule expressions into cheaper equivalent forms.
+ *
+ * Attach with Grammar::setOptimizer(); the rule passes then run on each
+ * rule right after Grammar::addRule() has parsed it, and the grammar
+ * passes run once in Grammar::finalize(). The rewrites keep the language
+ * and the consumed length of every parse unchanged, but replace the
+ * anonymous nodes they touch, so the AST below a symbol node may have a
+ * different shape. Only inlining removes symbol nodes, and never those
+ * of capture symbols, so DataExtractor results for them stay the same.
+ */
+class GrammarOptimizer {
+public:
+    /**
+     * @brief The available passes, in the order they run.
+     *
+     * - PASS_FUSE_CHAR_CLASSES: alternatives of single-byte ranges, classes
+     *   and one-byte literals become one EXPR_CHAR_CLASS bitmap; in a mixed
+     *   alternative, each run of adjacent ones does.
+     * - PASS_MERGE_LITERALS: adjacent terminals in a sequence become one
+     *   terminal; a sequence made only of terminals becomes one terminal.
+     * - PASS_FACTOR_PREFIXES: an alternative whose branches start with the
+     *   same elements records the prefix length (Expression::factorPrefix),
+     *   so the recursive engine matches the prefix once. The tree is the
+     *   same as without factoring.
+     * - PASS_INLINE_RULES (grammar pass): references to small non-recursive
+     *   rules are replaced by a copy of the rule body. The rule passes then
+     *   run again on the callers.
+     */
+    enum Pass {
+        PASS_FUSE_CHAR_CLASSES,
+        PASS_MERGE_LITERALS,
+        PASS_FACTOR_PREFIXES,
+        PASS_INLINE_RULES,
+        PASS_COUNT
+    };
+
+    /**
+     * @brief Rewrite counters, accumulated over all optimized rules.
+     */
+    struct Stats {
+        size_t rules;               ///< Rules passed through the pipeline
+        size_t rewrites[PASS_COUNT]; ///< Nodes rewritten, per pass
+        Stats();
+    };
+
+    /**
+     * @brief Creates an optimizer with every pass enabled.
+     */
+    GrammarOptimizer();
+
+    /**
+     * @brief Enables or disables one pass.
+     */
+    void setPass(Pass pass, bool enabled);
+
+    /**
+     * @brief Returns true if the pass runs.
+     */
+    bool isEnabled(Pass pass) const;
+
+    /**
+     * @brief Enables or disables every pass at once.
+     */
+    void setAllPasses(bool enabled);
+
+    /**
+     * @brief Returns a short name for the pass, e.g. "fuse-char-classes".
+     */
+    static const char* passName(Pass pass);
+
+    /**
+     * @brief Sets the largest rule body, in expression nodes, that is inlined.
+     * @param nodes Node budget (default: DEFAULT_INLINE_BUDGET)
+     */
+    void setInlineBudget(size_t nodes) { inlineBudget = nodes; }
+
+    /**
+     * @brief Sets the symbols that must keep their AST nodes.
+     *
+     * These rules are never inlined, so DataExtractor finds them as before.
+     * @param symbols Rule names, e.g. "<nickname>"
+     */
+    void setCaptureSymbols(const std::vector<std::string>& symbols);
+
+    /// Default node budget for PASS_INLINE_RULES
+    static const size_t DEFAULT_INLINE_BUDGET = 8;
+
+    /**
+     * @brief Runs the enabled passes on one rule of the grammar.
+     *
+     * Called by Grammar::addRule(). New nodes come from the grammar's
+     * arena when it has one; replaced nodes are only freed when the
+     * grammar owns them exclusively (no arena and no interner).
+     */
+    void optimizeRule(Grammar& grammar, Rule& rule);
+
+    /**
+     * @brief Runs the enabled grammar passes over all rules.
+     *
+     * Called by Grammar::finalize(), once every rule is known.
+     */
+    void optimizeGrammar(Grammar& grammar);
+
+    /**
+     * @brief Returns the rewrite counters.
+     */
+    const Stats& getStats() const { return stats; }
+
+    /**
+     * @brief Clears the rewrite counters.
+     */
+    void resetStats() { stats = Stats(); }
+
+private:
+    void rewrite(Grammar& g, Expression* e);
+    bool fuseCharClasses(Grammar& g, Expression* alt);
+    bool mergeLiterals(Grammar& g, Expression* seq);
+    bool factorPrefixes(Expression* alt);
+    void release(Grammar& g, Expression* e) const;
+
+    typedef std::map<std::string, Rule*> RuleIndex;
+    bool isRecursive(const Rule* rule, const RuleIndex& index) const;
+    void inlineRule(Grammar& g, Rule* rule, const RuleIndex& index,
+                    std::map<const Rule*, int>& state);
+    Expression* inlineCalls(Grammar& g, Expression* e, const RuleIndex& index, bool& changed);
+    Expression* clone(Grammar& g, const Expression* e) const;
+
+    bool enabled[PASS_COUNT];
+    size_t inlineBudget;
+    std::set<std::string> captures;
+    std::set<const Rule*> recursive;    ///< Rules on a reference cycle, per optimizeGrammar()
+    Stats stats;
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef KEYWORD_TRIE_HPP
+#define KEYWORD_TRIE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct Expression;
+
+/**
+ * @brief Finds the longest of a set of literal branches in one pass.
+ *
+ * Used for alternatives whose branches are all terminals, such as a
+ * command list `'PRIVMSG' | 'NOTICE' | 'JOIN' | ...`. The root maps each
+ * byte directly to its child; deeper nodes keep their edges sorted by
+ * byte in one flat array. Walking the input byte by byte visits every
+ * keyword that is a prefix of it, so the longest match is known when the
+ * walk stops. A keyword listed twice keeps its first branch, matching the
+ * first-branch-wins rule of parseAlternative().
+ */
+class KeywordTrie {
+public:
+    /// Smallest alternative for which the trie replaces per-branch compares.
+    static const size_t MIN_KEYWORDS = 4;
+
+    /// Branch value of a node where no keyword ends.
+    static const size_t NO_BRANCH = static_cast<size_t>(-1);
+
+    KeywordTrie();
+
+    /**
+     * @brief Fills `trie` from an alternative of at least MIN_KEYWORDS
+     * branches that are all terminals (or null, which never match).
+     * @param alt The alternative
+     * @param trie Empty trie that receives the literals
+     * @return false, leaving `trie` unfinished, if the alternative does not qualify
+     */
+    static bool fromAlternative(const Expression* alt, KeywordTrie& trie);
+
+    /**
+     * @brief Adds the literal of branch `branch`. Empty literals never match and are ignored.
+     */
+    void addKeyword(const std::string& literal, size_t branch);
+
+    /**
+     * @brief Packs the trie into its lookup form once every keyword was added.
+     */
+    void finish();
+
+    /**
+     * @brief Finds the longest keyword starting at `data`.
+     * @param data First byte to match
+     * @param size Bytes available
+     * @param branch Receives the branch of the match, or NO_BRANCH
+     * @return Length of the match, 0 if no keyword matches
+     */
+    size_t longest(const char* data, size_t size, size_t& branch) const;
+
+    /**
+     * @brief Finds the keyword with the lowest branch among those starting at `data`.
+     *
+     * This is the winner of an ordered (PEG) choice over the literals.
+     * @param data First byte to match
+     * @param size Bytes available
+     * @param branch Receives the branch of the match, or NO_BRANCH
+     * @return Length of the match, 0 if no keyword matches
+     */
+    size_t first(const char* data, size_t size, size_t& branch) const;
+
+    /**
+     * @brief Returns the number of distinct keywords.
+     */
+    size_t keywords() const { return count; }
+
+    /**
+     * @brief Returns the number of trie nodes, including the root.
+     */
+    size_t nodes() const { return branches.size(); }
+
+private:
+    struct Edge {
+        unsigned char byte;
+        unsigned target;
+        bool operator<(const Edge& other) const { return byte < other.byte; }
+    };
+
+    size_t walk(const char* data, size_t size, bool lowest, size_t& branch) const;
+
+    // Build form: one unsorted edge list per node
+    std::vector<std::vector<Edge> > building;
+
+    // Lookup form
+    std::vector<unsigned> root;        ///< Child of the root per byte, 0 if none
+    std::vector<unsigned> edgeBegin;   ///< First edge of each node (nodes + 1 entries)
+    std::vector<Edge> edges;           ///< Edges of all nodes, sorted by byte per node
+    std::vector<size_t> branches;      ///< Branch ending at each node, or NO_BRANCH
+    size_t count;                      ///< Distinct keywords
+};
+
+#endif // KEYWORD_TRIE_HPP
@@ -0,0 +1,136 @@
+#ifndef LL1_ANALYSIS_HPP
+#define LL1_ANALYSIS_HPP
+
+#include <bitset>
+#include <map>
+#include <ostream>
+#include <vector>
+#include "Grammar.hpp"
+#include "FirstSets.hpp"
+
+/**
+ * @brief FIRST/FOLLOW analysis that classifies every decision point.
+ *
+ * Decision points are alternatives, optionals and repetitions. A point is
+ * deterministic (LL(1)) when the next input byte, or the end of input,
+ * selects at most one way to continue:
+ * - the branches of an alternative have disjoint FIRST sets, at most one
+ *   of them is nullable, and when one is, no other branch can start with
+ *   a byte in the alternative's FOLLOW set;
+ * - the body of an optional or repetition is not nullable and can start
+ *   with no byte in the construct's FOLLOW set.
+ *
+ * FOLLOW sets are a least fixpoint over all rules, seeded with the end of
+ * input for every rule since any rule may start a parse. Every other
+ * point is reported as a Conflict. The grammar must not change while the
+ * analysis is in use.
+ */
+class LL1Analysis {
+public:
+    /// Marks a lookahead that selects no branch.
+    static const unsigned short NONE = 0xFFFF;
+
+    /**
+     * @brief Why a decision point is not LL(1).
+     */
+    enum ConflictKind {
+        CONFLICT_FIRST_FIRST,   ///< Two branches can start with the same byte
+        CONFLICT_FIRST_FOLLOW,  ///< A byte can start a branch and also follow the empty choice
+        CONFLICT_NULLABLE       ///< Two ways to match empty: nullable branches or body
+    };
+
+    /**
+     * @brief One decision point that needs backtracking.
+     */
+    struct Conflict {
+        const Rule* rule;         ///< First rule whose body holds the point
+        const Expression* expr;   ///< The alternative, optional or repetition
+        ConflictKind kind;        ///< Kind of conflict
+        std::bitset<256> bytes;   ///< Lookahead bytes that do not decide (none for CONFLICT_NULLABLE)
+    };
+
+    /**
+     * @brief Prediction table of one deterministic decision point.
+     *
+     * For an alternative, the branch to take per lookahead byte; at the end
+     * of input, or on a byte no branch starts with, its nullable branch if
+     * any. For an optional or repetition, 0 when the body must be matched
+     * and NONE when it is skipped.
+     */
+    struct Decision {
+        unsigned short next[257];  ///< Choice per lookahead byte; [256] at end of input
+
+        /**
+         * @brief Returns the choice for the lookahead at `pos`, or NONE.
+         */
+        size_t choose(const std::string& input, size_t pos) const {
+            return pos < input.size() ? next[static_cast<unsigned char>(input[pos])] : next[256];
+        }
+    };
+
+    /**
+     * @brief Runs the analysis over the given grammar.
+     * @param g Grammar to analyse
+     */
+    explicit LL1Analysis(const Grammar& g);
+
+    /**
+     * @brief Returns the prediction table of a deterministic decision point.
+     * @param expr Alternative, optional or repetition
+     * @return The table, or null if `expr` is not a deterministic decision point
+     */
+    const Decision* decision(const Expression* expr) const;
+
+    /**
+     * @brief Returns the bytes that can follow a match of a rule.
+     */
+    const std::bitset<256>& follow(const Rule* rule) const;
+
+    /**
+     * @brief Returns the decision points that are not LL(1), in grammar order.
+     */
+    const std::vector<Conflict>& getConflicts() const { return conflicts; }
+
+    /**
+     * @brief Returns the number of decision points found.
+     */
+    size_t decisionCount() const { return points.size(); }
+
+    /**
+     * @brief Returns the number of deterministic decision points.
+     */
+    size_t deterministicCount() const { return decisions.size(); }
+
+    /**
+     * @brief Returns true if every decision point is deterministic.
+     */
+    bool isLL1() const { return conflicts.empty(); }
+
+    /**
+     * @brief Writes a summary line and one line per conflict.
+     * @param out Stream to write to
+     */
+    void report(std::ostream& out) const;
+
+private:
+    const Grammar& grammar;                                    ///< Analysed grammar
+    FirstSets first;                                           ///< FIRST/nullable per expression
+    std::map<const Rule*, std::bitset<256> > ruleFollow;       ///< FOLLOW per rule
+    std::map<const Expression*, std::bitset<256> > exprFollow; ///< FOLLOW per decision point
+    std::vector<std::pair<const Expression*, const Rule*> > points; ///< Decision points, first rule
+    std::map<const Expression*, Decision> decisions;           ///< Tables of deterministic points
+    std::vector<Conflict> conflicts;                           ///< Points that are not LL(1)
+    std::bitset<256> none;                                     ///< Result for unknown rules
+    bool changed;                                              ///< A rule FOLLOW grew this round
+
+    LL1Analysis(const LL1Analysis&);
+    LL1Analysis& operator=(const LL1Analysis&);
+
+    void walk(const Rule* rule, const Expression* expr, const std::bitset<256>& follow);
+    void classifyAlternative(const Rule* rule, const Expression* expr);
+    void classifyBody(const Rule* rule, const Expression* expr);
+    void addConflict(const Rule* rule, const Expression* expr, ConflictKind kind,
+                     const std::bitset<256>& bytes);
+};
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef LALR_TABLE_HPP
+#define LALR_TABLE_HPP
+
+#include <bitset>
+#include <map>
+#include <ostream>
+#include <vector>
+#include "Grammar.hpp"
+
+/**
+ * @brief LALR(1) parse tables of a grammar, for a shift-reduce parser.
+ *
+ * The grammar is translated once into a context-free grammar over byte
+ * classes: bytes that no literal or character set tells apart share a
+ * terminal, and the end of input is one more terminal. Every literal,
+ * character set, sequence, alternative, optional and repetition becomes a
+ * helper nonterminal, and structurally equal expressions share one:
+ * - a literal derives its bytes, a character set one class per production;
+ * - an alternative has one production per branch;
+ * - `[ body ]` becomes `X ::= body | ε`, `{ body }` becomes `X ::= X body | ε`;
+ * - each rule `R ::= root`, and each rule may start a parse.
+ *
+ * The states are the LR(0) item sets; lookaheads are propagated over them
+ * to a least fixpoint, which gives the LALR(1) lookahead sets. A conflict
+ * is resolved as yacc does: a shift or an accept beats a reduction, and
+ * the earlier production wins between two reductions. Each conflict is
+ * listed by getConflicts() and report(). Null and undefined references
+ * and empty literals never match. The grammar must not change while the
+ * table is in use.
+ */
+class LalrTable {
+public:
+    /// Returned by startState() for a rule without a body.
+    static const unsigned NONE = 0xFFFFFFFFu;
+
+    /**
+     * @brief Kind of an action; action() packs it in the low two bits.
+     */
+    enum ActionKind {
+        ACTION_ERROR,    ///< No way to continue with this lookahead
+        ACTION_SHIFT,    ///< Consume the byte and go to target()
+        ACTION_REDUCE,   ///< Reduce production target()
+        ACTION_ACCEPT    ///< The start rule matched the input before the lookahead
+    };
+
+    /**
+     * @brief Node a production builds when it is reduced.
+     */
+    enum Build {
+        BUILD_LEAF,          ///< Literal or character set over the bytes popped
+        BUILD_SEQUENCE,      ///< `<seq>` of every element's node
+        BUILD_ALTERNATIVE,   ///< `<alt>` of the branch, or nothing when empty
+        BUILD_OPTIONAL,      ///< `<opt>` with the body's node, if any
+        BUILD_REPEAT,        ///< `<rep>`, or one more iteration appended to it
+        BUILD_RULE,          ///< Node named after the rule, with its body's node
+        BUILD_ACCEPT         ///< The start rule's body; never reduced
+    };
+
+    /**
+     * @brief Production of the translated grammar.
+     */
+    struct Production {
+        size_t lhs;               ///< Nonterminal being defined
+        size_t rhsBegin;          ///< Offset of the right-hand side in `rhs`
+        size_t size;              ///< Number of right-hand side symbols
+        size_t slot;              ///< Item of the dot before the first symbol
+        Build build;              ///< Node built on reduction
+        const Expression* expr;   ///< Expression translated (first one if shared)
+        const Rule* rule;         ///< Rule of BUILD_RULE and BUILD_ACCEPT
+    };
+
+    /**
+     * @brief Why a state has more than one action for a lookahead.
+     */
+    enum ConflictKind {
+        CONFLICT_SHIFT_REDUCE,    ///< A reduction loses to a shift
+        CONFLICT_REDUCE_REDUCE    ///< A reduction loses to an accept or an earlier production
+    };
+
+    /**
+     * @brief Productions that lost an action, merged over all states.
+     */
+    struct Conflict {
+        const Rule* rule;         ///< First rule whose body holds the production
+        const Production* prod;   ///< The reduction that lost
+        ConflictKind kind;        ///< Kind of conflict
+        std::bitset<256> bytes;   ///< Lookahead bytes involved
+        bool atEnd;               ///< The end of input is involved too
+    };
+
+    /**
+     * @brief Builds the tables of the given grammar.
+     * @param g Grammar to translate
+     */
+    explicit LalrTable(const Grammar& g);
+
+    /**
+     * @brief Returns the state a parse of `rule` starts in, or NONE.
+     */
+    unsigned startState(const Rule* rule) const;
+
+    /**
+     * @brief Returns the terminal of an input byte.
+     */
+    unsigned terminal(unsigned char c) const { return classOf[c]; }
+
+    /**
+     * @brief Returns the terminal of the end of input.
+     */
+    unsigned endTerminal() const { return classCount; }
+
+    /**
+     * @brief Returns the packed action of a state on a terminal.
+     */
+    unsigned action(unsigned state, unsigned term) const { return actions[state * terms + term]; }
+
+    /**
+     * @brief Returns the state after reducing to nonterminal `lhs` in `state`.
+     */
+    unsigned jump(unsigned state, size_t lhs) const { return gotos[state * nonterminals + lhs]; }
+
+    /**
+     * @brief Kind of a packed action.
+     */
+    static ActionKind kind(unsigned action) { return static_cast<ActionKind>(action & 3); }
+
+    /**
+     * @brief State of a shift, or production of a reduction.
+     */
+    static unsigned target(unsigned action) { return action >> 2; }
+
+    /**
+     * @brief Returns a production by number.
+     */
+    const Production& production(size_t p) const { return prods[p]; }
+
+    /**
+     * @brief Returns the number of states.
+     */
+    size_t stateCount() const { return states.size(); }
+
+    /**
+     * @brief Returns the number of productions, including one start production per rule.
+     */
+    size_t productionCount() const { return prods.size(); }
+
+    /**
+     * @brief Returns the number of byte classes, not counting the end of input.
+     */
+    size_t byteClasses() const { return classCount; }
+
+    /**
+     * @brief Returns the conflicts, in order of the losing production.
+     */
+    const std::vector<Conflict>& getConflicts() const { return conflicts; }
+
+    /**
+     * @brief Returns true if no state has a conflict.
+     */
+    bool isLALR1() const { return conflicts.empty(); }
+
+    /**
+     * @brief Writes a summary line and one line per conflict.
+     * @param out Stream to write to
+     */
+    void report(std::ostream& out) const;
+
+private:
+    typedef std::bitset<257> Lookahead;   ///< Set of terminals, the end of input included
+
+    /**
+     * @brief LR(0) item set, kernel first, with its transitions.
+     */
+    struct State {
+        std::vector<size_t> items;        ///< Items: kernel (sorted), then closure
+        size_t kernel;                    ///< Number of kernel items
+        size_t firstItem;                 ///< Index of items[0] in `lookahead`
+        std::vector<std::pair<size_t, unsigned> > edges; ///< Symbol and next state
+    };
+
+    const Grammar& grammar;                              ///< Translated grammar
+    unsigned char classOf[256];                          ///< Byte class of each byte
+    unsigned classCount;                                 ///< Number of byte classes
+    size_t terms;                                        ///< Byte classes plus the end of input
+    size_t nonterminals;                                 ///< Number of nonterminals
+    std::vector<std::bitset<256> > classBytes;           ///< Bytes of each class
+
+    std::vector<Production> prods;                       ///< Productions, contiguous per nonterminal
+    std::vector<size_t> rhs;                             ///< Right-hand sides; terminals first, then terms + nonterminal
+    std::vector<size_t> firstProd;                       ///< First production of each nonterminal
+    std::vector<size_t> prodCount;                       ///< Productions of each nonterminal
+    std::vector<const Rule*> owner;                      ///< Rule whose translation created each nonterminal
+    std::vector<size_t> itemNext;                        ///< Symbol after the dot of each item, or NONE
+    std::vector<size_t> itemProd;                        ///< Production of each item
+    std::vector<bool> nullable;                          ///< Nonterminal derives the empty string
+    std::vector<Lookahead> first;                        ///< FIRST terminals of each nonterminal
+
+    std::map<const Rule*, size_t> ruleSymbol;            ///< Nonterminal of each rule
+    std::map<const Expression*, size_t> exprSymbol;      ///< Symbol of each translated expression
+    std::map<std::vector<size_t>, size_t> shared;        ///< Nonterminal per structural key
+    std::map<const Rule*, unsigned> starts;              ///< Start state of each rule
+    const Rule* current;                                 ///< Rule being translated
+
+    std::vector<State> states;                           ///< LR(0) item sets
+    std::vector<Lookahead> lookahead;                    ///< LALR(1) lookahead of every item of every state
+    std::vector<unsigned> actions;                       ///< Packed action per state and terminal
+    std::vector<unsigned> gotos;                         ///< Next state per state and nonterminal
+    std::vector<Conflict> conflicts;                     ///< Losing productions
+
+    LalrTable(const LalrTable&);
+    LalrTable& operator=(const LalrTable&);
+
+    void splitClasses();
+    void collectSets(const Expression* expr, std::vector<std::bitset<256> >& sets) const;
+    size_t addNonterminal();
+    size_t symbolOf(const Expression* expr);
+    size_t sharedSymbol(const std::vector<size_t>& key, Build build, const Expression* expr,
+                        const std::vector<std::vector<size_t> >& bodies);
+    void addProduction(size_t lhs, const std::vector<size_t>& right, Build build,
+                       const Expression* expr, const Rule* rule);
+    void solve();
+
+    unsigned addState(const std::vector<size_t>& kernel, std::map<std::vector<size_t>, unsigned>& ids);
+    void buildStates();
+    void propagate();
+    void fillTables();
+    void setAction(unsigned state, size_t term, unsigned action);
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef OPERATOR_TABLE_HPP
+#define OPERATOR_TABLE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct ASTNode;
+
+/**
+ * @brief Binary operators of an expression rule, by precedence level.
+ *
+ * Declared with Grammar::addOperatorRule() as levels separated by `|`,
+ * loosest first, each an associativity followed by its literals:
+ * `left '||' | left '&&' | left '+' '-' | left '*' '/' | right '^'`.
+ *
+ * The rule matches `operand { op operand }` like the chain
+ * `operand { 'op1' operand | 'op2' operand | ... }` it is stored as, so
+ * every engine and analysis sees an ordinary rule body. Its tree is
+ * binary instead: each operator becomes an `<infix>` node holding the
+ * left operand, the operator's terminal node and the right operand, and
+ * tighter levels and associativity decide the nesting. The recursive
+ * engine builds that tree directly by precedence climbing; fold() turns
+ * the chain's tree into it for the other engines.
+ */
+class OperatorTable {
+public:
+    /**
+     * @brief How operators of the same level group.
+     */
+    enum Assoc {
+        ASSOC_LEFT,   ///< `a - b - c` is `(a - b) - c`
+        ASSOC_RIGHT   ///< `a ^ b ^ c` is `a ^ (b ^ c)`
+    };
+
+    /**
+     * @brief One operator, in declaration order.
+     */
+    struct Operator {
+        std::string literal;  ///< Operator text
+        size_t level;         ///< Precedence level, 0 binds loosest
+    };
+
+    /// Returned by levelOf() for a literal that is not an operator.
+    static const size_t NO_LEVEL = static_cast<size_t>(-1);
+
+    OperatorTable();
+
+    /**
+     * @brief Reads a table such as `left '+' '-' | right '^'`.
+     *
+     * Errors (an unknown associativity, a level without operators, an
+     * empty or repeated literal) are reported on std::cerr.
+     * @param text Table text
+     * @return false if the text is not a valid table
+     */
+    bool parse(const std::string& text);
+
+    /**
+     * @brief Operators in declaration order; the i-th is the i-th branch
+     * of the rule's chain.
+     */
+    const std::vector<Operator>& getOperators() const { return ops; }
+
+    /**
+     * @brief Returns the number of precedence levels.
+     */
+    size_t levelCount() const { return assocs.size(); }
+
+    /**
+     * @brief Returns the associativity of a level.
+     */
+    Assoc assoc(size_t level) const { return assocs[level]; }
+
+    /**
+     * @brief Returns the level of an operator literal, or NO_LEVEL.
+     */
+    size_t levelOf(const std::string& literal) const;
+
+    /**
+     * @brief Whether an operator already read applies before the next one.
+     * @param stacked Level of the earlier operator
+     * @param next Level of the operator that follows its right operand
+     */
+    bool appliesFirst(size_t stacked, size_t next) const {
+        return stacked > next || (stacked == next && assocs[next] == ASSOC_LEFT);
+    }
+
+    /**
+     * @brief Rebuilds the tree of a matched chain as `<infix>` nodes.
+     *
+     * `chain` is the node of the rule body: a `<seq>` of the first
+     * operand and a `<rep>` whose iterations hold an operator and an
+     * operand. The iterations' `<seq>` nodes become the `<infix>` nodes;
+     * the other structural nodes are deleted unless they are pooled
+     * (ASTNode::pooled). Spans are taken from the operands.
+     * @param chain Body node of the rule, may be null
+     * @return Root of the binary tree, or the only operand
+     */
+    ASTNode* fold(ASTNode* chain) const;
+
+private:
+    std::vector<Operator> ops;   ///< Operators in declaration order
+    std::vector<Assoc> assocs;   ///< Associativity per level
+};
+
+#endif
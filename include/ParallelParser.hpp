@@ -0,0 +1,143 @@
+#ifndef PARALLEL_PARSER_HPP
+#define PARALLEL_PARSER_HPP
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "BNFParser.hpp"
+#include "BatchResult.hpp"
+
+/**
+ * @brief Parses large batches of independent inputs on a thread pool.
+ *
+ * A batch is cut into chunks of consecutive inputs. Every worker thread
+ * owns a BNFParser over the shared CompiledGrammar, and with it its own
+ * scratch stacks, FIRST cache and batch node pool; nothing mutable is
+ * shared between workers. Chunks are dealt out in contiguous runs, one
+ * deque per worker. A worker takes chunks from the back of its own deque
+ * and, once that is empty, steals from the front of another worker's.
+ *
+ * Each chunk is parsed with BNFParser::parseBatch() into its own
+ * BatchResult, so results stay in input order without any merging:
+ * input i is entry i % getChunkSize() of chunk i / getChunkSize().
+ *
+ * The threads are started by the constructor and live until destruction.
+ * A ParallelParser itself must be driven by one thread at a time.
+ */
+class ParallelParser {
+public:
+    /// Default number of inputs per chunk.
+    static const size_t DEFAULT_CHUNK_SIZE = 64;
+
+    /**
+     * @brief Starts the worker threads.
+     * @param cg Linked grammar shared by all workers (see Grammar::finalize())
+     * @param threads Number of worker threads (at least 1)
+     */
+    ParallelParser(const CompiledGrammar& cg, size_t threads);
+
+    /**
+     * @brief Stops and joins the worker threads.
+     */
+    ~ParallelParser();
+
+    /**
+     * @brief Parses every input with the same start rule.
+     *
+     * Returns once all inputs are parsed. The results replace those of the
+     * previous call and hold spans into @p inputs.
+     * @param ruleName Name of the grammar rule to use as starting point
+     * @param inputs Inputs to parse
+     * @return Number of inputs that matched
+     */
+    size_t parseAll(const std::string& ruleName, const std::vector<std::string>& inputs);
+
+    /**
+     * @brief Returns the number of inputs of the last parseAll().
+     */
+    size_t size() const { return inputCount; }
+
+    /**
+     * @brief Returns the outcome for one input of the last parseAll().
+     */
+    const BatchResult::Entry& entry(size_t index) const;
+
+    /**
+     * @brief Returns the chunk result holding one input's tree.
+     * @param index Input index
+     * @param local Receives the input's entry index within the chunk
+     */
+    const BatchResult& resultOf(size_t index, size_t& local) const;
+
+    /**
+     * @brief Rebuilds an ASTNode tree for one input.
+     * @return Heap tree owned by the caller, or nullptr if the input failed
+     */
+    ASTNode* toAST(size_t index, const std::string& input) const;
+
+    /**
+     * @brief Sets how many consecutive inputs form one unit of work.
+     * @param inputs Inputs per chunk (default: DEFAULT_CHUNK_SIZE)
+     */
+    void setChunkSize(size_t inputs);
+    size_t getChunkSize() const { return chunkSize; }
+
+    size_t getThreadCount() const { return workers.size(); }
+
+    /**
+     * @brief Selects the engine of every worker parser.
+     */
+    void setEngine(BNFParser::Engine e);
+
+    /**
+     * @brief Enables packrat memoization in every worker parser.
+     */
+    void setMemoization(bool enabled);
+
+    /**
+     * @brief Returns how many chunks were stolen during the last parseAll().
+     */
+    size_t getSteals() const;
+
+private:
+    struct Worker {
+        ParallelParser* owner;
+        BNFParser parser;              ///< Private parser: scratch, FIRST cache, node pool
+        std::deque<size_t> chunks;     ///< Chunk indices still to parse
+        pthread_mutex_t lock;          ///< Guards chunks
+        pthread_t thread;
+        size_t steals;                 ///< Chunks taken from other workers
+        size_t accepted;               ///< Inputs matched in this job
+
+        Worker(ParallelParser* o, const CompiledGrammar& cg);
+    };
+
+    std::vector<Worker*> workers;
+    std::vector<BatchResult> results;  ///< One result per chunk, in input order
+    size_t chunkSize;
+    size_t inputCount;
+
+    // Current job, published under `mutex`
+    const std::string* rule;
+    const std::vector<std::string>* inputs;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;               ///< A job was posted, or shutdown
+    pthread_cond_t done;               ///< The job finished
+    size_t generation;                 ///< Job counter seen by the workers
+    size_t pending;                    ///< Chunks not finished yet
+    size_t active;                     ///< Workers inside the current job
+    bool stopping;
+
+    ParallelParser(const ParallelParser&);
+    ParallelParser& operator=(const ParallelParser&);
+
+    static void* workerMain(void* arg);
+    void work(Worker& self);
+    bool takeChunk(Worker& self, size_t& chunk);
+    void parseChunk(Worker& self, size_t chunk);
+};
+
+#endif // PARALLEL_PARSER_HPP
@@ -0,0 +1,119 @@
+#ifndef PARSE_SESSION_HPP
+#define PARSE_SESSION_HPP
+
+#include <string>
+#include <vector>
+#include "BNFParser.hpp"
+
+/**
+ * @brief Push-style incremental parse of a stream of messages.
+ *
+ * Input arrives in chunks through feed(). The session drives the parser's
+ * iterative engine over the bytes buffered so far and suspends it, frame
+ * stack and all, as soon as a leaf needs bytes that have not arrived yet.
+ * The next feed() resumes exactly there, so no input is scanned twice.
+ *
+ * A result is reported as soon as the start rule finishes. A trailing
+ * repetition can only finish once a byte that does not continue it
+ * arrives, or at finish(). Several messages may be taken from one stream:
+ * takeResult() drops the consumed bytes and readies the next message.
+ *
+ * Session trees always carry copied matched text (zero-copy mode does not
+ * apply, since the buffer changes) and packrat memoization is not used.
+ * The parser must outlive the session and must not be used from another
+ * thread while a session call is running.
+ */
+class ParseSession {
+public:
+    /**
+     * @brief State of the session after the last call.
+     */
+    enum Status {
+        NEED_MORE,      ///< The current message needs more input
+        COMPLETE,       ///< A message was parsed; collect it with takeResult()
+        FAILED,         ///< The buffered input does not match the start rule
+        END_OF_STREAM   ///< finish() was called and every message was taken
+    };
+
+    /**
+     * @brief Creates a session matching messages against a rule.
+     * @param parser Parser providing the grammar and options
+     * @param ruleName Start rule of every message
+     */
+    ParseSession(const BNFParser& parser, const std::string& ruleName);
+    ~ParseSession();
+
+    /**
+     * @brief Appends a chunk of input and continues parsing.
+     * @param data Bytes to append
+     * @param size Number of bytes
+     * @return New status
+     */
+    Status feed(const char* data, size_t size);
+    Status feed(const std::string& data);
+
+    /**
+     * @brief Signals that no more input will arrive and finishes the message.
+     * @return New status
+     */
+    Status finish();
+
+    /**
+     * @brief Continues parsing the bytes already buffered.
+     *
+     * Use after takeResult() when more messages may be waiting in the buffer.
+     * @return New status
+     */
+    Status poll();
+
+    Status getStatus() const { return status; }
+
+    /**
+     * @brief Returns the completed message tree and moves to the next message.
+     * @return Tree owned by the caller, or null if no message is complete
+     */
+    ASTNode* takeResult();
+
+    /**
+     * @brief Returns the length of the completed message.
+     */
+    size_t consumed() const { return status == COMPLETE ? pos : 0; }
+
+    /**
+     * @brief Returns the number of bytes held in the session buffer.
+     */
+    size_t buffered() const { return buffer.size(); }
+
+    /**
+     * @brief Drops all input and partial state and starts over.
+     */
+    void reset();
+
+    /**
+     * @brief Releases buffer and stack capacity while the session is idle.
+     */
+    void shrink();
+
+private:
+    const BNFParser& parser;
+    const Rule* rule;                      ///< Start rule, or null if unknown
+    std::string buffer;                    ///< Bytes of the current and later messages
+    std::vector<BNFParser::Frame> frames;  ///< Suspended engine stack
+    std::vector<BNFParser::GrowEntry>* growing; ///< Suspended left-recursive heads, or null
+    Expression* callee;                    ///< Construct to start on resume
+    ASTNode* node;                         ///< Last finished result
+    ASTNode* result;                       ///< Completed message tree
+    size_t pos;                            ///< Engine position in buffer
+    Status status;
+    bool calling;                          ///< Resume by starting `callee`
+    bool ok;                               ///< Whether the last construct matched
+    bool active;                           ///< A message is in progress
+    bool eof;                              ///< finish() was called
+
+    ParseSession(const ParseSession&);
+    ParseSession& operator=(const ParseSession&);
+
+    void clearFrames();
+};
+
+#endif // PARSE_SESSION_HPP
@@ -0,0 +1,98 @@
+#ifndef VM_PARSER_HPP
+#define VM_PARSER_HPP
+
+#include <string>
+#include <vector>
+#include "Grammar.hpp"
+#include "AST.hpp"
+#include "BytecodeCompiler.hpp"
+
+/**
+ * @brief Parsing virtual machine executing a compiled BytecodeProgram.
+ *
+ * Drop-in alternative to BNFParser: the grammar is lowered once by
+ * BytecodeCompiler at construction, and parse() then runs a flat dispatch
+ * loop instead of walking the Expression tree. Matching semantics and the
+ * resulting AST are those of a BNFParser with default options, except:
+ * - left-recursive rules are not supported; they are reported when the
+ *   grammar is compiled and never match (BytecodeProgram::unsupported);
+ * - alternatives always take the longest match; there is no ordered
+ *   choice, prediction or two-phase mode.
+ *
+ * The VM keeps its backtrack, call and capture stacks on the heap and
+ * reuses them across calls, so one instance must not be shared between
+ * threads.
+ */
+class VMParser {
+public:
+    /**
+     * @brief Compiles the grammar and prepares the VM.
+     * @param g The grammar (all rules must already be added)
+     */
+    explicit VMParser(const Grammar& g);
+
+    /**
+     * @brief Parses input text according to the specified grammar rule.
+     * @param ruleName Name of the grammar rule to use as starting point
+     * @param input The text to parse
+     * @param consumed Output parameter for the number of characters consumed
+     * @return Pointer to the root AST node, or nullptr if parsing failed
+     */
+    ASTNode* parse(const std::string& ruleName,
+                   const std::string& input,
+                   size_t& consumed) const;
+
+    /**
+     * @brief Returns the compiled program (for inspection or dumping).
+     */
+    const BytecodeProgram& getProgram() const { return program; }
+
+private:
+    /**
+     * @brief Saved machine state restored on failure.
+     */
+    struct Backtrack {
+        int target;        ///< Address to resume at
+        size_t pos;        ///< Input position
+        size_t captures;   ///< Capture log length
+        size_t calls;      ///< Call stack depth
+        size_t alts;       ///< Alternative frame depth
+    };
+
+    /**
+     * @brief Bookkeeping of one longest-match alternative.
+     */
+    struct AltFrame {
+        size_t start;      ///< Position where the alternative began
+        size_t open;       ///< Index of the "<alt>" open capture
+        size_t bestEnd;    ///< End of the longest branch so far
+        size_t bestLen;    ///< Captures produced by that branch
+        bool any;          ///< Whether any branch matched
+    };
+
+    /**
+     * @brief Entry of the capture log replayed into an AST.
+     */
+    struct Capture {
+        enum Kind { OPEN, CLOSE, LEAF, EMPTY };
+        Kind kind;         ///< Event type
+        int symbol;        ///< Symbol index (OPEN, LEAF)
+        size_t pos;        ///< Input position
+        size_t len;        ///< Match length (LEAF)
+    };
+
+    BytecodeProgram program;                    ///< Compiled grammar
+    mutable std::vector<Backtrack> backtrack;   ///< Backtrack stack
+    mutable std::vector<int> calls;             ///< Return addresses
+    mutable std::vector<AltFrame> alts;         ///< Open alternatives
+    mutable std::vector<Capture> captures;      ///< Capture log
+    mutable std::vector<ASTNode*> openNodes;    ///< buildTree: open nodes
+    mutable std::vector<size_t> openStarts;     ///< buildTree: their start offsets
+    mutable std::vector<int> openSymbols;       ///< buildTree: their symbols
+
+    bool run(int entry, const std::string& input, size_t& pos) const;
+    ASTNode* buildTree(const std::string& input) const;
+    void pushCapture(Capture::Kind kind, int symbol, size_t pos, size_t len) const;
+};
+
+#endif
@@ -2,15 +2,37 @@
 #include "../include/Debug.hpp"
 
 // ASTNode implementation
-ASTNode::ASTNode(const std::string& s) : symbol(s) {
+ASTNode::ASTNode(const std::string& s)
+    : symbol(s), pooled(false), refs(0), begin(0), end(0), source(0) {
     DEBUG_MSG("ASTNode created: '" << s << "'");
 }
 
-// Destructor recursively deletes all child nodes to prevent memory leaks
+// Matched text, read from the input span when available
+std::string ASTNode::text() const {
+    if (source) return source->substr(begin, end - begin);
+    return matched;
+}
+
+// Destructor deletes the subtree. Each descendant's children are moved to
+// a worklist before it is deleted, so nested deletes never recurse. A shared
+// descendant stays alive for its other owners.
 ASTNode::~ASTNode() {
     DEBUG_MSG("ASTNode destroyed: '" << symbol << "' with " << children.size() << " children");
-    for (size_t i = 0; i < children.size(); ++i)
-        delete children[i];
+    if (pooled || children.empty()) return;
+    std::vector<ASTNode*> pending;
+    pending.swap(children);
+    while (!pending.empty()) {
+        ASTNode* n = pending.back();
+        pending.pop_back();
+        if (!n || n->pooled) continue;
+        if (n->refs) {
+            --n->refs;
+            continue;
+        }
+        pending.insert(pending.end(), n->children.begin(), n->children.end());
+        n->children.clear();
+        delete n;
+    }
 }
 
 // Helper function to print indentation for hierarchical display
@@ -33,8 +55,9 @@ void printAST(const ASTNode* node, int indent) {
     std::cout << node->symbol;
 
     // Show matched text if available (useful for understanding repetitions and alternatives)
-    if (!node->matched.empty())
-        std::cout << "  [matched=\"" << node->matched << "\"]";
+    std::string text = node->text();
+    if (!text.empty())
+        std::cout << "  [matched=\"" << text << "\"]";
 
     std::cout << "\n";
 
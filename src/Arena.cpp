@@ -2,28 +2,36 @@
 #include <cstdlib>
 #include <new>
 
-Arena::Arena(std::size_t blockSize) : defaultBlockSize(blockSize) {
+Arena::Arena(std::size_t blockSize) : current(0), defaultBlockSize(blockSize) {
     blocks.reserve(4);
 }
 
 Arena::~Arena() {
+    runCleanups();
     for (std::size_t i = 0; i < blocks.size(); ++i) {
         std::free(blocks[i].data);
     }
 }
 
+// Move to the next block that can hold minSize bytes. Blocks kept by
+// reset() are reused before new memory is requested.
 void Arena::addBlock(std::size_t minSize) {
+    while (!blocks.empty() && current + 1 < blocks.size()) {
+        ++current;
+        if (blocks[current].size >= minSize) return;
+    }
     std::size_t size = minSize > defaultBlockSize ? minSize : defaultBlockSize;
     char* mem = static_cast<char*>(std::malloc(size));
-    Block b; b.data = mem; b.used = 0; b.size = size;
+    Block b; b.data = mem; b.used = 0; b.size = mem ? size : 0;
     blocks.push_back(b);
+    current = blocks.size() - 1;
 }
 
 void* Arena::allocate(std::size_t size, std::size_t alignment) {
     if (alignment < sizeof(void*)) alignment = sizeof(void*);
     // Try current block
     if (blocks.empty()) addBlock(size);
-    Block& blk = blocks.back();
+    Block& blk = blocks[current];
     // Align current pointer
     std::size_t base = reinterpret_cast<std::size_t>(blk.data);
     std::size_t curr = base + blk.used;
@@ -32,7 +40,7 @@ void* Arena::allocate(std::size_t size, std::size_t alignment) {
     if (offset + size > blk.size) {
         // Need new block
         addBlock(size + alignment);
-        Block& nb = blocks.back();
+        Block& nb = blocks[current];
         base = reinterpret_cast<std::size_t>(nb.data);
         aligned = (base + (alignment - 1)) & ~(alignment - 1);
         offset = aligned - base;
@@ -44,8 +52,29 @@ void* Arena::allocate(std::size_t size, std::size_t alignment) {
     return blk.data + offset;
 }
 
+void Arena::addCleanup(Cleanup fn, void* object) {
+    CleanupEntry e; e.fn = fn; e.object = object;
+    cleanups.push_back(e);
+}
+
+void Arena::runCleanups() {
+    while (!cleanups.empty()) {
+        CleanupEntry e = cleanups.back();
+        cleanups.pop_back();
+        e.fn(e.object);
+    }
+}
+
 void Arena::reset() {
+    runCleanups();
     for (std::size_t i = 0; i < blocks.size(); ++i) {
         blocks[i].used = 0;
     }
+    current = 0;
+}
+
+std::size_t Arena::capacity() const {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < blocks.size(); ++i) total += blocks[i].size;
+    return total;
 }
@@ -2,110 +2,425 @@
 #include "../include/Expression.hpp"
 #include "../include/Debug.hpp"
 #include <iostream>
+#include <algorithm>
 #include <cstring>
+#include <new>
+
+const size_t BNFParser::DEFAULT_MEMO_LIMIT;
+
+// No growing head (see growHead())
+static const size_t NO_HEAD = static_cast<size_t>(-1);
+
+// Logged for an alternative that matched only empty, or a step of
+// precedence climbing that found no operator
+static const size_t NO_DECISION = static_cast<size_t>(-1);
+
+namespace {
+
+// Sets a parser mode for one scope. It is restored when the scope is left,
+// also by an exception (e.g. std::bad_alloc), so a failed call never leaves
+// the mode on for the next one.
+template <class T>
+class ScopedValue {
+public:
+    ScopedValue(T& target, T value) : target(target), saved(target) { target = value; }
+    ~ScopedValue() { target = saved; }
+
+private:
+    T& target;
+    T saved;
+
+    ScopedValue(const ScopedValue&);
+    ScopedValue& operator=(const ScopedValue&);
+};
+
+// Lends a container to the parser for one scope: swapped in on entry and
+// back out on exit, also when an exception leaves the scope.
+template <class T>
+class ScopedSwap {
+public:
+    ScopedSwap(T& target, T& lent) : target(target), lent(lent) { target.swap(lent); }
+    ~ScopedSwap() { target.swap(lent); }
+
+private:
+    T& target;
+    T& lent;
+
+    ScopedSwap(const ScopedSwap&);
+    ScopedSwap& operator=(const ScopedSwap&);
+};
+
+}
+
+BNFParser::ParseStats::ParseStats()
+    : memoHits(0), memoMisses(0), memoStores(0), memoRejected(0),
+      memoPeakBytes(0), peakDepth(0), depthAborts(0), pairPrunes(0),
+      predictions(0), earleyItems(0), reductions(0), seedGrowths(0),
+      climbs(0), nodesBuilt(0), decisions(0) {}
 
 // BNFParser implementation
 BNFParser::BNFParser(const Grammar& g)
-    : grammar(g)
+    : grammar(g),
+      compiled(g.getCompiled()),
+      firstSets(0),
+      memoEnabled(false),
+      memoLimit(DEFAULT_MEMO_LIMIT),
+      memoArena(8192),
+      memoBytes(0),
+      orderedEnabled(false),
+      orderedResolved(false),
+      engine(ENGINE_RECURSIVE),
+      maxDepth(0),
+      growLow(NO_HEAD),
+      astArena(0),
+      zeroCopy(false),
+      collapseRuns(false),
+      dispatch(true),
+      keywordTries(true),
+      regularDfa(true),
+      collapseRegular(false),
+      pairPruning(false),
+      pairAnalysis(0),
+      predictive(false),
+      ll1(0),
+      earley(0),
+      lalr(0),
+      noTree(false),
+      twoPhase(false),
+      recording(false),
+      replaying(false),
+      replayAt(0),
+      streaming(false),
+      streamOpen(false),
+      poolUsed(0),
+      batching(false)
 {
 }
 
-BNFParser::~BNFParser() {}
+BNFParser::BNFParser(const CompiledGrammar& cg)
+    : grammar(cg.getGrammar()),
+      compiled(&cg),
+      firstSets(0),
+      memoEnabled(false),
+      memoLimit(DEFAULT_MEMO_LIMIT),
+      memoArena(8192),
+      memoBytes(0),
+      orderedEnabled(false),
+      orderedResolved(false),
+      engine(ENGINE_RECURSIVE),
+      maxDepth(0),
+      growLow(NO_HEAD),
+      astArena(0),
+      zeroCopy(false),
+      collapseRuns(false),
+      dispatch(true),
+      keywordTries(true),
+      regularDfa(true),
+      collapseRegular(false),
+      pairPruning(false),
+      pairAnalysis(0),
+      predictive(false),
+      ll1(0),
+      earley(0),
+      lalr(0),
+      noTree(false),
+      twoPhase(false),
+      recording(false),
+      replaying(false),
+      replayAt(0),
+      streaming(false),
+      streamOpen(false),
+      poolUsed(0),
+      batching(false)
+{
+}
 
-void BNFParser::mergeFirst(FirstInfo& dst, const FirstInfo& src) const {
-    dst.chars |= src.chars;
-    dst.nullable = dst.nullable || src.nullable;
+BNFParser::~BNFParser() {
+    memoEnd();
+    delete pairAnalysis;
+    delete ll1;
+    delete earley;
+    delete lalr;
+    delete firstSets;
+    for (std::map<const Rule*, Expression*>::iterator it = entryCalls.begin();
+         it != entryCalls.end(); ++it)
+        delete it->second;
+    // Seed bodies share their branches with the rules
+    for (std::map<const Rule*, Expression*>::iterator it = seedBodies.begin();
+         it != seedBodies.end(); ++it) {
+        if (!it->second) continue;
+        it->second->children.clear();
+        delete it->second;
+    }
+    for (size_t i = 0; i < nodePool.size(); ++i)
+        delete nodePool[i];
 }
 
-void BNFParser::addChar(FirstInfo& fi, unsigned char c) const {
-    fi.chars.set(static_cast<size_t>(c));
+void BNFParser::setMemoization(bool enabled) {
+    memoEnabled = enabled;
+    memoDecisions.clear();
 }
 
-std::string BNFParser::terminalFirstString(Expression* expr) const {
-    std::string literal = stripQuotes(expr->value);
-    return literal;
+void BNFParser::setMemoLimit(size_t bytes) {
+    memoLimit = bytes;
 }
 
-const BNFParser::FirstInfo& BNFParser::computeFirst(Expression* expr) const {
-    std::map<Expression*, FirstInfo>::iterator it = firstCache.find(expr);
-    if (it != firstCache.end()) return it->second;
+void BNFParser::setRuleMemoization(const std::string& ruleName, bool enabled) {
+    memoOverrides[ruleName] = enabled;
+    memoDecisions.clear();
+}
 
-    FirstInfo fi;
-    switch (expr->type) {
-        case Expression::EXPR_TERMINAL: {
-            std::string lit = terminalFirstString(expr);
-            if (!lit.empty()) {
-                addChar(fi, static_cast<unsigned char>(lit[0]));
-            } else {
-                fi.nullable = true;
-            }
-            break;
-        }
-        case Expression::EXPR_SYMBOL: {
-            Rule* rr = grammar.getRule(expr->value);
-            if (rr && rr->rootExpr) {
-                fi = computeFirst(rr->rootExpr);
-            }
-            break;
-        }
-        case Expression::EXPR_SEQUENCE: {
-            fi.nullable = true;
-            for (size_t i = 0; i < expr->children.size(); ++i) {
-                const FirstInfo& childFirst = computeFirst(expr->children[i]);
-                mergeFirst(fi, childFirst);
-                if (!childFirst.nullable) {
-                    fi.nullable = false;
-                    break;
-                }
-            }
-            break;
-        }
-        case Expression::EXPR_ALTERNATIVE: {
-            for (size_t i = 0; i < expr->children.size(); ++i) {
-                const FirstInfo& childFirst = computeFirst(expr->children[i]);
-                mergeFirst(fi, childFirst);
-            }
-            break;
-        }
-        case Expression::EXPR_OPTIONAL: {
-            fi.nullable = true;
-            if (!expr->children.empty()) {
-                const FirstInfo& childFirst = computeFirst(expr->children[0]);
-                mergeFirst(fi, childFirst);
-            }
-            break;
-        }
-        case Expression::EXPR_REPEAT: {
-            fi.nullable = true;
-            if (!expr->children.empty()) {
-                const FirstInfo& childFirst = computeFirst(expr->children[0]);
-                mergeFirst(fi, childFirst);
-            }
-            break;
-        }
-        case Expression::EXPR_CHAR_RANGE: {
-            unsigned char start = expr->charRange.start;
-            unsigned char end = expr->charRange.end;
-            for (unsigned int c = start; c <= end; ++c) {
-                addChar(fi, static_cast<unsigned char>(c));
-                if (c == 255) break; // avoid overflow
-            }
-            fi.nullable = false;
-            break;
-        }
-        case Expression::EXPR_CHAR_CLASS: {
-            fi.nullable = false;
-            for (size_t i = 0; i < 256; ++i) {
-                if (expr->classMatches(static_cast<unsigned char>(i))) fi.chars.set(i);
-            }
-            break;
+void BNFParser::setOrderedChoice(bool enabled) {
+    orderedEnabled = enabled;
+    orderedDecisions.clear();
+    orderedResolved = false;
+}
+
+void BNFParser::setRuleOrderedChoice(const std::string& ruleName, bool enabled) {
+    orderedOverrides[ruleName] = enabled;
+    orderedDecisions.clear();
+    orderedResolved = false;
+}
+
+void BNFParser::setEngine(Engine e) {
+    engine = e;
+}
+
+BNFParser::Engine BNFParser::getEngine() const {
+    return engine;
+}
+
+void BNFParser::setMaxDepth(size_t frames) {
+    maxDepth = frames;
+}
+
+void BNFParser::setCollapseRuns(bool enabled) {
+    collapseRuns = enabled;
+}
+
+void BNFParser::setDispatch(bool enabled) {
+    dispatch = enabled;
+}
+
+void BNFParser::setKeywordTries(bool enabled) {
+    keywordTries = enabled;
+}
+
+void BNFParser::setRegularDfa(bool enabled) {
+    regularDfa = enabled;
+}
+
+void BNFParser::setCollapseRegular(bool enabled) {
+    collapseRegular = enabled;
+}
+
+void BNFParser::setFirstPairs(bool enabled) {
+    pairPruning = enabled;
+}
+
+void BNFParser::setPredictive(bool enabled) {
+    predictive = enabled;
+}
+
+void BNFParser::setTwoPhase(bool enabled) {
+    twoPhase = enabled;
+}
+
+void BNFParser::setZeroCopy(bool enabled) {
+    zeroCopy = enabled;
+}
+
+const BNFParser::ParseStats& BNFParser::getStats() const {
+    return stats;
+}
+
+void BNFParser::resetStats() {
+    stats = ParseStats();
+}
+
+// ---------------- AST allocation ----------------
+
+static void destroyPooledNode(void* p) {
+    static_cast<ASTNode*>(p)->~ASTNode();
+}
+
+// Allocate a node on the heap, or from the arena of an arena parse
+ASTNode* BNFParser::newNode(const std::string& symbol) const {
+    if (noTree) return 0;
+    stats.nodesBuilt++;
+    if (batching) return poolNode(symbol);
+    if (!astArena) return new ASTNode(symbol);
+    void* mem = astArena->allocate(sizeof(ASTNode));
+    if (!mem) throw std::bad_alloc();
+    ASTNode* node = new (mem) ASTNode(symbol);
+    node->pooled = true;
+    astArena->addCleanup(destroyPooledNode, node);
+    return node;
+}
+
+// Deep copy into the current node storage. The tree is walked with an
+// explicit worklist of (original, parent copy), so depth costs no stack.
+ASTNode* BNFParser::cloneNode(const ASTNode* node) const {
+    if (!node || noTree) return 0;
+    ASTNode* root = 0;
+    std::vector<std::pair<const ASTNode*, ASTNode*> > pending(1, std::make_pair(node, static_cast<ASTNode*>(0)));
+    while (!pending.empty()) {
+        const ASTNode* from = pending.back().first;
+        ASTNode* parent = pending.back().second;
+        pending.pop_back();
+        ASTNode* copy = 0;
+        if (from) {
+            copy = newNode(from->symbol);
+            copy->matched = from->matched;
+            copy->begin = from->begin;
+            copy->end = from->end;
+            copy->source = from->source;
+            copy->children.reserve(from->children.size());
+            // Pushed last to first, so children are copied in order
+            for (size_t i = from->children.size(); i-- > 0; )
+                pending.push_back(std::make_pair(from->children[i], copy));
         }
-        default:
-            break;
+        if (parent) parent->children.push_back(copy);
+        else root = copy;
+    }
+    return root;
+}
+
+// Record the [begin, end) span of a node. Zero-copy nodes point at the
+// input; otherwise the text is copied to `matched`, so the tree does not
+// depend on the input's lifetime. Batch trees are flattened to spans
+// before the input moves on and need neither.
+void BNFParser::setSpan(ASTNode* node, const std::string& input,
+                        size_t begin, size_t end) const {
+    if (!node) return;
+    node->begin = begin;
+    node->end = end;
+    if (batching) return;
+    if (zeroCopy && !streaming) node->source = &input;
+    else node->matched.assign(input, begin, end - begin);
+}
+
+// Append a child to a node under construction (no-op when recognizing)
+void BNFParser::attach(ASTNode* parent, ASTNode* child) const {
+    if (parent) parent->children.push_back(child);
+}
+
+// Drop a losing subtree; arena and pool nodes are reclaimed by their owner,
+// a pinned seed (see pinSeed()) by its growing head, and a shared node by
+// its last owner
+void BNFParser::discard(ASTNode* node) const {
+    if (astArena || batching || !node || node->pooled) return;
+    if (node->refs) --node->refs;
+    else delete node;
+}
+
+// Hand out a node that already has an owner. Arena and pool nodes are
+// released all at once and need no count.
+ASTNode* BNFParser::shareNode(ASTNode* node) const {
+    if (node && !node->pooled) ++node->refs;
+    return node;
+}
+
+// Batch node storage: nodes are recycled for every input, keeping the
+// capacity of their symbol strings and child vectors
+ASTNode* BNFParser::poolNode(const std::string& symbol) const {
+    if (poolUsed == nodePool.size()) {
+        ASTNode* fresh = new ASTNode(symbol);
+        fresh->pooled = true;
+        nodePool.push_back(fresh);
+        ++poolUsed;
+        return fresh;
+    }
+    ASTNode* node = nodePool[poolUsed++];
+    node->symbol = symbol;
+    node->children.clear();
+    node->begin = node->end = 0;
+    return node;
+}
+
+// ---------------- Packrat memo table ----------------
+
+// Resolve (and cache) whether results of a rule should be memoized
+bool BNFParser::memoizes(const Rule* r) const {
+    std::map<const Rule*, bool>::const_iterator it = memoDecisions.find(r);
+    if (it != memoDecisions.end()) return it->second;
+
+    bool on = memoEnabled;
+    std::map<std::string, bool>::const_iterator ov = memoOverrides.find(r->name);
+    if (ov != memoOverrides.end()) on = ov->second;
+    memoDecisions[r] = on;
+    return on;
+}
+
+// Prepare an empty table with one slot per input position (plus EOF)
+void BNFParser::memoBegin(size_t inputSize) const {
+    memoEnd();
+    if (!memoEnabled && memoOverrides.empty()) return;
+    memoTable.assign(inputSize + 1, static_cast<MemoEntry*>(0));
+    memoBytes = memoTable.size() * sizeof(MemoEntry*);
+}
+
+// Release every stored subtree and recycle the entry storage
+void BNFParser::memoEnd() const {
+    for (size_t i = 0; i < memoTable.size(); ++i) {
+        for (MemoEntry* e = memoTable[i]; e; e = e->next)
+            discard(e->node);
+    }
+    if (memoBytes > stats.memoPeakBytes) stats.memoPeakBytes = memoBytes;
+    memoTable.clear();
+    memoArena.reset();
+    memoChoices.clear();
+    memoBytes = 0;
+}
+
+BNFParser::MemoEntry* BNFParser::memoLookup(const Rule* r, size_t pos) const {
+    if (pos >= memoTable.size()) return 0;
+    for (MemoEntry* e = memoTable[pos]; e; e = e->next) {
+        if (e->rule == r) return e;
+    }
+    return 0;
+}
+
+// Record a rule outcome. On success the memo becomes another owner of
+// `node`, which the parse goes on using, so a hit hands out the same
+// subtree instead of a copy. While a two-phase parse records, the entry
+// also keeps the choices logged from `logFrom` on.
+void BNFParser::memoStore(const Rule* r, size_t pos, bool ok, size_t end,
+                          ASTNode* node, size_t logFrom) const
+{
+    if (pos >= memoTable.size()) return;
+    size_t logCount = recording && ok ? decisionLog.size() - logFrom : 0;
+    size_t bytes = sizeof(MemoEntry) + logCount * sizeof(size_t);
+    if (memoBytes + bytes > memoLimit) {
+        stats.memoRejected++;
+        return;
     }
 
-    std::pair<std::map<Expression*, FirstInfo>::iterator, bool> inserted = firstCache.insert(std::make_pair(expr, fi));
-    return inserted.first->second;
+    void* mem = memoArena.allocate(sizeof(MemoEntry));
+    if (!mem) {
+        stats.memoRejected++;
+        return;
+    }
+    MemoEntry* e = static_cast<MemoEntry*>(mem);
+    e->rule = r;
+    e->ok = ok;
+    e->end = end;
+    e->node = ok ? shareNode(node) : 0;
+    e->logBegin = memoChoices.size();
+    e->logCount = logCount;
+    if (logCount) memoChoices.insert(memoChoices.end(), decisionLog.begin() + logFrom, decisionLog.end());
+    e->next = memoTable[pos];
+    memoTable[pos] = e;
+
+    memoBytes += bytes;
+    stats.memoStores++;
+}
+
+// FIRST/nullable of an unlinked grammar's expression. FirstSets solves the
+// rules as a fixpoint, so recursive and left-recursive rules terminate.
+const FirstSets::Info& BNFParser::computeFirst(Expression* expr) const {
+    if (!firstSets) firstSets = new FirstSets(grammar);
+    return firstSets->of(expr);
 }
 
 // Remove surrounding quotes from terminal strings
@@ -122,33 +437,160 @@ std::string BNFParser::stripQuotes(const std::string& s) const{
 ASTNode* BNFParser::parse(const std::string& ruleName,
                           const std::string& input,
                           size_t& consumed) const
+{
+    return parse(ruleName, input, consumed, engine);
+}
+
+// Per-call engine: it is passed down, and the selected one is untouched
+ASTNode* BNFParser::parse(const std::string& ruleName,
+                          const std::string& input,
+                          size_t& consumed,
+                          Engine e) const
+{
+    ASTNode* root = 0;
+    return run(ruleName, input, consumed, root, e) ? root : 0;
+}
+
+bool BNFParser::recognize(const std::string& ruleName,
+                          const std::string& input,
+                          size_t& consumed) const
+{
+    return recognize(ruleName, input, consumed, engine);
+}
+
+// Recognizer entry point: same matching, but no node is ever created
+bool BNFParser::recognize(const std::string& ruleName,
+                          const std::string& input,
+                          size_t& consumed,
+                          Engine e) const
+{
+    ScopedValue<bool> tree(noTree, true);
+    ASTNode* root = 0;
+    return run(ruleName, input, consumed, root, e);
+}
+
+const Rule* BNFParser::findRule(const std::string& ruleName) const {
+    return compiled ? compiled->getRule(ruleName) : grammar.getRule(ruleName);
+}
+
+// Shared driver of parse() and recognize()
+bool BNFParser::run(const std::string& ruleName,
+                    const std::string& input,
+                    size_t& consumed,
+                    ASTNode*& root,
+                    Engine e) const
 {
     DEBUG_MSG("Starting parse for rule: " + ruleName + " with input: '" + input + "'");
     consumed = 0;
 
     // Find the requested grammar rule
-    Rule* r = grammar.getRule(ruleName);
+    const Rule* r = findRule(ruleName);
     if (!r) {
         DEBUG_MSG("Rule not found: " + ruleName);
         std::cerr << "BNFParser::parse: rule not found: " << ruleName << std::endl;
-        return 0;
+        return false;
     }
+    return runRule(r, input, consumed, root, e);
+}
 
+// Parse `input` from an already resolved start rule with engine `e`
+bool BNFParser::runRule(const Rule* r,
+                        const std::string& input,
+                        size_t& consumed,
+                        ASTNode*& root,
+                        Engine e) const
+{
     // Attempt to parse the input using the rule's expression
     size_t pos = 0;
-    ASTNode* root = 0;
-    bool ok = parseExpression(r->rootExpr, input, pos, root);
+    bool tables = e == ENGINE_EARLEY || e == ENGINE_LALR;
+    const Dfa* dfa = tables ? 0 : ruleDfa(r);
+    bool ok;
+    if (e == ENGINE_EARLEY) {
+        ok = parseEarley(r, input, pos, root);
+        if (ok) root = operatorTree(r, root);
+    } else if (e == ENGINE_LALR) {
+        ok = parseLalr(r, input, pos, root);
+        if (ok) root = operatorTree(r, root);
+    } else if (dfa) {
+        ok = scanRule(dfa, r->name, input, pos, root);
+    } else {
+        memoBegin(input.size());
+        growLow = NO_HEAD;
+        Expression* start = entryExpr(r);
+        if (e == ENGINE_ITERATIVE)
+            ok = parseIterative(start, input, pos, root);
+        else if (twoPhase && !noTree)
+            ok = parseTwoPhase(start, input, pos, root);
+        else
+            ok = parseExpression(start, input, pos, root);
+        if (ok) root = entryNode(r, root);
+        memoEnd();
+    }
 
     if (!ok) {
-        DEBUG_MSG("Parse failed for rule: " + ruleName);
-        if (root) delete root;
-        return 0;
+        DEBUG_MSG("Parse failed for rule: " + r->name);
+        discard(root);
+        root = 0;
+        return false;
     }
 
     consumed = pos;   // Export how much input was consumed by the parser
     DEBUG_MSG("Parse successful, consumed " << consumed << " characters");
 
-    return root;
+    return true;
+}
+
+
+// Arena variant: same parse, with every node allocated from `arena`
+ASTNode* BNFParser::parse(const std::string& ruleName,
+                          const std::string& input,
+                          size_t& consumed,
+                          Arena& arena) const
+{
+    ScopedValue<Arena*> storage(astArena, &arena);
+    return parse(ruleName, input, consumed);
+}
+
+
+// Batch entry point: one rule lookup, and every tree is built from the
+// node pool as spans, flattened into `out` and recycled
+size_t BNFParser::parseBatch(const std::string& ruleName,
+                             const std::string* inputs,
+                             size_t count,
+                             BatchResult& out) const
+{
+    out.clear();
+    out.entries.reserve(count);
+
+    const Rule* r = findRule(ruleName);
+    if (!r) {
+        std::cerr << "BNFParser::parseBatch: rule not found: " << ruleName << std::endl;
+    }
+
+    size_t accepted = 0;
+    ScopedValue<bool> spans(batching, true);
+    for (size_t i = 0; i < count; ++i) {
+        BatchResult::Entry e;
+        e.ok = false;
+        e.consumed = 0;
+        e.root = BatchResult::NONE;
+        ASTNode* root = 0;
+        if (r && runRule(r, inputs[i], e.consumed, root, engine)) {
+            e.ok = true;
+            e.root = out.append(root);
+            ++accepted;
+        }
+        out.entries.push_back(e);
+        poolUsed = 0;
+    }
+    return accepted;
+}
+
+size_t BNFParser::parseBatch(const std::string& ruleName,
+                             const std::vector<std::string>& inputs,
+                             BatchResult& out) const
+{
+    return parseBatch(ruleName, inputs.empty() ? 0 : &inputs[0], inputs.size(), out);
 }
 
 
@@ -165,6 +607,21 @@ bool BNFParser::parseExpression(Expression* expr,
 
     DEBUG_MSG("parseExpression: type=" << expr->type << " at pos=" << pos);
 
+    if (recording) {
+        // A construct that fails leaves no choices behind
+        size_t mark = decisionLog.size();
+        bool ok = dispatchExpression(expr, input, pos, outNode);
+        if (!ok) decisionLog.resize(mark);
+        return ok;
+    }
+    return dispatchExpression(expr, input, pos, outNode);
+}
+
+bool BNFParser::dispatchExpression(Expression* expr,
+                                   const std::string& input,
+                                   size_t& pos,
+                                   ASTNode*& outNode) const
+{
     switch (expr->type) {
         case Expression::EXPR_TERMINAL:
             return parseTerminal(expr, input, pos, outNode);
@@ -195,7 +652,9 @@ bool BNFParser::parseTerminal(Expression* expr,
                               size_t& pos,
                               ASTNode*& outNode) const
 {
-    std::string literal = stripQuotes(expr->value);
+    std::string decoded;
+    if (!compiled) decoded = stripQuotes(expr->value);
+    const std::string& literal = compiled ? expr->literal : decoded;
     DEBUG_MSG("parseTerminal: trying to match '" << literal << "' at pos=" << pos);
 
     size_t len = literal.size();
@@ -206,8 +665,8 @@ bool BNFParser::parseTerminal(Expression* expr,
 
     if (pos + len <= input.size() && input.compare(pos, len, literal) == 0) {
         DEBUG_MSG("parseTerminal: matched '" << literal << "'");
-        ASTNode* node = new ASTNode(literal);
-        node->matched = literal;
+        ASTNode* node = newNode(literal);
+        setSpan(node, input, pos, pos + len);
         pos += len;
         outNode = node;
         return true;
@@ -225,126 +684,611 @@ bool BNFParser::parseSymbol(Expression* expr,
 {
     DEBUG_MSG("parseSymbol: resolving symbol '" << expr->value << "' at pos=" << pos);
     
-    Rule* rr = grammar.getRule(expr->value);
+    const Rule* rr = compiled ? expr->rule : grammar.getRule(expr->value);
     if (!rr) {
         DEBUG_MSG("parseSymbol: unknown symbol " << expr->value);
         std::cerr << "BNFParser::parseSymbol: unknown symbol " << expr->value << std::endl;
         return false;
     }
     
+    const Dfa* dfa = ruleDfa(rr);
+    if (dfa) return scanRule(dfa, expr->value, input, pos, outNode);
+
+    // A left-recursive call where its rule is already growing gets the seed
+    bool grows = leftRecursive(rr);
+    if (grows) {
+        size_t head = growHead(rr, pos);
+        if (head != NO_HEAD) return useSeed(head, pos, outNode);
+    }
+
     size_t savedPos = pos;
-    ASTNode* child = 0;
-    bool ok = parseExpression(rr->rootExpr, input, pos, child);
+    bool memo = !memoTable.empty() && memoizes(rr);
+    if (memo) {
+        MemoEntry* hit = memoLookup(rr, pos);
+        if (hit) {
+            DEBUG_MSG("parseSymbol: memo hit for " << expr->value << " at pos=" << pos);
+            stats.memoHits++;
+            if (!hit->ok) return false;
+            pos = hit->end;
+            outNode = shareNode(hit->node);
+            if (recording) {
+                std::vector<size_t>::const_iterator from = memoChoices.begin() + hit->logBegin;
+                decisionLog.insert(decisionLog.end(), from, from + hit->logCount);
+            }
+            return true;
+        }
+        stats.memoMisses++;
+    }
+
+    size_t low = growLow;
+    size_t depth = growing.size();
+    growLow = NO_HEAD;
+    if (grows) beginGrow(rr, savedPos);
+    // A growing call logs how many rounds made its match longer
+    size_t logFrom = decisionLog.size();
+    size_t rounds = 0;
+    if (grows && recording) decisionLog.push_back(0);
+    if (grows && replaying) rounds = nextDecision();
+    Expression* body = rr->rootExpr;
+    // Prediction takes the chain's decisions, so it is parsed and folded
+    bool climb = rr->operators && !predictive && !grows;
+    ASTNode* node = 0;
+    bool ok;
+    bool more;
+    do {
+        // A growing rule parses its body again over each longer seed
+        pos = savedPos;
+        size_t roundFrom = decisionLog.size();
+        ASTNode* child = 0;
+        if (climb) {
+            ok = parseOperators(rr, input, pos, child);
+        } else {
+            ok = parseExpression(body, input, pos, child);
+            if (ok) child = operatorTree(rr, child);
+        }
+        node = 0;
+        if (ok) {
+            node = newNode(expr->value);
+            if (child) attach(node, child);
+            setSpan(node, input, savedPos, pos);
+        }
+        if (grows) body = seedBody(rr);
+        more = grows && growStep(ok, pos, node);
+        if (grows && recording) {
+            if (more) ++decisionLog[logFrom];
+            else decisionLog.resize(roundFrom);
+        }
+        if (more && replaying) more = --rounds > 0;
+    } while (more);
+    if (grows) ok = endGrow(pos, node);
+    // A result that used the seed of an enclosing head changes as it grows
+    bool stable = growLow >= depth;
+    growLow = std::min(low, growLow);
+
     if (!ok) {
         DEBUG_MSG("parseSymbol: failed to parse symbol " << expr->value);
         pos = savedPos;
+        if (memo && stable) {
+            memoStore(rr, savedPos, false, savedPos, 0, logFrom);
+        }
         return false;
     }
 
     DEBUG_MSG("parseSymbol: successfully parsed symbol " << expr->value);
-    ASTNode* node = new ASTNode(expr->value);
-    if (child) {
-        node->children.push_back(child);
-        node->matched = child->matched;
-    }
+    if (memo && stable) memoStore(rr, savedPos, true, pos, node, logFrom);
     outNode = node;
     return true;
 }
 
-// Parse sequence expressions (ordered list of sub-expressions)
-bool BNFParser::parseSequence(Expression* expr,
-                              const std::string& input,
-                              size_t& pos,
-                              ASTNode*& outNode) const
-{
-    DEBUG_MSG("parseSequence: parsing " << expr->children.size() << " elements at pos=" << pos);
+// ---------------- Left recursion ----------------
+//
+// A call of a left-recursive rule becomes a growing head at its position.
+// Its seed starts as a failure; calls of the rule at that position while
+// it grows get the seed instead of recursing, and the body is parsed
+// again as long as that makes the match longer. Heads are stacked by
+// position, innermost last, and growLow tracks the lowest head whose seed
+// a rule result depends on, so that only seed-free results are memoized.
+// Once there is a seed, a branch that cannot call the rule first matches
+// as before and cannot make the match longer, so only the other branches
+// are parsed again (not under ordered choice, where an earlier branch
+// that matches would win).
+//
+// With heap nodes, the seed may be attached to trees that are dropped
+// while it grows; it is pinned (ASTNode::pooled) so that discard() and
+// the destructors of those trees leave it alone.
 
-    size_t savedPos = pos;
-    std::vector<ASTNode*> tmpChildren;
-    std::string matchedAccum;
+bool BNFParser::leftRecursive(const Rule* r) const {
+    if (compiled) return r->leftRecursive;
+    if (!firstSets) firstSets = new FirstSets(grammar);
+    return firstSets->leftRecursive(r);
+}
 
-    for (size_t i = 0; i < expr->children.size(); ++i) {
-        ASTNode* childNode = 0;
-        bool ok = parseExpression(expr->children[i], input, pos, childNode);
-        if (!ok) {
-            DEBUG_MSG("parseSequence: failed at element " << i);
-            for (size_t j = 0; j < tmpChildren.size(); ++j)
-                delete tmpChildren[j];
-            pos = savedPos;
-            return false;
+// Body of a growth round after the first
+Expression* BNFParser::seedBody(const Rule* r) const {
+    if (orderedChoice(r->rootExpr)) return r->rootExpr;
+    Expression* body;
+    if (compiled) {
+        body = r->seedBody;
+    } else {
+        std::map<const Rule*, Expression*>::iterator it = seedBodies.find(r);
+        if (it == seedBodies.end()) {
+            if (!firstSets) firstSets = new FirstSets(grammar);
+            it = seedBodies.insert(std::make_pair(r, firstSets->seedBody(r))).first;
         }
-        tmpChildren.push_back(childNode);
-        if (childNode) matchedAccum += childNode->matched;
+        body = it->second;
     }
+    if (!body) return r->rootExpr;
+    // It is a longest-match alternative like the rule body it comes from
+    if (!orderedOverrides.empty()) orderedDecisions[body] = false;
+    return body;
+}
 
-    DEBUG_MSG("parseSequence: successfully parsed all elements, matched='" << matchedAccum << "'");
-    ASTNode* parent = new ASTNode("<seq>");
-    parent->matched = matchedAccum;
-    parent->children.reserve(tmpChildren.size());
-    for (size_t k = 0; k < tmpChildren.size(); ++k)
-        parent->children.push_back(tmpChildren[k]);
+// Index of the head growing `r` at `pos`. Heads never start before the
+// heads they are nested in, so the search stops below `pos`.
+size_t BNFParser::growHead(const Rule* r, size_t pos) const {
+    for (size_t i = growing.size(); i-- > 0 && growing[i].start >= pos; ) {
+        if (growing[i].start == pos && growing[i].rule == r) return i;
+    }
+    return NO_HEAD;
+}
 
-    outNode = parent;
+// Answer a call of a growing rule with its current seed. An empty seed
+// may appear twice in one tree, so it is handed out as a copy.
+bool BNFParser::useSeed(size_t head, size_t& pos, ASTNode*& outNode) const {
+    const GrowEntry& g = growing[head];
+    if (head < growLow) growLow = head;
+    if (!g.ok) return false;
+    pos = g.end;
+    outNode = g.end == g.start ? cloneNode(g.node) : g.node;
     return true;
 }
 
-// Parse alternative expressions (choice between sub-expressions)
-bool BNFParser::parseAlternative(Expression* expr,
-                                 const std::string& input,
-                                 size_t& pos,
-                                 ASTNode*& outNode) const
-{
-    DEBUG_MSG("parseAlternative: trying " << expr->children.size() << " alternatives at pos=" << pos);
-
-    ASTNode* bestNode = 0;
-    size_t bestPos = pos;
-    bool anyMatch = false;
-
-    bool hasChar = pos < input.size();
-    unsigned char look = hasChar ? static_cast<unsigned char>(input[pos]) : 0;
-
-    for (size_t i = 0; i < expr->children.size(); ++i) {
-        if (hasChar) {
-            const FirstInfo& fi = computeFirst(expr->children[i]);
-            if (!fi.nullable && !fi.chars.test(look)) {
-                DEBUG_MSG("parseAlternative: skipping alt " << i << " due to FIRST mismatch");
-                continue;
-            }
-            if (!fi.nullable && fi.chars.none()) {
-                DEBUG_MSG("parseAlternative: skipping alt " << i << " (empty FIRST and not nullable)");
-                continue;
-            }
-        } else {
-            const FirstInfo& fi = computeFirst(expr->children[i]);
-            if (!fi.nullable) {
-                DEBUG_MSG("parseAlternative: skipping alt " << i << " at EOF due to non-nullable FIRST");
-                continue;
-            }
-        }
-        size_t savedPos = pos;
-        ASTNode* branchNode = 0;
-        bool ok = parseExpression(expr->children[i], input, pos, branchNode);
+void BNFParser::beginGrow(const Rule* r, size_t pos) const {
+    GrowEntry g;
+    g.rule = r;
+    g.start = pos;
+    g.ok = false;
+    g.end = pos;
+    g.node = 0;
+    growing.push_back(g);
+}
 
-        if (ok) {
-            DEBUG_MSG("parseAlternative: alternative " << i << " matched, advanced to pos=" << pos);
-            anyMatch = true;
-            if (pos > bestPos) {
-                if (bestNode) delete bestNode;
-                bestNode = new ASTNode("<alt>");
-                bestNode->children.push_back(branchNode);
-                bestNode->matched = branchNode->matched;
-                bestPos = pos;
-            } else {
-                delete branchNode;
-            }
-        } else {
-            DEBUG_MSG("parseAlternative: alternative " << i << " failed");
+// Whether `tree` holds `node`; a seed can only be on its left edge, where
+// every node starts where it does
+bool BNFParser::holdsNode(const ASTNode* tree, const ASTNode* node) const {
+    seedSearch.assign(1, tree);
+    while (!seedSearch.empty()) {
+        const ASTNode* t = seedSearch.back();
+        seedSearch.pop_back();
+        if (t == node) return true;
+        for (size_t i = 0; i < t->children.size(); ++i) {
+            const ASTNode* c = t->children[i];
+            if (c && c->begin == node->begin) seedSearch.push_back(c);
         }
-        pos = savedPos;
     }
+    return false;
+}
 
-    if (!anyMatch) {
-        DEBUG_MSG("parseAlternative: no alternatives matched");
+// Record the result of one parse of the innermost head's body. Returns
+// true if it is longer than the seed, which it then replaces.
+bool BNFParser::growStep(bool ok, size_t end, ASTNode* node) const {
+    GrowEntry& g = growing.back();
+    if (!ok || (g.ok && end <= g.end)) {
+        discard(node);
+        return false;
+    }
+    stats.seedGrowths++;
+    ASTNode* old = g.node;
+    g.ok = true;
+    g.end = end;
+    g.node = node;
+    pinSeed(node, true);
+    if (old) {
+        // The old seed is usually part of the new one
+        pinSeed(old, false);
+        if (!holdsNode(node, old)) discard(old);
+    }
+    return true;
+}
+
+// Pop the innermost head; its seed is the rule's result
+bool BNFParser::endGrow(size_t& pos, ASTNode*& node) const {
+    GrowEntry g = growing.back();
+    growing.pop_back();
+    pinSeed(g.node, false);
+    node = g.node;
+    if (g.ok) pos = g.end;
+    return g.ok;
+}
+
+// Only heap nodes are pinned; arena and pool nodes are never deleted singly
+void BNFParser::pinSeed(ASTNode* node, bool pinned) const {
+    if (node && !astArena && !batching) node->pooled = pinned;
+}
+
+// Drop the seeds of an aborted parse. An inner seed may hold an outer one
+// but not the reverse, so they are released innermost first.
+void BNFParser::releaseSeeds(std::vector<GrowEntry>& heads) const {
+    while (!heads.empty()) {
+        pinSeed(heads.back().node, false);
+        discard(heads.back().node);
+        heads.pop_back();
+    }
+}
+
+// Start expression of a parse. A left-recursive start rule is called
+// through a symbol, so that its calls inside the body find it growing,
+// and so is an operator rule, whose tree parseSymbol() builds.
+Expression* BNFParser::entryExpr(const Rule* r) const {
+    if (!leftRecursive(r) && !r->operators) return r->rootExpr;
+    std::map<const Rule*, Expression*>::iterator it = entryCalls.find(r);
+    if (it == entryCalls.end()) {
+        Expression* call = new Expression(Expression::EXPR_SYMBOL);
+        call->value = r->name;
+        call->rule = r;
+        it = entryCalls.insert(std::make_pair(r, call)).first;
+    }
+    return it->second;
+}
+
+// The tree of a parse is the start rule's body; the symbol node of a
+// call made by entryExpr() is dropped
+ASTNode* BNFParser::entryNode(const Rule* r, ASTNode* node) const {
+    if (!node || (!leftRecursive(r) && !r->operators)) return node;
+    ASTNode* body = node->children.empty() ? 0 : node->children[0];
+    node->children.clear();
+    discard(node);
+    return body;
+}
+
+// ---------------- Two-phase parsing ----------------
+//
+// The first pass recognizes with no nodes and logs the choices of the
+// match in preorder of its tree: the branch of each alternative that
+// tries several (NO_DECISION when only empty matches), 0 or 1 for each
+// optional, the iteration count of each repetition, the operator of each
+// climbing step and the growth rounds of each left-recursive call. A
+// construct that fails drops what it logged (see parseExpression()), and
+// a branch or operator that stops being the best drops its choices, so
+// only the winning path remains. Entries hold no positions, so a memoized
+// match keeps a copy of its choices and a hit appends them. The second
+// pass walks the same constructs, taking each logged choice instead of
+// trying the others; choices that never backtrack (keyword tries, LL(1)
+// predictions, run scans, DFAs) are made again and not logged. It builds
+// only the nodes of the final tree and uses no memo table.
+
+bool BNFParser::parseTwoPhase(Expression* start, const std::string& input,
+                              size_t& pos, ASTNode*& root) const
+{
+    decisionLog.clear();
+    size_t end = pos;
+    ASTNode* none = 0;
+    bool ok;
+    {
+        ScopedValue<bool> tree(noTree, true);
+        ScopedValue<bool> record(recording, true);
+        ok = parseExpression(start, input, end, none);
+    }
+    memoEnd();
+    if (ok) {
+        ScopedValue<bool> replay(replaying, true);
+        replayAt = 0;
+        ok = parseExpression(start, input, pos, root) && pos == end;
+        DEBUG_MSG("parseTwoPhase: replayed " << replayAt << " of " << decisionLog.size() << " choices");
+    }
+    // The log is only valid for this input
+    decisionLog.clear();
+    return ok;
+}
+
+// The branch the first pass logged, with the node parseAlternative() builds
+bool BNFParser::replayAlternative(Expression* expr, const std::string& input,
+                                  size_t& pos, ASTNode*& outNode) const
+{
+    size_t branch = nextDecision();
+    if (branch == NO_DECISION) {
+        // Only empty matches, which have no node
+        outNode = 0;
+        return true;
+    }
+    size_t start = pos;
+    ASTNode* branchNode = 0;
+    if (!parseExpression(expr->children[branch], input, pos, branchNode)) return false;
+    ASTNode* alt = newNode("<alt>");
+    attach(alt, branchNode);
+    setSpan(alt, input, start, pos);
+    outNode = alt;
+    return true;
+}
+
+size_t BNFParser::nextDecision() const {
+    stats.decisions++;
+    return decisionLog[replayAt++];
+}
+
+// ---------------- Operator rules ----------------
+//
+// The body of an operator rule is the chain operand { op operand }. The
+// recursive engine reads it by precedence climbing: operands and
+// operators go on the member stacks above the call's base, and an
+// operator is applied as soon as one that binds more loosely (or as
+// loosely, when it is left-associative) follows, so the tree is built
+// directly. Each step takes the operator whose operand matches longest,
+// or the first one that matches under ordered choice, exactly as the
+// chain's alternative would, and the loop stops where the repetition
+// would. The other engines match the chain and fold its tree.
+
+bool BNFParser::parseOperators(const Rule* r, const std::string& input, size_t& pos,
+                               ASTNode*& outNode) const
+{
+    const OperatorTable& table = *r->operators;
+    const std::vector<OperatorTable::Operator>& ops = table.getOperators();
+    Expression* step = r->rootExpr->children[1]->children[0];
+    bool several = step->type == Expression::EXPR_ALTERNATIVE;
+    bool ordered = several && orderedChoice(step);
+
+    size_t start = pos;
+    ASTNode* first = 0;
+    if (!parseExpression(r->rootExpr->children[0], input, pos, first)) {
+        pos = start;
+        return false;
+    }
+    size_t base = climbOperands.size();
+    size_t opBase = climbOps.size();
+    if (!noTree) climbOperands.push_back(first);
+
+    while (pos < input.size()) {
+        const OperatorTable::Operator* best = 0;
+        ASTNode* bestNode = 0;
+        size_t bestEnd = pos;
+        size_t at = decisionLog.size();
+        if (recording) decisionLog.push_back(NO_DECISION);
+        size_t from = 0, to = ops.size();
+        if (replaying) {
+            // Only the operator that won is read again
+            from = nextDecision();
+            to = from == NO_DECISION ? from : from + 1;
+        }
+        for (size_t i = from; i < to; ++i) {
+            const std::string& literal = ops[i].literal;
+            if (input.compare(pos, literal.size(), literal) != 0) continue;
+            Expression* branch = several ? step->children[i] : step;
+            size_t end = pos + literal.size();
+            size_t mark = decisionLog.size();
+            ASTNode* operand = 0;
+            if (!parseExpression(branch->children[1], input, end, operand)) continue;
+            if (end > bestEnd) {
+                discard(bestNode);
+                best = &ops[i];
+                bestNode = operand;
+                bestEnd = end;
+                if (recording) {
+                    decisionLog[at] = i;
+                    decisionLog.erase(decisionLog.begin() + at + 1, decisionLog.begin() + mark);
+                }
+            } else {
+                discard(operand);
+                if (recording) decisionLog.resize(mark);
+            }
+            if (ordered) break;
+        }
+        if (!best) break;
+
+        DEBUG_MSG("parseOperators: '" << best->literal << "' at pos=" << pos);
+        stats.climbs++;
+        if (!noTree) {
+            while (climbOps.size() > opBase && table.appliesFirst(climbOps.back().op->level, best->level))
+                applyClimb(input);
+            ClimbOp c;
+            c.op = best;
+            c.begin = pos;
+            climbOps.push_back(c);
+            climbOperands.push_back(bestNode);
+        }
+        pos = bestEnd;
+    }
+
+    if (noTree) return true;
+    while (climbOps.size() > opBase)
+        applyClimb(input);
+    outNode = climbOperands[base];
+    climbOperands.resize(base);
+    return true;
+}
+
+// Replace the two topmost operands with the `<infix>` node of the topmost
+// operator; an operand that matched empty has no node and sits next to it
+void BNFParser::applyClimb(const std::string& input) const {
+    ClimbOp c = climbOps.back();
+    climbOps.pop_back();
+    ASTNode* right = climbOperands.back();
+    climbOperands.pop_back();
+    ASTNode* left = climbOperands.back();
+
+    size_t opEnd = c.begin + c.op->literal.size();
+    ASTNode* op = newNode(c.op->literal);
+    setSpan(op, input, c.begin, opEnd);
+    ASTNode* node = newNode("<infix>");
+    node->children.push_back(left);
+    node->children.push_back(op);
+    node->children.push_back(right);
+    setSpan(node, input, left ? left->begin : c.begin, right ? right->end : opEnd);
+    climbOperands.back() = node;
+}
+
+// Tree of an operator rule's body matched as a chain (see OperatorTable::fold())
+ASTNode* BNFParser::operatorTree(const Rule* r, ASTNode* body) const {
+    if (!r || !r->operators || noTree) return body;
+    return r->operators->fold(body);
+}
+
+// Scanner of a regular rule, if it may replace the rule body here: only
+// linked grammars have one, a streamed rule must be able to suspend, and
+// a DFA keeps the longest prefix where prediction would commit
+const Dfa* BNFParser::ruleDfa(const Rule* rule) const {
+    if (!compiled || !regularDfa || streaming || predictive) return 0;
+    // A two-phase recording needs the choices inside the rule
+    return (noTree && !recording) || collapseRegular ? rule->dfa : 0;
+}
+
+// Match a regular rule with one DFA pass; the leaf spans the whole match
+bool BNFParser::scanRule(const Dfa* dfa, const std::string& symbol, const std::string& input,
+                         size_t& pos, ASTNode*& outNode) const {
+    size_t avail = pos < input.size() ? input.size() - pos : 0;
+    size_t n = dfa->match(input.data() + pos, avail);
+    if (n == Dfa::NO_MATCH) {
+        DEBUG_MSG("scanRule: " << symbol << " failed at pos=" << pos);
+        return false;
+    }
+    ASTNode* node = newNode(symbol);
+    setSpan(node, input, pos, pos + n);
+    pos += n;
+    outNode = node;
+    return true;
+}
+
+// Parse sequence expressions (ordered list of sub-expressions)
+bool BNFParser::parseSequence(Expression* expr,
+                              const std::string& input,
+                              size_t& pos,
+                              ASTNode*& outNode) const
+{
+    DEBUG_MSG("parseSequence: parsing " << expr->children.size() << " elements at pos=" << pos);
+
+    size_t savedPos = pos;
+    // Children are collected on the shared scratch stack above `base`
+    size_t base = childStack.size();
+
+    for (size_t i = 0; i < expr->children.size(); ++i) {
+        ASTNode* childNode = 0;
+        bool ok = parseExpression(expr->children[i], input, pos, childNode);
+        if (!ok) {
+            DEBUG_MSG("parseSequence: failed at element " << i);
+            for (size_t j = base; j < childStack.size(); ++j)
+                discard(childStack[j]);
+            childStack.resize(base);
+            pos = savedPos;
+            return false;
+        }
+        if (!noTree) childStack.push_back(childNode);
+    }
+
+    DEBUG_MSG("parseSequence: successfully parsed all elements, advanced to pos=" << pos);
+    ASTNode* parent = newNode("<seq>");
+    setSpan(parent, input, savedPos, pos);
+    if (parent) parent->children.assign(childStack.begin() + base, childStack.end());
+    childStack.resize(base);
+
+    outNode = parent;
+    return true;
+}
+
+// ---------------- Choice semantics ----------------
+//
+// An alternative takes its longest matching branch, or under ordered
+// choice (setOrderedChoice(), setRuleOrderedChoice()) its first one.
+
+// Whether an alternative stops at its first matching branch. Per-rule
+// overrides are resolved once by walking each rule's own body.
+bool BNFParser::orderedChoice(const Expression* alt) const {
+    if (orderedOverrides.empty()) return orderedEnabled;
+    if (!orderedResolved) {
+        const std::vector<Rule*>& rules = grammar.getRules();
+        for (size_t i = 0; i < rules.size(); ++i) {
+            bool on = orderedEnabled;
+            std::map<std::string, bool>::const_iterator ov = orderedOverrides.find(rules[i]->name);
+            if (ov != orderedOverrides.end()) on = ov->second;
+            resolveOrdered(rules[i]->rootExpr, on);
+        }
+        orderedResolved = true;
+    }
+    std::map<const Expression*, bool>::const_iterator it = orderedDecisions.find(alt);
+    return it != orderedDecisions.end() ? it->second : orderedEnabled;
+}
+
+// Symbols are not followed: a referenced rule decides for its own body
+void BNFParser::resolveOrdered(const Expression* expr, bool ordered) const {
+    if (!expr || expr->type == Expression::EXPR_SYMBOL) return;
+    if (expr->type == Expression::EXPR_ALTERNATIVE &&
+        !orderedDecisions.insert(std::make_pair(expr, ordered)).second)
+        return;
+    for (size_t i = 0; i < expr->children.size(); ++i)
+        resolveOrdered(expr->children[i], ordered);
+}
+
+// Parse alternative expressions (choice between sub-expressions)
+bool BNFParser::parseAlternative(Expression* expr,
+                                 const std::string& input,
+                                 size_t& pos,
+                                 ASTNode*& outNode) const
+{
+    DEBUG_MSG("parseAlternative: trying " << expr->children.size() << " alternatives at pos=" << pos);
+
+    bool ordered = orderedChoice(expr);
+    const KeywordTrie* trie = keywordTrie(expr);
+    if (trie) return matchKeyword(expr, trie, ordered, input, pos, outNode);
+    const LL1Analysis::Decision* d = prediction(expr);
+    if (d) return parsePredicted(expr, d->choose(input, pos), input, pos, outNode);
+    if (replaying) return replayAlternative(expr, input, pos, outNode);
+    if (expr->factorPrefix) return parseFactored(expr, input, pos, outNode);
+
+    ASTNode* bestNode = 0;
+    size_t bestPos = pos;
+    bool anyMatch = false;
+
+    bool hasChar = pos < input.size();
+    unsigned char look = hasChar ? static_cast<unsigned char>(input[pos]) : 0;
+
+    // A dispatch table lists exactly the viable branches for the lookahead
+    const DispatchTable* table = dispatchTable(expr);
+    size_t key = hasChar ? look : DispatchTable::END_OF_INPUT;
+    size_t tried = table ? table->count(key) : expr->children.size();
+    // Recording: the winning branch, followed by its own choices
+    size_t at = decisionLog.size();
+    if (recording) decisionLog.push_back(NO_DECISION);
+
+    for (size_t n = 0; n < tried; ++n) {
+        size_t i = table ? table->branch(key, n) : n;
+        if (!table && !branchViable(expr->children[i], hasChar, look)) {
+            DEBUG_MSG("parseAlternative: skipping alt " << i << " due to FIRST mismatch");
+            continue;
+        }
+        if (!pairViable(expr->children[i], input, pos)) {
+            DEBUG_MSG("parseAlternative: skipping alt " << i << " due to FIRST_2 mismatch");
+            continue;
+        }
+        size_t savedPos = pos;
+        size_t mark = decisionLog.size();
+        ASTNode* branchNode = 0;
+        bool ok = parseExpression(expr->children[i], input, pos, branchNode);
+
+        if (ok) {
+            DEBUG_MSG("parseAlternative: alternative " << i << " matched, advanced to pos=" << pos);
+            anyMatch = true;
+            if (pos > bestPos) {
+                discard(bestNode);
+                bestNode = newNode("<alt>");
+                attach(bestNode, branchNode);
+                setSpan(bestNode, input, savedPos, pos);
+                bestPos = pos;
+                if (recording) {
+                    decisionLog[at] = i;
+                    decisionLog.erase(decisionLog.begin() + at + 1, decisionLog.begin() + mark);
+                }
+            } else {
+                discard(branchNode);
+                if (recording) decisionLog.resize(mark);
+            }
+        } else {
+            DEBUG_MSG("parseAlternative: alternative " << i << " failed");
+        }
+        pos = savedPos;
+        // Ordered choice: the first match wins, later branches are not tried
+        if (ok && ordered) break;
+    }
+
+    if (!anyMatch) {
+        DEBUG_MSG("parseAlternative: no alternatives matched");
         return false;
     }
 
@@ -354,6 +1298,265 @@ bool BNFParser::parseAlternative(Expression* expr,
     return true;
 }
 
+// An LL(1) alternative tries only the branch the lookahead selects, and
+// that branch's failure is the alternative's. The tree is built as above.
+bool BNFParser::parsePredicted(Expression* expr,
+                               size_t branch,
+                               const std::string& input,
+                               size_t& pos,
+                               ASTNode*& outNode) const
+{
+    stats.predictions++;
+    if (branch == LL1Analysis::NONE) {
+        DEBUG_MSG("parsePredicted: no branch starts here, pos=" << pos);
+        return false;
+    }
+    size_t start = pos;
+    ASTNode* branchNode = 0;
+    if (!parseExpression(expr->children[branch], input, pos, branchNode)) {
+        DEBUG_MSG("parsePredicted: predicted alternative " << branch << " failed");
+        return false;
+    }
+    if (pos == start) {
+        // An empty match yields no node, as in parseAlternative()
+        discard(branchNode);
+        outNode = 0;
+        return true;
+    }
+    ASTNode* alt = newNode("<alt>");
+    attach(alt, branchNode);
+    setSpan(alt, input, start, pos);
+    outNode = alt;
+    return true;
+}
+
+// Element j of a branch; a branch that is not a sequence is one element
+static Expression* branchElement(Expression* branch, size_t j) {
+    if (branch->type == Expression::EXPR_SEQUENCE) return branch->children[j];
+    return branch;
+}
+
+static size_t branchLength(const Expression* branch) {
+    return branch->type == Expression::EXPR_SEQUENCE ? branch->children.size() : 1;
+}
+
+// The shared prefix is matched once from the first branch; its nodes stay
+// on the scratch stack, followed by the best suffix found so far and then
+// the suffix being tried. Branches compete on their total length exactly
+// as in parseAlternative(), so the same branch wins.
+bool BNFParser::parseFactored(Expression* expr,
+                              const std::string& input,
+                              size_t& pos,
+                              ASTNode*& outNode) const
+{
+    size_t savedPos = pos;
+    size_t k = expr->factorPrefix;
+    size_t base = childStack.size();
+
+    bool hasChar = pos < input.size();
+    unsigned char look = hasChar ? static_cast<unsigned char>(input[pos]) : 0;
+    bool viable = false;
+    for (size_t i = 0; i < expr->children.size() && !viable; ++i)
+        viable = branchViable(expr->children[i], hasChar, look);
+    if (!viable) return false;
+
+    // Recording: the winning branch, then the prefix's and its suffix's choices
+    size_t at = decisionLog.size();
+    if (recording) decisionLog.push_back(NO_DECISION);
+    for (size_t j = 0; j < k; ++j) {
+        ASTNode* childNode = 0;
+        if (!parseExpression(branchElement(expr->children[0], j), input, pos, childNode)) {
+            for (size_t n = base; n < childStack.size(); ++n)
+                discard(childStack[n]);
+            childStack.resize(base);
+            pos = savedPos;
+            return false;
+        }
+        if (!noTree) childStack.push_back(childNode);
+    }
+    size_t prefixPos = pos;
+    size_t prefixLog = decisionLog.size();
+    size_t bestEnd = childStack.size();  // end of the best suffix's nodes
+    size_t bestPos = savedPos;
+    Expression* best = 0;
+    bool anyMatch = false;
+    bool ordered = orderedChoice(expr);
+
+    for (size_t i = 0; i < expr->children.size() && !(ordered && anyMatch); ++i) {
+        Expression* branch = expr->children[i];
+        if (!branchViable(branch, hasChar, look) || !pairViable(branch, input, savedPos)) continue;
+        size_t mark = childStack.size();
+        size_t logMark = decisionLog.size();
+        pos = prefixPos;
+        bool ok = true;
+        for (size_t j = k; ok && j < branchLength(branch); ++j) {
+            ASTNode* childNode = 0;
+            ok = parseExpression(branchElement(branch, j), input, pos, childNode);
+            if (ok && !noTree) childStack.push_back(childNode);
+        }
+        if (ok) anyMatch = true;
+        if (ok && pos > bestPos) {
+            // The new best suffix replaces the old one right after the prefix
+            size_t prefixEnd = base + (noTree ? 0 : k);
+            for (size_t n = prefixEnd; n < bestEnd; ++n)
+                discard(childStack[n]);
+            std::copy(childStack.begin() + mark, childStack.end(), childStack.begin() + prefixEnd);
+            childStack.resize(prefixEnd + (childStack.size() - mark));
+            bestEnd = childStack.size();
+            bestPos = pos;
+            best = branch;
+            if (recording) {
+                decisionLog[at] = i;
+                decisionLog.erase(decisionLog.begin() + prefixLog, decisionLog.begin() + logMark);
+            }
+        } else {
+            for (size_t n = mark; n < childStack.size(); ++n)
+                discard(childStack[n]);
+            childStack.resize(mark);
+            if (recording) decisionLog.resize(logMark);
+        }
+    }
+
+    if (!anyMatch || !best) {
+        // No match, or only empty ones, which parseAlternative() reports without a node
+        for (size_t n = base; n < childStack.size(); ++n)
+            discard(childStack[n]);
+        childStack.resize(base);
+        if (recording) decisionLog.resize(at + 1);
+        pos = savedPos;
+        if (anyMatch) outNode = 0;
+        return anyMatch;
+    }
+
+    ASTNode* branchNode = 0;
+    if (best->type == Expression::EXPR_SEQUENCE) {
+        branchNode = newNode("<seq>");
+        setSpan(branchNode, input, savedPos, bestPos);
+        if (branchNode) branchNode->children.assign(childStack.begin() + base, childStack.end());
+    } else if (!noTree) {
+        branchNode = childStack[base];
+    }
+    childStack.resize(base);
+
+    ASTNode* alt = newNode("<alt>");
+    attach(alt, branchNode);
+    setSpan(alt, input, savedPos, bestPos);
+    pos = bestPos;
+    outNode = alt;
+    return true;
+}
+
+// One walk of the trie finds the longest literal, or under ordered choice
+// the one of the lowest branch; a duplicated literal resolves to its
+// first branch, as in parseAlternative()
+bool BNFParser::matchKeyword(Expression* expr,
+                             const KeywordTrie* trie,
+                             bool ordered,
+                             const std::string& input,
+                             size_t& pos,
+                             ASTNode*& outNode) const
+{
+    size_t branch = KeywordTrie::NO_BRANCH;
+    size_t avail = pos < input.size() ? input.size() - pos : 0;
+    size_t len = ordered ? trie->first(input.data() + pos, avail, branch)
+                         : trie->longest(input.data() + pos, avail, branch);
+    if (!len) {
+        DEBUG_MSG("matchKeyword: no literal matched at pos=" << pos);
+        return false;
+    }
+
+    Expression* term = expr->children[branch];
+    std::string decoded;
+    if (!compiled) decoded = stripQuotes(term->value);
+    const std::string& literal = compiled ? term->literal : decoded;
+    DEBUG_MSG("matchKeyword: matched '" << literal << "' (alt " << branch << ")");
+
+    ASTNode* node = newNode(literal);
+    setSpan(node, input, pos, pos + len);
+    ASTNode* alt = newNode("<alt>");
+    attach(alt, node);
+    setSpan(alt, input, pos, pos + len);
+    pos += len;
+    outNode = alt;
+    return true;
+}
+
+// Linked grammars carry their tries; an unlinked grammar's are built on
+// first use. An empty cached trie marks an alternative that does not qualify.
+const KeywordTrie* BNFParser::keywordTrie(Expression* alt) const {
+    if (!keywordTries) return 0;
+    if (compiled) return alt->keywords;
+    if (alt->children.size() < KeywordTrie::MIN_KEYWORDS) return 0;
+    std::map<const Expression*, KeywordTrie>::iterator it = keywordCache.find(alt);
+    if (it == keywordCache.end()) {
+        it = keywordCache.insert(std::make_pair(alt, KeywordTrie())).first;
+        KeywordTrie::fromAlternative(alt, it->second);
+    }
+    return it->second.nodes() > 1 ? &it->second : 0;
+}
+
+// Linked grammars carry their tables; an unlinked grammar's are built
+// from computeFirst() on first use
+const DispatchTable* BNFParser::dispatchTable(Expression* alt) const {
+    if (!dispatch) return 0;
+    if (compiled) return alt->dispatch;
+    if (alt->children.size() < DispatchTable::MIN_BRANCHES) return 0;
+    std::map<const Expression*, DispatchTable>::iterator it = dispatchCache.find(alt);
+    if (it == dispatchCache.end()) {
+        DispatchTable table;
+        for (size_t i = 0; i < alt->children.size(); ++i) {
+            if (!alt->children[i]) {
+                table.addBranch(std::bitset<256>(), false);
+                continue;
+            }
+            const FirstSets::Info& fi = computeFirst(alt->children[i]);
+            table.addBranch(fi.chars, fi.nullable);
+        }
+        table.finish();
+        it = dispatchCache.insert(std::make_pair(alt, table)).first;
+    }
+    return &it->second;
+}
+
+// FIRST-set pruning: with a lookahead byte a non-nullable branch must be
+// able to start with it; at EOF only nullable branches can match. Linked
+// grammars carry FIRST in the node. A null branch never matches.
+bool BNFParser::branchViable(Expression* branch, bool hasChar, unsigned char look) const {
+    if (!branch) return false;
+    const FirstSets::Info* fi = compiled ? 0 : &computeFirst(branch);
+    const std::bitset<256>& chars = fi ? fi->chars : branch->first;
+    bool nullable = fi ? fi->nullable : branch->nullable;
+    if (nullable) return true;
+    return hasChar && chars.test(look);
+}
+
+// FIRST_2 pruning of a branch that passed the FIRST test. With one byte
+// left only one-byte and empty matches fit, unless more input may follow.
+bool BNFParser::pairViable(Expression* branch, const std::string& input, size_t pos) const {
+    if (!pairPruning || !branch || pos >= input.size()) return true;
+    bool last = pos + 1 >= input.size();
+    if (last && streamOpen) return true;
+    if (!pairAnalysis) pairAnalysis = new FirstPairs(grammar);
+    unsigned char second = last ? 0 : static_cast<unsigned char>(input[pos + 1]);
+    if (pairAnalysis->of(branch).admits(static_cast<unsigned char>(input[pos]), last ? 0 : &second))
+        return true;
+    stats.pairPrunes++;
+    return false;
+}
+
+// LL(1) table of a decision point when predictive mode applies. Streamed
+// input may still change the lookahead, and under ordered choice a
+// nullable branch before the predicted one would win, so those backtrack.
+const LL1Analysis::Decision* BNFParser::prediction(const Expression* expr) const {
+    if (!predictive || streaming) return 0;
+    if (!ll1) ll1 = new LL1Analysis(grammar);
+    const LL1Analysis::Decision* d = ll1->decision(expr);
+    if (d && expr->type == Expression::EXPR_ALTERNATIVE &&
+        d->next[256] != LL1Analysis::NONE && orderedChoice(expr))
+        return 0;
+    return d;
+}
+
 // Parse optional expressions (zero or one occurrence)
 bool BNFParser::parseOptional(Expression* expr,
                               const std::string& input,
@@ -364,22 +1567,33 @@ bool BNFParser::parseOptional(Expression* expr,
 
     size_t savedPos = pos;
     ASTNode* inside = 0;
-    bool ok = parseExpression(expr->children[0], input, pos, inside);
+    // LL(1): the body is tried only when the lookahead selects it, and then
+    // its failure is the optional's. A replay enters it only if it matched.
+    const LL1Analysis::Decision* d = replaying ? 0 : prediction(expr);
+    if (d) stats.predictions++;
+    bool enter = replaying ? nextDecision() != 0
+                           : !d || d->choose(input, pos) != LL1Analysis::NONE;
+    size_t at = decisionLog.size();
+    if (recording) decisionLog.push_back(0);
+    bool ok = enter && parseExpression(expr->children[0], input, pos, inside);
+    if (!ok && d && enter) {
+        DEBUG_MSG("parseOptional: predicted content failed");
+        return false;
+    }
     if (!ok) {
         DEBUG_MSG("parseOptional: optional content not found, creating empty node");
         pos = savedPos;
-        ASTNode* node = new ASTNode("<opt>");
-        node->matched = "";
+        ASTNode* node = newNode("<opt>");
+        setSpan(node, input, savedPos, savedPos);
         outNode = node;
         return true;
     }
     
     DEBUG_MSG("parseOptional: optional content matched");
-    ASTNode* node = new ASTNode("<opt>");
-    if (inside) {
-        node->children.push_back(inside);
-        node->matched = inside->matched;
-    }
+    if (recording) decisionLog[at] = 1;
+    ASTNode* node = newNode("<opt>");
+    if (inside) attach(node, inside);
+    setSpan(node, input, savedPos, pos);
     outNode = node;
     return true;
 }
@@ -391,44 +1605,133 @@ bool BNFParser::parseRepeat(Expression* expr,
                            ASTNode*& outNode) const
 {
     DEBUG_MSG("parseRepeat: starting repetition at pos=" << pos);
+    if (matchRun(expr, input, pos, outNode)) return true;
 
-    std::vector<ASTNode*> items;
-    std::string matchedAccum;
+    size_t start = pos;
+    size_t base = childStack.size();
     int iterations = 0;
+    // A replay runs exactly the iterations that matched
+    const LL1Analysis::Decision* d = replaying ? 0 : prediction(expr);
+    size_t count = replaying ? nextDecision() : 0;
+    size_t at = decisionLog.size();
+    if (recording) decisionLog.push_back(0);
     
-    while (true) {
+    while (!replaying || static_cast<size_t>(iterations) < count) {
+        // LL(1): iterate while the lookahead selects the body
+        if (d) {
+            stats.predictions++;
+            if (d->choose(input, pos) == LL1Analysis::NONE) break;
+        }
         size_t iterSaved = pos;
+        size_t iterLog = decisionLog.size();
         ASTNode* it = 0;
         bool ok = parseExpression(expr->children[0], input, pos, it);
-        if (!ok) {
-            pos = iterSaved;
-            break;
+        if (!ok && d) {
+            DEBUG_MSG("parseRepeat: predicted iteration failed");
+            for (size_t j = base; j < childStack.size(); ++j)
+                discard(childStack[j]);
+            childStack.resize(base);
+            pos = start;
+            return false;
         }
-        if (it && it->matched.empty()) {
-            delete it;
+        if (!ok) {
             pos = iterSaved;
             break;
         }
-        if (it) {
-            matchedAccum += it->matched;
-            items.push_back(it);
-            iterations++;
-            DEBUG_MSG("parseRepeat: iteration " << iterations << " matched");
-        } else {
+        if (pos == iterSaved) {
+            // Empty iteration: stop without consuming
+            discard(it);
+            if (recording) decisionLog.resize(iterLog);
             break;
         }
+        if (it) childStack.push_back(it);
+        iterations++;
+        DEBUG_MSG("parseRepeat: iteration " << iterations << " matched");
         if (pos >= input.size()) break;
     }
 
     DEBUG_MSG("parseRepeat: completed with " << iterations << " iterations");
-    ASTNode* parent = new ASTNode("<rep>");
-    parent->matched = matchedAccum;
-    for (size_t i = 0; i < items.size(); ++i)
-        parent->children.push_back(items[i]);
+    if (recording) decisionLog[at] = static_cast<size_t>(iterations);
+    ASTNode* parent = newNode("<rep>");
+    setSpan(parent, input, start, pos);
+    if (parent) parent->children.assign(childStack.begin() + base, childStack.end());
+    childStack.resize(base);
     outNode = parent;
     return true;
 }
 
+// Whether `expr` of an unlinked grammar always matches exactly one byte;
+// collects the bytes it accepts. Symbols are followed a bounded number of
+// levels. Linked grammars get this from ByteRun::fromRepeat().
+bool BNFParser::byteClass(Expression* expr, std::bitset<256>& out, int depth) const {
+    if (!expr || depth > 32) return false;
+    switch (expr->type) {
+        case Expression::EXPR_TERMINAL: {
+            std::string lit = stripQuotes(expr->value);
+            if (lit.size() != 1) return false;
+            out.set(static_cast<unsigned char>(lit[0]));
+            return true;
+        }
+        case Expression::EXPR_CHAR_RANGE:
+            for (unsigned int c = expr->charRange.start; c <= expr->charRange.end; ++c)
+                out.set(c);
+            return true;
+        case Expression::EXPR_CHAR_CLASS:
+            out |= expr->charBitmap;
+            return true;
+        case Expression::EXPR_SYMBOL: {
+            const Rule* r = grammar.getRule(expr->value);
+            return r && byteClass(r->rootExpr, out, depth + 1);
+        }
+        case Expression::EXPR_SEQUENCE:
+            return expr->children.size() == 1 && byteClass(expr->children[0], out, depth + 1);
+        case Expression::EXPR_ALTERNATIVE: {
+            // Null branches never match; every other branch must be one byte
+            bool any = false;
+            for (size_t i = 0; i < expr->children.size(); ++i) {
+                if (!expr->children[i]) continue;
+                if (!byteClass(expr->children[i], out, depth + 1)) return false;
+                any = true;
+            }
+            return any;
+        }
+        default:
+            return false;
+    }
+}
+
+// Run scanner of a repetition whose body is a single byte class, or null.
+// A linked grammar carries its scanners, so recognize() allocates nothing.
+const ByteRun* BNFParser::runClass(Expression* repeat) const {
+    if (compiled) return repeat->run;
+    std::map<const Expression*, RunInfo>::iterator it = runCache.find(repeat);
+    if (it == runCache.end()) {
+        RunInfo info;
+        std::bitset<256> bits;
+        info.eligible = !repeat->children.empty() && byteClass(repeat->children[0], bits, 0);
+        if (info.eligible) info.run = ByteRun(bits);
+        it = runCache.insert(std::make_pair(repeat, info)).first;
+    }
+    return it->second.eligible ? &it->second.run : 0;
+}
+
+// Match a whole single-byte-class repetition with one scan. Used when no
+// per-byte nodes are wanted: while recognizing, or with setCollapseRuns().
+// A streamed repetition keeps the bytewise path so it can suspend.
+bool BNFParser::matchRun(Expression* expr, const std::string& input,
+                         size_t& pos, ASTNode*& outNode) const {
+    // A two-phase recording logs the choices of the bytewise path
+    if (!((noTree && !recording) || collapseRuns) || streaming) return false;
+    const ByteRun* run = runClass(expr);
+    if (!run) return false;
+    size_t n = pos < input.size() ? run->scan(input.data() + pos, input.size() - pos) : 0;
+    ASTNode* node = newNode("<char-run>");
+    setSpan(node, input, pos, pos + n);
+    pos += n;
+    outNode = node;
+    return true;
+}
+
 // Parse character range expressions - match one character within the range
 bool BNFParser::parseCharRange(Expression* expr,
                                const std::string& input,
@@ -449,8 +1752,8 @@ bool BNFParser::parseCharRange(Expression* expr,
     
     if (ch >= start && ch <= end) {
         DEBUG_MSG("parseCharRange: matched character " << (int)ch);
-        ASTNode* node = new ASTNode("<char-range>");
-        node->matched = std::string(1, ch);
+        ASTNode* node = newNode("<char-range>");
+        setSpan(node, input, pos, pos + 1);
         pos++;
         outNode = node;
         return true;
@@ -476,8 +1779,8 @@ bool BNFParser::parseCharClass(Expression* expr,
     
     if (match) {
         DEBUG_MSG("parseCharClass: matched character " << (int)ch);
-        ASTNode* node = new ASTNode("<char-class>");
-        node->matched = std::string(1, ch);
+        ASTNode* node = newNode("<char-class>");
+        setSpan(node, input, pos, pos + 1);
         pos++;
         outNode = node;
         return true;
@@ -486,3 +1789,675 @@ bool BNFParser::parseCharClass(Expression* expr,
     DEBUG_MSG("parseCharClass: character " << (int)ch << " did not match class");
     return false;
 }
+
+// ---------------- Earley engine ----------------
+//
+// EarleyChart recognizes the input and reads one derivation back as steps
+// in preorder; each step becomes the node the other engines would build.
+
+bool BNFParser::parseEarley(const Rule* r, const std::string& input,
+                            size_t& pos, ASTNode*& outNode) const
+{
+    if (!earley) earley = new EarleyChart(grammar);
+    size_t end = earley->recognize(r, input);
+    stats.earleyItems += earley->itemCount();
+    if (end == EarleyChart::NO_MATCH) {
+        DEBUG_MSG("parseEarley: no prefix matches " << r->name);
+        return false;
+    }
+    pos = end;
+    if (noTree) return true;
+
+    earley->derive(r, end, earleySteps);
+    earleyNodes.resize(earleySteps.size());
+    for (size_t i = 0; i < earleySteps.size(); ++i) {
+        const EarleyChart::Step& step = earleySteps[i];
+        ASTNode* node = spanNode(step.expr, input, step.begin, step.end);
+        earleyNodes[i] = node;
+        if (step.parent == EarleyChart::NO_MATCH) continue;
+        // Sequences keep the null node of an empty alternative, as in
+        // parseSequence(); other parents only take real nodes
+        if (node || earleySteps[step.parent].expr->type == Expression::EXPR_SEQUENCE)
+            attach(earleyNodes[step.parent], node);
+    }
+    // Operator rules get their tree once their chain is complete
+    for (size_t i = earleySteps.size(); grammar.hasOperatorRules() && i-- > 1; ) {
+        const Expression* e = earleySteps[i].expr;
+        ASTNode* node = earleyNodes[i];
+        if (e->type != Expression::EXPR_SYMBOL || !node || node->children.empty()) continue;
+        const Rule* rr = compiled ? e->rule : grammar.getRule(e->value);
+        node->children[0] = operatorTree(rr, node->children[0]);
+    }
+    outNode = earleySteps.empty() ? 0 : earleyNodes[0];
+    return true;
+}
+
+// The node parseExpression() builds for `expr` over [begin, end), without
+// its children
+ASTNode* BNFParser::spanNode(const Expression* expr, const std::string& input,
+                             size_t begin, size_t end) const {
+    ASTNode* node = 0;
+    switch (expr->type) {
+        case Expression::EXPR_TERMINAL:
+            node = newNode(compiled ? expr->literal : stripQuotes(expr->value));
+            break;
+        case Expression::EXPR_SYMBOL:
+            node = newNode(expr->value);
+            break;
+        case Expression::EXPR_SEQUENCE:
+            node = newNode("<seq>");
+            break;
+        case Expression::EXPR_ALTERNATIVE:
+            // An empty best match yields no node
+            if (begin != end) node = newNode("<alt>");
+            break;
+        case Expression::EXPR_OPTIONAL:
+            node = newNode("<opt>");
+            break;
+        case Expression::EXPR_REPEAT:
+            node = newNode("<rep>");
+            break;
+        case Expression::EXPR_CHAR_RANGE:
+            node = newNode("<char-range>");
+            break;
+        case Expression::EXPR_CHAR_CLASS:
+            node = newNode("<char-class>");
+            break;
+    }
+    setSpan(node, input, begin, end);
+    return node;
+}
+
+// ---------------- LALR(1) engine ----------------
+//
+// A shift-reduce parser over LalrTable. Shifted bytes carry no node; each
+// reduction pops its right-hand side and pushes the node parseExpression()
+// would build over the same span. A repetition's node stays open while
+// iterations are appended to it and gets its span once it is popped.
+
+bool BNFParser::parseLalr(const Rule* r, const std::string& input,
+                          size_t& pos, ASTNode*& outNode) const
+{
+    if (!lalr) lalr = new LalrTable(grammar);
+    unsigned start = lalr->startState(r);
+    if (start == LalrTable::NONE) {
+        DEBUG_MSG("parseLalr: rule has no body: " << r->name);
+        return false;
+    }
+    lalrStack.clear();
+    LalrEntry bottom = { start, false, 0, 0 };
+    lalrStack.push_back(bottom);
+
+    size_t at = 0;
+    bool ending = false;   // the lookahead is the end of input from here on
+    // Conflict-free tables always reach a shift; resolved conflicts can
+    // make them reduce forever (hidden left recursion, cycles), so a run of
+    // reductions this long is taken as having no action
+    bool guarded = !lalr->isLALR1();
+    size_t run = 0, limit = 2 * lalr->productionCount();
+    while (true) {
+        unsigned term = ending || at >= input.size()
+                      ? lalr->endTerminal()
+                      : lalr->terminal(static_cast<unsigned char>(input[at]));
+        unsigned action = lalr->action(lalrStack.back().state, term);
+        if (guarded && LalrTable::kind(action) == LalrTable::ACTION_REDUCE &&
+            ++run > limit)
+            action = LalrTable::ACTION_ERROR;
+        switch (LalrTable::kind(action)) {
+            case LalrTable::ACTION_SHIFT: {
+                LalrEntry e = { LalrTable::target(action), false, at, 0 };
+                lalrStack.push_back(e);
+                ++at;
+                run = 0;
+                limit = (lalrStack.size() + 1) * lalr->productionCount();
+                break;
+            }
+            case LalrTable::ACTION_REDUCE: {
+                const LalrTable::Production& prod = lalr->production(LalrTable::target(action));
+                size_t base = lalrStack.size() - prod.size;
+                LalrEntry e;
+                e.begin = prod.size ? lalrStack[base].begin : at;
+                e.open = prod.build == LalrTable::BUILD_REPEAT;
+                e.node = noTree ? 0 : reduceLalr(prod, base, input, at);
+                lalrStack.resize(base);
+                e.state = lalr->jump(lalrStack.back().state, prod.lhs);
+                lalrStack.push_back(e);
+                stats.reductions++;
+                break;
+            }
+            case LalrTable::ACTION_ACCEPT:
+                closeLalr(lalrStack.size() - 1, input, at);
+                pos = at;
+                outNode = lalrStack.back().node;
+                return true;
+            default:
+                if (!ending && at < input.size()) {
+                    // Try the prefix before the first byte that cannot continue it
+                    DEBUG_MSG("parseLalr: no action at pos=" << at << ", trying end of input");
+                    ending = true;
+                    run = 0;
+                    limit = (lalrStack.size() + 1) * lalr->productionCount();
+                    break;
+                }
+                DEBUG_MSG("parseLalr: syntax error at pos=" << at);
+                for (size_t i = 0; i < lalrStack.size(); ++i)
+                    discard(lalrStack[i].node);
+                lalrStack.clear();
+                return false;
+        }
+    }
+}
+
+// Node of a reduction of the entries from `base` up, which end at `pos`
+ASTNode* BNFParser::reduceLalr(const LalrTable::Production& prod, size_t base,
+                               const std::string& input, size_t pos) const
+{
+    size_t top = lalrStack.size();
+    size_t begin = prod.size ? lalrStack[base].begin : pos;
+    bool extend = prod.build == LalrTable::BUILD_REPEAT && prod.size;
+    // A repetition being extended keeps its span open
+    for (size_t i = extend ? base + 1 : base; i < top; ++i)
+        closeLalr(i, input, i + 1 < top ? lalrStack[i + 1].begin : pos);
+
+    ASTNode* node = 0;
+    switch (prod.build) {
+        case LalrTable::BUILD_LEAF:
+            return spanNode(prod.expr, input, begin, pos);
+        case LalrTable::BUILD_SEQUENCE:
+            node = spanNode(prod.expr, input, begin, pos);
+            for (size_t i = base; i < top; ++i)
+                attach(node, lalrStack[i].node);
+            return node;
+        case LalrTable::BUILD_ALTERNATIVE:
+            // An empty match yields no node, as in parseAlternative()
+            if (begin == pos) {
+                discard(lalrStack[base].node);
+                return 0;
+            }
+            node = spanNode(prod.expr, input, begin, pos);
+            attach(node, lalrStack[base].node);
+            return node;
+        case LalrTable::BUILD_OPTIONAL:
+            node = spanNode(prod.expr, input, begin, pos);
+            if (prod.size && lalrStack[base].node) attach(node, lalrStack[base].node);
+            return node;
+        case LalrTable::BUILD_REPEAT: {
+            if (!extend) return newNode("<rep>");
+            // Empty iterations are dropped, as in parseRepeat()
+            node = lalrStack[base].node;
+            const LalrEntry& it = lalrStack[base + 1];
+            if (it.node && it.begin != pos) attach(node, it.node);
+            else discard(it.node);
+            return node;
+        }
+        case LalrTable::BUILD_RULE:
+            node = newNode(prod.rule->name);
+            if (lalrStack[base].node) attach(node, operatorTree(prod.rule, lalrStack[base].node));
+            setSpan(node, input, begin, pos);
+            return node;
+        default:
+            return 0;
+    }
+}
+
+// Sets the span of an open repetition once it can no longer grow
+void BNFParser::closeLalr(size_t at, const std::string& input, size_t end) const {
+    LalrEntry& e = lalrStack[at];
+    if (!e.open) return;
+    setSpan(e.node, input, e.begin, end);
+    e.open = false;
+}
+
+// ---------------- Iterative engine ----------------
+//
+// Same matching rules and AST as the recursive functions above, but each
+// composite construct lives in a Frame on the `frames` stack. The loop
+// alternates between starting a construct (`callee`) and resuming the top
+// frame with the result (`ok`, `node`) of the construct it started.
+
+bool BNFParser::parseIterative(Expression* root,
+                               const std::string& input,
+                               size_t& pos,
+                               ASTNode*& outNode) const
+{
+    frames.clear();
+    Expression* callee = root;
+    bool calling = true;
+    bool ok = false;
+    ASTNode* node = 0;
+
+    if (runFrames(input, pos, callee, calling, ok, node) != RUN_DONE)
+        return false;
+    outNode = node;
+    return ok;
+}
+
+// Streaming entry (ParseSession): run a suspended session's stacks until
+// done or starved. The stacks and the streaming modes belong to the parser
+// only for this call, so an exception leaves it ready for other parses.
+BNFParser::RunState BNFParser::resumeStream(std::vector<Frame>& stack,
+                                            std::vector<GrowEntry>*& heads,
+                                            bool open, const std::string& input,
+                                            size_t& pos, Expression*& callee,
+                                            bool& calling, bool& ok,
+                                            ASTNode*& node) const
+{
+    // Heads are rare, so the session's stack for them is only allocated
+    // once one suspends; until then they come back through `fresh`
+    std::vector<GrowEntry> fresh;
+    RunState state = RUN_DONE;
+    try {
+        ScopedSwap<std::vector<Frame> > lentFrames(frames, stack);
+        ScopedSwap<std::vector<GrowEntry> > lentHeads(growing, heads ? *heads : fresh);
+        ScopedValue<bool> stream(streaming, true);
+        ScopedValue<bool> more(streamOpen, open);
+        state = runFrames(input, pos, callee, calling, ok, node);
+        if (!heads && !growing.empty()) heads = new std::vector<GrowEntry>();
+    } catch (...) {
+        releaseSeeds(fresh);
+        throw;
+    }
+    if (!fresh.empty()) heads->swap(fresh);
+    return state;
+}
+
+// Engine loop. The whole machine state is the frame stack plus the
+// arguments, so a streaming session can suspend (RUN_SUSPENDED) when a
+// leaf needs bytes that have not arrived yet and call again later.
+BNFParser::RunState BNFParser::runFrames(const std::string& input, size_t& pos,
+                                         Expression*& callee, bool& calling,
+                                         bool& ok, ASTNode*& node) const
+{
+    for (;;) {
+        if (calling) {
+            if (streamOpen && needsInput(callee, input, pos))
+                return RUN_SUSPENDED;
+            bool done = startFrame(callee, input, pos, callee, ok, node);
+            if (maxDepth && frames.size() > maxDepth) {
+                std::cerr << "BNFParser: maximum depth of " << maxDepth
+                          << " frames exceeded" << std::endl;
+                stats.depthAborts++;
+                unwindFrames();
+                node = 0;
+                return RUN_ABORTED;
+            }
+            if (!done) continue;
+        }
+        if (frames.empty()) return RUN_DONE;
+        calling = !resumeFrame(input, pos, callee, ok, node);
+    }
+}
+
+// Whether a leaf cannot be decided from the bytes buffered so far
+bool BNFParser::needsInput(const Expression* expr, const std::string& input, size_t pos) const {
+    if (!expr) return false;
+    switch (expr->type) {
+        case Expression::EXPR_CHAR_RANGE:
+        case Expression::EXPR_CHAR_CLASS:
+            return pos >= input.size();
+        case Expression::EXPR_TERMINAL: {
+            std::string decoded;
+            if (!compiled) decoded = stripQuotes(expr->value);
+            const std::string& literal = compiled ? expr->literal : decoded;
+            size_t avail = pos < input.size() ? input.size() - pos : 0;
+            // Only a literal whose buffered part matches can still succeed
+            return avail < literal.size() &&
+                   input.compare(pos, avail, literal, 0, avail) == 0;
+        }
+        default:
+            return false;
+    }
+}
+
+// Push a frame for a composite construct starting at `pos`
+void BNFParser::pushFrame(Expression* expr, size_t pos) const {
+    Frame f;
+    f.expr = expr;
+    f.rule = 0;
+    f.memo = false;
+    f.any = false;
+    f.committed = false;
+    f.grows = false;
+    f.start = pos;
+    f.index = 0;
+    f.mark = pos;
+    f.low = NO_HEAD;
+    f.node = 0;
+    frames.push_back(f);
+    if (frames.size() > stats.peakDepth) stats.peakDepth = frames.size();
+}
+
+// Release the partial results of every open frame (depth limit reached)
+void BNFParser::unwindFrames() const {
+    for (size_t i = 0; i < frames.size(); ++i)
+        discard(frames[i].node);
+    frames.clear();
+    releaseSeeds(growing);
+}
+
+// Advance an alternative frame to its next viable branch, if any
+bool BNFParser::nextBranch(Frame& f, const std::string& input) const {
+    bool hasChar = f.start < input.size();
+    unsigned char look = hasChar ? static_cast<unsigned char>(input[f.start]) : 0;
+    const DispatchTable* table = dispatchTable(f.expr);
+    if (table && (hasChar || !streamOpen)) {
+        size_t key = hasChar ? look : DispatchTable::END_OF_INPUT;
+        for (;; ++f.index) {
+            f.index = table->next(key, f.index);
+            if (f.index >= f.expr->children.size()) return false;
+            if (pairViable(f.expr->children[f.index], input, f.start)) return true;
+        }
+    }
+    for (; f.index < f.expr->children.size(); ++f.index) {
+        // Without a lookahead byte yet, a streamed branch cannot be pruned
+        if (!hasChar && streamOpen && f.expr->children[f.index])
+            return true;
+        if (branchViable(f.expr->children[f.index], hasChar, look) &&
+            pairViable(f.expr->children[f.index], input, f.start))
+            return true;
+        DEBUG_MSG("parseIterative: skipping alt " << f.index << " due to FIRST mismatch");
+    }
+    return false;
+}
+
+// Begin matching `expr`. Leaves and constructs that finish immediately
+// return true with the result in ok/node; otherwise a frame is pushed,
+// `callee` is set to its first child and false is returned.
+bool BNFParser::startFrame(Expression* expr, const std::string& input, size_t& pos,
+                           Expression*& callee, bool& ok, ASTNode*& node) const
+{
+    node = 0;
+    if (!expr) {
+        DEBUG_MSG("parseIterative: null expression");
+        ok = false;
+        return true;
+    }
+
+    switch (expr->type) {
+        case Expression::EXPR_TERMINAL:
+            ok = parseTerminal(expr, input, pos, node);
+            return true;
+        case Expression::EXPR_CHAR_RANGE:
+            ok = parseCharRange(expr, input, pos, node);
+            return true;
+        case Expression::EXPR_CHAR_CLASS:
+            ok = parseCharClass(expr, input, pos, node);
+            return true;
+
+        case Expression::EXPR_SYMBOL: {
+            const Rule* rr = compiled ? expr->rule : grammar.getRule(expr->value);
+            if (!rr) {
+                std::cerr << "BNFParser::parseSymbol: unknown symbol " << expr->value << std::endl;
+                ok = false;
+                return true;
+            }
+            const Dfa* dfa = ruleDfa(rr);
+            if (dfa) {
+                ok = scanRule(dfa, expr->value, input, pos, node);
+                return true;
+            }
+            bool grows = leftRecursive(rr);
+            if (grows) {
+                size_t head = growHead(rr, pos);
+                if (head != NO_HEAD) {
+                    ok = useSeed(head, pos, node);
+                    return true;
+                }
+            }
+            bool memo = !memoTable.empty() && memoizes(rr);
+            if (memo) {
+                MemoEntry* hit = memoLookup(rr, pos);
+                if (hit) {
+                    stats.memoHits++;
+                    ok = hit->ok;
+                    if (ok) {
+                        pos = hit->end;
+                        node = shareNode(hit->node);
+                    }
+                    return true;
+                }
+                stats.memoMisses++;
+            }
+            pushFrame(expr, pos);
+            Frame& f = frames.back();
+            f.rule = rr;
+            f.memo = memo;
+            f.grows = grows;
+            f.mark = growing.size();
+            f.low = growLow;
+            growLow = NO_HEAD;
+            if (grows) beginGrow(rr, pos);
+            callee = rr->rootExpr;
+            return false;
+        }
+
+        case Expression::EXPR_SEQUENCE:
+            if (expr->children.empty()) {
+                node = newNode("<seq>");
+                setSpan(node, input, pos, pos);
+                ok = true;
+                return true;
+            }
+            pushFrame(expr, pos);
+            frames.back().node = newNode("<seq>");
+            callee = expr->children[0];
+            return false;
+
+        case Expression::EXPR_ALTERNATIVE: {
+            // A streamed keyword may still grow, so it takes the branch path
+            const KeywordTrie* trie = streamOpen ? 0 : keywordTrie(expr);
+            if (trie) {
+                ok = matchKeyword(expr, trie, orderedChoice(expr), input, pos, node);
+                return true;
+            }
+            const LL1Analysis::Decision* d = prediction(expr);
+            pushFrame(expr, pos);
+            Frame& f = frames.back();
+            bool viable;
+            if (d) {
+                // LL(1): the lookahead selects the only branch to try
+                stats.predictions++;
+                f.committed = true;
+                f.index = d->choose(input, pos);
+                viable = f.index != LL1Analysis::NONE;
+            } else {
+                viable = nextBranch(f, input);
+            }
+            if (!viable) {
+                frames.pop_back();
+                ok = false;
+                return true;
+            }
+            callee = expr->children[f.index];
+            return false;
+        }
+
+        case Expression::EXPR_OPTIONAL:
+        case Expression::EXPR_REPEAT: {
+            if (expr->type == Expression::EXPR_REPEAT && matchRun(expr, input, pos, node)) {
+                ok = true;
+                return true;
+            }
+            const char* symbol = expr->type == Expression::EXPR_REPEAT ? "<rep>" : "<opt>";
+            const LL1Analysis::Decision* d = prediction(expr);
+            if (d) {
+                stats.predictions++;
+                if (d->choose(input, pos) == LL1Analysis::NONE) {
+                    // LL(1): the lookahead does not select the body
+                    node = newNode(symbol);
+                    setSpan(node, input, pos, pos);
+                    ok = true;
+                    return true;
+                }
+            }
+            pushFrame(expr, pos);
+            frames.back().committed = d != 0;
+            if (expr->type == Expression::EXPR_REPEAT) frames.back().node = newNode(symbol);
+            callee = expr->children[0];
+            return false;
+        }
+
+        default:
+            std::cerr << "BNFParser::parseExpression: unsupported expr type\n";
+            ok = false;
+            return true;
+    }
+}
+
+// Feed the child result in ok/node to the top frame. Returns true when the
+// frame finished (popped, its own result now in ok/node) and false when it
+// needs another child, which is then stored in `callee`.
+bool BNFParser::resumeFrame(const std::string& input, size_t& pos,
+                            Expression*& callee, bool& ok, ASTNode*& node) const
+{
+    Frame& f = frames.back();
+    Expression* expr = f.expr;
+
+    switch (expr->type) {
+        case Expression::EXPR_SYMBOL: {
+            const Rule* rr = f.rule;
+            size_t start = f.start;
+            ASTNode* sym = 0;
+            if (ok) {
+                sym = newNode(expr->value);
+                if (node) attach(sym, operatorTree(rr, node));
+                setSpan(sym, input, start, pos);
+            }
+            if (f.grows) {
+                if (growStep(ok, pos, sym)) {
+                    // Parse the body again over the longer seed
+                    pos = start;
+                    callee = seedBody(rr);
+                    return false;
+                }
+                ok = endGrow(pos, sym);
+            }
+            bool memo = f.memo;
+            bool stable = growLow >= f.mark;
+            growLow = std::min(f.low, growLow);
+            frames.pop_back();
+            if (!ok) {
+                pos = start;
+                if (memo && stable) {
+                    memoStore(rr, start, false, start, 0, 0);
+                }
+                node = 0;
+                return true;
+            }
+            if (memo && stable) memoStore(rr, start, true, pos, sym, 0);
+            node = sym;
+            return true;
+        }
+
+        case Expression::EXPR_SEQUENCE: {
+            if (!ok) {
+                pos = f.start;
+                discard(f.node);
+                frames.pop_back();
+                node = 0;
+                return true;
+            }
+            attach(f.node, node);
+            if (++f.index < expr->children.size()) {
+                callee = expr->children[f.index];
+                return false;
+            }
+            setSpan(f.node, input, f.start, pos);
+            node = f.node;
+            frames.pop_back();
+            return true;
+        }
+
+        case Expression::EXPR_ALTERNATIVE: {
+            if (ok) {
+                f.any = true;
+                if (pos > f.mark) {
+                    discard(f.node);
+                    f.node = newNode("<alt>");
+                    attach(f.node, node);
+                    setSpan(f.node, input, f.start, pos);
+                    f.mark = pos;
+                } else {
+                    discard(node);
+                }
+            }
+            pos = f.start;
+            ++f.index;
+            // Ordered choice: the first match wins, later branches are not tried;
+            // a predicted branch is the only one
+            if (!f.committed && !(ok && orderedChoice(expr)) && nextBranch(f, input)) {
+                callee = expr->children[f.index];
+                return false;
+            }
+            ok = f.any;
+            node = f.node;
+            pos = f.mark;
+            frames.pop_back();
+            return true;
+        }
+
+        case Expression::EXPR_OPTIONAL: {
+            if (!ok && f.committed) {
+                // A predicted body failed, and with it the optional
+                pos = f.start;
+                frames.pop_back();
+                node = 0;
+                return true;
+            }
+            ASTNode* opt = newNode("<opt>");
+            if (!ok) {
+                pos = f.start;
+            } else if (node) {
+                attach(opt, node);
+            }
+            setSpan(opt, input, f.start, pos);
+            frames.pop_back();
+            ok = true;
+            node = opt;
+            return true;
+        }
+
+        case Expression::EXPR_REPEAT: {
+            // f.mark is the start of the current iteration
+            bool more = false;
+            if (!ok && f.committed) {
+                // A predicted iteration failed, and with it the repetition
+                discard(f.node);
+                pos = f.start;
+                frames.pop_back();
+                node = 0;
+                return true;
+            }
+            if (!ok) {
+                pos = f.mark;
+            } else if (pos == f.mark) {
+                // Empty iteration: stop without consuming
+                discard(node);
+            } else {
+                attach(f.node, node);
+                // A streamed repetition keeps going until input runs out
+                more = pos < input.size() || streamOpen;
+            }
+            if (more && f.committed) {
+                stats.predictions++;
+                more = prediction(expr)->choose(input, pos) != LL1Analysis::NONE;
+            }
+            if (more) {
+                f.mark = pos;
+                callee = expr->children[0];
+                return false;
+            }
+            setSpan(f.node, input, f.start, pos);
+            ok = true;
+            node = f.node;
+            frames.pop_back();
+            return true;
+        }
+
+        default:
+            frames.pop_back();
+            ok = false;
+            node = 0;
+            return true;
+    }
+}
@@ -0,0 +1,100 @@
+#include "../include/BatchResult.hpp"
+
+const size_t BatchResult::NONE;
+
+const std::string& BatchResult::symbolOf(const FlatNode& node) const {
+    static const std::string empty;
+    return node.symbol == NONE ? empty : symbols[node.symbol];
+}
+
+std::string BatchResult::text(const FlatNode& node, const std::string& input) const {
+    return input.substr(node.begin, node.end - node.begin);
+}
+
+void BatchResult::clear() {
+    entries.clear();
+    nodes.clear();
+}
+
+static size_t hashSymbol(const std::string& s) {
+    size_t h = 2166136261u;
+    for (size_t i = 0; i < s.size(); ++i)
+        h = (h ^ static_cast<unsigned char>(s[i])) * 16777619u;
+    return h;
+}
+
+// Symbols are looked up once per node, so the index is a small hash table
+// rather than a std::map of string keys
+size_t BatchResult::intern(const std::string& symbol) {
+    if (symbolSlots.size() < 2 * (symbols.size() + 1))
+        rehash(symbolSlots.empty() ? 64 : 2 * symbolSlots.size());
+    size_t mask = symbolSlots.size() - 1;
+    for (size_t i = hashSymbol(symbol) & mask; ; i = (i + 1) & mask) {
+        size_t idx = symbolSlots[i];
+        if (idx == NONE) {
+            symbols.push_back(symbol);
+            symbolSlots[i] = symbols.size() - 1;
+            return symbols.size() - 1;
+        }
+        if (symbols[idx] == symbol) return idx;
+    }
+}
+
+void BatchResult::rehash(size_t slots) {
+    symbolSlots.assign(slots, NONE);
+    size_t mask = slots - 1;
+    for (size_t idx = 0; idx < symbols.size(); ++idx) {
+        size_t i = hashSymbol(symbols[idx]) & mask;
+        while (symbolSlots[i] != NONE) i = (i + 1) & mask;
+        symbolSlots[i] = idx;
+    }
+}
+
+// Breadth-first layout: node q of the walk lands at nodes[base + q], and
+// the children of each node are appended together, so they are adjacent.
+size_t BatchResult::append(const ASTNode* root) {
+    if (!root) return NONE;
+    size_t base = nodes.size();
+    queue.clear();
+    queue.push_back(root);
+    nodes.push_back(FlatNode());
+    for (size_t q = 0; q < queue.size(); ++q) {
+        const ASTNode* n = queue[q];
+        FlatNode flat;
+        flat.firstChild = nodes.size();
+        if (!n) {
+            flat.symbol = NONE;
+            flat.begin = flat.end = 0;
+            flat.childCount = 0;
+        } else {
+            flat.symbol = intern(n->symbol);
+            flat.begin = n->begin;
+            flat.end = n->end;
+            flat.childCount = n->children.size();
+            for (size_t i = 0; i < n->children.size(); ++i) {
+                queue.push_back(n->children[i]);
+                nodes.push_back(FlatNode());
+            }
+        }
+        nodes[base + q] = flat;
+    }
+    return base;
+}
+
+ASTNode* BatchResult::toAST(size_t index, const std::string& input) const {
+    if (index >= entries.size() || entries[index].root == NONE) return 0;
+    return expand(entries[index].root, input);
+}
+
+ASTNode* BatchResult::expand(size_t index, const std::string& input) const {
+    const FlatNode& flat = nodes[index];
+    if (flat.symbol == NONE) return 0;
+    ASTNode* node = new ASTNode(symbols[flat.symbol]);
+    node->matched = text(flat, input);
+    node->begin = flat.begin;
+    node->end = flat.end;
+    node->children.reserve(flat.childCount);
+    for (size_t i = 0; i < flat.childCount; ++i)
+        node->children.push_back(expand(flat.firstChild + i, input));
+    return node;
+}
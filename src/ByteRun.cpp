@@ -0,0 +1,163 @@
+#include "../include/ByteRun.hpp"
+#include "../include/Grammar.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define BYTE_RUN_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+const int ByteRun::MAX_RANGES;
+
+ByteRun::ByteRun() : ranges(0) {}
+
+// Split the class into maximal ranges; more than MAX_RANGES means bytewise
+ByteRun::ByteRun(const std::bitset<256>& b) : bits(b), ranges(0) {
+    for (int c = 0; c < 256; ) {
+        if (!bits.test(c)) { ++c; continue; }
+        int start = c;
+        while (c < 256 && bits.test(c)) ++c;
+        if (ranges == MAX_RANGES) { ranges = -1; return; }
+        lo[ranges] = static_cast<unsigned char>(start);
+        hi[ranges] = static_cast<unsigned char>(c - 1);
+        ++ranges;
+    }
+}
+
+// Bytes of a linked expression that always matches exactly one byte
+static bool singleByte(const Expression* expr, std::bitset<256>& out, int depth) {
+    if (!expr || depth > 32) return false;
+    switch (expr->type) {
+        case Expression::EXPR_TERMINAL:
+            if (expr->literal.size() != 1) return false;
+            out.set(static_cast<unsigned char>(expr->literal[0]));
+            return true;
+        case Expression::EXPR_CHAR_RANGE:
+            for (unsigned int c = expr->charRange.start; c <= expr->charRange.end; ++c)
+                out.set(c);
+            return true;
+        case Expression::EXPR_CHAR_CLASS:
+            out |= expr->charBitmap;
+            return true;
+        case Expression::EXPR_SYMBOL:
+            return expr->rule && singleByte(expr->rule->rootExpr, out, depth + 1);
+        case Expression::EXPR_SEQUENCE:
+            return expr->children.size() == 1 && singleByte(expr->children[0], out, depth + 1);
+        case Expression::EXPR_ALTERNATIVE: {
+            // Null branches never match; every other branch must be one byte
+            bool any = false;
+            for (size_t i = 0; i < expr->children.size(); ++i) {
+                if (!expr->children[i]) continue;
+                if (!singleByte(expr->children[i], out, depth + 1)) return false;
+                any = true;
+            }
+            return any;
+        }
+        default:
+            return false;
+    }
+}
+
+bool ByteRun::fromRepeat(const Expression* repeat, ByteRun& run) {
+    std::bitset<256> bits;
+    if (repeat->children.empty() || !singleByte(repeat->children[0], bits, 0)) return false;
+    run = ByteRun(bits);
+    return true;
+}
+
+size_t ByteRun::scanScalar(const char* data, size_t size) const {
+    size_t n = 0;
+    while (n < size && bits.test(static_cast<unsigned char>(data[n]))) ++n;
+    return n;
+}
+
+#ifdef BYTE_RUN_X86
+
+// A byte x is in [lo, hi] iff (x - lo) <= (hi - lo) as unsigned bytes.
+// SSE2 only compares signed bytes, so both sides are biased by 0x80.
+// Each function returns the length of the leading run found in whole
+// vectors; the caller finishes the tail bytewise.
+
+static size_t scanSSE2(const unsigned char* lo, const unsigned char* hi, int ranges,
+                       const char* data, size_t size) {
+    const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+    __m128i base[ByteRun::MAX_RANGES];
+    __m128i width[ByteRun::MAX_RANGES];
+    for (int k = 0; k < ranges; ++k) {
+        base[k] = _mm_set1_epi8(static_cast<char>(lo[k]));
+        width[k] = _mm_set1_epi8(static_cast<char>((hi[k] - lo[k]) ^ 0x80));
+    }
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i outside = _mm_set1_epi8(static_cast<char>(0xFF));
+        for (int k = 0; k < ranges; ++k) {
+            __m128i t = _mm_xor_si128(_mm_sub_epi8(x, base[k]), bias);
+            outside = _mm_and_si128(outside, _mm_cmpgt_epi8(t, width[k]));
+        }
+        int mask = _mm_movemask_epi8(outside);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t scanAVX2(const unsigned char* lo, const unsigned char* hi, int ranges,
+                       const char* data, size_t size) {
+    const __m256i bias = _mm256_set1_epi8(static_cast<char>(0x80));
+    __m256i base[ByteRun::MAX_RANGES];
+    __m256i width[ByteRun::MAX_RANGES];
+    for (int k = 0; k < ranges; ++k) {
+        base[k] = _mm256_set1_epi8(static_cast<char>(lo[k]));
+        width[k] = _mm256_set1_epi8(static_cast<char>((hi[k] - lo[k]) ^ 0x80));
+    }
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i outside = _mm256_set1_epi8(static_cast<char>(0xFF));
+        for (int k = 0; k < ranges; ++k) {
+            __m256i t = _mm256_xor_si256(_mm256_sub_epi8(x, base[k]), bias);
+            outside = _mm256_and_si256(outside, _mm256_cmpgt_epi8(t, width[k]));
+        }
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(outside));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    // Leave the last partial vector to SSE2
+    return i + scanSSE2(lo, hi, ranges, data + i, size - i);
+}
+
+static bool detectAVX2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+}
+
+static bool hasAVX2() {
+    static const bool avx2 = detectAVX2();
+    return avx2;
+}
+
+bool ByteRun::vectorized() {
+    return true;
+}
+
+size_t ByteRun::scan(const char* data, size_t size) const {
+    size_t n = 0;
+    if (ranges > 0 && size >= 16) {
+        n = hasAVX2() ? scanAVX2(lo, hi, ranges, data, size)
+                      : scanSSE2(lo, hi, ranges, data, size);
+        if (n < size && !bits.test(static_cast<unsigned char>(data[n]))) return n;
+    }
+    return n + scanScalar(data + n, size - n);
+}
+
+#else
+
+bool ByteRun::vectorized() {
+    return false;
+}
+
+size_t ByteRun::scan(const char* data, size_t size) const {
+    return scanScalar(data, size);
+}
+
+#endif
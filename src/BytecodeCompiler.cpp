@@ -0,0 +1,297 @@
+#include "../include/BytecodeCompiler.hpp"
+#include "../include/Debug.hpp"
+
+Instruction::Instruction(OpCode o, int x, int y)
+    : op(o), a(x), b(y) {}
+
+// ---------------- BytecodeProgram ----------------
+
+int BytecodeProgram::entryPoint(const std::string& ruleName) const {
+    std::map<std::string, int>::const_iterator it = entries.find(ruleName);
+    return it != entries.end() ? it->second : -1;
+}
+
+static const char* opName(Instruction::OpCode op) {
+    switch (op) {
+        case Instruction::OP_HALT:          return "HALT";
+        case Instruction::OP_CHAR:          return "CHAR";
+        case Instruction::OP_CLASS:         return "CLASS";
+        case Instruction::OP_LITERAL:       return "LITERAL";
+        case Instruction::OP_CALL:          return "CALL";
+        case Instruction::OP_RET:           return "RET";
+        case Instruction::OP_CHOICE:        return "CHOICE";
+        case Instruction::OP_COMMIT:        return "COMMIT";
+        case Instruction::OP_JUMP:          return "JUMP";
+        case Instruction::OP_FAIL:          return "FAIL";
+        case Instruction::OP_TEST:          return "TEST";
+        case Instruction::OP_PROGRESS:      return "PROGRESS";
+        case Instruction::OP_ALT_BEGIN:     return "ALT_BEGIN";
+        case Instruction::OP_ALT_RECORD:    return "ALT_RECORD";
+        case Instruction::OP_ALT_END:       return "ALT_END";
+        case Instruction::OP_CAPTURE_OPEN:  return "CAPTURE_OPEN";
+        case Instruction::OP_CAPTURE_CLOSE: return "CAPTURE_CLOSE";
+    }
+    return "?";
+}
+
+// Print one instruction per line, with rule entry labels
+void BytecodeProgram::dump(std::ostream& os) const {
+    std::map<int, std::string> labels;
+    for (std::map<std::string, int>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+        labels[it->second] = it->first;
+
+    for (size_t i = 0; i < code.size(); ++i) {
+        std::map<int, std::string>::const_iterator l = labels.find(static_cast<int>(i));
+        if (l != labels.end()) os << l->second << ":\n";
+
+        const Instruction& in = code[i];
+        os << "  " << i << "\t" << opName(in.op);
+        switch (in.op) {
+            case Instruction::OP_CHAR:
+                os << " " << in.a << " -> " << symbols[in.b];
+                break;
+            case Instruction::OP_CLASS:
+                os << " #" << in.a << " -> " << symbols[in.b];
+                break;
+            case Instruction::OP_LITERAL:
+                os << " '" << literals[in.a] << "'";
+                break;
+            case Instruction::OP_TEST:
+                os << " #" << in.a << " else " << in.b;
+                break;
+            case Instruction::OP_ALT_BEGIN:
+            case Instruction::OP_CAPTURE_OPEN:
+                os << " " << symbols[in.a];
+                break;
+            case Instruction::OP_CALL:
+            case Instruction::OP_CHOICE:
+            case Instruction::OP_COMMIT:
+            case Instruction::OP_JUMP:
+                os << " " << in.a;
+                break;
+            default:
+                break;
+        }
+        os << "\n";
+    }
+}
+
+// ---------------- BytecodeCompiler ----------------
+
+BytecodeCompiler::BytecodeCompiler(const Grammar& g)
+    : grammar(g), first(g), prog(0) {}
+
+int BytecodeCompiler::emit(Instruction::OpCode op, int a, int b) {
+    prog->code.push_back(Instruction(op, a, b));
+    return static_cast<int>(prog->code.size() - 1);
+}
+
+int BytecodeCompiler::here() const {
+    return static_cast<int>(prog->code.size());
+}
+
+// Point the jump operand of an already emitted instruction at `target`
+void BytecodeCompiler::patch(int at, int target) {
+    Instruction& in = prog->code[at];
+    if (in.op == Instruction::OP_TEST) in.b = target;
+    else in.a = target;
+}
+
+int BytecodeCompiler::internSymbol(const std::string& s, bool keepsNull) {
+    std::map<std::string, int>::iterator it = symbolIndex.find(s);
+    if (it != symbolIndex.end()) return it->second;
+    int idx = static_cast<int>(prog->symbols.size());
+    prog->symbols.push_back(s);
+    prog->keepsNull.push_back(keepsNull);
+    prog->operators.push_back(0);
+    symbolIndex[s] = idx;
+    return idx;
+}
+
+int BytecodeCompiler::internLiteral(const std::string& s) {
+    std::map<std::string, int>::iterator it = literalIndex.find(s);
+    if (it != literalIndex.end()) return it->second;
+    int idx = static_cast<int>(prog->literals.size());
+    prog->literals.push_back(s);
+    literalIndex[s] = idx;
+    return idx;
+}
+
+int BytecodeCompiler::internClass(const std::bitset<256>& bits) {
+    for (size_t i = 0; i < prog->classes.size(); ++i) {
+        if (prog->classes[i] == bits) return static_cast<int>(i);
+    }
+    prog->classes.push_back(bits);
+    return static_cast<int>(prog->classes.size() - 1);
+}
+
+// Emit a FIRST-set guard for a non-nullable expression; the jump target is
+// collected in `jumps` so the caller can patch it once known.
+void BytecodeCompiler::emitTest(const Expression* expr, std::vector<int>& jumps) {
+    const FirstSets::Info& fi = first.of(expr);
+    if (fi.nullable) return;
+    jumps.push_back(emit(Instruction::OP_TEST, internClass(fi.chars), -1));
+}
+
+// True when no branch is nullable and the branches' FIRST sets are pairwise
+// disjoint: the lookahead byte then selects at most one viable branch.
+bool BytecodeCompiler::isDeterministic(const Expression* alt) {
+    std::bitset<256> seen;
+    for (size_t i = 0; i < alt->children.size(); ++i) {
+        const FirstSets::Info& fi = first.of(alt->children[i]);
+        if (fi.nullable || (seen & fi.chars).any()) return false;
+        seen |= fi.chars;
+    }
+    return true;
+}
+
+void BytecodeCompiler::compile(BytecodeProgram& out) {
+    out = BytecodeProgram();
+    prog = &out;
+    symbolIndex.clear();
+    literalIndex.clear();
+    callFixups.clear();
+    callTargets.clear();
+
+    // Address 0 is the return address of the start rule
+    emit(Instruction::OP_HALT);
+
+    const std::vector<Rule*>& rules = grammar.getRules();
+    for (size_t i = 0; i < rules.size(); ++i) {
+        if (out.entries.find(rules[i]->name) != out.entries.end())
+            continue; // getRule() resolves duplicates to the first definition
+        out.entries[rules[i]->name] = here();
+        if (rules[i]->operators) out.operatorRules[rules[i]->name] = rules[i]->operators;
+        if (first.leftRecursive(rules[i])) {
+            // The VM has no seed growing; calling the rule would loop forever
+            std::cerr << "BytecodeCompiler: left-recursive rule " << rules[i]->name
+                      << " is not supported and never matches" << std::endl;
+            out.unsupported.push_back(rules[i]->name);
+            emit(Instruction::OP_FAIL);
+        } else {
+            compileExpr(rules[i]->rootExpr);
+        }
+        emit(Instruction::OP_RET);
+    }
+
+    for (size_t i = 0; i < callFixups.size(); ++i)
+        patch(static_cast<int>(callFixups[i]), out.entryPoint(callTargets[i]));
+
+    DEBUG_MSG("BytecodeCompiler: " << out.code.size() << " instructions, "
+              << out.entries.size() << " rules");
+    prog = 0;
+}
+
+void BytecodeCompiler::compileExpr(const Expression* expr) {
+    if (!expr) {
+        emit(Instruction::OP_FAIL);
+        return;
+    }
+
+    switch (expr->type) {
+        case Expression::EXPR_TERMINAL: {
+            std::string lit = expr->terminalText();
+            if (lit.empty()) {
+                emit(Instruction::OP_FAIL);
+            } else if (lit.size() == 1) {
+                emit(Instruction::OP_CHAR, static_cast<unsigned char>(lit[0]),
+                     internSymbol(lit, false));
+            } else {
+                emit(Instruction::OP_LITERAL, internLiteral(lit), internSymbol(lit, false));
+            }
+            break;
+        }
+        case Expression::EXPR_CHAR_RANGE: {
+            std::bitset<256> bits;
+            for (unsigned int c = expr->charRange.start; c <= expr->charRange.end; ++c)
+                bits.set(c);
+            emit(Instruction::OP_CLASS, internClass(bits), internSymbol("<char-range>", false));
+            break;
+        }
+        case Expression::EXPR_CHAR_CLASS:
+            emit(Instruction::OP_CLASS, internClass(expr->charBitmap),
+                 internSymbol("<char-class>", false));
+            break;
+        case Expression::EXPR_SYMBOL: {
+            const Rule* rule = grammar.getRule(expr->value);
+            if (!rule) {
+                DEBUG_MSG("BytecodeCompiler: unknown symbol " << expr->value);
+                emit(Instruction::OP_FAIL);
+                break;
+            }
+            // The rule's node gets the folded tree of an operator rule's chain
+            int symbol = internSymbol(expr->value, false);
+            prog->operators[symbol] = rule->operators;
+            emit(Instruction::OP_CAPTURE_OPEN, symbol);
+            callFixups.push_back(emit(Instruction::OP_CALL, -1));
+            callTargets.push_back(expr->value);
+            emit(Instruction::OP_CAPTURE_CLOSE);
+            break;
+        }
+        case Expression::EXPR_SEQUENCE:
+            emit(Instruction::OP_CAPTURE_OPEN, internSymbol("<seq>", true));
+            for (size_t i = 0; i < expr->children.size(); ++i)
+                compileExpr(expr->children[i]);
+            emit(Instruction::OP_CAPTURE_CLOSE);
+            break;
+        case Expression::EXPR_OPTIONAL: {
+            emit(Instruction::OP_CAPTURE_OPEN, internSymbol("<opt>", false));
+            int choice = emit(Instruction::OP_CHOICE, -1);
+            compileExpr(expr->children.empty() ? 0 : expr->children[0]);
+            int commit = emit(Instruction::OP_COMMIT, -1);
+            patch(choice, here());
+            patch(commit, here());
+            emit(Instruction::OP_CAPTURE_CLOSE);
+            break;
+        }
+        case Expression::EXPR_REPEAT: {
+            const Expression* body = expr->children.empty() ? 0 : expr->children[0];
+            emit(Instruction::OP_CAPTURE_OPEN, internSymbol("<rep>", false));
+            int loop = here();
+            std::vector<int> exits;
+            emitTest(body, exits);
+            exits.push_back(emit(Instruction::OP_CHOICE, -1));
+            compileExpr(body);
+            emit(Instruction::OP_PROGRESS);
+            emit(Instruction::OP_COMMIT, loop);
+            for (size_t i = 0; i < exits.size(); ++i)
+                patch(exits[i], here());
+            emit(Instruction::OP_CAPTURE_CLOSE);
+            break;
+        }
+        case Expression::EXPR_ALTERNATIVE: {
+            if (isDeterministic(expr)) {
+                emit(Instruction::OP_CAPTURE_OPEN, internSymbol("<alt>", false));
+                std::vector<int> done;
+                for (size_t i = 0; i < expr->children.size(); ++i) {
+                    std::vector<int> next;
+                    emitTest(expr->children[i], next);
+                    compileExpr(expr->children[i]);
+                    done.push_back(emit(Instruction::OP_JUMP, -1));
+                    for (size_t j = 0; j < next.size(); ++j)
+                        patch(next[j], here());
+                }
+                emit(Instruction::OP_FAIL);
+                for (size_t j = 0; j < done.size(); ++j)
+                    patch(done[j], here());
+                emit(Instruction::OP_CAPTURE_CLOSE);
+                break;
+            }
+            emit(Instruction::OP_ALT_BEGIN, internSymbol("<alt>", false));
+            for (size_t i = 0; i < expr->children.size(); ++i) {
+                std::vector<int> next;
+                emitTest(expr->children[i], next);
+                next.push_back(emit(Instruction::OP_CHOICE, -1));
+                compileExpr(expr->children[i]);
+                emit(Instruction::OP_ALT_RECORD);
+                for (size_t j = 0; j < next.size(); ++j)
+                    patch(next[j], here());
+            }
+            emit(Instruction::OP_ALT_END);
+            break;
+        }
+        default:
+            emit(Instruction::OP_FAIL);
+            break;
+    }
+}
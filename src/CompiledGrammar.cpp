@@ -0,0 +1,142 @@
+#include "../include/CompiledGrammar.hpp"
+#include "../include/FirstSets.hpp"
+#include "../include/Debug.hpp"
+#include <set>
+
+// Store the link data of one expression tree. Interned grammars share
+// subtrees between rules, so already visited nodes are skipped.
+static void linkExpr(Expression* expr,
+                     const std::map<std::string, const Rule*>& index,
+                     FirstSets& first,
+                     std::set<const Expression*>& visited,
+                     std::vector<DispatchTable*>& tables,
+                     std::vector<KeywordTrie*>& tries)
+{
+    if (!expr || !visited.insert(expr).second) return;
+
+    const FirstSets::Info& fi = first.of(expr);
+    expr->first = fi.chars;
+    expr->nullable = fi.nullable;
+
+    if (expr->type == Expression::EXPR_SYMBOL) {
+        std::map<std::string, const Rule*>::const_iterator it = index.find(expr->value);
+        expr->rule = it != index.end() ? it->second : 0;
+        if (!expr->rule)
+            DEBUG_MSG("CompiledGrammar: unresolved symbol " << expr->value);
+    } else if (expr->type == Expression::EXPR_TERMINAL) {
+        expr->literal = expr->terminalText();
+    } else if (expr->type == Expression::EXPR_ALTERNATIVE &&
+               expr->children.size() >= DispatchTable::MIN_BRANCHES) {
+        DispatchTable* table = new DispatchTable();
+        for (size_t i = 0; i < expr->children.size(); ++i) {
+            // A null branch never matches: empty FIRST, not nullable
+            if (!expr->children[i]) {
+                table->addBranch(std::bitset<256>(), false);
+                continue;
+            }
+            const FirstSets::Info& bi = first.of(expr->children[i]);
+            table->addBranch(bi.chars, bi.nullable);
+        }
+        table->finish();
+        tables.push_back(table);
+        expr->dispatch = table;
+    }
+
+    if (expr->type == Expression::EXPR_ALTERNATIVE) {
+        KeywordTrie* trie = new KeywordTrie();
+        if (KeywordTrie::fromAlternative(expr, *trie)) {
+            tries.push_back(trie);
+            expr->keywords = trie;
+        } else {
+            delete trie;
+        }
+    }
+
+    for (size_t i = 0; i < expr->children.size(); ++i)
+        linkExpr(expr->children[i], index, first, visited, tables, tries);
+}
+
+// Run scanners need the link data of the rules a repetition's body calls
+static void linkRuns(Expression* expr, std::set<const Expression*>& visited,
+                     std::vector<ByteRun*>& runs)
+{
+    if (!expr || !visited.insert(expr).second) return;
+    if (expr->type == Expression::EXPR_REPEAT) {
+        ByteRun* run = new ByteRun();
+        if (ByteRun::fromRepeat(expr, *run)) {
+            runs.push_back(run);
+            expr->run = run;
+        } else {
+            delete run;
+        }
+    }
+    for (size_t i = 0; i < expr->children.size(); ++i)
+        linkRuns(expr->children[i], visited, runs);
+}
+
+CompiledGrammar::CompiledGrammar(const Grammar& g) : grammar(g) {
+    const std::vector<Rule*>& rules = g.getRules();
+    // insert() keeps the first definition, matching Grammar::getRule
+    for (size_t i = 0; i < rules.size(); ++i)
+        index.insert(std::make_pair(rules[i]->name, static_cast<const Rule*>(rules[i])));
+
+    FirstSets first(g);
+    std::set<const Expression*> visited;
+    for (size_t i = 0; i < rules.size(); ++i)
+        linkExpr(rules[i]->rootExpr, index, first, visited, tables, tries);
+
+    for (size_t i = 0; i < rules.size(); ++i) {
+        rules[i]->leftRecursive = first.leftRecursive(rules[i]);
+        if (rules[i]->leftRecursive && index[rules[i]->name] == rules[i]) {
+            leftRecursive.push_back(rules[i]->name);
+            DEBUG_MSG("CompiledGrammar: " << rules[i]->name << " is left-recursive");
+        }
+        rules[i]->seedBody = rules[i]->leftRecursive ? first.seedBody(rules[i]) : 0;
+        if (rules[i]->seedBody) {
+            seedBodies.push_back(rules[i]->seedBody);
+            linkExpr(rules[i]->seedBody, index, first, visited, tables, tries);
+        }
+    }
+
+    std::set<const Expression*> scanned;
+    for (size_t i = 0; i < rules.size(); ++i)
+        linkRuns(rules[i]->rootExpr, scanned, runs);
+
+    // DFAs need the link data of every rule they inline
+    for (size_t i = 0; i < rules.size(); ++i) {
+        if (index[rules[i]->name] != rules[i]) continue;
+        Dfa* dfa = new Dfa();
+        if (Dfa::fromRule(rules[i], *dfa)) {
+            rules[i]->dfa = dfa;
+            dfas.push_back(dfa);
+            regular.push_back(rules[i]->name);
+            DEBUG_MSG("CompiledGrammar: " << rules[i]->name << " compiled to a DFA of "
+                      << dfa->states() << " states");
+        } else {
+            delete dfa;
+        }
+    }
+
+    DEBUG_MSG("CompiledGrammar: linked " << rules.size() << " rules");
+}
+
+CompiledGrammar::~CompiledGrammar() {
+    for (size_t i = 0; i < tables.size(); ++i)
+        delete tables[i];
+    for (size_t i = 0; i < tries.size(); ++i)
+        delete tries[i];
+    for (size_t i = 0; i < dfas.size(); ++i)
+        delete dfas[i];
+    for (size_t i = 0; i < runs.size(); ++i)
+        delete runs[i];
+    // Seed bodies share their branches with the rules
+    for (size_t i = 0; i < seedBodies.size(); ++i) {
+        seedBodies[i]->children.clear();
+        delete seedBodies[i];
+    }
+}
+
+const Rule* CompiledGrammar::getRule(const std::string& name) const {
+    std::map<std::string, const Rule*>::const_iterator it = index.find(name);
+    return it != index.end() ? it->second : 0;
+}
@@ -95,8 +95,8 @@ void DataExtractor::visit(ASTNode* node, ExtractedData& out) {
 
     // 1) Check if we should extract this symbol
     if (shouldExtract(node->symbol)) {
-        DEBUG_MSG("DataExtractor::visit: extracting symbol '" + node->symbol + "' with value '" + node->matched + "'");
-        out.values[node->symbol].push_back(node->matched);
+        DEBUG_MSG("DataExtractor::visit: extracting symbol '" + node->symbol + "' with value '" + node->text() + "'");
+        out.values[node->symbol].push_back(node->text());
     } else {
         DEBUG_MSG("DataExtractor::visit: skipping symbol '" + node->symbol + "' (filtered out)");
     }
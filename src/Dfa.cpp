@@ -0,0 +1,309 @@
+#include "../include/Dfa.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/Expression.hpp"
+#include <algorithm>
+#include <bitset>
+#include <map>
+
+const size_t Dfa::MAX_STATES;
+const size_t Dfa::MAX_NFA_STATES;
+const size_t Dfa::NO_MATCH;
+
+namespace {
+
+// Whether the parser's choices in `e` are fixed by the next byte, given
+// the bytes that may follow it inside the rule. `active` holds the rules
+// being inlined, so a reference cycle is rejected.
+bool deterministic(const Expression* e, const std::bitset<256>& follow,
+                   std::vector<const Rule*>& active)
+{
+    if (!e) return false;
+    switch (e->type) {
+        case Expression::EXPR_TERMINAL:
+            // An empty literal never matches in the parser
+            return !e->literal.empty();
+        case Expression::EXPR_CHAR_RANGE:
+        case Expression::EXPR_CHAR_CLASS:
+            return true;
+        case Expression::EXPR_SYMBOL: {
+            if (!e->rule || !e->rule->rootExpr) return false;
+            if (std::find(active.begin(), active.end(), e->rule) != active.end()) return false;
+            active.push_back(e->rule);
+            bool ok = deterministic(e->rule->rootExpr, follow, active);
+            active.pop_back();
+            return ok;
+        }
+        case Expression::EXPR_SEQUENCE: {
+            std::bitset<256> after = follow;
+            for (size_t i = e->children.size(); i-- > 0; ) {
+                const Expression* c = e->children[i];
+                if (!c || !deterministic(c, after, active)) return false;
+                after = c->nullable ? (after | c->first) : c->first;
+            }
+            return true;
+        }
+        case Expression::EXPR_ALTERNATIVE: {
+            // Null branches never match; the others must not overlap
+            std::bitset<256> seen;
+            for (size_t i = 0; i < e->children.size(); ++i) {
+                const Expression* c = e->children[i];
+                if (!c) continue;
+                if (c->nullable || (seen & c->first).any()) return false;
+                if (!deterministic(c, follow, active)) return false;
+                seen |= c->first;
+            }
+            return true;
+        }
+        case Expression::EXPR_OPTIONAL:
+        case Expression::EXPR_REPEAT: {
+            const Expression* c = e->children.empty() ? 0 : e->children[0];
+            if (!c || c->nullable || (c->first & follow).any()) return false;
+            std::bitset<256> inner = follow;
+            if (e->type == Expression::EXPR_REPEAT) inner |= c->first;
+            return deterministic(c, inner, active);
+        }
+        default:
+            return false;
+    }
+}
+
+// Thompson NFA: every state has at most one byte-set edge plus epsilon edges
+struct NfaState {
+    std::bitset<256> bytes;
+    int target;
+    std::vector<int> eps;
+    NfaState() : target(-1) {}
+};
+
+struct Nfa {
+    std::vector<NfaState> states;
+    bool overflow;
+    Nfa() : overflow(false) {}
+
+    int add() {
+        if (states.size() >= Dfa::MAX_NFA_STATES) {
+            overflow = true;
+            return 0;
+        }
+        states.push_back(NfaState());
+        return static_cast<int>(states.size() - 1);
+    }
+
+    // Builds the fragment of `e` between `in` and a new exit state
+    int build(const Expression* e, int in) {
+        if (overflow) return in;
+        switch (e->type) {
+            case Expression::EXPR_TERMINAL: {
+                int at = in;
+                for (size_t i = 0; i < e->literal.size() && !overflow; ++i) {
+                    int to = add();
+                    states[at].bytes.set(static_cast<unsigned char>(e->literal[i]));
+                    states[at].target = to;
+                    at = to;
+                }
+                return at;
+            }
+            case Expression::EXPR_CHAR_RANGE: {
+                int to = add();
+                for (unsigned c = e->charRange.start; c <= e->charRange.end; ++c)
+                    states[in].bytes.set(c);
+                states[in].target = to;
+                return to;
+            }
+            case Expression::EXPR_CHAR_CLASS: {
+                int to = add();
+                states[in].bytes = e->charBitmap;
+                states[in].target = to;
+                return to;
+            }
+            case Expression::EXPR_SYMBOL:
+                return build(e->rule->rootExpr, in);
+            case Expression::EXPR_SEQUENCE: {
+                int at = in;
+                for (size_t i = 0; i < e->children.size(); ++i) {
+                    // A fresh entry keeps byte edges one per state
+                    int entry = add();
+                    states[at].eps.push_back(entry);
+                    at = build(e->children[i], entry);
+                }
+                return at;
+            }
+            case Expression::EXPR_ALTERNATIVE: {
+                int out = add();
+                for (size_t i = 0; i < e->children.size() && !overflow; ++i) {
+                    if (!e->children[i]) continue;
+                    int entry = add();
+                    states[in].eps.push_back(entry);
+                    int end = build(e->children[i], entry);
+                    states[end].eps.push_back(out);
+                }
+                return out;
+            }
+            case Expression::EXPR_OPTIONAL: {
+                int entry = add();
+                int out = add();
+                states[in].eps.push_back(entry);
+                states[in].eps.push_back(out);
+                int end = build(e->children[0], entry);
+                states[end].eps.push_back(out);
+                return out;
+            }
+            case Expression::EXPR_REPEAT: {
+                int loop = add();
+                int entry = add();
+                int out = add();
+                states[in].eps.push_back(loop);
+                states[loop].eps.push_back(entry);
+                states[loop].eps.push_back(out);
+                int end = build(e->children[0], entry);
+                states[end].eps.push_back(loop);
+                return out;
+            }
+            default:
+                overflow = true;
+                return in;
+        }
+    }
+
+    void closure(std::vector<int>& set) const {
+        std::vector<char> in(states.size(), 0);
+        for (size_t i = 0; i < set.size(); ++i) in[set[i]] = 1;
+        for (size_t i = 0; i < set.size(); ++i) {
+            const std::vector<int>& eps = states[set[i]].eps;
+            for (size_t j = 0; j < eps.size(); ++j) {
+                if (!in[eps[j]]) {
+                    in[eps[j]] = 1;
+                    set.push_back(eps[j]);
+                }
+            }
+        }
+        std::sort(set.begin(), set.end());
+    }
+};
+
+} // namespace
+
+Dfa::Dfa() : classCount(0), start(0) {
+    std::fill(classOf, classOf + 256, static_cast<unsigned char>(0));
+}
+
+bool Dfa::fromRule(const Rule* rule, Dfa& dfa) {
+    if (!rule || !rule->rootExpr) return false;
+    std::vector<const Rule*> active(1, rule);
+    if (!deterministic(rule->rootExpr, std::bitset<256>(), active)) return false;
+
+    Nfa nfa;
+    int entry = nfa.add();
+    int exit = nfa.build(rule->rootExpr, entry);
+    if (nfa.overflow) return false;
+
+    // Byte classes: bytes that no edge tells apart share a class
+    std::vector<unsigned> cls(256, 0);
+    unsigned classes = 1;
+    for (size_t s = 0; s < nfa.states.size(); ++s) {
+        const std::bitset<256>& bytes = nfa.states[s].bytes;
+        if (bytes.none()) continue;
+        std::map<std::pair<unsigned, bool>, unsigned> split;
+        for (unsigned c = 0; c < 256; ++c) {
+            std::pair<unsigned, bool> key(cls[c], bytes.test(c));
+            std::map<std::pair<unsigned, bool>, unsigned>::iterator it = split.find(key);
+            if (it == split.end())
+                it = split.insert(std::make_pair(key, static_cast<unsigned>(split.size()))).first;
+            cls[c] = it->second;
+        }
+        classes = static_cast<unsigned>(split.size());
+    }
+    std::vector<unsigned> sample(classes, 0);
+    for (unsigned c = 256; c-- > 0; ) sample[cls[c]] = c;
+
+    // Subset construction; state 0 is the dead state
+    std::map<std::vector<int>, unsigned> ids;
+    std::vector<std::vector<int> > sets(1);
+    std::vector<unsigned> table(classes, 0);
+    std::vector<char> accept(1, 0);
+    std::vector<int> first(1, entry);
+    nfa.closure(first);
+    ids[first] = 1;
+    sets.push_back(first);
+    table.resize(2 * classes, 0);
+    accept.push_back(std::binary_search(first.begin(), first.end(), exit));
+
+    for (size_t d = 1; d < sets.size(); ++d) {
+        for (unsigned c = 0; c < classes; ++c) {
+            std::vector<int> to;
+            for (size_t i = 0; i < sets[d].size(); ++i) {
+                const NfaState& s = nfa.states[sets[d][i]];
+                if (s.target >= 0 && s.bytes.test(sample[c])) to.push_back(s.target);
+            }
+            if (to.empty()) continue;
+            nfa.closure(to);
+            std::map<std::vector<int>, unsigned>::iterator it = ids.find(to);
+            if (it == ids.end()) {
+                if (sets.size() >= MAX_STATES) return false;
+                it = ids.insert(std::make_pair(to, static_cast<unsigned>(sets.size()))).first;
+                sets.push_back(to);
+                table.resize(sets.size() * classes, 0);
+                accept.push_back(std::binary_search(to.begin(), to.end(), exit));
+            }
+            table[d * classes + c] = it->second;
+        }
+    }
+
+    // Moore minimization: split blocks by acceptance, then by the blocks
+    // their transitions lead to, until nothing changes
+    size_t n = sets.size();
+    std::vector<unsigned> block(n);
+    for (size_t s = 0; s < n; ++s) block[s] = accept[s] ? 1 : 0;
+    size_t blocks = 0;
+    for (;;) {
+        std::map<std::vector<unsigned>, unsigned> sig;
+        std::vector<unsigned> refined(n);
+        for (size_t s = 0; s < n; ++s) {
+            std::vector<unsigned> key(1, block[s]);
+            for (unsigned c = 0; c < classes; ++c) key.push_back(block[table[s * classes + c]]);
+            std::map<std::vector<unsigned>, unsigned>::iterator it = sig.find(key);
+            if (it == sig.end())
+                it = sig.insert(std::make_pair(key, static_cast<unsigned>(sig.size()))).first;
+            refined[s] = it->second;
+        }
+        block.swap(refined);
+        if (sig.size() == blocks) break;
+        blocks = sig.size();
+    }
+
+    // Renumber so that the dead state's block is state 0
+    std::vector<unsigned> id(blocks, 0);
+    std::vector<char> seen(blocks, 0);
+    seen[block[0]] = 1;
+    unsigned count = 1;
+    for (size_t s = 1; s < n; ++s) {
+        if (!seen[block[s]]) {
+            seen[block[s]] = 1;
+            id[block[s]] = count++;
+        }
+    }
+
+    dfa.classCount = classes;
+    for (unsigned c = 0; c < 256; ++c) dfa.classOf[c] = static_cast<unsigned char>(cls[c]);
+    dfa.next.assign(count * classes, 0);
+    dfa.accepting.assign(count, 0);
+    for (size_t s = 1; s < n; ++s) {
+        unsigned to = id[block[s]];
+        dfa.accepting[to] = accept[s];
+        for (unsigned c = 0; c < classes; ++c)
+            dfa.next[to * classes + c] = id[block[table[s * classes + c]]];
+    }
+    dfa.start = id[block[1]];
+    return true;
+}
+
+size_t Dfa::match(const char* data, size_t size) const {
+    size_t best = accepting[start] ? 0 : NO_MATCH;
+    unsigned s = start;
+    for (size_t i = 0; i < size; ++i) {
+        s = next[s * classCount + classOf[static_cast<unsigned char>(data[i])]];
+        if (!s) break;
+        if (accepting[s]) best = i + 1;
+    }
+    return best;
+}
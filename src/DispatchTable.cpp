@@ -0,0 +1,40 @@
+#include "../include/DispatchTable.hpp"
+#include <algorithm>
+
+const size_t DispatchTable::MIN_BRANCHES;
+const size_t DispatchTable::END_OF_INPUT;
+
+DispatchTable::DispatchTable() {}
+
+void DispatchTable::addBranch(const std::bitset<256>& first, bool nullable) {
+    firsts.push_back(first);
+    nullables.push_back(nullable);
+}
+
+// Counting pass, then a fill pass: one flat array for all 257 lists
+void DispatchTable::finish() {
+    offsets.assign(END_OF_INPUT + 2, 0);
+    for (size_t key = 0; key <= END_OF_INPUT; ++key) {
+        unsigned n = 0;
+        for (size_t b = 0; b < firsts.size(); ++b) {
+            if (nullables[b] || (key < END_OF_INPUT && firsts[b].test(key))) ++n;
+        }
+        offsets[key + 1] = offsets[key] + n;
+    }
+    list.resize(offsets[END_OF_INPUT + 1]);
+    for (size_t key = 0; key <= END_OF_INPUT; ++key) {
+        unsigned at = offsets[key];
+        for (size_t b = 0; b < firsts.size(); ++b) {
+            if (nullables[b] || (key < END_OF_INPUT && firsts[b].test(key)))
+                list[at++] = static_cast<unsigned>(b);
+        }
+    }
+}
+
+size_t DispatchTable::next(size_t key, size_t from) const {
+    std::vector<unsigned>::const_iterator first = list.begin() + offsets[key];
+    std::vector<unsigned>::const_iterator last = list.begin() + offsets[key + 1];
+    std::vector<unsigned>::const_iterator it =
+        std::lower_bound(first, last, static_cast<unsigned>(from));
+    return it == last ? firsts.size() : *it;
+}
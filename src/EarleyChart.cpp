@@ -0,0 +1,542 @@
+#include "../include/EarleyChart.hpp"
+#include "../include/Debug.hpp"
+#include <algorithm>
+#include <functional>
+
+const size_t EarleyChart::NO_MATCH;
+
+// A free entry of the item index
+EarleyChart::Key EarleyChart::blankKey() {
+    Key k;
+    k.pos = k.origin = k.seq = 0;
+    k.slot = NO_MATCH;
+    return k;
+}
+
+EarleyChart::EarleyChart(const Grammar& g)
+    : grammar(g), failSymbol(0), text(0), used(0), items(0), horizon(0),
+      startSymbol(0), accepted(NO_MATCH)
+{
+    failSymbol = addSymbol(0);
+    const std::vector<Rule*>& rules = grammar.getRules();
+    for (size_t i = 0; i < rules.size(); ++i) {
+        if (ruleSymbol.find(rules[i]) == ruleSymbol.end())
+            ruleSymbol[rules[i]] = addSymbol(rules[i]);
+    }
+    for (size_t i = 0; i < rules.size(); ++i) {
+        std::vector<size_t> right(1, symbolOf(rules[i]->rootExpr));
+        addProduction(ruleSymbol[rules[i]], right);
+    }
+    solve();
+    predicted.resize(symbols.size(), 0);
+    index.assign(1024, blankKey());
+    DEBUG_MSG("EarleyChart: " << symbols.size() << " symbols, " << prods.size() << " productions");
+}
+
+size_t EarleyChart::addSymbol(const Rule* rule) {
+    Symbol s;
+    s.rule = rule;
+    s.terminal = false;
+    s.literalTerm = false;
+    s.nullable = false;
+    s.firstProd = 0;
+    s.prodCount = 0;
+    symbols.push_back(s);
+    return symbols.size() - 1;
+}
+
+// Symbol of one expression; composite expressions get their productions
+// after those of their children, so each symbol's productions are adjacent
+size_t EarleyChart::symbolOf(const Expression* expr) {
+    if (!expr) return failSymbol;
+    std::map<const Expression*, size_t>::const_iterator it = exprSymbol.find(expr);
+    if (it != exprSymbol.end()) return it->second;
+
+    size_t sym = failSymbol;
+    switch (expr->type) {
+        case Expression::EXPR_SYMBOL: {
+            const Rule* r = grammar.getRule(expr->value);
+            if (r) sym = ruleSymbol[r];
+            else DEBUG_MSG("EarleyChart: unknown symbol " << expr->value);
+            break;
+        }
+        case Expression::EXPR_TERMINAL:
+        case Expression::EXPR_CHAR_RANGE:
+        case Expression::EXPR_CHAR_CLASS: {
+            sym = addSymbol(0);
+            Symbol& s = symbols[sym];
+            s.terminal = true;
+            if (expr->type == Expression::EXPR_TERMINAL) {
+                s.literalTerm = true;
+                s.literal = expr->terminalText();
+            } else if (expr->type == Expression::EXPR_CHAR_RANGE) {
+                for (unsigned c = expr->charRange.start; c <= expr->charRange.end; ++c)
+                    s.bytes.set(c);
+            } else {
+                s.bytes = expr->charBitmap;
+            }
+            break;
+        }
+        case Expression::EXPR_SEQUENCE:
+        case Expression::EXPR_ALTERNATIVE: {
+            sym = addSymbol(0);
+            std::vector<size_t> parts;
+            for (size_t i = 0; i < expr->children.size(); ++i)
+                parts.push_back(symbolOf(expr->children[i]));
+            if (expr->type == Expression::EXPR_SEQUENCE) {
+                addProduction(sym, parts);
+            } else {
+                // One production per branch, in branch order
+                for (size_t i = 0; i < parts.size(); ++i)
+                    addProduction(sym, std::vector<size_t>(1, parts[i]));
+            }
+            break;
+        }
+        case Expression::EXPR_OPTIONAL:
+        case Expression::EXPR_REPEAT: {
+            sym = addSymbol(0);
+            size_t body = symbolOf(expr->children.empty() ? 0 : expr->children[0]);
+            std::vector<size_t> right;
+            // X ::= X body | ε keeps repetitions left-recursive
+            if (expr->type == Expression::EXPR_REPEAT) right.push_back(sym);
+            right.push_back(body);
+            addProduction(sym, right);
+            addProduction(sym, std::vector<size_t>());
+            break;
+        }
+        default:
+            break;
+    }
+    exprSymbol[expr] = sym;
+    return sym;
+}
+
+void EarleyChart::addProduction(size_t lhs, const std::vector<size_t>& right) {
+    Symbol& s = symbols[lhs];
+    if (s.prodCount == 0) s.firstProd = prods.size();
+    s.prodCount++;
+
+    Production p;
+    p.lhs = lhs;
+    p.rhsBegin = rhs.size();
+    p.size = right.size();
+    p.slot = slots.size();
+    p.nullable = false;
+    prods.push_back(p);
+    rhs.insert(rhs.end(), right.begin(), right.end());
+    for (size_t dot = 0; dot <= right.size(); ++dot) {
+        Slot sl;
+        sl.prod = prods.size() - 1;
+        sl.dot = dot;
+        sl.next = dot < right.size() ? right[dot] : NO_MATCH;
+        slots.push_back(sl);
+    }
+}
+
+// Nullable and FIRST of every symbol and production, as a least fixpoint.
+// An empty literal never matches, as in BNFParser.
+void EarleyChart::solve() {
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        Symbol& s = symbols[i];
+        if (!s.terminal) continue;
+        if (s.literalTerm) {
+            if (!s.literal.empty()) s.first.set(static_cast<unsigned char>(s.literal[0]));
+        } else {
+            s.first = s.bytes;
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < prods.size(); ++i) {
+            Production& p = prods[i];
+            bool nullable = true;
+            std::bitset<256> first;
+            for (size_t k = 0; k < p.size && nullable; ++k) {
+                const Symbol& s = symbols[rhs[p.rhsBegin + k]];
+                first |= s.first;
+                nullable = s.nullable;
+            }
+            Symbol& lhs = symbols[p.lhs];
+            if (nullable != p.nullable || (p.first | first) != p.first ||
+                (nullable && !lhs.nullable) || (lhs.first | first) != lhs.first) {
+                p.nullable = nullable;
+                p.first |= first;
+                lhs.nullable = lhs.nullable || nullable;
+                lhs.first |= first;
+                changed = true;
+            }
+        }
+    }
+}
+
+// ---------------- Item index ----------------
+
+static size_t hashItem(size_t pos, size_t slot, size_t origin) {
+    size_t h = (pos * 31 + slot) * 31 + origin;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6DU;
+    h ^= h >> 12;
+    return h;
+}
+
+// Insertion order of an item or completion marker, or NO_MATCH
+size_t EarleyChart::lookup(size_t pos, size_t slot, size_t origin) const {
+    size_t mask = index.size() - 1;
+    for (size_t i = hashItem(pos, slot, origin) & mask; index[i].slot != NO_MATCH; i = (i + 1) & mask) {
+        const Key& k = index[i];
+        if (k.pos == pos && k.slot == slot && k.origin == origin) return k.seq;
+    }
+    return NO_MATCH;
+}
+
+bool EarleyChart::insert(size_t pos, size_t slot, size_t origin) {
+    if ((used + 1) * 2 > index.size()) grow();
+    size_t mask = index.size() - 1;
+    size_t i = hashItem(pos, slot, origin) & mask;
+    for (; index[i].slot != NO_MATCH; i = (i + 1) & mask) {
+        const Key& k = index[i];
+        if (k.pos == pos && k.slot == slot && k.origin == origin) return false;
+    }
+    Key& k = index[i];
+    k.pos = pos;
+    k.slot = slot;
+    k.origin = origin;
+    k.seq = used++;
+    return true;
+}
+
+void EarleyChart::grow() {
+    std::vector<Key> old;
+    old.swap(index);
+    index.assign(old.size() * 2, blankKey());
+    size_t mask = index.size() - 1;
+    for (size_t j = 0; j < old.size(); ++j) {
+        if (old[j].slot == NO_MATCH) continue;
+        size_t i = hashItem(old[j].pos, old[j].slot, old[j].origin) & mask;
+        while (index[i].slot != NO_MATCH) i = (i + 1) & mask;
+        index[i] = old[j];
+    }
+}
+
+// ---------------- Recognizer ----------------
+
+// Add an item to set `pos` unless present; a completed item also records
+// that its symbol spans [origin, pos)
+void EarleyChart::add(size_t pos, size_t slot, size_t origin) {
+    if (!insert(pos, slot, origin)) return;
+    Item item;
+    item.slot = slot;
+    item.origin = origin;
+    sets[pos].push_back(item);
+    ++items;
+    if (pos > horizon) horizon = pos;
+
+    const Slot& sl = slots[slot];
+    if (sl.next != NO_MATCH) return;
+    size_t lhs = prods[sl.prod].lhs;
+    insert(pos, slots.size() + lhs, origin);
+    if (lhs == startSymbol && origin == 0 && (accepted == NO_MATCH || pos > accepted))
+        accepted = pos;
+}
+
+// Predict, scan and complete every item of one set. Items only ever go
+// to this set or later ones, so earlier sets are final.
+void EarleyChart::process(size_t pos) {
+    const std::string& input = *text;
+    bool hasChar = pos < input.size();
+    unsigned char look = hasChar ? static_cast<unsigned char>(input[pos]) : 0;
+
+    for (size_t k = 0; k < sets[pos].size(); ++k) {
+        Item it = sets[pos][k];
+        const Slot& sl = slots[it.slot];
+
+        if (sl.next == NO_MATCH) {
+            // Empty completions were already applied at prediction time
+            if (it.origin == pos) continue;
+            size_t lhs = prods[sl.prod].lhs;
+            const std::vector<Item>& waiting = sets[it.origin];
+            for (size_t w = 0; w < waiting.size(); ++w) {
+                if (slots[waiting[w].slot].next == lhs) add(pos, waiting[w].slot + 1, waiting[w].origin);
+            }
+            continue;
+        }
+
+        const Symbol& next = symbols[sl.next];
+        if (next.terminal) {
+            if (next.literalTerm) {
+                size_t len = next.literal.size();
+                if (len && pos + len <= input.size() && input.compare(pos, len, next.literal) == 0)
+                    add(pos + len, it.slot + 1, it.origin);
+            } else if (hasChar && next.bytes.test(look)) {
+                add(pos + 1, it.slot + 1, it.origin);
+            }
+            continue;
+        }
+
+        if (predicted[sl.next] != pos + 1) {
+            predicted[sl.next] = pos + 1;
+            for (size_t p = next.firstProd; p < next.firstProd + next.prodCount; ++p) {
+                if (prods[p].nullable || (hasChar && prods[p].first.test(look)))
+                    add(pos, prods[p].slot, pos);
+            }
+        }
+        // Aycock/Horspool: step over a nullable symbol right away
+        if (next.nullable) add(pos, it.slot + 1, it.origin);
+    }
+}
+
+size_t EarleyChart::recognize(const Rule* start, const std::string& input) {
+    text = &input;
+    if (sets.size() < input.size() + 1) sets.resize(input.size() + 1);
+    for (size_t i = 0; i <= input.size(); ++i)
+        sets[i].clear();
+    std::fill(predicted.begin(), predicted.end(), 0);
+    std::fill(index.begin(), index.end(), blankKey());
+    used = 0;
+    items = 0;
+    horizon = 0;
+    accepted = NO_MATCH;
+
+    std::map<const Rule*, size_t>::const_iterator it = ruleSymbol.find(start);
+    if (it == ruleSymbol.end()) return NO_MATCH;
+    startSymbol = it->second;
+    const Symbol& s = symbols[startSymbol];
+    predicted[startSymbol] = 1;
+    for (size_t p = s.firstProd; p < s.firstProd + s.prodCount; ++p)
+        add(0, prods[p].slot, 0);
+
+    // Stop once no set ahead holds an item
+    for (size_t pos = 0; pos <= horizon; ++pos)
+        process(pos);
+
+    DEBUG_MSG("EarleyChart: " << items << " items, accepted " << accepted);
+    return accepted;
+}
+
+// ---------------- Derivation ----------------
+
+size_t EarleyChart::symbolAt(const Expression* expr) const {
+    std::map<const Expression*, size_t>::const_iterator it = exprSymbol.find(expr);
+    return it != exprSymbol.end() ? it->second : failSymbol;
+}
+
+// Insertion order of the first completion of a nonterminal over [begin, end)
+size_t EarleyChart::completion(size_t sym, size_t begin, size_t end) const {
+    return lookup(end, slots.size() + sym, begin);
+}
+
+bool EarleyChart::matches(size_t sym, size_t begin, size_t end) const {
+    const Symbol& s = symbols[sym];
+    if (begin == end) return s.nullable;
+    if (!s.terminal) return completion(sym, begin, end) != NO_MATCH;
+    if (s.literalTerm)
+        return s.literal.size() == end - begin && text->compare(begin, end - begin, s.literal) == 0;
+    return end - begin == 1 && s.bytes.test(static_cast<unsigned char>((*text)[begin]));
+}
+
+// Starts s in [begin, end] from which `sym` derives [s, end), latest first
+void EarleyChart::endings(size_t sym, size_t begin, size_t end, std::vector<size_t>& out) const {
+    out.clear();
+    const Symbol& s = symbols[sym];
+    if (s.nullable) out.push_back(end);
+    if (s.terminal) {
+        size_t len = s.literalTerm ? s.literal.size() : 1;
+        if (len && end - begin >= len && matches(sym, end - len, end)) out.push_back(end - len);
+        return;
+    }
+    const std::vector<Item>& set = sets[end];
+    for (size_t i = 0; i < set.size(); ++i) {
+        const Slot& sl = slots[set[i].slot];
+        if (sl.next == NO_MATCH && prods[sl.prod].lhs == sym &&
+            set[i].origin >= begin && set[i].origin < end)
+            out.push_back(set[i].origin);
+    }
+    std::sort(out.begin(), out.end(), std::greater<size_t>());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+// Place the first k symbols of a production over [begin, end), each last
+// one as short as possible. The prefix item in set s proves the symbols
+// before it fit [begin, s). A symbol spanning the whole [begin, whole) of
+// the parent must have completed before the parent (`bound`), which rules
+// out cycles through unit and nullable productions.
+bool EarleyChart::splitSequence(size_t prod, size_t k, size_t begin, size_t end, size_t whole,
+                                size_t bound, std::vector<size_t>& cuts) const {
+    if (k == 0) return end == begin;
+    const Production& p = prods[prod];
+    size_t sym = rhs[p.rhsBegin + k - 1];
+    std::vector<size_t> starts;
+    endings(sym, begin, end, starts);
+    for (size_t i = 0; i < starts.size(); ++i) {
+        size_t s = starts[i];
+        if (lookup(s, p.slot + k - 1, begin) == NO_MATCH) continue;
+        if (s == begin && end == whole && s < end && !symbols[sym].terminal &&
+            completion(sym, s, end) >= bound)
+            continue;
+        cuts[k - 1] = s;
+        if (splitSequence(prod, k - 1, begin, s, whole, bound, cuts)) return true;
+    }
+    return false;
+}
+
+// Emit the step of one non-empty task and queue its children
+void EarleyChart::expand(const Task& task, std::vector<Step>& out, std::vector<Task>& todo) const {
+    Step step;
+    step.expr = task.expr;
+    step.begin = task.begin;
+    step.end = task.end;
+    step.parent = task.parent;
+    size_t self = out.size();
+    out.push_back(step);
+
+    const Expression* expr = task.expr;
+    const Symbol& s = symbols[symbolAt(expr)];
+    std::vector<Task> kids;
+    Task kid;
+    kid.parent = self;
+    kid.bound = NO_MATCH;
+
+    switch (expr->type) {
+        case Expression::EXPR_SYMBOL: {
+            const Production& p = prods[s.firstProd];
+            kid.expr = s.rule->rootExpr;
+            kid.begin = task.begin;
+            kid.end = task.end;
+            kid.bound = lookup(task.end, p.slot + 1, task.begin);
+            kids.push_back(kid);
+            break;
+        }
+        case Expression::EXPR_ALTERNATIVE:
+        case Expression::EXPR_OPTIONAL: {
+            // First branch (or the body) whose completion is old enough
+            for (size_t b = 0; b < s.prodCount; ++b) {
+                const Production& p = prods[s.firstProd + b];
+                if (p.size != 1) continue;
+                size_t seq = lookup(task.end, p.slot + 1, task.begin);
+                if (seq == NO_MATCH || seq >= task.bound) continue;
+                size_t child = rhs[p.rhsBegin];
+                if (!symbols[child].terminal && completion(child, task.begin, task.end) >= seq) continue;
+                kid.expr = expr->children[b];
+                kid.begin = task.begin;
+                kid.end = task.end;
+                kid.bound = seq;
+                kids.push_back(kid);
+                break;
+            }
+            break;
+        }
+        case Expression::EXPR_SEQUENCE: {
+            size_t prod = s.firstProd;
+            const Production& p = prods[prod];
+            size_t seq = lookup(task.end, p.slot + p.size, task.begin);
+            std::vector<size_t> cuts(p.size + 1, task.end);
+            if (!splitSequence(prod, p.size, task.begin, task.end, task.end, seq, cuts)) {
+                DEBUG_MSG("EarleyChart: no split for sequence at " << task.begin);
+                break;
+            }
+            for (size_t i = 0; i < p.size; ++i) {
+                kid.expr = expr->children[i];
+                kid.begin = cuts[i];
+                kid.end = cuts[i + 1];
+                kid.bound = kid.begin == task.begin && kid.end == task.end ? seq : NO_MATCH;
+                kids.push_back(kid);
+            }
+            break;
+        }
+        case Expression::EXPR_REPEAT: {
+            // Peel non-empty iterations off the end: X ::= X body
+            const Production& p = prods[s.firstProd];
+            size_t body = rhs[p.rhsBegin + 1];
+            size_t seq = lookup(task.end, p.slot + 2, task.begin);
+            std::vector<size_t> starts;
+            size_t end = task.end;
+            while (end > task.begin) {
+                endings(body, task.begin, end, starts);
+                size_t found = NO_MATCH;
+                for (size_t i = 0; i < starts.size() && found == NO_MATCH; ++i) {
+                    size_t st = starts[i];
+                    if (st == end || lookup(st, p.slot + 1, task.begin) == NO_MATCH) continue;
+                    if (st == task.begin && end == task.end && !symbols[body].terminal &&
+                        completion(body, st, end) >= seq)
+                        continue;
+                    found = st;
+                }
+                if (found == NO_MATCH) {
+                    DEBUG_MSG("EarleyChart: no iteration ends at " << end);
+                    break;
+                }
+                kid.expr = expr->children[0];
+                kid.begin = found;
+                kid.end = end;
+                kid.bound = found == task.begin && end == task.end ? seq : NO_MATCH;
+                kids.push_back(kid);
+                end = found;
+            }
+            std::reverse(kids.begin(), kids.end());
+            break;
+        }
+        default:
+            break;
+    }
+    // Children are popped left to right, which keeps the steps in preorder
+    for (size_t i = kids.size(); i-- > 0; )
+        todo.push_back(kids[i]);
+}
+
+// Steps of an expression matched empty: no chart is needed. An optional
+// holds its body unless the body is already being derived here.
+void EarleyChart::deriveEmpty(const Expression* expr, size_t pos, size_t parent,
+                              std::vector<Step>& out, std::vector<const Expression*>& path) const {
+    Step step;
+    step.expr = expr;
+    step.begin = step.end = pos;
+    step.parent = parent;
+    size_t self = out.size();
+    out.push_back(step);
+
+    path.push_back(expr);
+    switch (expr->type) {
+        case Expression::EXPR_SEQUENCE:
+            for (size_t i = 0; i < expr->children.size(); ++i)
+                deriveEmpty(expr->children[i], pos, self, out, path);
+            break;
+        case Expression::EXPR_SYMBOL: {
+            const Rule* r = symbols[symbolAt(expr)].rule;
+            if (r && r->rootExpr) deriveEmpty(r->rootExpr, pos, self, out, path);
+            break;
+        }
+        case Expression::EXPR_OPTIONAL: {
+            const Expression* body = expr->children.empty() ? 0 : expr->children[0];
+            if (body && symbols[symbolAt(body)].nullable &&
+                std::find(path.begin(), path.end(), body) == path.end())
+                deriveEmpty(body, pos, self, out, path);
+            break;
+        }
+        default:
+            break;
+    }
+    path.pop_back();
+}
+
+void EarleyChart::derive(const Rule* start, size_t end, std::vector<Step>& out) const {
+    out.clear();
+    if (!start || !start->rootExpr || end == NO_MATCH) return;
+
+    std::vector<Task> todo;
+    std::vector<const Expression*> path;
+    Task root;
+    root.expr = start->rootExpr;
+    root.begin = 0;
+    root.end = end;
+    root.bound = NO_MATCH;
+    root.parent = NO_MATCH;
+    todo.push_back(root);
+    while (!todo.empty()) {
+        Task task = todo.back();
+        todo.pop_back();
+        if (task.begin == task.end) deriveEmpty(task.expr, task.begin, task.parent, out, path);
+        else expand(task, out, todo);
+    }
+}
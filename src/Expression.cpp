@@ -9,7 +9,7 @@ CharRange::CharRange(unsigned char s, unsigned char e)
 
 // Expression implementation
 Expression::Expression(Type t)
-    : type(t) {
+    : type(t), factorPrefix(0), rule(0), nullable(false), dispatch(0), keywords(0), run(0) {
     DEBUG_MSG("Expression created: type=" << t);
 }
 
@@ -20,3 +20,14 @@ Expression::~Expression() {
         delete children[i];
     children.clear();
 }
+
+// Literal text of a terminal, without surrounding quotes
+std::string Expression::terminalText() const {
+    const std::string& s = value;
+    if (s.size() >= 2 && ((s[0] == '\'' && s[s.size()-1] == '\'') ||
+                          (s[0] == '"'  && s[s.size()-1] == '"')))
+    {
+        return s.substr(1, s.size() - 2);
+    }
+    return s;
+}
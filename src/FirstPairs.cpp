@@ -0,0 +1,170 @@
+#include "../include/FirstPairs.hpp"
+#include "../include/Debug.hpp"
+#include <algorithm>
+
+FirstPairs::PairSet::PairSet() {
+    std::fill(rowOf, rowOf + 256, static_cast<unsigned short>(0));
+}
+
+void FirstPairs::PairSet::add(unsigned char first, const std::bitset<256>& seconds) {
+    if (seconds.none()) return;
+    if (!rowOf[first]) {
+        rows.push_back(std::bitset<256>());
+        rowOf[first] = static_cast<unsigned short>(rows.size());
+        used.set(first);
+    }
+    rows[rowOf[first] - 1] |= seconds;
+}
+
+void FirstPairs::PairSet::merge(const PairSet& other) {
+    for (unsigned c = 0; c < 256; ++c) {
+        if (other.rowOf[c]) add(static_cast<unsigned char>(c), other.rows[other.rowOf[c] - 1]);
+    }
+}
+
+bool FirstPairs::PairSet::operator==(const PairSet& other) const {
+    if (used != other.used) return false;
+    for (unsigned c = 0; c < 256; ++c) {
+        if (rowOf[c] && rows[rowOf[c] - 1] != other.rows[other.rowOf[c] - 1]) return false;
+    }
+    return true;
+}
+
+FirstPairs::Info::Info() : nullable(false) {}
+
+// Bytes that can start a non-empty match
+static std::bitset<256> leading(const FirstPairs::Info& info) {
+    return info.singles | info.pairs.firsts();
+}
+
+// FIRST_2 of `a` followed by `b`: words of `a` shorter than two bytes
+// are extended by the words of `b`
+static FirstPairs::Info concat(const FirstPairs::Info& a, const FirstPairs::Info& b) {
+    FirstPairs::Info r;
+    r.nullable = a.nullable && b.nullable;
+    if (a.nullable) {
+        r.singles |= b.singles;
+        r.pairs.merge(b.pairs);
+    }
+    if (b.nullable) r.singles |= a.singles;
+    r.pairs.merge(a.pairs);
+    std::bitset<256> next = leading(b);
+    if (next.any()) {
+        for (unsigned c = 0; c < 256; ++c) {
+            if (a.singles.test(c)) r.pairs.add(static_cast<unsigned char>(c), next);
+        }
+    }
+    return r;
+}
+
+static void unite(FirstPairs::Info& dst, const FirstPairs::Info& src) {
+    dst.nullable = dst.nullable || src.nullable;
+    dst.singles |= src.singles;
+    dst.pairs.merge(src.pairs);
+}
+
+static bool sameInfo(const FirstPairs::Info& a, const FirstPairs::Info& b) {
+    return a.nullable == b.nullable && a.singles == b.singles && a.pairs == b.pairs;
+}
+
+FirstPairs::FirstPairs(const Grammar& g)
+    : grammar(g), solved(false) {}
+
+// Iterate rule-level results until nothing changes; sets only grow
+void FirstPairs::solve() {
+    solved = true;
+    const std::vector<Rule*>& rules = grammar.getRules();
+    for (size_t i = 0; i < rules.size(); ++i)
+        ruleInfo[rules[i]] = Info();
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < rules.size(); ++i) {
+            Info next = compute(rules[i]->rootExpr);
+            Info& cur = ruleInfo[rules[i]];
+            if (!sameInfo(next, cur)) {
+                cur = next;
+                changed = true;
+            }
+        }
+    }
+    DEBUG_MSG("FirstPairs: solved " << rules.size() << " rules");
+}
+
+// FIRST_2 of one expression tree, reading symbols from the rule table
+FirstPairs::Info FirstPairs::compute(const Expression* expr) const {
+    Info fi;
+    if (!expr) return fi;
+
+    switch (expr->type) {
+        case Expression::EXPR_TERMINAL: {
+            std::string lit = expr->terminalText();
+            if (lit.size() == 1) {
+                fi.singles.set(static_cast<unsigned char>(lit[0]));
+            } else if (lit.size() > 1) {
+                std::bitset<256> second;
+                second.set(static_cast<unsigned char>(lit[1]));
+                fi.pairs.add(static_cast<unsigned char>(lit[0]), second);
+            }
+            break;
+        }
+        case Expression::EXPR_SYMBOL: {
+            Rule* rr = grammar.getRule(expr->value);
+            if (rr) {
+                std::map<const Rule*, Info>::const_iterator it = ruleInfo.find(rr);
+                if (it != ruleInfo.end()) fi = it->second;
+            }
+            break;
+        }
+        case Expression::EXPR_SEQUENCE: {
+            fi.nullable = true;
+            for (size_t i = 0; i < expr->children.size(); ++i) {
+                fi = concat(fi, compute(expr->children[i]));
+                // Once every word has two bytes, later elements add nothing
+                if (!fi.nullable && fi.singles.none()) break;
+            }
+            break;
+        }
+        case Expression::EXPR_ALTERNATIVE: {
+            for (size_t i = 0; i < expr->children.size(); ++i)
+                unite(fi, compute(expr->children[i]));
+            break;
+        }
+        case Expression::EXPR_OPTIONAL: {
+            fi.nullable = true;
+            if (!expr->children.empty()) unite(fi, compute(expr->children[0]));
+            break;
+        }
+        case Expression::EXPR_REPEAT: {
+            // Zero, one or two iterations cover every two-byte prefix
+            fi.nullable = true;
+            if (!expr->children.empty()) {
+                Info body = compute(expr->children[0]);
+                unite(fi, body);
+                unite(fi, concat(body, body));
+            }
+            break;
+        }
+        case Expression::EXPR_CHAR_RANGE: {
+            for (unsigned int c = expr->charRange.start; c <= expr->charRange.end; ++c)
+                fi.singles.set(c);
+            break;
+        }
+        case Expression::EXPR_CHAR_CLASS:
+            fi.singles = expr->charBitmap;
+            break;
+        default:
+            break;
+    }
+    return fi;
+}
+
+const FirstPairs::Info& FirstPairs::of(const Expression* expr) {
+    if (!expr) return empty;
+    std::map<const Expression*, Info>::iterator it = exprInfo.find(expr);
+    if (it != exprInfo.end()) return it->second;
+
+    if (!solved) solve();
+    return exprInfo.insert(std::make_pair(expr, compute(expr))).first->second;
+}
@@ -0,0 +1,187 @@
+#include "../include/FirstSets.hpp"
+#include "../include/Debug.hpp"
+
+FirstSets::Info::Info() : nullable(false) {}
+
+FirstSets::FirstSets(const Grammar& g)
+    : grammar(g), solved(false), cornersFound(false) {}
+
+// Iterate rule-level FIRST sets until nothing changes. Sets only grow, so
+// the loop reaches the least fixpoint in at most |rules| * 257 rounds.
+void FirstSets::solve() {
+    solved = true;
+    const std::vector<Rule*>& rules = grammar.getRules();
+    for (size_t i = 0; i < rules.size(); ++i)
+        ruleInfo[rules[i]] = Info();
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < rules.size(); ++i) {
+            Info next = compute(rules[i]->rootExpr);
+            Info& cur = ruleInfo[rules[i]];
+            if (next.chars != cur.chars || next.nullable != cur.nullable) {
+                cur = next;
+                changed = true;
+            }
+        }
+    }
+    DEBUG_MSG("FirstSets: solved " << rules.size() << " rules");
+}
+
+// FIRST of one expression tree, reading symbols from the rule table
+FirstSets::Info FirstSets::compute(const Expression* expr) const {
+    Info fi;
+    if (!expr) return fi;
+
+    switch (expr->type) {
+        case Expression::EXPR_TERMINAL: {
+            std::string lit = expr->terminalText();
+            if (!lit.empty()) fi.chars.set(static_cast<unsigned char>(lit[0]));
+            else fi.nullable = true;
+            break;
+        }
+        case Expression::EXPR_SYMBOL: {
+            Rule* rr = grammar.getRule(expr->value);
+            if (rr) {
+                std::map<const Rule*, Info>::const_iterator it = ruleInfo.find(rr);
+                if (it != ruleInfo.end()) fi = it->second;
+            }
+            break;
+        }
+        case Expression::EXPR_SEQUENCE: {
+            fi.nullable = true;
+            for (size_t i = 0; i < expr->children.size(); ++i) {
+                Info child = compute(expr->children[i]);
+                fi.chars |= child.chars;
+                if (!child.nullable) {
+                    fi.nullable = false;
+                    break;
+                }
+            }
+            break;
+        }
+        case Expression::EXPR_ALTERNATIVE: {
+            for (size_t i = 0; i < expr->children.size(); ++i) {
+                Info child = compute(expr->children[i]);
+                fi.chars |= child.chars;
+                fi.nullable = fi.nullable || child.nullable;
+            }
+            break;
+        }
+        case Expression::EXPR_OPTIONAL:
+        case Expression::EXPR_REPEAT: {
+            fi.nullable = true;
+            if (!expr->children.empty())
+                fi.chars = compute(expr->children[0]).chars;
+            break;
+        }
+        case Expression::EXPR_CHAR_RANGE: {
+            for (unsigned int c = expr->charRange.start; c <= expr->charRange.end; ++c)
+                fi.chars.set(c);
+            break;
+        }
+        case Expression::EXPR_CHAR_CLASS:
+            fi.chars = expr->charBitmap;
+            break;
+        default:
+            break;
+    }
+    return fi;
+}
+
+const FirstSets::Info& FirstSets::of(const Expression* expr) {
+    if (!expr) return empty;
+    std::map<const Expression*, Info>::iterator it = exprInfo.find(expr);
+    if (it != exprInfo.end()) return it->second;
+
+    if (!solved) solve();
+    return exprInfo.insert(std::make_pair(expr, compute(expr))).first->second;
+}
+
+const FirstSets::Info& FirstSets::ofRule(const Rule* rule) {
+    if (!solved) solve();
+    std::map<const Rule*, Info>::const_iterator it = ruleInfo.find(rule);
+    return it != ruleInfo.end() ? it->second : empty;
+}
+
+bool FirstSets::leftRecursive(const Rule* rule) {
+    if (!cornersFound) findLeftRecursion();
+    return leftRec.count(rule) != 0;
+}
+
+bool FirstSets::reachesFirst(const Expression* expr, const Rule* target) {
+    if (!cornersFound) findLeftRecursion();
+    std::set<const Rule*> seen;
+    std::vector<const Rule*> work;
+    leftCalls(expr, work);
+    while (!work.empty()) {
+        const Rule* r = work.back();
+        work.pop_back();
+        if (r == target) return true;
+        if (!seen.insert(r).second) continue;
+        const std::vector<const Rule*>& next = leftGraph[r];
+        work.insert(work.end(), next.begin(), next.end());
+    }
+    return false;
+}
+
+Expression* FirstSets::seedBody(const Rule* rule) {
+    const Expression* body = rule->rootExpr;
+    if (!body || body->type != Expression::EXPR_ALTERNATIVE) return 0;
+    Expression* alt = new Expression(Expression::EXPR_ALTERNATIVE);
+    for (size_t i = 0; i < body->children.size(); ++i) {
+        if (body->children[i] && reachesFirst(body->children[i], rule))
+            alt->children.push_back(body->children[i]);
+    }
+    if (alt->children.empty() || alt->children.size() == body->children.size()) {
+        alt->children.clear();
+        delete alt;
+        return 0;
+    }
+    return alt;
+}
+
+// Rules a match of `expr` can call at its start position
+void FirstSets::leftCalls(const Expression* expr, std::vector<const Rule*>& out) {
+    if (!expr) return;
+    switch (expr->type) {
+        case Expression::EXPR_SYMBOL: {
+            const Rule* rr = grammar.getRule(expr->value);
+            if (rr) out.push_back(rr);
+            break;
+        }
+        case Expression::EXPR_SEQUENCE:
+            // Elements after a nullable prefix also start at its position
+            for (size_t i = 0; i < expr->children.size(); ++i) {
+                leftCalls(expr->children[i], out);
+                if (!of(expr->children[i]).nullable) break;
+            }
+            break;
+        case Expression::EXPR_ALTERNATIVE:
+            for (size_t i = 0; i < expr->children.size(); ++i)
+                leftCalls(expr->children[i], out);
+            break;
+        case Expression::EXPR_OPTIONAL:
+        case Expression::EXPR_REPEAT:
+            if (!expr->children.empty()) leftCalls(expr->children[0], out);
+            break;
+        default:
+            break;
+    }
+}
+
+// A rule is left-recursive when it reaches itself in the graph of the
+// calls each rule can make before consuming input
+void FirstSets::findLeftRecursion() {
+    if (!solved) solve();
+    cornersFound = true;
+    const std::vector<Rule*>& rules = grammar.getRules();
+    for (size_t i = 0; i < rules.size(); ++i)
+        leftCalls(rules[i]->rootExpr, leftGraph[rules[i]]);
+
+    for (size_t i = 0; i < rules.size(); ++i) {
+        if (reachesFirst(rules[i]->rootExpr, rules[i])) leftRec.insert(rules[i]);
+    }
+    DEBUG_MSG("FirstSets: " << leftRec.size() << " left-recursive rules");
+}
@@ -1,4 +1,7 @@
 #include "../include/Grammar.hpp"
+#include "../include/CompiledGrammar.hpp"
+#include "../include/GrammarOptimizer.hpp"
+#include "../include/OperatorTable.hpp"
 #include "../include/Debug.hpp"
 #include <iostream>
 #include <sstream>
@@ -7,13 +10,16 @@
 // Constructor and destructor for Rule.
 // Rule owns the root expression node for the grammar rule.
 // The destructor frees the root expression to avoid leaks.
-Rule::Rule() : rootExpr(0) {}
+Rule::Rule() : rootExpr(0), operators(0), dfa(0), leftRecursive(false), seedBody(0) {}
 Rule::~Rule() { delete rootExpr; }
 
 // ---------------- Grammar ----------------
 // Grammar lifecycle: initialize debug flag and clean up allocated rules.
-Grammar::Grammar() : arena(0), interner(0) {}
+Grammar::Grammar() : arena(0), interner(0), optimizer(0), compiled(0) {}
 Grammar::~Grammar() {
+    delete compiled;
+    for (size_t i = 0; i < operatorTables.size(); ++i)
+        delete operatorTables[i];
     // When using arena, memory is owned by the arena; skip deletes entirely.
     if (arena) return;
     // When using interner without arena, avoid double-freeing shared nodes.
@@ -57,30 +63,101 @@ Expression* Grammar::internIfEnabled(Expression* expr) {
 void Grammar::addRule(const std::string& ruleText) {
     DEBUG_MSG("Adding rule: " + ruleText);
 
-    size_t pos = ruleText.find("::=");
-    if (pos == std::string::npos) {
-        std::cerr << "Invalid rule: " << ruleText << std::endl;
+    if (compiled) {
+        std::cerr << "Grammar is finalized, rule ignored: " << ruleText << std::endl;
         return;
     }
 
-    std::string lhs = ruleText.substr(0, pos);
-    std::string rhs = ruleText.substr(pos + 3);
-
-    // trim spaces
-    while (!lhs.empty() && lhs[0] == ' ') lhs.erase(0,1);
-    while (!lhs.empty() && lhs[lhs.size()-1] == ' ') lhs.erase(lhs.size()-1,1);
+    std::string lhs, rhs;
+    if (!splitRule(ruleText, lhs, rhs)) {
+        std::cerr << "Invalid rule: " << ruleText << std::endl;
+        return;
+    }
 
     Rule* r = createRule();
     r->name = lhs;
 
     BNFTokenizer tz(rhs);
     r->rootExpr = parseExpression(tz);
+    if (optimizer) optimizer->optimizeRule(*this, *r);
 
     DEBUG_MSG("Parsed rootExpr for rule: " + lhs);
     rules.push_back(r);
 }
 
 
+// addOperatorRule: store the rule as the chain
+// operand { 'op1' operand | 'op2' operand | ... }, one branch per operator
+// in declaration order, so that every engine can match it; the operand is
+// parsed once per use, since expression nodes have a single owner.
+void Grammar::addOperatorRule(const std::string& ruleText, const std::string& table) {
+    DEBUG_MSG("Adding operator rule: " + ruleText + " with " + table);
+
+    if (compiled) {
+        std::cerr << "Grammar is finalized, rule ignored: " << ruleText << std::endl;
+        return;
+    }
+
+    std::string lhs, rhs;
+    if (!splitRule(ruleText, lhs, rhs)) {
+        std::cerr << "Invalid rule: " << ruleText << std::endl;
+        return;
+    }
+    OperatorTable* ops = new OperatorTable();
+    if (!ops->parse(table)) {
+        std::cerr << "Invalid operator table for " << lhs << ": " << table << std::endl;
+        delete ops;
+        return;
+    }
+    operatorTables.push_back(ops);
+
+    const std::vector<OperatorTable::Operator>& list = ops->getOperators();
+    std::vector<Expression*> branches;
+    for (size_t i = 0; i < list.size(); ++i) {
+        Expression* op = createExpr(Expression::EXPR_TERMINAL);
+        op->value = list[i].literal;
+        BNFTokenizer tz(rhs);
+        Expression* seq = createExpr(Expression::EXPR_SEQUENCE);
+        seq->children.push_back(internIfEnabled(op));
+        seq->children.push_back(parseExpression(tz));
+        branches.push_back(internIfEnabled(seq));
+    }
+    Expression* body = branches[0];
+    if (branches.size() > 1) {
+        body = createExpr(Expression::EXPR_ALTERNATIVE);
+        body->children = branches;
+        body = internIfEnabled(body);
+    }
+    Expression* rep = createExpr(Expression::EXPR_REPEAT);
+    rep->children.push_back(body);
+
+    BNFTokenizer tz(rhs);
+    Expression* chain = createExpr(Expression::EXPR_SEQUENCE);
+    chain->children.push_back(parseExpression(tz));
+    chain->children.push_back(internIfEnabled(rep));
+
+    Rule* r = createRule();
+    r->name = lhs;
+    r->rootExpr = internIfEnabled(chain);
+    r->operators = ops;
+    rules.push_back(r);
+}
+
+// splitRule: trim the LHS of "LHS ::= RHS" and return the RHS text
+bool Grammar::splitRule(const std::string& ruleText, std::string& name, std::string& rhs) const {
+    size_t pos = ruleText.find("::=");
+    if (pos == std::string::npos) return false;
+
+    name = ruleText.substr(0, pos);
+    rhs = ruleText.substr(pos + 3);
+
+    // trim spaces
+    while (!name.empty() && name[0] == ' ') name.erase(0,1);
+    while (!name.empty() && name[name.size()-1] == ' ') name.erase(name.size()-1,1);
+    return true;
+}
+
+
 // getRule: perform a linear search through stored rules and return
 // a pointer to the rule matching the provided name, or nullptr if not found.
 Rule* Grammar::getRule(const std::string& name) const {
@@ -96,6 +173,16 @@ Rule* Grammar::getRule(const std::string& name) const {
 }
 
 
+// finalize: link the grammar once; later calls return the same object.
+const CompiledGrammar& Grammar::finalize() {
+    if (!compiled) {
+        if (optimizer) optimizer->optimizeGrammar(*this);
+        compiled = new CompiledGrammar(*this);
+    }
+    return *compiled;
+}
+
+
 // ---------------- Parsing functions ----------------
 
 // parseExpression: parse alternatives separated by '|' and build an
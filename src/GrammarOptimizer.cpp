@@ -0,0 +1,381 @@
+#include "../include/GrammarOptimizer.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/Debug.hpp"
+#include <bitset>
+#include <string>
+#include <vector>
+
+const size_t GrammarOptimizer::DEFAULT_INLINE_BUDGET;
+
+GrammarOptimizer::Stats::Stats() : rules(0) {
+    for (size_t i = 0; i < PASS_COUNT; ++i) rewrites[i] = 0;
+}
+
+GrammarOptimizer::GrammarOptimizer() : inlineBudget(DEFAULT_INLINE_BUDGET) {
+    setAllPasses(true);
+}
+
+void GrammarOptimizer::setPass(Pass pass, bool on) {
+    if (pass < PASS_COUNT) enabled[pass] = on;
+}
+
+bool GrammarOptimizer::isEnabled(Pass pass) const {
+    return pass < PASS_COUNT && enabled[pass];
+}
+
+void GrammarOptimizer::setAllPasses(bool on) {
+    for (size_t i = 0; i < PASS_COUNT; ++i) enabled[i] = on;
+}
+
+const char* GrammarOptimizer::passName(Pass pass) {
+    switch (pass) {
+    case PASS_FUSE_CHAR_CLASSES: return "fuse-char-classes";
+    case PASS_MERGE_LITERALS:    return "merge-literals";
+    case PASS_FACTOR_PREFIXES:   return "factor-prefixes";
+    case PASS_INLINE_RULES:      return "inline-rules";
+    default:                     return "unknown";
+    }
+}
+
+void GrammarOptimizer::setCaptureSymbols(const std::vector<std::string>& symbols) {
+    captures.clear();
+    captures.insert(symbols.begin(), symbols.end());
+}
+
+void GrammarOptimizer::optimizeRule(Grammar& g, Rule& rule) {
+    ++stats.rules;
+    if (rule.rootExpr) rewrite(g, rule.rootExpr);
+}
+
+// Nodes are shared when the grammar interns them and arena-owned nodes are
+// freed with the arena, so only a plain grammar's nodes may be deleted here.
+void GrammarOptimizer::release(Grammar& g, Expression* e) const {
+    if (!g.arena && !g.interner) delete e;
+}
+
+// Bottom-up: children are rewritten first so a fused inner alternative can
+// take part in the fusion of its parent. Every rewrite is done in place and
+// keeps the node's language, which keeps interned (shared) nodes valid.
+void GrammarOptimizer::rewrite(Grammar& g, Expression* e) {
+    for (size_t i = 0; i < e->children.size(); ++i) {
+        if (e->children[i]) rewrite(g, e->children[i]);
+    }
+
+    if (e->type == Expression::EXPR_ALTERNATIVE && enabled[PASS_FUSE_CHAR_CLASSES]) {
+        if (fuseCharClasses(g, e)) ++stats.rewrites[PASS_FUSE_CHAR_CLASSES];
+    }
+    if (e->type == Expression::EXPR_SEQUENCE && enabled[PASS_MERGE_LITERALS]) {
+        if (mergeLiterals(g, e)) ++stats.rewrites[PASS_MERGE_LITERALS];
+    }
+    if (e->type == Expression::EXPR_ALTERNATIVE && enabled[PASS_FACTOR_PREFIXES]) {
+        if (factorPrefixes(e)) ++stats.rewrites[PASS_FACTOR_PREFIXES];
+    }
+}
+
+// Bytes matched by a single-byte expression; false if it may match more
+static bool singleByteSet(const Expression* e, std::bitset<256>& bits) {
+    if (!e) return false;
+    switch (e->type) {
+    case Expression::EXPR_CHAR_RANGE:
+        for (unsigned c = e->charRange.start; c <= e->charRange.end; ++c)
+            bits.set(c);
+        return true;
+    case Expression::EXPR_CHAR_CLASS:
+        bits |= e->charBitmap;
+        return true;
+    case Expression::EXPR_TERMINAL: {
+        std::string text = e->terminalText();
+        if (text.size() != 1) return false;
+        bits.set(static_cast<unsigned char>(text[0]));
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+// Every single-byte branch matches exactly one byte, so under longest match
+// they are interchangeable with one class. Null branches never match and are
+// dropped when the whole alternative turns into a class. Otherwise only runs
+// of adjacent single-byte branches are fused, in place, so that the branch
+// order ordered choice depends on is kept.
+bool GrammarOptimizer::fuseCharClasses(Grammar& g, Expression* alt) {
+    std::bitset<256> bits;
+    bool whole = true;
+    bool hasRun = false;
+    bool prevFusable = false;
+    for (size_t i = 0; i < alt->children.size(); ++i) {
+        Expression* c = alt->children[i];
+        bool fusable = c && singleByteSet(c, bits);
+        if (c && !fusable) whole = false;
+        if (fusable && prevFusable) hasRun = true;
+        prevFusable = fusable;
+    }
+    if (bits.none() || (!whole && !hasRun)) return false;
+
+    if (whole) {
+        for (size_t i = 0; i < alt->children.size(); ++i) {
+            if (alt->children[i]) release(g, alt->children[i]);
+        }
+        alt->children.clear();
+        alt->type = Expression::EXPR_CHAR_CLASS;
+        alt->charBitmap = bits;
+        DEBUG_MSG("GrammarOptimizer: alternative fused into class of " << bits.count() << " bytes");
+        return true;
+    }
+
+    std::vector<Expression*>& ch = alt->children;
+    std::vector<Expression*> kept;
+    size_t i = 0;
+    while (i < ch.size()) {
+        std::bitset<256> run;
+        size_t j = i;
+        while (j < ch.size() && ch[j] && singleByteSet(ch[j], run)) ++j;
+        Expression* cls = j - i >= 2 ? g.createExpr(Expression::EXPR_CHAR_CLASS) : 0;
+        if (!cls) {
+            kept.push_back(ch[i]);
+            ++i;
+            continue;
+        }
+        cls->charBitmap = run;
+        for (size_t k = i; k < j; ++k) release(g, ch[k]);
+        kept.push_back(cls);
+        DEBUG_MSG("GrammarOptimizer: " << (j - i) << " adjacent branches fused into one class");
+        i = j;
+    }
+    ch.swap(kept);
+    return true;
+}
+
+// An empty terminal never matches, so it must stay in its sequence
+static bool mergeable(const Expression* e) {
+    return e && e->type == Expression::EXPR_TERMINAL && !e->terminalText().empty();
+}
+
+// Runs of adjacent terminals match the concatenation of their literals.
+// The merged value is quoted so terminalText() strips exactly one quote
+// pair, whatever quotes the literals themselves contain.
+bool GrammarOptimizer::mergeLiterals(Grammar& g, Expression* seq) {
+    std::vector<Expression*>& ch = seq->children;
+    bool allTerminals = !ch.empty();
+    bool hasRun = false;
+    for (size_t i = 0; i < ch.size(); ++i) {
+        bool term = mergeable(ch[i]);
+        if (!term) allTerminals = false;
+        if (term && i > 0 && mergeable(ch[i-1]))
+            hasRun = true;
+    }
+    if (!hasRun) return false;
+
+    if (allTerminals) {
+        std::string text;
+        for (size_t i = 0; i < ch.size(); ++i) {
+            text += ch[i]->terminalText();
+            release(g, ch[i]);
+        }
+        ch.clear();
+        seq->type = Expression::EXPR_TERMINAL;
+        seq->value = "'" + text + "'";
+        DEBUG_MSG("GrammarOptimizer: sequence merged into " << seq->value);
+        return true;
+    }
+
+    std::vector<Expression*> kept;
+    size_t i = 0;
+    while (i < ch.size()) {
+        size_t j = i;
+        while (j < ch.size() && mergeable(ch[j])) ++j;
+        if (j - i < 2) {
+            kept.push_back(ch[i]);
+            ++i;
+            continue;
+        }
+        Expression* lit = g.createExpr(Expression::EXPR_TERMINAL);
+        if (!lit) {
+            kept.insert(kept.end(), ch.begin() + i, ch.begin() + j);
+            i = j;
+            continue;
+        }
+        std::string text;
+        for (size_t k = i; k < j; ++k) text += ch[k]->terminalText();
+        lit->value = "'" + text + "'";
+        for (size_t k = i; k < j; ++k) release(g, ch[k]);
+        kept.push_back(lit);
+        i = j;
+    }
+    ch.swap(kept);
+    return true;
+}
+
+// Structural equality: both match the same input the same way
+static bool sameExpr(const Expression* a, const Expression* b) {
+    if (a == b) return true;
+    if (!a || !b || a->type != b->type || a->value != b->value) return false;
+    if (a->children.size() != b->children.size()) return false;
+    if (a->type == Expression::EXPR_CHAR_RANGE &&
+        (a->charRange.start != b->charRange.start || a->charRange.end != b->charRange.end))
+        return false;
+    if (a->type == Expression::EXPR_CHAR_CLASS && a->charBitmap != b->charBitmap)
+        return false;
+    if (a->factorPrefix != b->factorPrefix) return false;
+    for (size_t i = 0; i < a->children.size(); ++i) {
+        if (!sameExpr(a->children[i], b->children[i])) return false;
+    }
+    return true;
+}
+
+static const Expression* element(const Expression* branch, size_t j) {
+    if (branch->type == Expression::EXPR_SEQUENCE) return branch->children[j];
+    return branch;
+}
+
+static size_t elementCount(const Expression* branch) {
+    return branch->type == Expression::EXPR_SEQUENCE ? branch->children.size() : 1;
+}
+
+// The branches keep their shape; only the shared prefix length is recorded,
+// which leaves the AST of every parse as it was. The length is recomputed
+// on every run because inlining may lengthen or break a prefix.
+bool GrammarOptimizer::factorPrefixes(Expression* alt) {
+    size_t before = alt->factorPrefix;
+    size_t k = 0;
+    bool valid = !alt->children.empty();
+    for (size_t i = 0; i < alt->children.size() && valid; ++i)
+        valid = alt->children[i] != 0;
+    if (valid) {
+        const Expression* first = alt->children[0];
+        k = elementCount(first);
+        for (size_t i = 1; i < alt->children.size() && k > 0; ++i) {
+            const Expression* b = alt->children[i];
+            size_t n = elementCount(b);
+            if (n < k) k = n;
+            size_t j = 0;
+            while (j < k && sameExpr(element(first, j), element(b, j))) ++j;
+            k = j;
+        }
+    }
+    alt->factorPrefix = k;
+    if (k) DEBUG_MSG("GrammarOptimizer: alternative shares a prefix of " << k << " elements");
+    return k != 0 && k != before;
+}
+
+// ---------------- Rule inlining ----------------
+
+// Callees are inlined before their callers, so a caller copies bodies that
+// are already inlined and fused, and the budget applies to those bodies.
+void GrammarOptimizer::optimizeGrammar(Grammar& g) {
+    if (!enabled[PASS_INLINE_RULES]) return;
+
+    // insert() keeps the first definition, matching Grammar::getRule
+    RuleIndex index;
+    for (size_t i = 0; i < g.rules.size(); ++i)
+        index.insert(std::make_pair(g.rules[i]->name, g.rules[i]));
+
+    recursive.clear();
+    for (size_t i = 0; i < g.rules.size(); ++i) {
+        if (isRecursive(g.rules[i], index)) recursive.insert(g.rules[i]);
+    }
+
+    std::map<const Rule*, int> state;
+    for (size_t i = 0; i < g.rules.size(); ++i)
+        inlineRule(g, g.rules[i], index, state);
+    recursive.clear();
+}
+
+// Symbol names referenced anywhere below e
+static void collectCalls(const Expression* e, std::vector<const std::string*>& out) {
+    if (!e) return;
+    if (e->type == Expression::EXPR_SYMBOL) out.push_back(&e->value);
+    for (size_t i = 0; i < e->children.size(); ++i)
+        collectCalls(e->children[i], out);
+}
+
+static size_t countNodes(const Expression* e) {
+    if (!e) return 0;
+    size_t n = 1;
+    for (size_t i = 0; i < e->children.size(); ++i)
+        n += countNodes(e->children[i]);
+    return n;
+}
+
+// True if the rule can reach itself through symbol references
+bool GrammarOptimizer::isRecursive(const Rule* rule, const RuleIndex& index) const {
+    std::set<const Rule*> seen;
+    std::vector<const Rule*> work(1, rule);
+    while (!work.empty()) {
+        const Rule* r = work.back();
+        work.pop_back();
+        std::vector<const std::string*> calls;
+        collectCalls(r->rootExpr, calls);
+        for (size_t i = 0; i < calls.size(); ++i) {
+            RuleIndex::const_iterator it = index.find(*calls[i]);
+            if (it == index.end()) continue;
+            if (it->second == rule) return true;
+            if (seen.insert(it->second).second) work.push_back(it->second);
+        }
+    }
+    return false;
+}
+
+// Post-order over the rule graph: 1 = in progress, 2 = done
+void GrammarOptimizer::inlineRule(Grammar& g, Rule* rule, const RuleIndex& index,
+                                  std::map<const Rule*, int>& state) {
+    int& st = state[rule];
+    if (st != 0) return;
+    st = 1;
+
+    std::vector<const std::string*> calls;
+    collectCalls(rule->rootExpr, calls);
+    for (size_t i = 0; i < calls.size(); ++i) {
+        RuleIndex::const_iterator it = index.find(*calls[i]);
+        if (it != index.end()) inlineRule(g, it->second, index, state);
+    }
+
+    // The chain of an operator rule keeps the shape OperatorTable expects
+    if (rule->operators) {
+        state[rule] = 2;
+        return;
+    }
+    bool changed = false;
+    rule->rootExpr = inlineCalls(g, rule->rootExpr, index, changed);
+    // Inlined bodies may now fuse or merge with their new neighbours
+    if (changed) rewrite(g, rule->rootExpr);
+    state[rule] = 2;
+}
+
+Expression* GrammarOptimizer::inlineCalls(Grammar& g, Expression* e,
+                                          const RuleIndex& index, bool& changed) {
+    if (!e) return e;
+    if (e->type == Expression::EXPR_SYMBOL) {
+        RuleIndex::const_iterator it = index.find(e->value);
+        if (it == index.end() || !it->second->rootExpr) return e;
+        const Rule* callee = it->second;
+        // An operator rule's node is where its tree is built
+        if (recursive.count(callee) || captures.count(callee->name) || callee->operators) return e;
+        if (countNodes(callee->rootExpr) > inlineBudget) return e;
+
+        Expression* body = clone(g, callee->rootExpr);
+        if (!body) return e;
+        DEBUG_MSG("GrammarOptimizer: inlined " << callee->name);
+        release(g, e);
+        ++stats.rewrites[PASS_INLINE_RULES];
+        changed = true;
+        return body;
+    }
+    for (size_t i = 0; i < e->children.size(); ++i)
+        e->children[i] = inlineCalls(g, e->children[i], index, changed);
+    return e;
+}
+
+Expression* GrammarOptimizer::clone(Grammar& g, const Expression* e) const {
+    if (!e) return 0;
+    Expression* c = g.createExpr(e->type);
+    if (!c) return 0;
+    c->value = e->value;
+    c->charRange = e->charRange;
+    c->charBitmap = e->charBitmap;
+    c->children.reserve(e->children.size());
+    for (size_t i = 0; i < e->children.size(); ++i)
+        c->children.push_back(clone(g, e->children[i]));
+    return c;
+}
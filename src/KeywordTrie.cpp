@@ -0,0 +1,102 @@
+#include "../include/KeywordTrie.hpp"
+#include "../include/Expression.hpp"
+#include <algorithm>
+
+const size_t KeywordTrie::MIN_KEYWORDS;
+const size_t KeywordTrie::NO_BRANCH;
+
+KeywordTrie::KeywordTrie() : building(1), branches(1, NO_BRANCH), count(0) {}
+
+bool KeywordTrie::fromAlternative(const Expression* alt, KeywordTrie& trie) {
+    if (alt->type != Expression::EXPR_ALTERNATIVE || alt->children.size() < MIN_KEYWORDS)
+        return false;
+    for (size_t i = 0; i < alt->children.size(); ++i) {
+        const Expression* b = alt->children[i];
+        if (b && b->type != Expression::EXPR_TERMINAL) return false;
+    }
+    for (size_t i = 0; i < alt->children.size(); ++i) {
+        if (alt->children[i]) trie.addKeyword(alt->children[i]->terminalText(), i);
+    }
+    trie.finish();
+    return true;
+}
+
+void KeywordTrie::addKeyword(const std::string& literal, size_t branch) {
+    if (literal.empty()) return;
+    unsigned node = 0;
+    for (size_t i = 0; i < literal.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(literal[i]);
+        std::vector<Edge>& out = building[node];
+        unsigned next = 0;
+        for (size_t e = 0; e < out.size() && !next; ++e)
+            if (out[e].byte == c) next = out[e].target;
+        if (!next) {
+            next = static_cast<unsigned>(branches.size());
+            Edge edge;
+            edge.byte = c;
+            edge.target = next;
+            out.push_back(edge);
+            building.push_back(std::vector<Edge>());
+            branches.push_back(NO_BRANCH);
+        }
+        node = next;
+    }
+    // Keep the first branch of a duplicated keyword
+    if (branches[node] == NO_BRANCH) {
+        branches[node] = branch;
+        ++count;
+    }
+}
+
+void KeywordTrie::finish() {
+    root.assign(256, 0);
+    for (size_t e = 0; e < building[0].size(); ++e)
+        root[building[0][e].byte] = building[0][e].target;
+
+    edgeBegin.assign(building.size() + 1, 0);
+    edges.clear();
+    for (size_t n = 0; n < building.size(); ++n) {
+        edgeBegin[n] = static_cast<unsigned>(edges.size());
+        if (n == 0) continue;
+        std::sort(building[n].begin(), building[n].end());
+        edges.insert(edges.end(), building[n].begin(), building[n].end());
+    }
+    edgeBegin[building.size()] = static_cast<unsigned>(edges.size());
+    std::vector<std::vector<Edge> >().swap(building);
+}
+
+size_t KeywordTrie::longest(const char* data, size_t size, size_t& branch) const {
+    return walk(data, size, false, branch);
+}
+
+size_t KeywordTrie::first(const char* data, size_t size, size_t& branch) const {
+    return walk(data, size, true, branch);
+}
+
+// Visit every keyword that is a prefix of the input; keep the last one,
+// or the one with the lowest branch
+size_t KeywordTrie::walk(const char* data, size_t size, bool lowest, size_t& branch) const {
+    branch = NO_BRANCH;
+    if (size == 0) return 0;
+    size_t best = 0;
+    unsigned node = root[static_cast<unsigned char>(data[0])];
+    for (size_t i = 1; node; ++i) {
+        size_t b = branches[node];
+        if (b != NO_BRANCH && (!lowest || b < branch)) {
+            branch = b;
+            best = i;
+        }
+        if (i == size) break;
+        unsigned char c = static_cast<unsigned char>(data[i]);
+        // Fan-out below the root is small: a linear scan of sorted edges
+        unsigned next = 0;
+        for (unsigned e = edgeBegin[node]; e < edgeBegin[node + 1]; ++e) {
+            if (edges[e].byte >= c) {
+                if (edges[e].byte == c) next = edges[e].target;
+                break;
+            }
+        }
+        node = next;
+    }
+    return best;
+}
@@ -0,0 +1,224 @@
+#include "../include/LL1Analysis.hpp"
+#include "../include/Debug.hpp"
+#include <algorithm>
+
+const unsigned short LL1Analysis::NONE;
+
+LL1Analysis::LL1Analysis(const Grammar& g)
+    : grammar(g), first(g), changed(false)
+{
+    const std::vector<Rule*>& rules = grammar.getRules();
+
+    // FOLLOW sets only grow, so repeating the walk reaches the fixpoint
+    do {
+        changed = false;
+        for (size_t i = 0; i < rules.size(); ++i)
+            walk(rules[i], rules[i]->rootExpr, ruleFollow[rules[i]]);
+    } while (changed);
+
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (points[i].first->type == Expression::EXPR_ALTERNATIVE)
+            classifyAlternative(points[i].second, points[i].first);
+        else
+            classifyBody(points[i].second, points[i].first);
+    }
+    DEBUG_MSG("LL1Analysis: " << decisions.size() << " of " << points.size()
+              << " decision points deterministic");
+}
+
+// Propagate `follow` into `expr`: record it for decision points and add it
+// to the FOLLOW set of referenced rules
+void LL1Analysis::walk(const Rule* rule, const Expression* expr, const std::bitset<256>& follow) {
+    if (!expr) return;
+    switch (expr->type) {
+        case Expression::EXPR_ALTERNATIVE:
+        case Expression::EXPR_OPTIONAL:
+        case Expression::EXPR_REPEAT: {
+            std::map<const Expression*, std::bitset<256> >::iterator it = exprFollow.find(expr);
+            if (it == exprFollow.end()) {
+                exprFollow.insert(std::make_pair(expr, follow));
+                points.push_back(std::make_pair(expr, rule));
+            } else {
+                it->second |= follow;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    switch (expr->type) {
+        case Expression::EXPR_SYMBOL: {
+            Rule* target = grammar.getRule(expr->value);
+            if (!target) break;
+            std::bitset<256>& rf = ruleFollow[target];
+            if ((rf | follow) != rf) {
+                rf |= follow;
+                changed = true;
+            }
+            break;
+        }
+        case Expression::EXPR_SEQUENCE: {
+            std::bitset<256> after = follow;
+            for (size_t i = expr->children.size(); i-- > 0; ) {
+                walk(rule, expr->children[i], after);
+                const FirstSets::Info& fi = first.of(expr->children[i]);
+                after = fi.nullable ? (after | fi.chars) : fi.chars;
+            }
+            break;
+        }
+        case Expression::EXPR_ALTERNATIVE:
+        case Expression::EXPR_OPTIONAL:
+            for (size_t i = 0; i < expr->children.size(); ++i)
+                walk(rule, expr->children[i], follow);
+            break;
+        case Expression::EXPR_REPEAT:
+            // Another iteration may follow each iteration
+            if (!expr->children.empty())
+                walk(rule, expr->children[0], follow | first.of(expr->children[0]).chars);
+            break;
+        default:
+            break;
+    }
+}
+
+void LL1Analysis::classifyAlternative(const Rule* rule, const Expression* expr) {
+    if (expr->children.size() >= NONE) return;
+
+    // Null branches never match and take part in no decision
+    std::bitset<256> seen, clash;
+    size_t empty = NONE;
+    bool ambiguous = false;
+    for (size_t i = 0; i < expr->children.size(); ++i) {
+        if (!expr->children[i]) continue;
+        const FirstSets::Info& fi = first.of(expr->children[i]);
+        clash |= seen & fi.chars;
+        seen |= fi.chars;
+        if (fi.nullable) {
+            if (empty != NONE) ambiguous = true;
+            else empty = i;
+        }
+    }
+
+    bool ok = true;
+    if (clash.any()) {
+        addConflict(rule, expr, CONFLICT_FIRST_FIRST, clash);
+        ok = false;
+    }
+    if (ambiguous) {
+        addConflict(rule, expr, CONFLICT_NULLABLE, std::bitset<256>());
+        ok = false;
+    }
+    if (empty != NONE && !ambiguous) {
+        // The empty choice competes with every other branch on FOLLOW
+        std::bitset<256> others;
+        for (size_t i = 0; i < expr->children.size(); ++i) {
+            if (i != empty && expr->children[i]) others |= first.of(expr->children[i]).chars;
+        }
+        std::bitset<256> overlap = others & exprFollow[expr];
+        if (overlap.any()) {
+            addConflict(rule, expr, CONFLICT_FIRST_FOLLOW, overlap);
+            ok = false;
+        }
+    }
+    if (!ok) return;
+
+    Decision& d = decisions[expr];
+    std::fill(d.next, d.next + 257, static_cast<unsigned short>(empty));
+    for (size_t i = 0; i < expr->children.size(); ++i) {
+        if (!expr->children[i]) continue;
+        const std::bitset<256>& chars = first.of(expr->children[i]).chars;
+        for (unsigned c = 0; c < 256; ++c) {
+            if (chars.test(c)) d.next[c] = static_cast<unsigned short>(i);
+        }
+    }
+}
+
+void LL1Analysis::classifyBody(const Rule* rule, const Expression* expr) {
+    if (expr->children.empty() || !expr->children[0]) return;
+    const FirstSets::Info& fi = first.of(expr->children[0]);
+    if (fi.nullable) {
+        addConflict(rule, expr, CONFLICT_NULLABLE, std::bitset<256>());
+        return;
+    }
+    std::bitset<256> overlap = fi.chars & exprFollow[expr];
+    if (overlap.any()) {
+        addConflict(rule, expr, CONFLICT_FIRST_FOLLOW, overlap);
+        return;
+    }
+
+    Decision& d = decisions[expr];
+    for (unsigned c = 0; c < 256; ++c)
+        d.next[c] = fi.chars.test(c) ? 0 : NONE;
+    d.next[256] = NONE;
+}
+
+void LL1Analysis::addConflict(const Rule* rule, const Expression* expr, ConflictKind kind,
+                              const std::bitset<256>& bytes) {
+    Conflict c;
+    c.rule = rule;
+    c.expr = expr;
+    c.kind = kind;
+    c.bytes = bytes;
+    conflicts.push_back(c);
+}
+
+const LL1Analysis::Decision* LL1Analysis::decision(const Expression* expr) const {
+    std::map<const Expression*, Decision>::const_iterator it = decisions.find(expr);
+    return it != decisions.end() ? &it->second : 0;
+}
+
+const std::bitset<256>& LL1Analysis::follow(const Rule* rule) const {
+    std::map<const Rule*, std::bitset<256> >::const_iterator it = ruleFollow.find(rule);
+    return it != ruleFollow.end() ? it->second : none;
+}
+
+static void writeByte(std::ostream& out, unsigned b) {
+    const char* hex = "0123456789ABCDEF";
+    if (b > 0x20 && b < 0x7F && b != '\'') out << '\'' << static_cast<char>(b) << '\'';
+    else out << "0x" << hex[b >> 4] << hex[b & 15];
+}
+
+// Bytes in grammar notation, runs of three or more as ranges
+static void writeBytes(std::ostream& out, const std::bitset<256>& bytes) {
+    const char* sep = "";
+    for (unsigned c = 0; c < 256; ++c) {
+        if (!bytes.test(c)) continue;
+        unsigned end = c;
+        while (end < 255 && bytes.test(end + 1)) ++end;
+        out << sep;
+        sep = " ";
+        writeByte(out, c);
+        if (end > c) {
+            out << (end > c + 1 ? " ... " : " ");
+            writeByte(out, end);
+        }
+        c = end;
+    }
+}
+
+void LL1Analysis::report(std::ostream& out) const {
+    out << "LL(1): " << decisions.size() << " of " << points.size()
+        << " decision points deterministic" << std::endl;
+    for (size_t i = 0; i < conflicts.size(); ++i) {
+        const Conflict& c = conflicts[i];
+        const char* what = c.expr->type == Expression::EXPR_ALTERNATIVE ? "alternative"
+                         : c.expr->type == Expression::EXPR_OPTIONAL ? "optional" : "repetition";
+        out << "  " << c.rule->name << ": " << what << ": ";
+        switch (c.kind) {
+            case CONFLICT_FIRST_FIRST:
+                out << "FIRST/FIRST conflict on ";
+                writeBytes(out, c.bytes);
+                break;
+            case CONFLICT_FIRST_FOLLOW:
+                out << "FIRST/FOLLOW conflict on ";
+                writeBytes(out, c.bytes);
+                break;
+            case CONFLICT_NULLABLE:
+                out << (c.expr->type == Expression::EXPR_ALTERNATIVE
+                        ? "several nullable branches" : "nullable body");
+                break;
+        }
+        out << std::endl;
+    }
+}
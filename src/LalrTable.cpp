@@ -0,0 +1,559 @@
+#include "LalrTable.hpp"
+#include <algorithm>
+#include "Debug.hpp"
+
+const unsigned LalrTable::NONE;
+
+namespace {
+
+// First element of the structural key of each kind of helper nonterminal
+enum KeyKind { KEY_LITERAL, KEY_RANGE, KEY_CLASS, KEY_SEQUENCE, KEY_ALTERNATIVE,
+               KEY_OPTIONAL, KEY_REPEAT };
+
+// Stands for the nonterminal being defined in a right-hand side
+const size_t SELF = static_cast<size_t>(-1);
+
+// Marks an item of no state, a symbol with no transition
+const size_t NO_ITEM = static_cast<size_t>(-1);
+
+unsigned pack(LalrTable::ActionKind kind, size_t target) {
+    return static_cast<unsigned>(target << 2) | kind;
+}
+
+}
+
+LalrTable::LalrTable(const Grammar& g)
+    : grammar(g), classCount(0), terms(0), nonterminals(0), current(0)
+{
+    splitClasses();
+    terms = classCount + 1;
+
+    // Nonterminal 0 has no production: null and undefined references
+    addNonterminal();
+    const std::vector<Rule*>& rules = grammar.getRules();
+    std::vector<const Rule*> unique;
+    for (size_t i = 0; i < rules.size(); ++i) {
+        if (ruleSymbol.find(rules[i]) != ruleSymbol.end()) continue;
+        current = rules[i];
+        ruleSymbol[rules[i]] = addNonterminal();
+        unique.push_back(rules[i]);
+    }
+    std::vector<size_t> roots;
+    for (size_t i = 0; i < unique.size(); ++i) {
+        current = unique[i];
+        size_t root = symbolOf(unique[i]->rootExpr);
+        roots.push_back(root);
+        if (unique[i]->rootExpr)
+            addProduction(ruleSymbol[unique[i]], std::vector<size_t>(1, terms + root),
+                          BUILD_RULE, 0, unique[i]);
+    }
+    // One start production per rule, over its body: parse() returns the
+    // body's node, not a node named after the rule
+    std::vector<size_t> startProds;
+    for (size_t i = 0; i < unique.size(); ++i) {
+        startProds.push_back(prods.size());
+        if (!unique[i]->rootExpr) continue;
+        current = unique[i];
+        addProduction(addNonterminal(), std::vector<size_t>(1, terms + roots[i]),
+                      BUILD_ACCEPT, unique[i]->rootExpr, unique[i]);
+    }
+    current = 0;
+    solve();
+
+    std::map<std::vector<size_t>, unsigned> ids;
+    for (size_t i = 0; i < unique.size(); ++i) {
+        if (!unique[i]->rootExpr) continue;
+        starts[unique[i]] = addState(std::vector<size_t>(1, prods[startProds[i]].slot), ids);
+    }
+    buildStates();
+    propagate();
+    fillTables();
+    DEBUG_MSG("LalrTable: " << classCount << " byte classes, " << nonterminals << " nonterminals, "
+              << prods.size() << " productions, " << states.size() << " states, "
+              << conflicts.size() << " conflicts");
+}
+
+unsigned LalrTable::startState(const Rule* rule) const {
+    std::map<const Rule*, unsigned>::const_iterator it = starts.find(rule);
+    return it != starts.end() ? it->second : NONE;
+}
+
+// ---------------- Translation ----------------
+
+void LalrTable::collectSets(const Expression* expr, std::vector<std::bitset<256> >& sets) const {
+    if (!expr) return;
+    switch (expr->type) {
+        case Expression::EXPR_TERMINAL: {
+            std::string text = expr->terminalText();
+            for (size_t i = 0; i < text.size(); ++i) {
+                std::bitset<256> one;
+                one.set(static_cast<unsigned char>(text[i]));
+                sets.push_back(one);
+            }
+            break;
+        }
+        case Expression::EXPR_CHAR_RANGE: {
+            std::bitset<256> range;
+            for (unsigned c = expr->charRange.start; c <= expr->charRange.end; ++c)
+                range.set(c);
+            sets.push_back(range);
+            break;
+        }
+        case Expression::EXPR_CHAR_CLASS:
+            sets.push_back(expr->charBitmap);
+            break;
+        default:
+            for (size_t i = 0; i < expr->children.size(); ++i)
+                collectSets(expr->children[i], sets);
+            break;
+    }
+}
+
+// Byte classes: bytes that no literal or character set tells apart
+void LalrTable::splitClasses() {
+    std::vector<std::bitset<256> > sets;
+    const std::vector<Rule*>& rules = grammar.getRules();
+    for (size_t i = 0; i < rules.size(); ++i)
+        collectSets(rules[i]->rootExpr, sets);
+
+    std::vector<unsigned> cls(256, 0);
+    unsigned classes = 1;
+    for (size_t s = 0; s < sets.size(); ++s) {
+        std::map<std::pair<unsigned, bool>, unsigned> split;
+        for (unsigned c = 0; c < 256; ++c) {
+            std::pair<unsigned, bool> key(cls[c], sets[s].test(c));
+            std::map<std::pair<unsigned, bool>, unsigned>::iterator it = split.find(key);
+            if (it == split.end())
+                it = split.insert(std::make_pair(key, static_cast<unsigned>(split.size()))).first;
+            cls[c] = it->second;
+        }
+        classes = static_cast<unsigned>(split.size());
+    }
+    classCount = classes;
+    classBytes.assign(classes, std::bitset<256>());
+    for (unsigned c = 0; c < 256; ++c) {
+        classOf[c] = static_cast<unsigned char>(cls[c]);
+        classBytes[cls[c]].set(c);
+    }
+}
+
+size_t LalrTable::addNonterminal() {
+    firstProd.push_back(0);
+    prodCount.push_back(0);
+    owner.push_back(current);
+    return nonterminals++;
+}
+
+// Helper nonterminal for a structural key, created with its productions
+// the first time; SELF in a body stands for the nonterminal itself
+size_t LalrTable::sharedSymbol(const std::vector<size_t>& key, Build build, const Expression* expr,
+                               const std::vector<std::vector<size_t> >& bodies) {
+    std::map<std::vector<size_t>, size_t>::const_iterator it = shared.find(key);
+    if (it != shared.end()) return it->second;
+    size_t sym = addNonterminal();
+    shared[key] = sym;
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        std::vector<size_t> right = bodies[i];
+        for (size_t k = 0; k < right.size(); ++k)
+            if (right[k] == SELF) right[k] = terms + sym;
+        addProduction(sym, right, build, expr, 0);
+    }
+    return sym;
+}
+
+// Nonterminal of one expression; its children are translated first, so
+// the productions of each nonterminal are adjacent
+size_t LalrTable::symbolOf(const Expression* expr) {
+    if (!expr) return 0;
+    std::map<const Expression*, size_t>::const_iterator it = exprSymbol.find(expr);
+    if (it != exprSymbol.end()) return it->second;
+
+    size_t sym = 0;
+    std::vector<size_t> key;
+    std::vector<std::vector<size_t> > bodies;
+    switch (expr->type) {
+        case Expression::EXPR_SYMBOL: {
+            const Rule* r = grammar.getRule(expr->value);
+            if (r) sym = ruleSymbol[r];
+            else DEBUG_MSG("LalrTable: unknown symbol " << expr->value);
+            break;
+        }
+        case Expression::EXPR_TERMINAL: {
+            // An empty literal never matches: no production
+            std::string text = expr->terminalText();
+            key.push_back(KEY_LITERAL);
+            std::vector<size_t> bytes;
+            for (size_t i = 0; i < text.size(); ++i) {
+                key.push_back(static_cast<unsigned char>(text[i]));
+                bytes.push_back(classOf[static_cast<unsigned char>(text[i])]);
+            }
+            if (!bytes.empty()) bodies.push_back(bytes);
+            sym = sharedSymbol(key, BUILD_LEAF, expr, bodies);
+            break;
+        }
+        case Expression::EXPR_CHAR_RANGE:
+        case Expression::EXPR_CHAR_CLASS: {
+            std::bitset<256> bytes;
+            if (expr->type == Expression::EXPR_CHAR_CLASS) {
+                bytes = expr->charBitmap;
+            } else {
+                for (unsigned c = expr->charRange.start; c <= expr->charRange.end; ++c)
+                    bytes.set(c);
+            }
+            key.push_back(expr->type == Expression::EXPR_CHAR_RANGE ? KEY_RANGE : KEY_CLASS);
+            for (unsigned k = 0; k < classCount; ++k) {
+                if ((classBytes[k] & bytes).none()) continue;
+                key.push_back(k);
+                bodies.push_back(std::vector<size_t>(1, k));
+            }
+            sym = sharedSymbol(key, BUILD_LEAF, expr, bodies);
+            break;
+        }
+        case Expression::EXPR_SEQUENCE:
+        case Expression::EXPR_ALTERNATIVE: {
+            bool sequence = expr->type == Expression::EXPR_SEQUENCE;
+            key.push_back(sequence ? KEY_SEQUENCE : KEY_ALTERNATIVE);
+            for (size_t i = 0; i < expr->children.size(); ++i)
+                key.push_back(terms + symbolOf(expr->children[i]));
+            if (sequence) {
+                bodies.push_back(std::vector<size_t>(key.begin() + 1, key.end()));
+            } else {
+                // One production per branch, in branch order
+                for (size_t i = 1; i < key.size(); ++i)
+                    bodies.push_back(std::vector<size_t>(1, key[i]));
+            }
+            sym = sharedSymbol(key, sequence ? BUILD_SEQUENCE : BUILD_ALTERNATIVE, expr, bodies);
+            break;
+        }
+        case Expression::EXPR_OPTIONAL:
+        case Expression::EXPR_REPEAT: {
+            bool repeat = expr->type == Expression::EXPR_REPEAT;
+            size_t body = terms + symbolOf(expr->children.empty() ? 0 : expr->children[0]);
+            key.push_back(repeat ? KEY_REPEAT : KEY_OPTIONAL);
+            key.push_back(body);
+            // X ::= X body | ε keeps repetitions left-recursive: the stack
+            // stays flat however many iterations there are
+            std::vector<size_t> right;
+            if (repeat) right.push_back(SELF);
+            right.push_back(body);
+            bodies.push_back(right);
+            bodies.push_back(std::vector<size_t>());
+            sym = sharedSymbol(key, repeat ? BUILD_REPEAT : BUILD_OPTIONAL, expr, bodies);
+            break;
+        }
+        default:
+            break;
+    }
+    exprSymbol[expr] = sym;
+    return sym;
+}
+
+void LalrTable::addProduction(size_t lhs, const std::vector<size_t>& right, Build build,
+                              const Expression* expr, const Rule* rule) {
+    if (prodCount[lhs] == 0) firstProd[lhs] = prods.size();
+    prodCount[lhs]++;
+
+    Production p;
+    p.lhs = lhs;
+    p.rhsBegin = rhs.size();
+    p.size = right.size();
+    p.slot = itemNext.size();
+    p.build = build;
+    p.expr = expr;
+    p.rule = rule;
+    prods.push_back(p);
+    rhs.insert(rhs.end(), right.begin(), right.end());
+    for (size_t dot = 0; dot <= right.size(); ++dot) {
+        itemNext.push_back(dot < right.size() ? right[dot] : NONE);
+        itemProd.push_back(prods.size() - 1);
+    }
+}
+
+// Nullable and FIRST terminals of every nonterminal, as a least fixpoint
+void LalrTable::solve() {
+    nullable.assign(nonterminals, false);
+    first.assign(nonterminals, Lookahead());
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < prods.size(); ++i) {
+            const Production& p = prods[i];
+            bool empty = true;
+            Lookahead f;
+            for (size_t k = 0; k < p.size && empty; ++k) {
+                size_t sym = rhs[p.rhsBegin + k];
+                if (sym < terms) {
+                    f.set(sym);
+                    empty = false;
+                } else {
+                    f |= first[sym - terms];
+                    empty = nullable[sym - terms];
+                }
+            }
+            if ((empty && !nullable[p.lhs]) || (first[p.lhs] | f) != first[p.lhs]) {
+                nullable[p.lhs] = nullable[p.lhs] || empty;
+                first[p.lhs] |= f;
+                changed = true;
+            }
+        }
+    }
+}
+
+// ---------------- LR(0) states ----------------
+
+unsigned LalrTable::addState(const std::vector<size_t>& kernel,
+                             std::map<std::vector<size_t>, unsigned>& ids) {
+    std::map<std::vector<size_t>, unsigned>::const_iterator it = ids.find(kernel);
+    if (it != ids.end()) return it->second;
+    unsigned id = static_cast<unsigned>(states.size());
+    ids[kernel] = id;
+    State s;
+    s.items = kernel;
+    s.kernel = kernel.size();
+    s.firstItem = 0;
+    states.push_back(s);
+    return id;
+}
+
+// Closes each state and adds its successors until no new kernel appears
+void LalrTable::buildStates() {
+    std::map<std::vector<size_t>, unsigned> ids;
+    for (size_t s = 0; s < states.size(); ++s) ids[states[s].items] = static_cast<unsigned>(s);
+
+    std::vector<size_t> stamp(nonterminals, NO_ITEM);
+    for (size_t s = 0; s < states.size(); ++s) {
+        std::vector<size_t> items = states[s].items;
+        for (size_t i = 0; i < items.size(); ++i) {
+            size_t next = itemNext[items[i]];
+            if (next == NONE || next < terms || stamp[next - terms] == s) continue;
+            size_t n = next - terms;
+            stamp[n] = s;
+            for (size_t p = firstProd[n]; p < firstProd[n] + prodCount[n]; ++p)
+                items.push_back(prods[p].slot);
+        }
+
+        // Successor kernels, one per symbol after a dot
+        std::map<size_t, std::vector<size_t> > moves;
+        for (size_t i = 0; i < items.size(); ++i) {
+            size_t next = itemNext[items[i]];
+            if (next != NONE) moves[next].push_back(items[i] + 1);
+        }
+        std::vector<std::pair<size_t, unsigned> > edges;
+        for (std::map<size_t, std::vector<size_t> >::iterator it = moves.begin(); it != moves.end(); ++it) {
+            std::sort(it->second.begin(), it->second.end());
+            edges.push_back(std::make_pair(it->first, addState(it->second, ids)));
+        }
+        states[s].items.swap(items);
+        states[s].edges.swap(edges);
+    }
+
+    size_t total = 0;
+    for (size_t s = 0; s < states.size(); ++s) {
+        states[s].firstItem = total;
+        total += states[s].items.size();
+    }
+}
+
+// ---------------- LALR(1) lookaheads ----------------
+
+// Lookaheads flow along two kinds of edges: from an item to the same item
+// with the dot advanced in the successor state, and from an item A ::= α.Bβ
+// to the items B ::= .γ of its state when β is nullable. FIRST(β) seeds
+// those closure items directly; the start items are seeded with the end of
+// input. The least fixpoint is the LALR(1) lookahead of every item.
+void LalrTable::propagate() {
+    size_t total = states.empty() ? 0 : states.back().firstItem + states.back().items.size();
+    lookahead.assign(total, Lookahead());
+
+    // FIRST and nullability of what follows the symbol after each dot
+    std::vector<Lookahead> afterFirst(itemNext.size());
+    std::vector<bool> afterNullable(itemNext.size(), true);
+    for (size_t p = 0; p < prods.size(); ++p) {
+        Lookahead f;
+        bool empty = true;
+        for (size_t k = prods[p].size; k-- > 0; ) {
+            size_t item = prods[p].slot + k;
+            afterFirst[item] = f;
+            afterNullable[item] = empty;
+            size_t sym = rhs[prods[p].rhsBegin + k];
+            if (sym < terms) {
+                f.reset();
+                f.set(sym);
+                empty = false;
+            } else {
+                if (!nullable[sym - terms]) {
+                    f.reset();
+                    empty = false;
+                }
+                f |= first[sym - terms];
+            }
+        }
+    }
+
+    for (std::map<const Rule*, unsigned>::const_iterator it = starts.begin(); it != starts.end(); ++it)
+        lookahead[states[it->second].firstItem].set(endTerminal());
+
+    std::vector<std::vector<size_t> > flow(total);
+    std::vector<size_t> where(itemNext.size(), NO_ITEM);
+    std::vector<size_t> succ(terms + nonterminals, NO_ITEM);
+    for (size_t s = 0; s < states.size(); ++s) {
+        const State& st = states[s];
+        for (size_t i = 0; i < st.items.size(); ++i) where[st.items[i]] = i;
+        for (size_t e = 0; e < st.edges.size(); ++e) succ[st.edges[e].first] = st.edges[e].second;
+
+        for (size_t i = 0; i < st.items.size(); ++i) {
+            size_t item = st.items[i];
+            size_t next = itemNext[item];
+            if (next == NONE) continue;
+            const State& to = states[succ[next]];
+            size_t k = std::lower_bound(to.items.begin(), to.items.begin() + to.kernel, item + 1)
+                     - to.items.begin();
+            flow[st.firstItem + i].push_back(to.firstItem + k);
+            if (next < terms) continue;
+            size_t n = next - terms;
+            for (size_t p = firstProd[n]; p < firstProd[n] + prodCount[n]; ++p) {
+                size_t j = st.firstItem + where[prods[p].slot];
+                lookahead[j] |= afterFirst[item];
+                if (afterNullable[item]) flow[st.firstItem + i].push_back(j);
+            }
+        }
+
+        for (size_t i = 0; i < st.items.size(); ++i) where[st.items[i]] = NO_ITEM;
+        for (size_t e = 0; e < st.edges.size(); ++e) succ[st.edges[e].first] = NO_ITEM;
+    }
+
+    std::vector<size_t> work;
+    std::vector<bool> queued(total, false);
+    for (size_t x = 0; x < total; ++x) {
+        if (lookahead[x].none()) continue;
+        work.push_back(x);
+        queued[x] = true;
+    }
+    while (!work.empty()) {
+        size_t x = work.back();
+        work.pop_back();
+        queued[x] = false;
+        for (size_t e = 0; e < flow[x].size(); ++e) {
+            size_t y = flow[x][e];
+            if ((lookahead[y] | lookahead[x]) == lookahead[y]) continue;
+            lookahead[y] |= lookahead[x];
+            if (!queued[y]) {
+                work.push_back(y);
+                queued[y] = true;
+            }
+        }
+    }
+}
+
+// ---------------- Tables ----------------
+
+void LalrTable::fillTables() {
+    actions.assign(states.size() * terms, pack(ACTION_ERROR, 0));
+    gotos.assign(states.size() * nonterminals, 0);
+    for (size_t s = 0; s < states.size(); ++s) {
+        const State& st = states[s];
+        for (size_t e = 0; e < st.edges.size(); ++e) {
+            size_t sym = st.edges[e].first;
+            if (sym < terms) actions[s * terms + sym] = pack(ACTION_SHIFT, st.edges[e].second);
+            else gotos[s * nonterminals + sym - terms] = st.edges[e].second;
+        }
+    }
+    for (size_t s = 0; s < states.size(); ++s) {
+        const State& st = states[s];
+        for (size_t i = 0; i < st.items.size(); ++i) {
+            if (itemNext[st.items[i]] != NONE) continue;
+            size_t p = itemProd[st.items[i]];
+            ActionKind kind = prods[p].build == BUILD_ACCEPT ? ACTION_ACCEPT : ACTION_REDUCE;
+            const Lookahead& la = lookahead[st.firstItem + i];
+            for (size_t t = 0; t < terms; ++t)
+                if (la.test(t)) setAction(static_cast<unsigned>(s), t, pack(kind, p));
+        }
+    }
+}
+
+// Shifts are entered first. A reduction then loses to a shift, to an
+// accept and to an earlier production, and the loser is recorded.
+void LalrTable::setAction(unsigned state, size_t term, unsigned action) {
+    unsigned& cell = actions[state * terms + term];
+    if (kind(cell) == ACTION_ERROR) {
+        cell = action;
+        return;
+    }
+    ConflictKind conflict = kind(cell) == ACTION_SHIFT ? CONFLICT_SHIFT_REDUCE : CONFLICT_REDUCE_REDUCE;
+    unsigned lost = action;
+    if (conflict == CONFLICT_REDUCE_REDUCE &&
+        (kind(action) == ACTION_ACCEPT ||
+         (kind(cell) != ACTION_ACCEPT && target(action) < target(cell)))) {
+        lost = cell;
+        cell = action;
+    }
+
+    const Production* prod = &prods[target(lost)];
+    size_t c = 0;
+    while (c < conflicts.size() && !(conflicts[c].prod == prod && conflicts[c].kind == conflict)) ++c;
+    if (c == conflicts.size()) {
+        Conflict fresh;
+        fresh.rule = owner[prod->lhs];
+        fresh.prod = prod;
+        fresh.kind = conflict;
+        fresh.atEnd = false;
+        // Keep the list in production order
+        size_t at = 0;
+        while (at < conflicts.size() && conflicts[at].prod <= prod) ++at;
+        conflicts.insert(conflicts.begin() + at, fresh);
+        c = at;
+    }
+    if (term == endTerminal()) conflicts[c].atEnd = true;
+    else conflicts[c].bytes |= classBytes[term];
+}
+
+// ---------------- Report ----------------
+
+static void writeByte(std::ostream& out, unsigned b) {
+    const char* hex = "0123456789ABCDEF";
+    if (b > 0x20 && b < 0x7F && b != '\'') out << '\'' << static_cast<char>(b) << '\'';
+    else out << "0x" << hex[b >> 4] << hex[b & 15];
+}
+
+// Bytes in grammar notation, runs of three or more as ranges
+static void writeBytes(std::ostream& out, const std::bitset<256>& bytes) {
+    const char* sep = "";
+    for (unsigned c = 0; c < 256; ++c) {
+        if (!bytes.test(c)) continue;
+        unsigned end = c;
+        while (end < 255 && bytes.test(end + 1)) ++end;
+        out << sep;
+        sep = " ";
+        writeByte(out, c);
+        if (end > c) {
+            out << (end > c + 1 ? " ... " : " ");
+            writeByte(out, end);
+        }
+        c = end;
+    }
+}
+
+void LalrTable::report(std::ostream& out) const {
+    out << "LALR(1): " << states.size() << " states, " << prods.size() << " productions, "
+        << classCount << " byte classes, " << conflicts.size() << " conflicts" << std::endl;
+    for (size_t i = 0; i < conflicts.size(); ++i) {
+        const Conflict& c = conflicts[i];
+        const char* what = "rule";
+        switch (c.prod->build) {
+            case BUILD_LEAF:
+                what = c.prod->expr->type == Expression::EXPR_TERMINAL ? "literal" : "character class";
+                break;
+            case BUILD_SEQUENCE:    what = "sequence"; break;
+            case BUILD_ALTERNATIVE: what = "alternative"; break;
+            case BUILD_OPTIONAL:    what = "optional"; break;
+            case BUILD_REPEAT:      what = "repetition"; break;
+            default: break;
+        }
+        out << "  " << (c.rule ? c.rule->name : std::string("?")) << ": " << what << ": "
+            << (c.kind == CONFLICT_SHIFT_REDUCE ? "shift/reduce" : "reduce/reduce")
+            << " conflict on ";
+        writeBytes(out, c.bytes);
+        if (c.atEnd) out << (c.bytes.any() ? " and " : "") << "end of input";
+        out << std::endl;
+    }
+}
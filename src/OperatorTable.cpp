@@ -0,0 +1,128 @@
+#include "OperatorTable.hpp"
+#include <iostream>
+#include "AST.hpp"
+#include "BNFTokenizer.hpp"
+#include "Debug.hpp"
+
+const size_t OperatorTable::NO_LEVEL;
+
+namespace {
+
+// An operator whose right operand is not complete yet
+struct Pending {
+    ASTNode* node;   // Iteration node that becomes the <infix> node
+    ASTNode* op;     // Operator's terminal node
+    size_t level;
+};
+
+// Frees a structural node of the chain, but not its children
+void dropNode(ASTNode* n) {
+    if (!n || n->pooled) return;
+    n->children.clear();
+    delete n;
+}
+
+// Combines the two topmost operands with the topmost operator
+void applyTop(std::vector<ASTNode*>& operands, std::vector<Pending>& stack) {
+    Pending p = stack.back();
+    stack.pop_back();
+    ASTNode* right = operands.back();
+    operands.pop_back();
+    ASTNode* left = operands.back();
+
+    ASTNode* n = p.node;
+    n->symbol = "<infix>";
+    n->children.clear();
+    n->children.push_back(left);
+    n->children.push_back(p.op);
+    n->children.push_back(right);
+    // An operand that matched empty has no node; it sits next to the operator
+    n->begin = left ? left->begin : p.op->begin;
+    n->end = right ? right->end : p.op->end;
+    n->source = p.op->source;
+    n->matched = (left ? left->matched : std::string()) + p.op->matched +
+                 (right ? right->matched : std::string());
+    operands.back() = n;
+}
+
+}
+
+OperatorTable::OperatorTable() {}
+
+bool OperatorTable::parse(const std::string& text) {
+    ops.clear();
+    assocs.clear();
+    BNFTokenizer tz(text);
+    while (true) {
+        Token t = tz.next();
+        if (t.type != Token::TOK_WORD || (t.value != "left" && t.value != "right")) {
+            std::cerr << "Operator table: expected 'left' or 'right', found '" << t.value << "'" << std::endl;
+            return false;
+        }
+        size_t level = assocs.size();
+        assocs.push_back(t.value == "left" ? ASSOC_LEFT : ASSOC_RIGHT);
+
+        size_t count = 0;
+        for (t = tz.next(); t.type == Token::TOK_TERMINAL; t = tz.next(), ++count) {
+            if (t.value.empty() || levelOf(t.value) != NO_LEVEL) {
+                std::cerr << "Operator table: empty or repeated operator '" << t.value << "'" << std::endl;
+                return false;
+            }
+            Operator op;
+            op.literal = t.value;
+            op.level = level;
+            ops.push_back(op);
+        }
+        if (count == 0) {
+            std::cerr << "Operator table: level " << level << " has no operators" << std::endl;
+            return false;
+        }
+        if (t.type == Token::TOK_END) break;
+        if (t.type != Token::TOK_PIPE) {
+            std::cerr << "Operator table: unexpected '" << t.value << "'" << std::endl;
+            return false;
+        }
+    }
+    DEBUG_MSG("OperatorTable: " << ops.size() << " operators in " << assocs.size() << " levels");
+    return true;
+}
+
+size_t OperatorTable::levelOf(const std::string& literal) const {
+    for (size_t i = 0; i < ops.size(); ++i) {
+        if (ops[i].literal == literal) return ops[i].level;
+    }
+    return NO_LEVEL;
+}
+
+// Shunting-yard over the iterations: an operator is applied as soon as one
+// that binds more loosely (or as loosely, for left associativity) follows
+ASTNode* OperatorTable::fold(ASTNode* chain) const {
+    if (!chain || chain->children.size() != 2) return chain;
+    ASTNode* rep = chain->children[1];
+    std::vector<ASTNode*> operands(1, chain->children[0]);
+    std::vector<Pending> stack;
+
+    for (size_t i = 0; rep && i < rep->children.size(); ++i) {
+        ASTNode* step = rep->children[i];
+        // A table of several operators stores its branches in an alternative
+        if (step->symbol == "<alt>") {
+            ASTNode* branch = step->children[0];
+            dropNode(step);
+            step = branch;
+        }
+        Pending p;
+        p.node = step;
+        p.op = step->children[0];
+        p.level = levelOf(p.op->symbol);
+        while (!stack.empty() && appliesFirst(stack.back().level, p.level))
+            applyTop(operands, stack);
+        stack.push_back(p);
+        operands.push_back(step->children[1]);
+    }
+    while (!stack.empty())
+        applyTop(operands, stack);
+
+    dropNode(rep);
+    dropNode(chain);
+    return operands[0];
+}
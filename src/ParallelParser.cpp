@@ -0,0 +1,205 @@
+#include "../include/ParallelParser.hpp"
+#include "../include/Debug.hpp"
+#include <iostream>
+
+const size_t ParallelParser::DEFAULT_CHUNK_SIZE;
+
+ParallelParser::Worker::Worker(ParallelParser* o, const CompiledGrammar& cg)
+    : owner(o), parser(cg), steals(0), accepted(0)
+{
+    pthread_mutex_init(&lock, 0);
+}
+
+ParallelParser::ParallelParser(const CompiledGrammar& cg, size_t threads)
+    : chunkSize(DEFAULT_CHUNK_SIZE),
+      inputCount(0),
+      rule(0),
+      inputs(0),
+      generation(0),
+      pending(0),
+      active(0),
+      stopping(false)
+{
+    pthread_mutex_init(&mutex, 0);
+    pthread_cond_init(&wake, 0);
+    pthread_cond_init(&done, 0);
+
+    if (threads == 0) threads = 1;
+    for (size_t i = 0; i < threads; ++i) {
+        Worker* w = new Worker(this, cg);
+        if (pthread_create(&w->thread, 0, workerMain, w) != 0) {
+            std::cerr << "ParallelParser: could not start worker " << i << std::endl;
+            pthread_mutex_destroy(&w->lock);
+            delete w;
+            break;
+        }
+        workers.push_back(w);
+    }
+}
+
+ParallelParser::~ParallelParser() {
+    pthread_mutex_lock(&mutex);
+    stopping = true;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&mutex);
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        pthread_join(workers[i]->thread, 0);
+        pthread_mutex_destroy(&workers[i]->lock);
+        delete workers[i];
+    }
+    pthread_cond_destroy(&done);
+    pthread_cond_destroy(&wake);
+    pthread_mutex_destroy(&mutex);
+}
+
+void ParallelParser::setChunkSize(size_t n) {
+    chunkSize = n ? n : 1;
+}
+
+void ParallelParser::setEngine(BNFParser::Engine e) {
+    for (size_t i = 0; i < workers.size(); ++i)
+        workers[i]->parser.setEngine(e);
+}
+
+void ParallelParser::setMemoization(bool enabled) {
+    for (size_t i = 0; i < workers.size(); ++i)
+        workers[i]->parser.setMemoization(enabled);
+}
+
+size_t ParallelParser::getSteals() const {
+    size_t total = 0;
+    for (size_t i = 0; i < workers.size(); ++i)
+        total += workers[i]->steals;
+    return total;
+}
+
+size_t ParallelParser::parseAll(const std::string& ruleName,
+                                const std::vector<std::string>& in)
+{
+    inputCount = in.size();
+    size_t chunkCount = (in.size() + chunkSize - 1) / chunkSize;
+    if (results.size() < chunkCount) results.resize(chunkCount);
+    if (chunkCount == 0 || workers.empty()) return 0;
+
+    // Publish the job before any chunk becomes visible: a worker that is
+    // late from the previous job may start taking chunks right away
+    pthread_mutex_lock(&mutex);
+    rule = &ruleName;
+    inputs = &in;
+    pending = chunkCount;
+
+    size_t n = workers.size();
+    for (size_t i = 0; i < n; ++i) {
+        workers[i]->steals = 0;
+        workers[i]->accepted = 0;
+    }
+
+    // Deal out contiguous runs of chunks so neighbouring inputs stay together
+    for (size_t i = 0; i < n; ++i) {
+        Worker& w = *workers[i];
+        pthread_mutex_lock(&w.lock);
+        for (size_t c = chunkCount * i / n; c < chunkCount * (i + 1) / n; ++c)
+            w.chunks.push_back(c);
+        pthread_mutex_unlock(&w.lock);
+    }
+
+    ++generation;
+    pthread_cond_broadcast(&wake);
+    while (pending > 0 || active > 0)
+        pthread_cond_wait(&done, &mutex);
+    pthread_mutex_unlock(&mutex);
+
+    size_t accepted = 0;
+    for (size_t i = 0; i < n; ++i)
+        accepted += workers[i]->accepted;
+    DEBUG_MSG("ParallelParser: " << chunkCount << " chunks, " << getSteals() << " stolen");
+    return accepted;
+}
+
+const BatchResult::Entry& ParallelParser::entry(size_t index) const {
+    size_t local = 0;
+    const BatchResult& r = resultOf(index, local);
+    return r.entries[local];
+}
+
+const BatchResult& ParallelParser::resultOf(size_t index, size_t& local) const {
+    local = index % chunkSize;
+    return results[index / chunkSize];
+}
+
+ASTNode* ParallelParser::toAST(size_t index, const std::string& input) const {
+    if (index >= inputCount) return 0;
+    size_t local = 0;
+    const BatchResult& r = resultOf(index, local);
+    return r.toAST(local, input);
+}
+
+void* ParallelParser::workerMain(void* arg) {
+    Worker* self = static_cast<Worker*>(arg);
+    self->owner->work(*self);
+    return 0;
+}
+
+// Worker loop: sleep until a job is posted, then drain chunks until no
+// deque has any left
+void ParallelParser::work(Worker& self) {
+    size_t seen = 0;
+    pthread_mutex_lock(&mutex);
+    for (;;) {
+        while (!stopping && generation == seen)
+            pthread_cond_wait(&wake, &mutex);
+        if (stopping) break;
+        seen = generation;
+        ++active;
+        pthread_mutex_unlock(&mutex);
+
+        size_t chunk = 0;
+        while (takeChunk(self, chunk)) {
+            parseChunk(self, chunk);
+            pthread_mutex_lock(&mutex);
+            --pending;
+            pthread_mutex_unlock(&mutex);
+        }
+
+        pthread_mutex_lock(&mutex);
+        --active;
+        if (pending == 0 && active == 0)
+            pthread_cond_signal(&done);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+// Own chunks come off the back; others are stolen from the front, which
+// holds the work their owner would reach last
+bool ParallelParser::takeChunk(Worker& self, size_t& chunk) {
+    pthread_mutex_lock(&self.lock);
+    if (!self.chunks.empty()) {
+        chunk = self.chunks.back();
+        self.chunks.pop_back();
+        pthread_mutex_unlock(&self.lock);
+        return true;
+    }
+    pthread_mutex_unlock(&self.lock);
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        Worker& victim = *workers[i];
+        if (&victim == &self) continue;
+        pthread_mutex_lock(&victim.lock);
+        if (!victim.chunks.empty()) {
+            chunk = victim.chunks.front();
+            victim.chunks.pop_front();
+            pthread_mutex_unlock(&victim.lock);
+            ++self.steals;
+            return true;
+        }
+        pthread_mutex_unlock(&victim.lock);
+    }
+    return false;
+}
+
+void ParallelParser::parseChunk(Worker& self, size_t chunk) {
+    size_t first = chunk * chunkSize;
+    size_t count = inputs->size() - first < chunkSize ? inputs->size() - first : chunkSize;
+    self.accepted += self.parser.parseBatch(*rule, &(*inputs)[first], count, results[chunk]);
+}
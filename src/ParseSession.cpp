@@ -0,0 +1,125 @@
+#include "../include/ParseSession.hpp"
+#include "../include/Debug.hpp"
+#include <iostream>
+
+ParseSession::ParseSession(const BNFParser& p, const std::string& ruleName)
+    : parser(p),
+      rule(p.findRule(ruleName)),
+      growing(0),
+      callee(0),
+      node(0),
+      result(0),
+      pos(0),
+      status(NEED_MORE),
+      calling(false),
+      ok(false),
+      active(false),
+      eof(false)
+{
+    if (!rule) {
+        std::cerr << "ParseSession: rule not found: " << ruleName << std::endl;
+        status = FAILED;
+    }
+}
+
+ParseSession::~ParseSession() {
+    clearFrames();
+    delete growing;
+    delete result;
+}
+
+ParseSession::Status ParseSession::feed(const char* data, size_t size) {
+    if (eof) {
+        std::cerr << "ParseSession: input after finish() ignored" << std::endl;
+        return status;
+    }
+    buffer.append(data, size);
+    return poll();
+}
+
+ParseSession::Status ParseSession::feed(const std::string& data) {
+    return feed(data.data(), data.size());
+}
+
+ParseSession::Status ParseSession::finish() {
+    eof = true;
+    return poll();
+}
+
+ParseSession::Status ParseSession::poll() {
+    if (status != NEED_MORE) return status;
+
+    if (!active) {
+        // A new message starts only once its first byte is here
+        if (buffer.empty()) {
+            if (eof) status = END_OF_STREAM;
+            return status;
+        }
+        frames.clear();
+        callee = parser.entryExpr(rule);
+        calling = true;
+        ok = false;
+        node = 0;
+        pos = 0;
+        active = true;
+    }
+
+    // Run the suspended stack until done or starved
+    BNFParser::RunState state = parser.resumeStream(frames, growing, !eof, buffer,
+                                                    pos, callee, calling, ok, node);
+
+    if (state == BNFParser::RUN_SUSPENDED) {
+        DEBUG_MSG("ParseSession: suspended at " << pos << " of " << buffer.size());
+        return status;
+    }
+
+    active = false;
+    // An empty match would never advance the stream
+    if (state == BNFParser::RUN_DONE && ok && pos > 0) {
+        result = parser.entryNode(rule, node);
+        status = COMPLETE;
+    } else {
+        parser.discard(node);
+        status = FAILED;
+    }
+    node = 0;
+    return status;
+}
+
+ASTNode* ParseSession::takeResult() {
+    if (status != COMPLETE) return 0;
+    ASTNode* tree = result;
+    result = 0;
+    buffer.erase(0, pos);
+    pos = 0;
+    status = NEED_MORE;
+    return tree;
+}
+
+void ParseSession::reset() {
+    clearFrames();
+    delete result;
+    result = 0;
+    node = 0;
+    buffer.clear();
+    pos = 0;
+    active = false;
+    eof = false;
+    status = rule ? NEED_MORE : FAILED;
+}
+
+void ParseSession::shrink() {
+    if (active) return;
+    std::string(buffer).swap(buffer);
+    std::vector<BNFParser::Frame>().swap(frames);
+    delete growing;
+    growing = 0;
+}
+
+// Free the partial nodes held by a suspended stack
+void ParseSession::clearFrames() {
+    for (size_t i = 0; i < frames.size(); ++i)
+        parser.discard(frames[i].node);
+    frames.clear();
+    if (growing) parser.releaseSeeds(*growing);
+}
@@ -0,0 +1,263 @@
+#include "../include/VMParser.hpp"
+#include "../include/OperatorTable.hpp"
+#include "../include/Debug.hpp"
+#include <iostream>
+#include <cstring>
+
+VMParser::VMParser(const Grammar& g) {
+    BytecodeCompiler compiler(g);
+    compiler.compile(program);
+}
+
+void VMParser::pushCapture(Capture::Kind kind, int symbol, size_t pos, size_t len) const {
+    Capture c;
+    c.kind = kind;
+    c.symbol = symbol;
+    c.pos = pos;
+    c.len = len;
+    captures.push_back(c);
+}
+
+ASTNode* VMParser::parse(const std::string& ruleName,
+                         const std::string& input,
+                         size_t& consumed) const
+{
+    consumed = 0;
+    int entry = program.entryPoint(ruleName);
+    if (entry < 0) {
+        std::cerr << "VMParser::parse: rule not found: " << ruleName << std::endl;
+        return 0;
+    }
+
+    size_t pos = 0;
+    if (!run(entry, input, pos)) {
+        DEBUG_MSG("VMParser: parse failed for rule " << ruleName);
+        return 0;
+    }
+    consumed = pos;
+    ASTNode* root = buildTree(input);
+    std::map<std::string, const OperatorTable*>::const_iterator ops = program.operatorRules.find(ruleName);
+    return ops == program.operatorRules.end() ? root : ops->second->fold(root);
+}
+
+// Main dispatch loop. Returns true when the start rule returns to HALT.
+bool VMParser::run(int entry, const std::string& input, size_t& pos) const {
+    const Instruction* code = &program.code[0];
+    const size_t size = input.size();
+    const char* data = input.data();
+
+    backtrack.clear();
+    calls.clear();
+    alts.clear();
+    captures.clear();
+    calls.push_back(0);
+
+    int ip = entry;
+    pos = 0;
+
+    for (;;) {
+        const Instruction& in = code[ip];
+        switch (in.op) {
+            case Instruction::OP_HALT:
+                return true;
+
+            case Instruction::OP_CHAR:
+                if (pos < size && static_cast<unsigned char>(data[pos]) == in.a) {
+                    pushCapture(Capture::LEAF, in.b, pos, 1);
+                    ++pos;
+                    ++ip;
+                    continue;
+                }
+                break;
+
+            case Instruction::OP_CLASS:
+                if (pos < size && program.classes[in.a].test(static_cast<unsigned char>(data[pos]))) {
+                    pushCapture(Capture::LEAF, in.b, pos, 1);
+                    ++pos;
+                    ++ip;
+                    continue;
+                }
+                break;
+
+            case Instruction::OP_LITERAL: {
+                const std::string& lit = program.literals[in.a];
+                if (pos + lit.size() <= size &&
+                    std::memcmp(data + pos, lit.data(), lit.size()) == 0) {
+                    pushCapture(Capture::LEAF, in.b, pos, lit.size());
+                    pos += lit.size();
+                    ++ip;
+                    continue;
+                }
+                break;
+            }
+
+            case Instruction::OP_CALL:
+                calls.push_back(ip + 1);
+                ip = in.a;
+                continue;
+
+            case Instruction::OP_RET:
+                ip = calls.back();
+                calls.pop_back();
+                continue;
+
+            case Instruction::OP_CHOICE: {
+                Backtrack b;
+                b.target = in.a;
+                b.pos = pos;
+                b.captures = captures.size();
+                b.calls = calls.size();
+                b.alts = alts.size();
+                backtrack.push_back(b);
+                ++ip;
+                continue;
+            }
+
+            case Instruction::OP_COMMIT:
+                backtrack.pop_back();
+                ip = in.a;
+                continue;
+
+            case Instruction::OP_JUMP:
+                ip = in.a;
+                continue;
+
+            case Instruction::OP_FAIL:
+                break;
+
+            case Instruction::OP_TEST:
+                if (pos < size && program.classes[in.a].test(static_cast<unsigned char>(data[pos])))
+                    ++ip;
+                else
+                    ip = in.b;
+                continue;
+
+            case Instruction::OP_PROGRESS:
+                if (pos != backtrack.back().pos) {
+                    ++ip;
+                    continue;
+                }
+                break;
+
+            case Instruction::OP_ALT_BEGIN: {
+                pushCapture(Capture::OPEN, in.a, pos, 0);
+                AltFrame f;
+                f.start = pos;
+                f.open = captures.size() - 1;
+                f.bestEnd = pos;
+                f.bestLen = 0;
+                f.any = false;
+                alts.push_back(f);
+                ++ip;
+                continue;
+            }
+
+            case Instruction::OP_ALT_RECORD: {
+                // The branch's CHOICE entry is on top: consume it directly so
+                // the retained best captures survive the rewind.
+                AltFrame& f = alts.back();
+                Backtrack b = backtrack.back();
+                backtrack.pop_back();
+                f.any = true;
+                size_t mark = f.open + 1;
+                if (pos > f.bestEnd) {
+                    size_t len = captures.size() - b.captures;
+                    for (size_t i = 0; i < len; ++i)
+                        captures[mark + i] = captures[b.captures + i];
+                    f.bestEnd = pos;
+                    f.bestLen = len;
+                }
+                captures.resize(mark + f.bestLen);
+                pos = f.start;
+                ip = b.target;
+                continue;
+            }
+
+            case Instruction::OP_ALT_END: {
+                AltFrame f = alts.back();
+                alts.pop_back();
+                if (!f.any)
+                    break;
+                if (f.bestEnd == f.start) {
+                    // Only empty matches: BNFParser yields no node at all
+                    captures.resize(f.open);
+                    pushCapture(Capture::EMPTY, 0, f.start, 0);
+                    pos = f.start;
+                } else {
+                    pos = f.bestEnd;
+                    pushCapture(Capture::CLOSE, 0, pos, 0);
+                }
+                ++ip;
+                continue;
+            }
+
+            case Instruction::OP_CAPTURE_OPEN:
+                pushCapture(Capture::OPEN, in.a, pos, 0);
+                ++ip;
+                continue;
+
+            case Instruction::OP_CAPTURE_CLOSE:
+                pushCapture(Capture::CLOSE, 0, pos, 0);
+                ++ip;
+                continue;
+        }
+
+        // Failure: resume at the most recent backtrack entry
+        if (backtrack.empty())
+            return false;
+        const Backtrack& b = backtrack.back();
+        ip = b.target;
+        pos = b.pos;
+        captures.resize(b.captures);
+        calls.resize(b.calls);
+        alts.resize(b.alts);
+        backtrack.pop_back();
+    }
+}
+
+// Replay the capture log into an ASTNode tree
+ASTNode* VMParser::buildTree(const std::string& input) const {
+    std::vector<ASTNode*>& open = openNodes;
+    std::vector<size_t>& starts = openStarts;
+    std::vector<int>& symbols = openSymbols;
+    open.clear();
+    starts.clear();
+    symbols.clear();
+    ASTNode* root = 0;
+
+    for (size_t i = 0; i < captures.size(); ++i) {
+        const Capture& c = captures[i];
+        ASTNode* done = 0;
+        switch (c.kind) {
+            case Capture::OPEN:
+                open.push_back(new ASTNode(program.symbols[c.symbol]));
+                starts.push_back(c.pos);
+                symbols.push_back(c.symbol);
+                continue;
+            case Capture::CLOSE:
+                done = open.back();
+                done->begin = starts.back();
+                done->end = c.pos;
+                done->matched.assign(input, done->begin, done->end - done->begin);
+                if (program.operators[symbols.back()] && !done->children.empty())
+                    done->children[0] = program.operators[symbols.back()]->fold(done->children[0]);
+                open.pop_back();
+                starts.pop_back();
+                symbols.pop_back();
+                break;
+            case Capture::LEAF:
+                done = new ASTNode(program.symbols[c.symbol]);
+                done->begin = c.pos;
+                done->end = c.pos + c.len;
+                done->matched.assign(input, c.pos, c.len);
+                break;
+            case Capture::EMPTY:
+                if (!open.empty() && program.keepsNull[symbols.back()])
+                    open.back()->children.push_back(0);
+                continue;
+        }
+        if (open.empty()) root = done;
+        else open.back()->children.push_back(done);
+    }
+    return root;
+}
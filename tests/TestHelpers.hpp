@@ -0,0 +1,68 @@
+/**
+ * Shared helpers for the test suites: tree comparisons and the grammar
+ * fragments that several suites parse, so every suite checks its feature
+ * against the same trees and rules.
+ */
+
+#ifndef TEST_HELPERS_HPP
+#define TEST_HELPERS_HPP
+
+#include "../include/AST.hpp"
+#include "../include/Grammar.hpp"
+
+/**
+ * @brief Whether two trees have the same shape, symbols and text.
+ *
+ * Text is compared through ASTNode::text(), so a zero-copy tree matches
+ * the copying tree of the same parse.
+ */
+inline bool sameTree(const ASTNode* a, const ASTNode* b) {
+    if (!a || !b) return a == b;
+    if (a->symbol != b->symbol || a->text() != b->text()) return false;
+    if (a->children.size() != b->children.size()) return false;
+    for (size_t i = 0; i < a->children.size(); ++i) {
+        if (!sameTree(a->children[i], b->children[i])) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Like sameTree(), and every node also spans the same offsets.
+ */
+inline bool sameSpans(const ASTNode* a, const ASTNode* b) {
+    if (!a || !b) return a == b;
+    if (a->symbol != b->symbol || a->text() != b->text()) return false;
+    if (a->begin != b->begin || a->end != b->end) return false;
+    if (a->children.size() != b->children.size()) return false;
+    for (size_t i = 0; i < a->children.size(); ++i) {
+        if (!sameSpans(a->children[i], b->children[i])) return false;
+    }
+    return true;
+}
+
+/// Lowercase words: <letter>, <digit> and <word>
+inline void buildWords(Grammar& g) {
+    g.addRule("<letter> ::= 'a' ... 'z'");
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<word> ::= <letter> { <letter> | <digit> }");
+}
+
+/// Nicknames of the mini protocol: <letter>, <digit>, <nick-char> and <nickname>
+inline void buildNickname(Grammar& g) {
+    g.addRule("<letter> ::= 'a' ... 'z' | 'A' ... 'Z'");
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<nick-char> ::= <letter> | <digit> | '_' | '-'");
+    g.addRule("<nickname> ::= <letter> { <nick-char> }");
+}
+
+/// Mini protocol from examples/example_mini_protocol.cpp (start rule <message>)
+inline void buildMiniProtocol(Grammar& g) {
+    buildNickname(g);
+    g.addRule("<space> ::= ' ' { ' ' }");
+    g.addRule("<text-char> ::= ( 0x21 ... 0x7E )");
+    g.addRule("<text> ::= <text-char> { <text-char> | ' ' }");
+    g.addRule("<crlf> ::= '\r' '\n'");
+    g.addRule("<message> ::= 'MSG' <space> <nickname> <space> ':' <text> <crlf>");
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/Arena.hpp"
+#include "TestHelpers.hpp"
+#include <string>
+
+static void buildGrammar(Grammar& g) {
+    buildWords(g);
+    g.addRule("<cmd> ::= <word> ':' | <word> ';' | <word> [ '!' ]");
+}
+
+static bool allPooled(const ASTNode* n) {
+    if (!n) return true;
+    if (!n->pooled) return false;
+    for (size_t i = 0; i < n->children.size(); ++i) {
+        if (!allPooled(n->children[i])) return false;
+    }
+    return true;
+}
+
+void test_arena_ast_same_tree(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    BNFParser p(g);
+    Arena arena(1024);
+
+    const char* inputs[] = { "abc1:", "x;", "hello!", "hello", "9" };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+        size_t c1 = 0, c2 = 0;
+        ASTNode* heap = p.parse("<cmd>", inputs[i], c1);
+        ASTNode* pooled = p.parse("<cmd>", inputs[i], c2, arena);
+        ASSERT_EQ(runner, c1, c2);
+        ASSERT_TRUE(runner, sameTree(heap, pooled));
+        ASSERT_TRUE(runner, allPooled(pooled));
+        delete heap;
+        arena.reset();
+    }
+}
+
+void test_arena_ast_reuse(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    BNFParser p(g);
+    Arena arena(4096);
+
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<cmd>", "abcdefgh12345:", consumed, arena);
+    ASSERT_NOT_NULL(runner, ast);
+    arena.reset();
+    size_t capacity = arena.capacity();
+
+    // reset() recycles the blocks, so repeated parses do not grow the arena
+    for (int i = 0; i < 200; ++i) {
+        ast = p.parse("<cmd>", "abcdefgh12345:", consumed, arena);
+        ASSERT_NOT_NULL(runner, ast);
+        ASSERT_EQ(runner, ast->matched, "abcdefgh12345:");
+        arena.reset();
+    }
+    ASSERT_EQ(runner, arena.capacity(), capacity);
+
+    // Heap parses are unaffected after arena parses
+    ast = p.parse("<cmd>", "ab;", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_FALSE(runner, ast->pooled);
+    delete ast;
+}
+
+void test_arena_ast_engines_and_memo(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+
+    BNFParser rec(g);
+    BNFParser it(g);
+    it.setEngine(BNFParser::ENGINE_ITERATIVE);
+    it.setMemoization(true);
+    Arena arena;
+
+    size_t c1 = 0, c2 = 0;
+    ASTNode* a = rec.parse("<cmd>", "word42!", c1);
+    ASTNode* b = it.parse("<cmd>", "word42!", c2, arena);
+    ASSERT_EQ(runner, c1, c2);
+    ASSERT_TRUE(runner, sameTree(a, b));
+    ASSERT_TRUE(runner, allPooled(b));
+    ASSERT_GT(runner, it.getStats().memoHits, 0u);
+    delete a;
+}
+
+static int cleanupOrder[3];
+static int cleanupCount = 0;
+static void recordCleanup(void* p) {
+    cleanupOrder[cleanupCount++] = *static_cast<int*>(p);
+}
+
+void test_arena_cleanups(TestRunner& runner) {
+    static int ids[3] = { 1, 2, 3 };
+    Arena arena(64);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_NOT_NULL(runner, arena.allocate(48));
+        arena.addCleanup(recordCleanup, &ids[i]);
+    }
+    arena.reset();
+    ASSERT_EQ(runner, cleanupCount, 3);
+    ASSERT_EQ(runner, cleanupOrder[0], 3);
+    ASSERT_EQ(runner, cleanupOrder[2], 1);
+
+    // A second reset has nothing left to clean up
+    arena.reset();
+    ASSERT_EQ(runner, cleanupCount, 3);
+}
+
+int main() {
+    TestSuite suite("Arena AST Test Suite");
+    suite.addTest("Same Tree As Heap Parse", test_arena_ast_same_tree);
+    suite.addTest("Arena Reuse Across Parses", test_arena_ast_reuse);
+    suite.addTest("Engines And Memoization", test_arena_ast_engines_and_memo);
+    suite.addTest("Arena Cleanups", test_arena_cleanups);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/BatchResult.hpp"
+#include "TestHelpers.hpp"
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+// Count global allocations to check that warm batches stay off the heap
+static size_t allocations = 0;
+
+void* operator new(std::size_t size) throw(std::bad_alloc) {
+    ++allocations;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) throw() {
+    std::free(p);
+}
+
+static void buildGrammar(Grammar& g) {
+    buildWords(g);
+    g.addRule("<maybe> ::= [ 'x' ]");
+    g.addRule("<list> ::= <word> [ ',' <list> ]");
+    g.addRule("<pair> ::= <maybe> '=' <maybe>");
+}
+
+static std::vector<std::string> sampleInputs() {
+    std::vector<std::string> inputs;
+    inputs.push_back("abc,d4,efg");
+    inputs.push_back("9lives");
+    inputs.push_back("x");
+    inputs.push_back("");
+    inputs.push_back("a,b,");
+    inputs.push_back("hello,world");
+    return inputs;
+}
+
+void test_batch_matches_parse(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    BNFParser p(g.finalize());
+    std::vector<std::string> inputs = sampleInputs();
+
+    BatchResult out;
+    size_t accepted = p.parseBatch("<list>", inputs, out);
+    ASSERT_EQ(runner, out.size(), inputs.size());
+
+    size_t expectedAccepted = 0;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        size_t consumed = 0;
+        ASTNode* expected = p.parse("<list>", inputs[i], consumed);
+        if (expected) ++expectedAccepted;
+        ASSERT_EQ(runner, out.entries[i].ok, expected != 0);
+        ASSERT_EQ(runner, out.entries[i].consumed, consumed);
+        ASTNode* rebuilt = out.toAST(i, inputs[i]);
+        ASSERT_TRUE(runner, sameSpans(expected, rebuilt));
+        delete rebuilt;
+        delete expected;
+    }
+    ASSERT_EQ(runner, accepted, expectedAccepted);
+}
+
+void test_flat_layout(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    BNFParser p(g);
+    std::string input = "=x";
+
+    BatchResult out;
+    size_t accepted = p.parseBatch("<pair>", &input, 1, out);
+    ASSERT_EQ(runner, accepted, 1u);
+    const FlatNode& seq = out.nodes[out.entries[0].root];
+    ASSERT_EQ(runner, out.symbolOf(seq), "<seq>");
+    ASSERT_EQ(runner, out.text(seq, input), "=x");
+
+    // Children of a node are adjacent, in order
+    ASSERT_EQ(runner, seq.childCount, 3u);
+    const FlatNode& first = out.nodes[seq.firstChild];
+    ASSERT_EQ(runner, out.symbolOf(first), "<maybe>");
+    ASSERT_EQ(runner, first.begin, first.end);
+    ASSERT_EQ(runner, out.symbolOf(out.nodes[seq.firstChild + 1]), "=");
+    ASSERT_EQ(runner, out.text(out.nodes[seq.firstChild + 2], input), "x");
+}
+
+void test_reuse_across_batches(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    BNFParser p(g.finalize());
+    p.setEngine(BNFParser::ENGINE_ITERATIVE);
+    p.setMemoization(true);
+    std::vector<std::string> inputs = sampleInputs();
+
+    BatchResult out;
+    p.parseBatch("<list>", inputs, out);
+    size_t nodes = out.nodes.size();
+    size_t symbols = out.symbols.size();
+    p.parseBatch("<list>", inputs, out);
+    ASSERT_EQ(runner, out.size(), inputs.size());
+    ASSERT_EQ(runner, out.nodes.size(), nodes);
+    ASSERT_EQ(runner, out.symbols.size(), symbols);
+
+    // Ordinary parses still copy matched text afterwards
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<list>", "ab,cd", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, ast->matched, "ab,cd");
+    delete ast;
+}
+
+void test_warm_batch_no_allocations(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    BNFParser p(g.finalize());
+    std::vector<std::string> inputs = sampleInputs();
+
+    BatchResult out;
+    p.parseBatch("<list>", inputs, out);
+
+    size_t before = allocations;
+    for (int i = 0; i < 50; ++i)
+        p.parseBatch("<list>", inputs, out);
+    size_t used = allocations - before;
+    ASSERT_EQ(runner, used, 0u);
+    ASSERT_EQ(runner, out.size(), inputs.size());
+}
+
+void test_unknown_rule(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    BNFParser p(g);
+    std::vector<std::string> inputs = sampleInputs();
+
+    BatchResult out;
+    size_t accepted = p.parseBatch("<missing>", inputs, out);
+    ASSERT_EQ(runner, accepted, 0u);
+    ASSERT_EQ(runner, out.size(), inputs.size());
+    ASSERT_FALSE(runner, out.entries[0].ok);
+    ASSERT_NULL(runner, out.toAST(0, inputs[0]));
+}
+
+int main() {
+    TestSuite suite("Batch Parse Test Suite");
+    suite.addTest("Batch Matches Parse", test_batch_matches_parse);
+    suite.addTest("Flat Layout", test_flat_layout);
+    suite.addTest("Reuse Across Batches", test_reuse_across_batches);
+    suite.addTest("Warm Batch Does Not Allocate", test_warm_batch_no_allocations);
+    suite.addTest("Unknown Rule", test_unknown_rule);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
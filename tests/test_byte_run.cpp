@@ -0,0 +1,164 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/ByteRun.hpp"
+#include "../include/ParseSession.hpp"
+#include "TestHelpers.hpp"
+#include <cstdlib>
+#include <string>
+
+static void buildProtocol(Grammar& g) {
+    buildNickname(g);
+    g.addRule("<text-char> ::= ( 0x21 ... 0x7E )");
+    g.addRule("<text> ::= <text-char> { <text-char> | ' ' }");
+    g.addRule("<message> ::= 'MSG' ' ' <nickname> ' ' ':' <text> '\r' '\n'");
+    g.addRule("<pair> ::= { 'a' 'b' }");
+}
+
+static const ASTNode* findSymbol(const ASTNode* n, const std::string& symbol) {
+    if (!n) return 0;
+    if (n->symbol == symbol) return n;
+    for (size_t i = 0; i < n->children.size(); ++i) {
+        const ASTNode* hit = findSymbol(n->children[i], symbol);
+        if (hit) return hit;
+    }
+    return 0;
+}
+
+static size_t countSymbol(const ASTNode* n, const std::string& symbol) {
+    if (!n) return 0;
+    size_t count = n->symbol == symbol ? 1 : 0;
+    for (size_t i = 0; i < n->children.size(); ++i)
+        count += countSymbol(n->children[i], symbol);
+    return count;
+}
+
+void test_scan_matches_scalar(TestRunner& runner) {
+    std::srand(7);
+    bool allSame = true;
+    for (int round = 0; round < 200; ++round) {
+        // Classes of 1 to 6 ranges, so both vector and bytewise paths run
+        std::bitset<256> bits;
+        int ranges = 1 + round % 6;
+        for (int r = 0; r < ranges; ++r) {
+            int a = std::rand() % 256;
+            int b = a + std::rand() % 40;
+            for (int c = a; c <= b && c < 256; ++c) bits.set(c);
+        }
+        ByteRun run(bits);
+
+        std::string data;
+        size_t len = std::rand() % 100;
+        for (size_t i = 0; i < len; ++i) {
+            unsigned char c;
+            do { c = static_cast<unsigned char>(std::rand() % 256); } while (!bits.test(c));
+            data += static_cast<char>(c);
+        }
+        data += static_cast<char>(std::rand() % 256);
+        data.append(40, 'x');
+
+        for (size_t off = 0; off < 3 && off < data.size(); ++off) {
+            size_t fast = run.scan(data.data() + off, data.size() - off);
+            size_t slow = run.scanScalar(data.data() + off, data.size() - off);
+            if (fast != slow) allSame = false;
+        }
+    }
+    ASSERT_TRUE(runner, allSame);
+
+    std::bitset<256> printable;
+    for (int c = 0x21; c <= 0x7E; ++c) printable.set(c);
+    ByteRun text(printable);
+    ASSERT_EQ(runner, text.rangeCount(), 1);
+    std::string line = "the-quick-brown-fox-jumps-over-the-lazy-dog-0123456789 tail";
+    ASSERT_EQ(runner, text.scan(line.data(), line.size()), line.find(' '));
+    ASSERT_EQ(runner, text.scan(line.data(), 0), 0u);
+}
+
+void test_collapsed_runs(TestRunner& runner) {
+    Grammar g;
+    buildProtocol(g);
+    const CompiledGrammar& cg = g.finalize();
+    BNFParser plain(cg);
+    BNFParser runs(cg);
+    runs.setCollapseRuns(true);
+
+    std::string input = "MSG alice_9 :status-update-0123456789 and more\r\n";
+    size_t c1 = 0, c2 = 0;
+    ASTNode* a = plain.parse("<message>", input, c1);
+    ASTNode* b = runs.parse("<message>", input, c2);
+    ASSERT_NOT_NULL(runner, a);
+    ASSERT_NOT_NULL(runner, b);
+    ASSERT_EQ(runner, c1, c2);
+    ASSERT_EQ(runner, b->matched, a->matched);
+
+    // { <nick-char> } is one leaf; { <text-char> | ' ' } is too
+    ASSERT_EQ(runner, countSymbol(b, "<char-run>"), 2u);
+    ASSERT_EQ(runner, countSymbol(b, "<nick-char>"), 0u);
+    const ASTNode* run = findSymbol(b, "<char-run>");
+    ASSERT_NOT_NULL(runner, run);
+    ASSERT_EQ(runner, run->matched, "lice_9");
+    ASSERT_EQ(runner, run->children.size(), 0u);
+    ASSERT_GT(runner, countSymbol(a, "<nick-char>"), 5u);
+    delete a;
+    delete b;
+
+    // Bodies longer than one byte are not collapsed
+    ASTNode* pairs = runs.parse("<pair>", "ababa", c2);
+    ASSERT_EQ(runner, c2, 4u);
+    ASSERT_EQ(runner, countSymbol(pairs, "<char-run>"), 0u);
+    delete pairs;
+}
+
+void test_engines_and_recognize(TestRunner& runner) {
+    Grammar g;
+    buildProtocol(g);
+    BNFParser rec(g);
+    BNFParser it(g);
+    rec.setCollapseRuns(true);
+    it.setCollapseRuns(true);
+    it.setEngine(BNFParser::ENGINE_ITERATIVE);
+
+    const char* inputs[] = { "MSG bob :hi\r\n", "MSG x :a b c\r\n", "MSG 9 :no\r\n", "MSG abc :\r\n" };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+        size_t c1 = 0, c2 = 0, c3 = 0;
+        ASTNode* a = rec.parse("<message>", inputs[i], c1);
+        ASTNode* b = it.parse("<message>", inputs[i], c2);
+        bool ok = it.recognize("<message>", inputs[i], c3);
+        ASSERT_EQ(runner, a != 0, b != 0);
+        ASSERT_EQ(runner, a != 0, ok);
+        ASSERT_EQ(runner, c1, c2);
+        ASSERT_EQ(runner, c1, c3);
+        if (a && b) ASSERT_EQ(runner, countSymbol(a, "<char-run>"), countSymbol(b, "<char-run>"));
+        delete a;
+        delete b;
+    }
+}
+
+void test_streaming_keeps_bytewise_runs(TestRunner& runner) {
+    Grammar g;
+    buildProtocol(g);
+    BNFParser p(g.finalize());
+    p.setCollapseRuns(true);
+
+    // A run cut by a chunk boundary must wait for more input
+    ParseSession session(p, "<message>");
+    ParseSession::Status st = session.feed("MSG ali");
+    ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+    st = session.feed("ce :hello\r\n");
+    ASSERT_EQ(runner, st, ParseSession::COMPLETE);
+    ASTNode* ast = session.takeResult();
+    ASSERT_NOT_NULL(runner, findSymbol(ast, "<nickname>"));
+    ASSERT_EQ(runner, findSymbol(ast, "<nickname>")->matched, "alice");
+    delete ast;
+}
+
+int main() {
+    TestSuite suite("Byte Run Scanning Test Suite");
+    suite.addTest("Scan Matches Scalar", test_scan_matches_scalar);
+    suite.addTest("Collapsed Runs", test_collapsed_runs);
+    suite.addTest("Engines And Recognize", test_engines_and_recognize);
+    suite.addTest("Streaming Keeps Bytewise Runs", test_streaming_keeps_bytewise_runs);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/CompiledGrammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "TestHelpers.hpp"
+#include <string>
+
+static void buildGrammar(Grammar& g) {
+    g.addRule("<letter> ::= 'a' ... 'z'");
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<ident> ::= <letter> { <letter> | <digit> }");
+    g.addRule("<assign> ::= <ident> \"=\" <digit> [ ';' ]");
+}
+
+void test_finalize_links_nodes(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    const CompiledGrammar& cg = g.finalize();
+
+    ASSERT_TRUE(runner, g.getCompiled() == &cg);
+    ASSERT_TRUE(runner, &g.finalize() == &cg);
+
+    const Rule* assign = cg.getRule("<assign>");
+    ASSERT_NOT_NULL(runner, assign);
+    ASSERT_TRUE(runner, assign == g.getRule("<assign>"));
+
+    // <ident> "=" <digit> [ ';' ]
+    Expression* seq = assign->rootExpr;
+    ASSERT_EQ(runner, seq->children.size(), 4u);
+    ASSERT_TRUE(runner, seq->children[0]->rule == g.getRule("<ident>"));
+    ASSERT_EQ(runner, seq->children[1]->literal, "=");
+    ASSERT_TRUE(runner, seq->children[2]->rule == g.getRule("<digit>"));
+
+    ASSERT_TRUE(runner, seq->first.test('a'));
+    ASSERT_FALSE(runner, seq->first.test('0'));
+    ASSERT_FALSE(runner, seq->nullable);
+    ASSERT_TRUE(runner, seq->children[3]->nullable);
+    ASSERT_TRUE(runner, seq->children[3]->first.test(';'));
+}
+
+void test_compiled_same_ast(TestRunner& runner) {
+    Grammar plain;
+    buildGrammar(plain);
+    Grammar linked;
+    buildGrammar(linked);
+
+    BNFParser p1(plain);
+    BNFParser p2(linked.finalize());
+
+    const char* inputs[] = { "x=1;", "abc9=0", "9=1", "a=", "" };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+        size_t c1 = 0, c2 = 0;
+        ASTNode* a = p1.parse("<assign>", inputs[i], c1);
+        ASTNode* b = p2.parse("<assign>", inputs[i], c2);
+        ASSERT_EQ(runner, c1, c2);
+        ASSERT_TRUE(runner, sameTree(a, b));
+        delete a;
+        delete b;
+    }
+}
+
+void test_finalized_grammar_rejects_rules(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    g.finalize();
+    size_t before = g.getRules().size();
+    g.addRule("<late> ::= 'z'");
+    ASSERT_EQ(runner, g.getRules().size(), before);
+    ASSERT_NULL(runner, g.getCompiled()->getRule("<late>"));
+}
+
+void test_shared_compiled_grammar(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    const CompiledGrammar& cg = g.finalize();
+
+    // Independent parsers over one linked grammar, including one created
+    // from the Grammar after finalize()
+    BNFParser a(cg);
+    BNFParser b(cg);
+    BNFParser c(g);
+    b.setMemoization(true);
+
+    size_t ca = 0, cb = 0, cc = 0;
+    ASTNode* ra = a.parse("<ident>", "abc123", ca);
+    ASTNode* rb = b.parse("<ident>", "abc123", cb);
+    ASTNode* rc = c.parse("<ident>", "abc123", cc);
+    ASSERT_EQ(runner, ca, 6u);
+    ASSERT_EQ(runner, cb, 6u);
+    ASSERT_EQ(runner, cc, 6u);
+    ASSERT_TRUE(runner, sameTree(ra, rb));
+    ASSERT_TRUE(runner, sameTree(ra, rc));
+    delete ra;
+    delete rb;
+    delete rc;
+}
+
+void test_finalize_left_recursion_and_gaps(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<list> ::= <list> ',' 'x' | 'x'");
+    g.addRule("<maybe> ::= 'a' | ");
+    g.addRule("<broken> ::= <missing> | 'b'");
+    const CompiledGrammar& cg = g.finalize();
+
+    const Rule* list = cg.getRule("<list>");
+    ASSERT_TRUE(runner, list->rootExpr->first.test('x'));
+    ASSERT_FALSE(runner, list->rootExpr->nullable);
+
+    const Rule* broken = cg.getRule("<broken>");
+    ASSERT_NULL(runner, broken->rootExpr->children[0]->rule);
+
+    BNFParser p(cg);
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<maybe>", "a", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 1u);
+    delete ast;
+
+    ast = p.parse("<broken>", "b", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 1u);
+    delete ast;
+}
+
+int main() {
+    TestSuite suite("Compiled Grammar Test Suite");
+    suite.addTest("Finalize Links Nodes", test_finalize_links_nodes);
+    suite.addTest("Same AST As Unlinked Grammar", test_compiled_same_ast);
+    suite.addTest("Finalized Grammar Rejects Rules", test_finalized_grammar_rejects_rules);
+    suite.addTest("Shared Compiled Grammar", test_shared_compiled_grammar);
+    suite.addTest("Left Recursion And Gaps", test_finalize_left_recursion_and_gaps);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/Dfa.hpp"
+#include "TestHelpers.hpp"
+#include <algorithm>
+#include <string>
+
+static void buildProtocol(Grammar& g) {
+    buildNickname(g);
+    g.addRule("<space> ::= ' ' { ' ' }");
+    g.addRule("<text> ::= ( 0x21 ... 0x7E ) { ( 0x20 ... 0x7E ) }");
+    g.addRule("<crlf> ::= '\r' '\n'");
+    g.addRule("<message> ::= 'MSG' <space> <nickname> [ <space> ':' <text> ] <crlf>");
+    g.addRule("<pair> ::= 'a' 'b' | 'c' 'b'");
+    // Not regular: recursive, or choices the next byte does not decide
+    g.addRule("<list> ::= '(' { <nickname> | <list> } ')'");
+    g.addRule("<greedy> ::= { 'a' } 'a'");
+    g.addRule("<prefixes> ::= 'a' | 'a' 'b'");
+    g.addRule("<maybe-space> ::= [ ' ' ] ' '");
+}
+
+static bool isRegular(const CompiledGrammar& cg, const char* name) {
+    const std::vector<std::string>& r = cg.getRegularRules();
+    return std::find(r.begin(), r.end(), std::string(name)) != r.end();
+}
+
+void test_regular_rules(TestRunner& runner) {
+    Grammar g;
+    buildProtocol(g);
+    const CompiledGrammar& cg = g.finalize();
+
+    ASSERT_TRUE(runner, isRegular(cg, "<nickname>"));
+    ASSERT_TRUE(runner, isRegular(cg, "<text>"));
+    ASSERT_TRUE(runner, isRegular(cg, "<crlf>"));
+    ASSERT_TRUE(runner, isRegular(cg, "<message>"));
+    ASSERT_FALSE(runner, isRegular(cg, "<list>"));
+    ASSERT_FALSE(runner, isRegular(cg, "<greedy>"));
+    ASSERT_FALSE(runner, isRegular(cg, "<prefixes>"));
+    ASSERT_FALSE(runner, isRegular(cg, "<maybe-space>"));
+    ASSERT_TRUE(runner, g.getRule("<list>")->dfa == 0);
+    ASSERT_NOT_NULL(runner, g.getRule("<message>")->dfa);
+}
+
+void test_match_and_minimize(TestRunner& runner) {
+    Grammar g;
+    buildProtocol(g);
+    g.finalize();
+
+    const Dfa* nick = g.getRule("<nickname>")->dfa;
+    std::string in = "alice bob";
+    ASSERT_EQ(runner, nick->match(in.data(), in.size()), 5u);
+    in = "9lives";
+    ASSERT_EQ(runner, nick->match(in.data(), in.size()), Dfa::NO_MATCH);
+    ASSERT_EQ(runner, nick->match(in.data(), 0), Dfa::NO_MATCH);
+    // Dead, start and one accepting loop
+    ASSERT_EQ(runner, nick->states(), 3u);
+
+    // 'a' and 'c' lead to equivalent states, which minimization merges
+    const Dfa* pair = g.getRule("<pair>")->dfa;
+    ASSERT_EQ(runner, pair->states(), 4u);
+    in = "cbx";
+    ASSERT_EQ(runner, pair->match(in.data(), in.size()), 2u);
+}
+
+void test_same_results(TestRunner& runner) {
+    Grammar g;
+    buildProtocol(g);
+    const CompiledGrammar& cg = g.finalize();
+
+    const char* rules[] = { "<message>", "<nickname>", "<text>", "<list>", "<space>" };
+    const char* inputs[] = { "MSG alice :hello there\r\n", "MSG  bob\r\n", "MSG bob :\r\n",
+                             "MSG x y\r\n", "MSG", "(ann(bo b)c)", "  x", "", "~ok", "9" };
+    for (int e = 0; e < 2; ++e) {
+        BNFParser reference(cg), dfa(cg);
+        reference.setRegularDfa(false);
+        BNFParser::Engine engine = e ? BNFParser::ENGINE_ITERATIVE : BNFParser::ENGINE_RECURSIVE;
+        reference.setEngine(engine);
+        dfa.setEngine(engine);
+        for (size_t r = 0; r < sizeof(rules) / sizeof(rules[0]); ++r) {
+            for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+                size_t c1 = 0, c2 = 0;
+                bool ok1 = reference.recognize(rules[r], inputs[i], c1);
+                bool ok2 = dfa.recognize(rules[r], inputs[i], c2);
+                ASSERT_EQ(runner, ok1, ok2);
+                ASSERT_EQ(runner, c1, c2);
+            }
+        }
+    }
+}
+
+void test_collapse_regular(TestRunner& runner) {
+    Grammar g;
+    buildProtocol(g);
+    BNFParser p(g.finalize());
+    p.setCollapseRegular(true);
+
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<message>", "MSG alice :hi\r\n", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 15u);
+    ASSERT_EQ(runner, ast->symbol, "<message>");
+    ASSERT_TRUE(runner, ast->children.empty());
+    delete ast;
+
+    // Inside a recursive rule, each regular rule becomes one leaf
+    ast = p.parse("<list>", "(ann(bo)c)", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 10u);
+    ASTNode* first = ast->children[1]->children[0]->children[0];
+    ASSERT_EQ(runner, first->symbol, "<nickname>");
+    ASSERT_EQ(runner, first->matched, "ann");
+    ASSERT_TRUE(runner, first->children.empty());
+    delete ast;
+
+    // Without collapsing, parse() keeps the full subtree
+    BNFParser full(g.finalize());
+    ast = full.parse("<message>", "MSG alice :hi\r\n", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_FALSE(runner, ast->children.empty());
+    delete ast;
+}
+
+int main() {
+    TestSuite suite("Regular Rule DFA Test Suite");
+    suite.addTest("Regular Rules", test_regular_rules);
+    suite.addTest("Match And Minimize", test_match_and_minimize);
+    suite.addTest("Same Results", test_same_results);
+    suite.addTest("Collapse Regular", test_collapse_regular);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/DispatchTable.hpp"
+#include "TestHelpers.hpp"
+#include <string>
+#include <sstream>
+
+// One branch per letter, some sharing a first byte, plus a nullable branch
+static void buildTokens(Grammar& g) {
+    g.addRule("<digits> ::= ( '0' ... '9' ) { ( '0' ... '9' ) }");
+    std::ostringstream oss;
+    oss << "<token> ::= ";
+    for (char c = 'a'; c <= 'z'; ++c) {
+        if (c != 'a') oss << " | ";
+        oss << "'" << c << "' <digits>";
+    }
+    oss << " | 'x' 'y' | 'q' ... 'z' | [ '!' ]";
+    g.addRule(oss.str());
+    g.addRule("<stream> ::= <token> { ';' <token> }");
+    g.addRule("<small> ::= 'a' | 'b' | 'c'");
+}
+
+void test_table_lists(TestRunner& runner) {
+    std::bitset<256> ab, b;
+    ab.set('a');
+    ab.set('b');
+    b.set('b');
+    DispatchTable t;
+    t.addBranch(ab, false);
+    t.addBranch(std::bitset<256>(), false);   // null branch
+    t.addBranch(b, false);
+    t.addBranch(std::bitset<256>(), true);    // nullable
+    t.finish();
+
+    ASSERT_EQ(runner, t.branches(), 4u);
+    ASSERT_EQ(runner, t.count('a'), 2u);
+    ASSERT_EQ(runner, t.branch('a', 0), 0u);
+    ASSERT_EQ(runner, t.branch('a', 1), 3u);
+    ASSERT_EQ(runner, t.count('b'), 3u);
+    ASSERT_EQ(runner, t.branch('b', 1), 2u);
+    ASSERT_EQ(runner, t.count('z'), 1u);
+    ASSERT_EQ(runner, t.count(DispatchTable::END_OF_INPUT), 1u);
+    ASSERT_EQ(runner, t.branch(DispatchTable::END_OF_INPUT, 0), 3u);
+    ASSERT_EQ(runner, t.next('b', 1), 2u);
+    ASSERT_EQ(runner, t.next('a', 1), 3u);
+    ASSERT_EQ(runner, t.next('z', 4), 4u);
+}
+
+void test_linked_tables(TestRunner& runner) {
+    Grammar g;
+    buildTokens(g);
+    g.finalize();
+    const Expression* token = g.getRule("<token>")->rootExpr;
+    ASSERT_NOT_NULL(runner, token->dispatch);
+    ASSERT_EQ(runner, token->dispatch->branches(), token->children.size());
+    // 'x' <digits>, 'x' 'y', 'q' ... 'z' and the nullable branch
+    ASSERT_EQ(runner, token->dispatch->count('x'), 4u);
+    ASSERT_EQ(runner, token->dispatch->count('!'), 1u);
+    ASSERT_TRUE(runner, g.getRule("<small>")->rootExpr->dispatch == 0);
+}
+
+void test_same_results(TestRunner& runner) {
+    Grammar lazy;
+    buildTokens(lazy);
+    Grammar linked;
+    buildTokens(linked);
+    const CompiledGrammar& cg = linked.finalize();
+
+    BNFParser reference(lazy);
+    reference.setDispatch(false);
+    BNFParser lazyRec(lazy), linkedRec(cg), lazyIt(lazy), linkedIt(cg);
+    lazyIt.setEngine(BNFParser::ENGINE_ITERATIVE);
+    linkedIt.setEngine(BNFParser::ENGINE_ITERATIVE);
+    BNFParser* parsers[] = { &lazyRec, &linkedRec, &lazyIt, &linkedIt };
+
+    const char* inputs[] = { "a1;b22;xy;x5;q;!;z9", "", "!", "x", "xy;", "m0;n", "7", ";" };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+        size_t c0 = 0;
+        ASTNode* expected = reference.parse("<stream>", inputs[i], c0);
+        for (size_t p = 0; p < 4; ++p) {
+            size_t c = 0, cr = 0;
+            ASTNode* got = parsers[p]->parse("<stream>", inputs[i], c);
+            bool ok = parsers[p]->recognize("<stream>", inputs[i], cr);
+            ASSERT_EQ(runner, c, c0);
+            ASSERT_EQ(runner, cr, c0);
+            ASSERT_EQ(runner, ok, expected != 0);
+            ASSERT_TRUE(runner, sameTree(expected, got));
+            delete got;
+        }
+        delete expected;
+    }
+}
+
+int main() {
+    TestSuite suite("Dispatch Table Test Suite");
+    suite.addTest("Table Lists", test_table_lists);
+    suite.addTest("Linked Tables", test_linked_tables);
+    suite.addTest("Same Results", test_same_results);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
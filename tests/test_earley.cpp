@@ -0,0 +1,275 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/BatchResult.hpp"
+#include "TestHelpers.hpp"
+#include <string>
+#include <vector>
+
+static size_t countLeaves(const ASTNode* node, const std::string& symbol) {
+    if (!node) return 0;
+    size_t n = node->symbol == symbol ? 1 : 0;
+    for (size_t i = 0; i < node->children.size(); ++i)
+        n += countLeaves(node->children[i], symbol);
+    return n;
+}
+
+static void buildArithmetic(Grammar& g) {
+    g.addRule("<expr> ::= <expr> '+' <term> | <expr> '-' <term> | <term>");
+    g.addRule("<term> ::= <term> '*' <factor> | <factor>");
+    g.addRule("<factor> ::= '0' ... '9' | '(' <expr> ')'");
+}
+
+void test_left_recursion(TestRunner& runner) {
+    Grammar g;
+    buildArithmetic(g);
+    BNFParser p(g);
+
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<expr>", "1+2*3-4", consumed, BNFParser::ENGINE_EARLEY);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 7u);
+    ASSERT_EQ(runner, p.getEngine(), BNFParser::ENGINE_RECURSIVE);
+
+    // Left-associative: ((1+2*3)-4)
+    ASSERT_EQ(runner, ast->symbol, "<alt>");
+    const ASTNode* seq = ast->children[0];
+    ASSERT_EQ(runner, seq->symbol, "<seq>");
+    ASSERT_EQ(runner, seq->children.size(), 3u);
+    ASSERT_EQ(runner, seq->children[0]->symbol, "<expr>");
+    ASSERT_EQ(runner, seq->children[0]->matched, "1+2*3");
+    ASSERT_EQ(runner, seq->children[1]->symbol, "-");
+    ASSERT_EQ(runner, seq->children[2]->matched, "4");
+    delete ast;
+
+    bool ok = p.recognize("<expr>", "1+(2+3)*4", consumed, BNFParser::ENGINE_EARLEY);
+    ASSERT_TRUE(runner, ok);
+    ASSERT_EQ(runner, consumed, 9u);
+
+    // The longest prefix is kept; nothing matches at all is a failure
+    ok = p.recognize("<expr>", "1+", consumed, BNFParser::ENGINE_EARLEY);
+    ASSERT_TRUE(runner, ok);
+    ASSERT_EQ(runner, consumed, 1u);
+    ok = p.recognize("<expr>", "+1", consumed, BNFParser::ENGINE_EARLEY);
+    ASSERT_FALSE(runner, ok);
+    ast = p.parse("<expr>", ")", consumed, BNFParser::ENGINE_EARLEY);
+    ASSERT_NULL(runner, ast);
+}
+
+// JSON subset plus empty branches and optionals
+static void buildMixed(Grammar& g) {
+    g.addRule("<value> ::= <object> | <array> | <number> | <string> | 'true' | 'false' | 'null'");
+    g.addRule("<object> ::= '{' <ws> [ <member> { ',' <ws> <member> } ] '}'");
+    g.addRule("<member> ::= <string> <ws> ':' <ws> <value> <ws>");
+    g.addRule("<array> ::= '[' <ws> [ <value> <ws> { ',' <ws> <value> <ws> } ] ']'");
+    g.addRule("<number> ::= [ '-' ] <digit> { <digit> }");
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<string> ::= '\"' { <char> } '\"'");
+    g.addRule("<char> ::= ( 0x20 ... 0x21 0x23 ... 0x7E )");
+    g.addRule("<ws> ::= { ' ' }");
+    g.addRule("<maybe> ::= 'a' | ");
+    g.addRule("<opt> ::= [ 'x' ] | [ 'y' ]");
+    g.addRule("<list> ::= <maybe> <opt> { 'z' }");
+}
+
+void test_same_trees(TestRunner& runner) {
+    Grammar lazy;
+    buildMixed(lazy);
+    Grammar linked;
+    buildMixed(linked);
+    const CompiledGrammar& cg = linked.finalize();
+
+    const char* json[] = { "{\"a\": [1, -20, true], \"b\": {\"c\": null}}", "[]", "{}",
+                           "\"x\"", "-5", "[ [ ], { } ]", "false", "12a", "[1, ]", "" };
+    const char* lists[] = { "a", "", "x", "azzz", "ay", "b", "zz" };
+    BNFParser reference(lazy), lazyEarley(lazy), linkedEarley(cg);
+    lazyEarley.setEngine(BNFParser::ENGINE_EARLEY);
+    linkedEarley.setEngine(BNFParser::ENGINE_EARLEY);
+    BNFParser* parsers[] = { &lazyEarley, &linkedEarley };
+
+    for (int set = 0; set < 2; ++set) {
+        const char* rule = set ? "<list>" : "<value>";
+        const char* const* inputs = set ? lists : json;
+        size_t count = set ? sizeof(lists) / sizeof(lists[0]) : sizeof(json) / sizeof(json[0]);
+        for (size_t i = 0; i < count; ++i) {
+            size_t c0 = 0;
+            ASTNode* expected = reference.parse(rule, inputs[i], c0);
+            for (size_t k = 0; k < 2; ++k) {
+                size_t c = 0;
+                ASTNode* got = parsers[k]->parse(rule, inputs[i], c);
+                ASSERT_EQ(runner, c, c0);
+                ASSERT_TRUE(runner, sameTree(expected, got));
+                delete got;
+            }
+            delete expected;
+        }
+    }
+    ASSERT_GT(runner, linkedEarley.getStats().earleyItems, 0u);
+    ASSERT_EQ(runner, reference.getStats().earleyItems, 0u);
+}
+
+void test_beyond_backtracking(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<word> ::= { 'a' ... 'z' } 'a' ... 'z'");
+    g.addRule("<pair> ::= { 'a' } { 'a' }");
+    BNFParser p(g);
+
+    // The greedy repetition leaves nothing for the last letter
+    size_t consumed = 0;
+    bool ok = p.recognize("<word>", "abc", consumed);
+    ASSERT_FALSE(runner, ok);
+    ASTNode* ast = p.parse("<word>", "abc", consumed, BNFParser::ENGINE_EARLEY);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 3u);
+    ASSERT_EQ(runner, ast->children.size(), 2u);
+    ASSERT_EQ(runner, ast->children[0]->symbol, "<rep>");
+    ASSERT_EQ(runner, ast->children[0]->children.size(), 2u);
+    ASSERT_EQ(runner, ast->children[1]->matched, "c");
+    delete ast;
+
+    // Earlier elements take the longest span
+    ast = p.parse("<pair>", "aaa", consumed, BNFParser::ENGINE_EARLEY);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, ast->children[0]->matched, "aaa");
+    ASSERT_EQ(runner, ast->children[1]->matched, "");
+    delete ast;
+}
+
+void test_ambiguous_grammar(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<s> ::= <s> <s> | 'a'");
+    g.addRule("<x> ::= 'a' <x> | 'a' <x> 'b' | 'a'");
+    BNFParser p(g);
+    p.setEngine(BNFParser::ENGINE_EARLEY);
+
+    // Catalan-many trees, one of them is built
+    std::string as(60, 'a');
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<s>", as, consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 60u);
+    ASSERT_EQ(runner, countLeaves(ast, "a"), 60u);
+    delete ast;
+
+    // Exponential for a backtracking longest match
+    std::string input = std::string(40, 'a') + std::string(20, 'b');
+    ast = p.parse("<x>", input, consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 60u);
+    ASSERT_EQ(runner, countLeaves(ast, "b"), 20u);
+    delete ast;
+}
+
+void test_nullable_and_cyclic(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<c> ::= <c> | 'a'");
+    g.addRule("<o> ::= [ <o> ]");
+    g.addRule("<n> ::= { [ 'a' ] } 'b'");
+    g.addRule("<u> ::= <v> | 'u'");
+    g.addRule("<v> ::= <u> [ 'v' ]");
+    BNFParser p(g);
+    p.setEngine(BNFParser::ENGINE_EARLEY);
+
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<c>", "a", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 1u);
+    ASSERT_EQ(runner, countLeaves(ast, "a"), 1u);
+    delete ast;
+
+    ast = p.parse("<o>", "", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 0u);
+    ASSERT_EQ(runner, ast->symbol, "<opt>");
+    delete ast;
+
+    // Iterations are never empty
+    ast = p.parse("<n>", "aab", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 3u);
+    ASSERT_EQ(runner, ast->children[0]->children.size(), 2u);
+    delete ast;
+
+    ast = p.parse("<u>", "uvv", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 3u);
+    ASSERT_EQ(runner, countLeaves(ast, "v"), 2u);
+    delete ast;
+}
+
+void test_node_storage(TestRunner& runner) {
+    Grammar g;
+    buildArithmetic(g);
+    BNFParser p(g.finalize());
+    p.setEngine(BNFParser::ENGINE_EARLEY);
+    std::string input = "2*(3+4)";
+
+    Arena arena(4096);
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<expr>", input, consumed, arena);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_TRUE(runner, ast->pooled);
+    ASSERT_EQ(runner, ast->matched, input);
+    arena.reset();
+
+    p.setZeroCopy(true);
+    ast = p.parse("<expr>", input, consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_TRUE(runner, ast->matched.empty());
+    ASSERT_EQ(runner, ast->text(), input);
+    delete ast;
+
+    std::vector<std::string> inputs;
+    inputs.push_back("1+1");
+    inputs.push_back("+");
+    inputs.push_back("(9)*8-7");
+    BatchResult out;
+    size_t accepted = p.parseBatch("<expr>", inputs, out);
+    ASSERT_EQ(runner, accepted, 2u);
+    ASSERT_TRUE(runner, out.entries[0].ok);
+    ASSERT_FALSE(runner, out.entries[1].ok);
+    ASSERT_EQ(runner, out.entries[2].consumed, 7u);
+}
+
+void test_linear_chart(TestRunner& runner) {
+    Grammar g;
+    buildArithmetic(g);
+    BNFParser p(g.finalize());
+    p.setEngine(BNFParser::ENGINE_EARLEY);
+
+    // Items per byte stay flat on an unambiguous left-recursive grammar
+    std::string small = "1", large = "1";
+    for (int i = 0; i < 1000; ++i) small += "+2*3";
+    for (int i = 0; i < 4000; ++i) large += "+2*3";
+
+    size_t consumed = 0;
+    bool ok = p.recognize("<expr>", small, consumed);
+    ASSERT_TRUE(runner, ok);
+    size_t smallItems = p.getStats().earleyItems;
+    p.resetStats();
+    ok = p.recognize("<expr>", large, consumed);
+    ASSERT_TRUE(runner, ok);
+    ASSERT_EQ(runner, consumed, large.size());
+    size_t largeItems = p.getStats().earleyItems;
+    ASSERT_LT(runner, largeItems, smallItems * 4 + smallItems / 10);
+    ASSERT_GT(runner, largeItems, smallItems * 4 - smallItems / 10);
+
+    ASTNode* ast = p.parse("<expr>", large, consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, countLeaves(ast, "*"), 4000u);
+    delete ast;
+}
+
+int main() {
+    TestSuite suite("Earley Engine Test Suite");
+    suite.addTest("Left Recursion", test_left_recursion);
+    suite.addTest("Same Trees", test_same_trees);
+    suite.addTest("Beyond Backtracking", test_beyond_backtracking);
+    suite.addTest("Ambiguous Grammar", test_ambiguous_grammar);
+    suite.addTest("Nullable And Cyclic", test_nullable_and_cyclic);
+    suite.addTest("Node Storage", test_node_storage);
+    suite.addTest("Linear Chart", test_linear_chart);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
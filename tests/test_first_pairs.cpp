@@ -0,0 +1,142 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/FirstPairs.hpp"
+#include "../include/ParseSession.hpp"
+#include "TestHelpers.hpp"
+#include <string>
+
+// Commands sharing their first letter, so only the second byte tells them apart
+static void buildCommands(Grammar& g) {
+    g.addRule("<space> ::= ' ' { ' ' }");
+    g.addRule("<word> ::= ( 'a' ... 'z' ) { ( 'a' ... 'z' ) }");
+    g.addRule("<nick> ::= 'NICK' <space> <word>");
+    g.addRule("<notice> ::= 'NOTICE' <space> <word> <space> <word>");
+    g.addRule("<names> ::= 'NAMES' [ <space> <word> ]");
+    g.addRule("<command> ::= <nick> | <notice> | <names> | 'N'");
+    g.addRule("<line> ::= <command> '\r' '\n'");
+    g.addRule("<rep> ::= { 'a' | 'bc' }");
+    g.addRule("<paren> ::= '(' <paren> ')' | 'x'");
+}
+
+void test_pair_analysis(TestRunner& runner) {
+    Grammar g;
+    buildCommands(g);
+    FirstPairs fp(g);
+
+    const FirstPairs::Info& nick = fp.of(g.getRule("<nick>")->rootExpr);
+    ASSERT_TRUE(runner, nick.pairs.test('N', 'I'));
+    ASSERT_FALSE(runner, nick.pairs.test('N', 'O'));
+    ASSERT_FALSE(runner, nick.nullable);
+    ASSERT_TRUE(runner, nick.singles.none());
+
+    const FirstPairs::Info& command = fp.of(g.getRule("<command>")->rootExpr);
+    ASSERT_TRUE(runner, command.pairs.test('N', 'O'));
+    ASSERT_TRUE(runner, command.pairs.test('N', 'A'));
+    ASSERT_TRUE(runner, command.singles.test('N'));
+
+    // Two iterations of the body give the pairs that span iterations
+    const FirstPairs::Info& rep = fp.of(g.getRule("<rep>")->rootExpr);
+    ASSERT_TRUE(runner, rep.nullable);
+    ASSERT_TRUE(runner, rep.singles.test('a'));
+    ASSERT_TRUE(runner, rep.pairs.test('a', 'a'));
+    ASSERT_TRUE(runner, rep.pairs.test('a', 'b'));
+    ASSERT_TRUE(runner, rep.pairs.test('b', 'c'));
+    ASSERT_FALSE(runner, rep.pairs.test('b', 'a'));
+
+    // Recursive rules reach a fixpoint
+    const FirstPairs::Info& paren = fp.of(g.getRule("<paren>")->rootExpr);
+    ASSERT_TRUE(runner, paren.pairs.test('(', '('));
+    ASSERT_TRUE(runner, paren.pairs.test('(', 'x'));
+    ASSERT_FALSE(runner, paren.pairs.test('(', ')'));
+    ASSERT_TRUE(runner, paren.singles.test('x'));
+    unsigned char i = 'I';
+    ASSERT_TRUE(runner, nick.admits('N', &i));
+    ASSERT_FALSE(runner, nick.admits('N', 0));
+}
+
+void test_prune_counter(TestRunner& runner) {
+    Grammar g;
+    buildCommands(g);
+    BNFParser p(g.finalize());
+    p.setFirstPairs(true);
+
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<line>", "NOTICE bob hi\r\n", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 15u);
+    // <nick> and <names> start with 'N' but not with "NO"; 'N' is one byte
+    ASSERT_EQ(runner, p.getStats().pairPrunes, 2u);
+    delete ast;
+
+    // "N" alone: only the one-byte branch fits
+    p.resetStats();
+    ASSERT_TRUE(runner, p.recognize("<command>", "N", consumed));
+    ASSERT_EQ(runner, consumed, 1u);
+    ASSERT_EQ(runner, p.getStats().pairPrunes, 3u);
+}
+
+void test_same_results(TestRunner& runner) {
+    Grammar lazy;
+    buildCommands(lazy);
+    Grammar linked;
+    buildCommands(linked);
+    const CompiledGrammar& cg = linked.finalize();
+
+    BNFParser reference(lazy);
+    BNFParser lazyRec(lazy), linkedRec(cg), lazyIt(lazy), linkedIt(cg);
+    lazyIt.setEngine(BNFParser::ENGINE_ITERATIVE);
+    linkedIt.setEngine(BNFParser::ENGINE_ITERATIVE);
+    BNFParser* parsers[] = { &lazyRec, &linkedRec, &lazyIt, &linkedIt };
+    for (size_t p = 0; p < 4; ++p) parsers[p]->setFirstPairs(true);
+
+    const char* rules[] = { "<line>", "<command>", "<rep>", "<paren>" };
+    const char* inputs[] = { "NICK bob\r\n", "NOTICE bob hi\r\n", "NAMES\r\n", "NAMES x\r\n",
+                             "N\r\n", "N", "NO", "abcaa", "((x))", "(", "", "x" };
+    for (size_t r = 0; r < 4; ++r) {
+        for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+            size_t c0 = 0;
+            ASTNode* expected = reference.parse(rules[r], inputs[i], c0);
+            for (size_t p = 0; p < 4; ++p) {
+                size_t c = 0, cr = 0;
+                ASTNode* got = parsers[p]->parse(rules[r], inputs[i], c);
+                bool ok = parsers[p]->recognize(rules[r], inputs[i], cr);
+                ASSERT_EQ(runner, c, c0);
+                ASSERT_EQ(runner, cr, c0);
+                ASSERT_EQ(runner, ok, expected != 0);
+                ASSERT_TRUE(runner, sameTree(expected, got));
+                delete got;
+            }
+            delete expected;
+        }
+    }
+}
+
+void test_streamed_pairs(TestRunner& runner) {
+    Grammar g;
+    buildCommands(g);
+    BNFParser p(g.finalize());
+    p.setFirstPairs(true);
+
+    // With only "N" buffered, no branch may be pruned on its second byte
+    ParseSession session(p, "<line>");
+    ParseSession::Status st = session.feed("N");
+    ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+    st = session.feed("ICK bob\r\n");
+    ASSERT_EQ(runner, st, ParseSession::COMPLETE);
+    ASTNode* ast = session.takeResult();
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, ast->matched, "NICK bob\r\n");
+    delete ast;
+}
+
+int main() {
+    TestSuite suite("FIRST_2 Test Suite");
+    suite.addTest("Pair Analysis", test_pair_analysis);
+    suite.addTest("Prune Counter", test_prune_counter);
+    suite.addTest("Same Results", test_same_results);
+    suite.addTest("Streamed Pairs", test_streamed_pairs);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "TestHelpers.hpp"
+#include <string>
+
+// Parse every input with both engines and compare consumed length and AST
+static void compareEngines(TestRunner& runner, const Grammar& g, const char* rule,
+                           const char* const* inputs, size_t count) {
+    BNFParser rec(g);
+    BNFParser it(g);
+    it.setEngine(BNFParser::ENGINE_ITERATIVE);
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t c1 = 0, c2 = 0;
+        ASTNode* a = rec.parse(rule, inputs[i], c1);
+        ASTNode* b = it.parse(rule, inputs[i], c2);
+        ASSERT_EQ(runner, c1, c2);
+        ASSERT_TRUE(runner, sameTree(a, b));
+        delete a;
+        delete b;
+    }
+}
+
+void test_iterative_matches_recursive(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<letter> ::= 'a' ... 'z' | 'A' ... 'Z'");
+    g.addRule("<digit> ::= ( '0' ... '9' )");
+    g.addRule("<nick-char> ::= <letter> | <digit> | '_' | '-'");
+    g.addRule("<nickname> ::= <letter> { <nick-char> }");
+    g.addRule("<space> ::= ' ' { ' ' }");
+    g.addRule("<message> ::= 'MSG' <space> <nickname> [ <space> ':' { <letter> | ' ' } ] '\r' '\n'");
+
+    const char* inputs[] = {
+        "MSG alice :Hello there\r\n",
+        "MSG bob_1\r\n",
+        "MSG  x :\r\n",
+        "MSG 9bad\r\n",
+        "MSG",
+        ""
+    };
+    compareEngines(runner, g, "<message>", inputs, sizeof(inputs) / sizeof(inputs[0]));
+}
+
+void test_iterative_empty_alternatives(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<maybe> ::= 'a' | ");
+    g.addRule("<opt> ::= [ 'x' ] | [ 'y' ]");
+    g.addRule("<list> ::= <maybe> <opt> { 'z' }");
+
+    const char* inputs[] = { "a", "", "x", "azzz", "ay", "b" };
+    compareEngines(runner, g, "<list>", inputs, sizeof(inputs) / sizeof(inputs[0]));
+    compareEngines(runner, g, "<maybe>", inputs, sizeof(inputs) / sizeof(inputs[0]));
+    compareEngines(runner, g, "<opt>", inputs, sizeof(inputs) / sizeof(inputs[0]));
+}
+
+void test_iterative_with_memoization(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<letter> ::= 'a' ... 'z'");
+    g.addRule("<word> ::= <letter> { <letter> }");
+    g.addRule("<cmd> ::= <word> ':' | <word> ';' | <word> '!' | <word>");
+
+    BNFParser rec(g);
+    BNFParser it(g);
+    it.setEngine(BNFParser::ENGINE_ITERATIVE);
+    it.setMemoization(true);
+
+    size_t c1 = 0, c2 = 0;
+    ASTNode* a = rec.parse("<cmd>", "hello!", c1);
+    ASTNode* b = it.parse("<cmd>", "hello!", c2);
+    ASSERT_EQ(runner, c2, 6u);
+    ASSERT_TRUE(runner, sameTree(a, b));
+    ASSERT_GE(runner, it.getStats().memoHits, 2u);
+    delete a;
+    delete b;
+}
+
+void test_iterative_deep_nesting(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<nest> ::= '(' <nest> ')' | 'x'");
+
+    const size_t depth = 20000;
+    std::string input(depth, '(');
+    input += 'x';
+    input += std::string(depth, ')');
+
+    BNFParser p(g.finalize());
+    p.setEngine(BNFParser::ENGINE_ITERATIVE);
+
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<nest>", input, consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, input.size());
+    ASSERT_GT(runner, p.getStats().peakDepth, depth);
+    delete ast;
+}
+
+void test_iterative_deep_nesting_memoized(TestRunner& runner) {
+    Grammar g;
+    // Every level fails its first branch and gets <nest> from the memo
+    // for the second; the innermost list grows from a seed
+    g.addRule("<nest> ::= '(' <nest> ')' '+' | '(' <nest> ')' | <list>");
+    g.addRule("<list> ::= <list> ',' 'x' | 'x'");
+
+    const size_t depth = 200000;
+    std::string input(depth, '(');
+    input += "x,x,x";
+    input += std::string(depth, ')');
+
+    // Zero-copy, since nested nodes copying their text would be quadratic
+    BNFParser p(g.finalize());
+    p.setEngine(BNFParser::ENGINE_ITERATIVE);
+    p.setMemoization(true);
+    p.setZeroCopy(true);
+
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<nest>", input, consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, input.size());
+    ASSERT_GE(runner, p.getStats().memoHits, depth);
+    ASSERT_GT(runner, p.getStats().seedGrowths, 0u);
+    delete ast;
+}
+
+void test_iterative_depth_limit(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<nest> ::= '(' <nest> ')' | 'x'");
+
+    BNFParser p(g);
+    p.setEngine(BNFParser::ENGINE_ITERATIVE);
+    p.setMaxDepth(50);
+
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<nest>", "((x))", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_LE(runner, p.getStats().peakDepth, 50u);
+    delete ast;
+
+    std::string deep(100, '(');
+    deep += 'x';
+    deep += std::string(100, ')');
+    ast = p.parse("<nest>", deep, consumed);
+    ASSERT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 0u);
+    ASSERT_EQ(runner, p.getStats().depthAborts, 1u);
+}
+
+int main() {
+    TestSuite suite("Iterative Engine Test Suite");
+    suite.addTest("Matches Recursive Engine", test_iterative_matches_recursive);
+    suite.addTest("Empty Alternatives", test_iterative_empty_alternatives);
+    suite.addTest("With Memoization", test_iterative_with_memoization);
+    suite.addTest("Deep Nesting", test_iterative_deep_nesting);
+    suite.addTest("Deep Nesting With Memoization", test_iterative_deep_nesting_memoized);
+    suite.addTest("Depth Limit", test_iterative_depth_limit);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/KeywordTrie.hpp"
+#include "../include/ParseSession.hpp"
+#include "TestHelpers.hpp"
+#include <string>
+
+// Keywords that are prefixes of each other, a duplicate and a mixed alternative
+static void buildCommands(Grammar& g) {
+    g.addRule("<command> ::= 'PRIV' | 'PRIVMSG' | 'NOTICE' | 'NICK' | 'JOIN'"
+              " | 'PRIVMSG' | 'PART' | 'PING' | 'PONG' | \"QUIT\"");
+    g.addRule("<word> ::= ( 'a' ... 'z' ) { ( 'a' ... 'z' ) }");
+    g.addRule("<mixed> ::= 'PING' | 'PONG' | 'PART' | <word>");
+    g.addRule("<line> ::= <command> { ' ' <word> } '\r' '\n'");
+}
+
+void test_longest_match(TestRunner& runner) {
+    KeywordTrie t;
+    t.addKeyword("PRIV", 0);
+    t.addKeyword("PRIVMSG", 1);
+    t.addKeyword("PING", 2);
+    t.addKeyword("PRIVMSG", 3);
+    t.addKeyword("", 4);
+    t.finish();
+    ASSERT_EQ(runner, t.keywords(), 3u);
+
+    size_t branch = 0;
+    std::string in = "PRIVMSG #chan";
+    size_t len = t.longest(in.data(), in.size(), branch);
+    ASSERT_EQ(runner, len, 7u);
+    ASSERT_EQ(runner, branch, 1u);
+
+    // A longer keyword cut short falls back to the longest full one
+    in = "PRIVMS";
+    len = t.longest(in.data(), in.size(), branch);
+    ASSERT_EQ(runner, len, 4u);
+    ASSERT_EQ(runner, branch, 0u);
+
+    in = "PIN";
+    len = t.longest(in.data(), in.size(), branch);
+    ASSERT_EQ(runner, len, 0u);
+    ASSERT_EQ(runner, branch, KeywordTrie::NO_BRANCH);
+    len = t.longest(in.data(), 0, branch);
+    ASSERT_EQ(runner, len, 0u);
+}
+
+void test_linked_tries(TestRunner& runner) {
+    Grammar g;
+    buildCommands(g);
+    g.finalize();
+    const Expression* command = g.getRule("<command>")->rootExpr;
+    ASSERT_NOT_NULL(runner, command->keywords);
+    ASSERT_EQ(runner, command->keywords->keywords(), 9u);
+    ASSERT_TRUE(runner, g.getRule("<mixed>")->rootExpr->keywords == 0);
+}
+
+void test_same_results(TestRunner& runner) {
+    Grammar lazy;
+    buildCommands(lazy);
+    Grammar linked;
+    buildCommands(linked);
+    const CompiledGrammar& cg = linked.finalize();
+
+    BNFParser reference(lazy);
+    reference.setKeywordTries(false);
+    BNFParser lazyRec(lazy), linkedRec(cg), lazyIt(lazy), linkedIt(cg);
+    lazyIt.setEngine(BNFParser::ENGINE_ITERATIVE);
+    linkedIt.setEngine(BNFParser::ENGINE_ITERATIVE);
+    BNFParser* parsers[] = { &lazyRec, &linkedRec, &lazyIt, &linkedIt };
+
+    const char* rules[] = { "<command>", "<line>", "<mixed>" };
+    const char* inputs[] = { "PRIVMSG alice hi\r\n", "PRIV bob\r\n", "PRIVMS x\r\n",
+                             "QUIT\r\n", "PONG", "PAR", "part", "", "NICKNAME" };
+    for (size_t r = 0; r < 3; ++r) {
+        for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+            size_t c0 = 0;
+            ASTNode* expected = reference.parse(rules[r], inputs[i], c0);
+            for (size_t p = 0; p < 4; ++p) {
+                size_t c = 0, cr = 0;
+                ASTNode* got = parsers[p]->parse(rules[r], inputs[i], c);
+                bool ok = parsers[p]->recognize(rules[r], inputs[i], cr);
+                ASSERT_EQ(runner, c, c0);
+                ASSERT_EQ(runner, cr, c0);
+                ASSERT_EQ(runner, ok, expected != 0);
+                ASSERT_TRUE(runner, sameTree(expected, got));
+                delete got;
+            }
+            delete expected;
+        }
+    }
+}
+
+void test_streamed_keyword(TestRunner& runner) {
+    Grammar g;
+    buildCommands(g);
+    BNFParser p(g.finalize());
+
+    // "PRIV" is complete but "PRIVMSG" may still follow the chunk boundary
+    ParseSession session(p, "<line>");
+    ParseSession::Status st = session.feed("PRIV");
+    ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+    st = session.feed("MSG alice\r\n");
+    ASSERT_EQ(runner, st, ParseSession::COMPLETE);
+    ASTNode* ast = session.takeResult();
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, ast->children[0]->matched, "PRIVMSG");
+    delete ast;
+}
+
+int main() {
+    TestSuite suite("Keyword Trie Test Suite");
+    suite.addTest("Longest Match", test_longest_match);
+    suite.addTest("Linked Tries", test_linked_tries);
+    suite.addTest("Same Results", test_same_results);
+    suite.addTest("Streamed Keyword", test_streamed_keyword);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
@@ -0,0 +1,296 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/BatchResult.hpp"
+#include "../include/LalrTable.hpp"
+#include "TestHelpers.hpp"
+#include <sstream>
+#include <string>
+#include <vector>
+
+static void buildJson(Grammar& g) {
+    g.addRule("<value> ::= <object> | <array> | <number> | <string> | 'true' | 'false' | 'null'");
+    g.addRule("<object> ::= '{' <ws> [ <member> { ',' <ws> <member> } ] '}'");
+    g.addRule("<member> ::= <string> <ws> ':' <ws> <value> <ws>");
+    g.addRule("<array> ::= '[' <ws> [ <value> <ws> { ',' <ws> <value> <ws> } ] ']'");
+    g.addRule("<number> ::= [ '-' ] <digit> { <digit> }");
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<string> ::= '\"' { <char> } '\"'");
+    g.addRule("<char> ::= ( 0x20 ... 0x21 0x23 ... 0x7E )");
+    g.addRule("<ws> ::= { ' ' }");
+}
+
+static void buildArithmetic(Grammar& g) {
+    g.addRule("<expr> ::= <expr> '+' <term> | <expr> '-' <term> | <term>");
+    g.addRule("<term> ::= <term> '*' <factor> | <factor>");
+    g.addRule("<factor> ::= '0' ... '9' | '(' <expr> ')'");
+}
+
+void test_same_trees(TestRunner& runner) {
+    Grammar lazy;
+    buildJson(lazy);
+    Grammar linked;
+    buildJson(linked);
+    const CompiledGrammar& cg = linked.finalize();
+
+    LalrTable table(lazy);
+    ASSERT_TRUE(runner, table.isLALR1());
+
+    const char* inputs[] = { "{\"a\": [1, -20, true], \"b\": {\"c\": null}}", "[]", "{}",
+                             "\"x\"", "-5", "[ [ ], { } ]", "false", "12a", "[1, ]", "",
+                             "{\"k\": \"v\"} trailing", "tru" };
+    BNFParser reference(lazy), lazyLalr(lazy), linkedLalr(cg);
+    lazyLalr.setEngine(BNFParser::ENGINE_LALR);
+    linkedLalr.setEngine(BNFParser::ENGINE_LALR);
+    BNFParser* parsers[] = { &lazyLalr, &linkedLalr };
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+        size_t c0 = 0;
+        ASTNode* expected = reference.parse("<value>", inputs[i], c0);
+        for (size_t k = 0; k < 2; ++k) {
+            size_t c = 0;
+            ASTNode* got = parsers[k]->parse("<value>", inputs[i], c);
+            ASSERT_EQ(runner, c, c0);
+            ASSERT_TRUE(runner, sameTree(expected, got));
+            delete got;
+
+            size_t r = 0;
+            bool ok = parsers[k]->recognize("<value>", inputs[i], r);
+            ASSERT_EQ(runner, ok, expected != 0);
+            ASSERT_EQ(runner, r, c0);
+        }
+        delete expected;
+    }
+    ASSERT_GT(runner, linkedLalr.getStats().reductions, 0u);
+    ASSERT_EQ(runner, reference.getStats().reductions, 0u);
+}
+
+void test_left_recursion(TestRunner& runner) {
+    Grammar g;
+    buildArithmetic(g);
+    LalrTable table(g);
+    ASSERT_TRUE(runner, table.isLALR1());
+    BNFParser p(g);
+
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<expr>", "1+2*3-4", consumed, BNFParser::ENGINE_LALR);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 7u);
+    ASSERT_EQ(runner, p.getEngine(), BNFParser::ENGINE_RECURSIVE);
+
+    // Left-associative: ((1+2*3)-4), the same tree as the Earley engine
+    ASSERT_EQ(runner, ast->symbol, "<alt>");
+    const ASTNode* seq = ast->children[0];
+    ASSERT_EQ(runner, seq->symbol, "<seq>");
+    ASSERT_EQ(runner, seq->children.size(), 3u);
+    ASSERT_EQ(runner, seq->children[0]->matched, "1+2*3");
+    ASSERT_EQ(runner, seq->children[1]->symbol, "-");
+    ASSERT_EQ(runner, seq->children[2]->matched, "4");
+    ASTNode* earley = p.parse("<expr>", "1+2*3-4", consumed, BNFParser::ENGINE_EARLEY);
+    ASSERT_TRUE(runner, sameTree(ast, earley));
+    delete earley;
+    delete ast;
+
+    // The prefix before the first byte that cannot continue is accepted,
+    // but a match that stops early is not searched for
+    bool ok = p.recognize("<expr>", "(1+2)*3)", consumed, BNFParser::ENGINE_LALR);
+    ASSERT_TRUE(runner, ok);
+    ASSERT_EQ(runner, consumed, 7u);
+    ok = p.recognize("<expr>", "1+", consumed, BNFParser::ENGINE_LALR);
+    ASSERT_FALSE(runner, ok);
+    ok = p.recognize("<expr>", "1+", consumed, BNFParser::ENGINE_EARLEY);
+    ASSERT_TRUE(runner, ok);
+    ASSERT_EQ(runner, consumed, 1u);
+    ast = p.parse("<expr>", ")", consumed, BNFParser::ENGINE_LALR);
+    ASSERT_NULL(runner, ast);
+}
+
+void test_conflict_report(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<integer> ::= [ '-' ] <digit> { <digit> }");
+    g.addRule("<hex> ::= '0' 'x' <digit> { <digit> }");
+    g.addRule("<number> ::= <hex> | <integer>");
+    g.addRule("<stmt> ::= 'i' <stmt> [ 'e' <stmt> ] | 's'");
+    g.addRule("<pair> ::= <p> 'z' | <q> 'z'");
+    g.addRule("<p> ::= 'a'");
+    g.addRule("<q> ::= 'a'");
+    LalrTable table(g);
+    ASSERT_FALSE(runner, table.isLALR1());
+    ASSERT_EQ(runner, table.getConflicts().size(), 3u);
+
+    std::ostringstream out;
+    table.report(out);
+    std::string str = out.str();
+    ASSERT_CONTAINS(runner, str, "LALR(1): ");
+    ASSERT_CONTAINS(runner, str, "3 conflicts");
+    ASSERT_CONTAINS(runner, str, "<integer>: optional: shift/reduce conflict on '0'");
+    ASSERT_CONTAINS(runner, str, "<stmt>: optional: shift/reduce conflict on 'e'");
+    ASSERT_CONTAINS(runner, str, "<q>: rule: reduce/reduce conflict on 'z'");
+
+    BNFParser p(g);
+    p.setEngine(BNFParser::ENGINE_LALR);
+    size_t consumed = 0;
+
+    // Shift wins: the else binds to the nearest if
+    ASTNode* ast = p.parse("<stmt>", "iises", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 5u);
+    const ASTNode* outer = ast->children[0];
+    ASSERT_EQ(runner, outer->children[2]->matched, "");
+    ASSERT_EQ(runner, outer->children[1]->matched, "ises");
+    delete ast;
+
+    // Shift wins: a leading 0 is read as the start of a hex number
+    bool ok = p.recognize("<number>", "0x12", consumed);
+    ASSERT_TRUE(runner, ok);
+    ASSERT_EQ(runner, consumed, 4u);
+    ok = p.recognize("<number>", "07", consumed);
+    ASSERT_FALSE(runner, ok);
+    ok = p.recognize("<number>", "-07", consumed);
+    ASSERT_TRUE(runner, ok);
+
+    // The earlier production wins: <p>, never <q>
+    ast = p.parse("<pair>", "az", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, ast->children[0]->children[0]->symbol, "<p>");
+    delete ast;
+
+    Grammar json;
+    buildJson(json);
+    LalrTable clean(json);
+    std::ostringstream cleanOut;
+    clean.report(cleanOut);
+    str = cleanOut.str();
+    ASSERT_CONTAINS(runner, str, "0 conflicts");
+    ASSERT_GT(runner, clean.stateCount(), 0u);
+    ASSERT_LT(runner, clean.byteClasses(), 256u);
+}
+
+void test_missing_parts(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<bad> ::= <missing> 'a' | 'b'");
+    g.addRule("<empty> ::= ''");
+    BNFParser p(g);
+    p.setEngine(BNFParser::ENGINE_LALR);
+
+    size_t consumed = 0;
+    bool ok = p.recognize("<bad>", "a", consumed);
+    ASSERT_FALSE(runner, ok);
+    ok = p.recognize("<bad>", "b", consumed);
+    ASSERT_TRUE(runner, ok);
+    ASSERT_EQ(runner, consumed, 1u);
+    ok = p.recognize("<empty>", "", consumed);
+    ASSERT_FALSE(runner, ok);
+}
+
+void test_reduction_loops(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<h> ::= { <h> 'b' } | 'a'");
+    g.addRule("<c> ::= <c> | 'a'");
+    BNFParser p(g);
+    p.setEngine(BNFParser::ENGINE_LALR);
+
+    // Hidden left recursion: the resolved tables nest empty <h> forever on
+    // 'b'; the run of reductions is cut off and the parse fails
+    size_t consumed = 0;
+    bool ok = p.recognize("<h>", "bb", consumed);
+    ASSERT_FALSE(runner, ok);
+    ok = p.recognize("<h>", "a", consumed);
+    ASSERT_TRUE(runner, ok);
+    ASSERT_EQ(runner, consumed, 1u);
+
+    // A cycle: <c> derives itself
+    ASTNode* ast = p.parse("<c>", "a", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 1u);
+    delete ast;
+    ok = p.recognize("<c>", "", consumed);
+    ASSERT_FALSE(runner, ok);
+}
+
+void test_node_storage(TestRunner& runner) {
+    Grammar g;
+    buildJson(g);
+    BNFParser p(g.finalize());
+    p.setEngine(BNFParser::ENGINE_LALR);
+    std::string in = "[1, 22, 333]";
+
+    size_t consumed = 0;
+    ASTNode* expected = p.parse("<value>", in, consumed, BNFParser::ENGINE_RECURSIVE);
+    ASSERT_NOT_NULL(runner, expected);
+
+    Arena arena(4096);
+    ASTNode* pooled = p.parse("<value>", in, consumed, arena);
+    ASSERT_TRUE(runner, sameTree(expected, pooled));
+    arena.reset();
+
+    // Zero-copy spans, including those of repetitions closed late
+    p.setZeroCopy(true);
+    ASTNode* spans = p.parse("<value>", in, consumed);
+    ASSERT_NOT_NULL(runner, spans);
+    ASSERT_EQ(runner, spans->text(), in);
+    const ASTNode* array = spans->children[0]->children[0];
+    ASSERT_EQ(runner, array->symbol, "<seq>");
+    const ASTNode* rest = array->children[2]->children[0]->children[2];
+    ASSERT_EQ(runner, rest->symbol, "<rep>");
+    ASSERT_EQ(runner, rest->text(), ", 22, 333");
+    ASSERT_EQ(runner, rest->children.size(), 2u);
+    delete spans;
+    p.setZeroCopy(false);
+    delete expected;
+
+    std::vector<std::string> inputs;
+    inputs.push_back("[1]");
+    inputs.push_back("]");
+    inputs.push_back("{\"a\": 1}x");
+    BatchResult out;
+    size_t accepted = p.parseBatch("<value>", inputs, out);
+    ASSERT_EQ(runner, accepted, 2u);
+    ASSERT_TRUE(runner, out.entries[0].ok);
+    ASSERT_FALSE(runner, out.entries[1].ok);
+    ASSERT_EQ(runner, out.entries[2].consumed, 8u);
+}
+
+void test_linear_work(TestRunner& runner) {
+    Grammar g;
+    buildArithmetic(g);
+    BNFParser p(g.finalize());
+    p.setEngine(BNFParser::ENGINE_LALR);
+
+    // Reductions grow linearly with the input
+    std::string small = "1", large = "1";
+    for (int i = 0; i < 1000; ++i) small += "+2*3";
+    for (int i = 0; i < 4000; ++i) large += "+2*3";
+    size_t consumed = 0;
+    bool ok = p.recognize("<expr>", small, consumed);
+    ASSERT_TRUE(runner, ok);
+    size_t smallWork = p.getStats().reductions;
+    p.resetStats();
+    ok = p.recognize("<expr>", large, consumed);
+    ASSERT_TRUE(runner, ok);
+    ASSERT_EQ(runner, consumed, large.size());
+    size_t largeWork = p.getStats().reductions;
+    ASSERT_LT(runner, largeWork, smallWork * 4 + smallWork / 10);
+    ASSERT_GT(runner, largeWork, smallWork * 4 - smallWork / 10);
+
+    // Deep nesting lives on the heap stack, not the call stack
+    std::string deep = std::string(100000, '(') + "7" + std::string(100000, ')');
+    ok = p.recognize("<expr>", deep, consumed);
+    ASSERT_TRUE(runner, ok);
+    ASSERT_EQ(runner, consumed, deep.size());
+}
+
+int main() {
+    TestSuite suite("LALR(1) Engine Test Suite");
+    suite.addTest("Same Trees", test_same_trees);
+    suite.addTest("Left Recursion", test_left_recursion);
+    suite.addTest("Conflict Report", test_conflict_report);
+    suite.addTest("Missing Parts", test_missing_parts);
+    suite.addTest("Reduction Loops", test_reduction_loops);
+    suite.addTest("Node Storage", test_node_storage);
+    suite.addTest("Linear Work", test_linear_work);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
@@ -0,0 +1,282 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/BatchResult.hpp"
+#include "../include/FirstSets.hpp"
+#include "../include/ParseSession.hpp"
+#include "TestHelpers.hpp"
+#include <string>
+#include <vector>
+
+static void buildArithmetic(Grammar& g) {
+    g.addRule("<expr> ::= <expr> '+' <term> | <expr> '-' <term> | <term>");
+    g.addRule("<term> ::= <term> '*' <factor> | <factor>");
+    g.addRule("<factor> ::= '0' ... '9' | '(' <expr> ')'");
+}
+
+// Indirect, hidden and nested left recursion next to ordinary rules
+static void buildMixed(Grammar& g) {
+    g.addRule("<a> ::= <b> 'x' | 'a'");
+    g.addRule("<b> ::= <a> 'y'");
+    g.addRule("<h> ::= [ 'p' ] <h> 'q' | 'h'");
+    g.addRule("<list> ::= <list> ',' <item> | <item>");
+    g.addRule("<item> ::= <word> | '[' <list> ']'");
+    g.addRule("<word> ::= ( 'a' ... 'z' ) { ( 'a' ... 'z' ) }");
+}
+
+void test_detection(TestRunner& runner) {
+    Grammar lazy;
+    buildMixed(lazy);
+    FirstSets first(lazy);
+    ASSERT_TRUE(runner, first.leftRecursive(lazy.getRule("<a>")));
+    ASSERT_TRUE(runner, first.leftRecursive(lazy.getRule("<b>")));
+    ASSERT_TRUE(runner, first.leftRecursive(lazy.getRule("<h>")));
+    ASSERT_TRUE(runner, first.leftRecursive(lazy.getRule("<list>")));
+    // <item> reaches <list> only after '['
+    ASSERT_FALSE(runner, first.leftRecursive(lazy.getRule("<item>")));
+    ASSERT_FALSE(runner, first.leftRecursive(lazy.getRule("<word>")));
+    ASSERT_TRUE(runner, first.reachesFirst(lazy.getRule("<a>")->rootExpr->children[0],
+                                           lazy.getRule("<a>")));
+    ASSERT_FALSE(runner, first.reachesFirst(lazy.getRule("<a>")->rootExpr->children[1],
+                                            lazy.getRule("<a>")));
+
+    Grammar linked;
+    buildMixed(linked);
+    const CompiledGrammar& cg = linked.finalize();
+    const std::vector<std::string>& names = cg.getLeftRecursiveRules();
+    ASSERT_EQ(runner, names.size(), 4u);
+    ASSERT_EQ(runner, names[0], "<a>");
+    ASSERT_EQ(runner, names[3], "<list>");
+    ASSERT_TRUE(runner, cg.getRule("<h>")->leftRecursive);
+    ASSERT_FALSE(runner, cg.getRule("<item>")->leftRecursive);
+    // Later rounds skip the branches that cannot call the rule first
+    ASSERT_NOT_NULL(runner, cg.getRule("<list>")->seedBody);
+    ASSERT_EQ(runner, cg.getRule("<list>")->seedBody->children.size(), 1u);
+    ASSERT_TRUE(runner, cg.getRule("<list>")->seedBody->children[0] ==
+                        cg.getRule("<list>")->rootExpr->children[0]);
+    ASSERT_NULL(runner, cg.getRule("<b>")->seedBody);
+    ASSERT_NULL(runner, cg.getRule("<item>")->seedBody);
+
+    Grammar plain;
+    plain.addRule("<r> ::= 'a' <r> | 'b'");
+    FirstSets none(plain);
+    ASSERT_FALSE(runner, none.leftRecursive(plain.getRule("<r>")));
+    ASSERT_NULL(runner, none.seedBody(plain.getRule("<r>")));
+}
+
+void test_arithmetic(TestRunner& runner) {
+    Grammar lazy;
+    buildArithmetic(lazy);
+    Grammar linked;
+    buildArithmetic(linked);
+    const CompiledGrammar& cg = linked.finalize();
+
+    BNFParser reference(lazy);
+    BNFParser lazyRec(lazy), lazyIt(lazy), linkedRec(cg), linkedIt(cg), memoRec(cg), memoIt(cg);
+    lazyIt.setEngine(BNFParser::ENGINE_ITERATIVE);
+    linkedIt.setEngine(BNFParser::ENGINE_ITERATIVE);
+    // Packrat memo keeps only the results that did not use a seed
+    memoRec.setMemoization(true);
+    memoIt.setMemoization(true);
+    memoIt.setEngine(BNFParser::ENGINE_ITERATIVE);
+    BNFParser* parsers[] = { &lazyRec, &lazyIt, &linkedRec, &linkedIt, &memoRec, &memoIt };
+
+    const char* inputs[] = { "1+2*3-4", "7", "(1+2)*(3-4)*5", "1+", "+1", "((2))",
+                             "1-2-3-4-5", "2*(3+4", "" };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+        size_t c0 = 0;
+        ASTNode* expected = reference.parse("<expr>", inputs[i], c0, BNFParser::ENGINE_EARLEY);
+        for (size_t k = 0; k < 6; ++k) {
+            size_t c = 0;
+            ASTNode* ast = parsers[k]->parse("<expr>", inputs[i], c);
+            ASSERT_EQ(runner, c, c0);
+            ASSERT_TRUE(runner, sameTree(ast, expected));
+            delete ast;
+            bool ok = parsers[k]->recognize("<expr>", inputs[i], c);
+            ASSERT_EQ(runner, ok, expected != 0);
+            ASSERT_EQ(runner, c, c0);
+        }
+        delete expected;
+    }
+    ASSERT_GT(runner, lazyRec.getStats().seedGrowths, 0u);
+
+    // Left-associative: ((1+2*3)-4)
+    size_t consumed = 0;
+    ASTNode* ast = linkedRec.parse("<expr>", "1+2*3-4", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, ast->symbol, "<alt>");
+    const ASTNode* seq = ast->children[0];
+    ASSERT_EQ(runner, seq->children.size(), 3u);
+    ASSERT_EQ(runner, seq->children[0]->symbol, "<expr>");
+    ASSERT_EQ(runner, seq->children[0]->matched, "1+2*3");
+    ASSERT_EQ(runner, seq->children[1]->symbol, "-");
+    ASSERT_EQ(runner, seq->children[2]->matched, "4");
+    delete ast;
+}
+
+void test_indirect_and_hidden(TestRunner& runner) {
+    Grammar g;
+    buildMixed(g);
+    const CompiledGrammar& cg = g.finalize();
+    BNFParser rec(cg), it(cg), ordered(cg);
+    it.setEngine(BNFParser::ENGINE_ITERATIVE);
+    ordered.setOrderedChoice(true);
+
+    struct Case { const char* rule; const char* input; };
+    const Case cases[] = {
+        { "<a>", "ayxyx" }, { "<a>", "ayxy" }, { "<a>", "a" }, { "<b>", "ayxy" },
+        { "<h>", "hqq" }, { "<h>", "hqqq" }, { "<h>", "q" },
+        { "<list>", "ab,[c,d],e" }, { "<list>", "[[a]],b," }, { "<list>", "," }
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        size_t c0 = 0, c1 = 0, c2 = 0;
+        ASTNode* expected = rec.parse(cases[i].rule, cases[i].input, c0, BNFParser::ENGINE_EARLEY);
+        ASTNode* a = rec.parse(cases[i].rule, cases[i].input, c1);
+        ASTNode* b = it.parse(cases[i].rule, cases[i].input, c2);
+        ASSERT_EQ(runner, c1, c0);
+        ASSERT_EQ(runner, c2, c0);
+        ASSERT_TRUE(runner, sameTree(a, expected));
+        ASSERT_TRUE(runner, sameTree(b, expected));
+        delete expected;
+        delete a;
+        delete b;
+    }
+
+    // Ordered choice grows too: the recursive branch comes first
+    size_t consumed = 0;
+    ASSERT_TRUE(runner, ordered.recognize("<list>", "a,b,c", consumed));
+    ASSERT_EQ(runner, consumed, 5u);
+    ASSERT_TRUE(runner, ordered.recognize("<a>", "ayxyx", consumed));
+    ASSERT_EQ(runner, consumed, 5u);
+}
+
+void test_node_storage(TestRunner& runner) {
+    Grammar g;
+    buildArithmetic(g);
+    const CompiledGrammar& cg = g.finalize();
+    BNFParser heap(cg), arenaParser(cg), zero(cg), batch(cg);
+    zero.setZeroCopy(true);
+    std::string input = "1+2*(3-4)+5*6*7-8";
+
+    size_t c0 = 0, c1 = 0, c2 = 0;
+    ASTNode* expected = heap.parse("<expr>", input, c0);
+    ASSERT_NOT_NULL(runner, expected);
+    ASSERT_EQ(runner, c0, input.size());
+
+    Arena arena(4096);
+    ASTNode* pooled = arenaParser.parse("<expr>", input, c1, arena);
+    ASSERT_EQ(runner, c1, c0);
+    ASSERT_TRUE(runner, sameTree(pooled, expected));
+    ASTNode* spans = zero.parse("<expr>", input, c2);
+    ASSERT_EQ(runner, c2, c0);
+    ASSERT_TRUE(runner, sameTree(spans, expected));
+    ASSERT_TRUE(runner, spans->matched.empty());
+    delete spans;
+
+    std::vector<std::string> inputs;
+    inputs.push_back(input);
+    inputs.push_back("9-");
+    inputs.push_back("*");
+    BatchResult out;
+    ASSERT_EQ(runner, batch.parseBatch("<expr>", inputs, out), 2u);
+    ASSERT_EQ(runner, out.entries[0].consumed, input.size());
+    ASSERT_EQ(runner, out.entries[1].consumed, 1u);
+    ASTNode* flat = out.toAST(out.entries[0].root, input);
+    ASSERT_TRUE(runner, sameTree(flat, expected));
+    delete flat;
+    delete expected;
+}
+
+void test_streaming(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<line> ::= <sum> ';'");
+    g.addRule("<sum> ::= <sum> '+' <num> | <num>");
+    g.addRule("<num> ::= ( '0' ... '9' ) { ( '0' ... '9' ) }");
+    BNFParser p(g);
+
+    size_t consumed = 0;
+    ASTNode* expected = p.parse("<line>", "12+3+45;", consumed);
+    ASSERT_NOT_NULL(runner, expected);
+
+    ParseSession session(p, "<line>");
+    std::string text = "12+3+45;";
+    ParseSession::Status st = ParseSession::NEED_MORE;
+    for (size_t i = 0; i < text.size(); ++i) {
+        st = session.feed(text.substr(i, 1));
+        // Interleaved parses do not disturb the suspended heads
+        size_t c = 0;
+        delete p.parse("<sum>", "1+1", c);
+        if (i + 1 < text.size()) ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+    }
+    ASSERT_EQ(runner, st, ParseSession::COMPLETE);
+    ASTNode* ast = session.takeResult();
+    ASSERT_TRUE(runner, sameTree(ast, expected));
+    delete ast;
+    delete expected;
+
+    // A left-recursive start rule, and a session dropped mid-growth
+    ParseSession sums(p, "<sum>");
+    st = sums.feed("1+2");
+    ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+    st = sums.finish();
+    ASSERT_EQ(runner, st, ParseSession::COMPLETE);
+    ast = sums.takeResult();
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, ast->symbol, "<alt>");
+    ASSERT_EQ(runner, ast->matched, "1+2");
+    delete ast;
+    ParseSession dropped(p, "<line>");
+    st = dropped.feed("4+5+");
+    ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+}
+
+void test_linear_work(TestRunner& runner) {
+    Grammar g;
+    buildArithmetic(g);
+    BNFParser p(g.finalize());
+    // Memoizing <factor> only counts the calls; growth needs no memo
+    p.setRuleMemoization("<factor>", true);
+
+    std::string small = "1";
+    for (int i = 1; i < 500; ++i) small += i % 3 ? "+2*3" : "-(4+5)";
+    std::string large;
+    for (int i = 0; i < 4; ++i) large += (i ? "+" : "") + small;
+
+    size_t consumed = 0;
+    ASSERT_TRUE(runner, p.recognize("<expr>", small, consumed));
+    ASSERT_EQ(runner, consumed, small.size());
+    size_t smallWork = p.getStats().memoMisses + p.getStats().memoHits;
+    p.resetStats();
+    ASSERT_TRUE(runner, p.recognize("<expr>", large, consumed));
+    ASSERT_EQ(runner, consumed, large.size());
+    size_t largeWork = p.getStats().memoMisses + p.getStats().memoHits;
+    // Each factor is parsed once and asked for once
+    ASSERT_EQ(runner, p.getStats().memoHits, 0u);
+    ASSERT_LT(runner, largeWork, smallWork * 4 + smallWork / 10);
+    ASSERT_GT(runner, largeWork, smallWork * 4 - smallWork / 10);
+
+    // Deep nesting on the heap stack, and the depth limit mid-growth
+    BNFParser it(g.finalize());
+    it.setEngine(BNFParser::ENGINE_ITERATIVE);
+    std::string deep = std::string(20000, '(') + "7" + std::string(20000, ')') + "+1";
+    ASTNode* ast = it.parse("<expr>", deep, consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, deep.size());
+    delete ast;
+    it.setMaxDepth(64);
+    ASSERT_NULL(runner, it.parse("<expr>", deep, consumed));
+    ASSERT_GT(runner, it.getStats().depthAborts, 0u);
+}
+
+int main() {
+    TestSuite suite("Left Recursion Test Suite");
+    suite.addTest("Detection", test_detection);
+    suite.addTest("Arithmetic", test_arithmetic);
+    suite.addTest("Indirect And Hidden", test_indirect_and_hidden);
+    suite.addTest("Node Storage", test_node_storage);
+    suite.addTest("Streaming", test_streaming);
+    suite.addTest("Linear Work", test_linear_work);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
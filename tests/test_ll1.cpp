@@ -0,0 +1,232 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/LL1Analysis.hpp"
+#include "../include/ParseSession.hpp"
+#include "TestHelpers.hpp"
+#include <sstream>
+#include <string>
+
+// A JSON subset that is LL(1) as written
+static void buildJson(Grammar& g) {
+    g.addRule("<value> ::= <object> | <array> | <number> | <string> | 'true' | 'false' | 'null'");
+    g.addRule("<object> ::= '{' <ws> [ <member> { ',' <ws> <member> } ] '}'");
+    g.addRule("<member> ::= <string> <ws> ':' <ws> <value> <ws>");
+    g.addRule("<array> ::= '[' <ws> [ <value> <ws> { ',' <ws> <value> <ws> } ] ']'");
+    g.addRule("<number> ::= [ '-' ] <digit> { <digit> }");
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<string> ::= '\"' { <char> } '\"'");
+    g.addRule("<char> ::= ( 0x20 ... 0x21 0x23 ... 0x7E )");
+    g.addRule("<ws> ::= { ' ' }");
+}
+
+static void buildConflicts(Grammar& g) {
+    g.addRule("<item> ::= 'a' ... 'z'");
+    g.addRule("<list> ::= <item> { ',' <item> }");
+    g.addRule("<prefix> ::= 'a' 'b' | 'a' 'c'");
+    g.addRule("<greedy> ::= 'x' { 'a' 'b' } 'a'");
+    g.addRule("<empty> ::= [ 'a' ] | { 'b' }");
+    g.addRule("<nested> ::= { [ 'a' ] }");
+}
+
+void test_classification(TestRunner& runner) {
+    Grammar g;
+    buildJson(g);
+    LL1Analysis ll1(g);
+    ASSERT_TRUE(runner, ll1.isLL1());
+    ASSERT_EQ(runner, ll1.decisionCount(), ll1.deterministicCount());
+    ASSERT_GT(runner, ll1.decisionCount(), 8u);
+
+    // FOLLOW(<value>): whatever may come after a value in any context
+    const std::bitset<256>& fv = ll1.follow(g.getRule("<value>"));
+    ASSERT_TRUE(runner, fv.test(','));
+    ASSERT_TRUE(runner, fv.test(']'));
+    ASSERT_TRUE(runner, fv.test('}'));
+    ASSERT_TRUE(runner, fv.test(' '));
+    ASSERT_FALSE(runner, fv.test(':'));
+
+    // The table of <value> picks its branch from the first byte
+    const LL1Analysis::Decision* d = ll1.decision(g.getRule("<value>")->rootExpr);
+    ASSERT_NOT_NULL(runner, d);
+    std::string in = "[1]";
+    ASSERT_EQ(runner, d->choose(in, 0), 1u);
+    in = "-3";
+    ASSERT_EQ(runner, d->choose(in, 0), 2u);
+    ASSERT_EQ(runner, d->choose(in, 2), static_cast<size_t>(LL1Analysis::NONE));
+
+    Grammar c;
+    buildConflicts(c);
+    LL1Analysis mixed(c);
+    ASSERT_FALSE(runner, mixed.isLL1());
+    ASSERT_NOT_NULL(runner, mixed.decision(c.getRule("<list>")->rootExpr->children[1]));
+    ASSERT_NULL(runner, mixed.decision(c.getRule("<prefix>")->rootExpr));
+    ASSERT_NULL(runner, mixed.decision(c.getRule("<greedy>")->rootExpr->children[1]));
+    ASSERT_NULL(runner, mixed.decision(c.getRule("<empty>")->rootExpr));
+
+    const std::vector<LL1Analysis::Conflict>& conflicts = mixed.getConflicts();
+    ASSERT_EQ(runner, conflicts.size(), 5u);
+    ASSERT_EQ(runner, conflicts[0].kind, LL1Analysis::CONFLICT_FIRST_FIRST);
+    ASSERT_TRUE(runner, conflicts[0].bytes.test('a'));
+    ASSERT_EQ(runner, conflicts[0].bytes.count(), 1u);
+    ASSERT_EQ(runner, conflicts[1].kind, LL1Analysis::CONFLICT_FIRST_FOLLOW);
+    ASSERT_EQ(runner, conflicts[1].rule->name, "<greedy>");
+    ASSERT_EQ(runner, conflicts[2].kind, LL1Analysis::CONFLICT_NULLABLE);
+    ASSERT_EQ(runner, conflicts[3].kind, LL1Analysis::CONFLICT_NULLABLE);
+    ASSERT_EQ(runner, conflicts[3].rule->name, "<nested>");
+    // The inner optional may be followed by another iteration
+    ASSERT_EQ(runner, conflicts[4].kind, LL1Analysis::CONFLICT_FIRST_FOLLOW);
+}
+
+void test_conflict_report(TestRunner& runner) {
+    Grammar g;
+    buildConflicts(g);
+    g.addRule("<word> ::= { 'a' ... 'z' } 'a' ... 'z'");
+    LL1Analysis ll1(g);
+
+    std::ostringstream out;
+    ll1.report(out);
+    std::string str = out.str();
+    ASSERT_CONTAINS(runner, str, "LL(1): ");
+    ASSERT_CONTAINS(runner, str, "<prefix>: alternative: FIRST/FIRST conflict on 'a'");
+    ASSERT_CONTAINS(runner, str, "<greedy>: repetition: FIRST/FOLLOW conflict on 'a'");
+    ASSERT_CONTAINS(runner, str, "<empty>: alternative: several nullable branches");
+    ASSERT_CONTAINS(runner, str, "<nested>: repetition: nullable body");
+    ASSERT_CONTAINS(runner, str, "<word>: repetition: FIRST/FOLLOW conflict on 'a' ... 'z'");
+}
+
+void test_left_recursive_first(TestRunner& runner) {
+    // FIRST of <sum> needs a fixpoint; an unlinked parser computes it
+    // lazily while pruning the branches of <start>
+    Grammar g;
+    g.addRule("<sum> ::= <sum> '+' 'x' | 'x'");
+    g.addRule("<start> ::= 'y' | <sum>");
+    BNFParser p(g);
+
+    size_t consumed = 0;
+    bool ok = p.recognize("<start>", "y", consumed);
+    ASSERT_TRUE(runner, ok);
+    ASSERT_EQ(runner, consumed, 1u);
+
+    LL1Analysis ll1(g);
+    ASSERT_FALSE(runner, ll1.isLL1());
+    ASSERT_EQ(runner, ll1.getConflicts()[0].kind, LL1Analysis::CONFLICT_FIRST_FIRST);
+    ASSERT_TRUE(runner, ll1.follow(g.getRule("<sum>")).test('+'));
+}
+
+void test_same_trees(TestRunner& runner) {
+    Grammar lazy;
+    buildJson(lazy);
+    Grammar linked;
+    buildJson(linked);
+    const CompiledGrammar& cg = linked.finalize();
+
+    const char* inputs[] = { "{\"a\": [1, -20, true], \"b\": {\"c\": null}}", "[]", "{}",
+                             "\"x\"", "-5", "[ [ ], { } ]", "false", "12a", "[1, ]", "" };
+    for (int e = 0; e < 2; ++e) {
+        BNFParser::Engine engine = e ? BNFParser::ENGINE_ITERATIVE : BNFParser::ENGINE_RECURSIVE;
+        BNFParser reference(lazy), lazyLL(lazy), linkedLL(cg);
+        reference.setEngine(engine);
+        lazyLL.setEngine(engine);
+        linkedLL.setEngine(engine);
+        lazyLL.setPredictive(true);
+        linkedLL.setPredictive(true);
+        BNFParser* parsers[] = { &lazyLL, &linkedLL };
+
+        for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+            size_t c0 = 0;
+            ASTNode* expected = reference.parse("<value>", inputs[i], c0);
+            for (size_t p = 0; p < 2; ++p) {
+                size_t c = 0, cr = 0;
+                ASTNode* got = parsers[p]->parse("<value>", inputs[i], c);
+                bool ok = parsers[p]->recognize("<value>", inputs[i], cr);
+                ASSERT_EQ(runner, c, c0);
+                ASSERT_EQ(runner, cr, c0);
+                ASSERT_EQ(runner, ok, expected != 0);
+                ASSERT_TRUE(runner, sameTree(expected, got));
+                delete got;
+            }
+            delete expected;
+        }
+        ASSERT_GT(runner, linkedLL.getStats().predictions, 0u);
+        ASSERT_EQ(runner, reference.getStats().predictions, 0u);
+    }
+}
+
+void test_committed_choice(TestRunner& runner) {
+    Grammar g;
+    buildConflicts(g);
+    g.addRule("<pair> ::= 'k' [ '=' 'v' ]");
+    const CompiledGrammar& cg = g.finalize();
+
+    for (int e = 0; e < 2; ++e) {
+        BNFParser::Engine engine = e ? BNFParser::ENGINE_ITERATIVE : BNFParser::ENGINE_RECURSIVE;
+        BNFParser backtrack(cg), predict(cg);
+        backtrack.setEngine(engine);
+        predict.setEngine(engine);
+        predict.setPredictive(true);
+
+        // Complete inputs give the same result
+        size_t consumed = 0;
+        ASTNode* ast = predict.parse("<list>", "a,b,c", consumed);
+        ASSERT_NOT_NULL(runner, ast);
+        ASSERT_EQ(runner, consumed, 5u);
+        delete ast;
+
+        // Backtracking keeps the longest prefix; a predicted body that
+        // fails makes the whole construct fail
+        bool ok = backtrack.recognize("<list>", "a,b,", consumed);
+        ASSERT_TRUE(runner, ok);
+        ASSERT_EQ(runner, consumed, 3u);
+        ok = predict.recognize("<list>", "a,b,", consumed);
+        ASSERT_FALSE(runner, ok);
+        ok = backtrack.recognize("<pair>", "k=x", consumed);
+        ASSERT_TRUE(runner, ok);
+        ASSERT_EQ(runner, consumed, 1u);
+        ok = predict.recognize("<pair>", "k=x", consumed);
+        ASSERT_FALSE(runner, ok);
+        ast = predict.parse("<pair>", "k=x", consumed);
+        ASSERT_NULL(runner, ast);
+
+        // Conflicting points keep backtracking
+        ok = predict.recognize("<greedy>", "xababa", consumed);
+        ASSERT_TRUE(runner, ok);
+        ASSERT_EQ(runner, consumed, 6u);
+        ok = predict.recognize("<prefix>", "ac", consumed);
+        ASSERT_TRUE(runner, ok);
+        ASSERT_EQ(runner, consumed, 2u);
+    }
+}
+
+void test_streamed_backtracks(TestRunner& runner) {
+    Grammar g;
+    buildConflicts(g);
+    BNFParser p(g.finalize());
+    p.setPredictive(true);
+
+    // Sessions do not predict, so the trailing ',' is left over as before
+    ParseSession session(p, "<list>");
+    ParseSession::Status st = session.feed("a,");
+    ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+    st = session.feed("b,");
+    ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+    st = session.finish();
+    ASSERT_EQ(runner, st, ParseSession::COMPLETE);
+    ASTNode* ast = session.takeResult();
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, ast->matched, "a,b");
+    delete ast;
+    ASSERT_EQ(runner, p.getStats().predictions, 0u);
+}
+
+int main() {
+    TestSuite suite("LL(1) Test Suite");
+    suite.addTest("Classification", test_classification);
+    suite.addTest("Conflict Report", test_conflict_report);
+    suite.addTest("Left-Recursive FIRST", test_left_recursive_first);
+    suite.addTest("Same Trees", test_same_trees);
+    suite.addTest("Committed Choice", test_committed_choice);
+    suite.addTest("Streamed Backtracks", test_streamed_backtracks);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
@@ -0,0 +1,313 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/BatchResult.hpp"
+#include "../include/GrammarOptimizer.hpp"
+#include "../include/OperatorTable.hpp"
+#include "../include/ParseSession.hpp"
+#include "../include/VMParser.hpp"
+#include "TestHelpers.hpp"
+#include <string>
+#include <vector>
+
+static void buildExpr(Grammar& g) {
+    g.addOperatorRule("<expr> ::= <unary>", "left '||' | left '+' '-' | left '*' '/' | right '^'");
+    g.addRule("<unary> ::= <num> | '(' <expr> ')' | '-' <unary>");
+    g.addRule("<num> ::= ( '0' ... '9' ) { ( '0' ... '9' ) }");
+}
+
+// The same language with one rule per precedence level
+static void buildLevels(Grammar& g) {
+    g.addRule("<expr> ::= <sum> { '||' <sum> }");
+    g.addRule("<sum> ::= <prod> { <addop> <prod> }");
+    g.addRule("<addop> ::= '+' | '-'");
+    g.addRule("<prod> ::= <pow> { <mulop> <pow> }");
+    g.addRule("<mulop> ::= '*' | '/'");
+    g.addRule("<pow> ::= <unary> [ '^' <pow> ]");
+    g.addRule("<unary> ::= <num> | '(' <expr> ')' | '-' <unary>");
+    g.addRule("<num> ::= ( '0' ... '9' ) { ( '0' ... '9' ) }");
+}
+
+static const char* const exprInputs[] = {
+    "1+2*3-4", "7", "2^3^4", "1||2+3*4^5^6/7-8", "(1+2)*-3", "1+", "-", "10/5/2",
+    "((1))^-(2||3)", "1*", ""
+};
+
+void test_table(TestRunner& runner) {
+    OperatorTable t;
+    ASSERT_TRUE(runner, t.parse("left '+' '-' | left '*' | right '^'"));
+    ASSERT_EQ(runner, t.levelCount(), 3u);
+    ASSERT_EQ(runner, t.getOperators().size(), 4u);
+    ASSERT_EQ(runner, t.getOperators()[1].literal, "-");
+    ASSERT_EQ(runner, t.levelOf("-"), 0u);
+    ASSERT_EQ(runner, t.levelOf("^"), 2u);
+    ASSERT_EQ(runner, t.levelOf("/"), OperatorTable::NO_LEVEL);
+    ASSERT_TRUE(runner, t.assoc(2) == OperatorTable::ASSOC_RIGHT);
+    // A stacked '*' applies before '+', and before another '*'; '^' waits
+    ASSERT_TRUE(runner, t.appliesFirst(1, 0));
+    ASSERT_TRUE(runner, t.appliesFirst(1, 1));
+    ASSERT_FALSE(runner, t.appliesFirst(0, 1));
+    ASSERT_FALSE(runner, t.appliesFirst(2, 2));
+
+    ASSERT_FALSE(runner, t.parse(""));
+    ASSERT_FALSE(runner, t.parse("middle '+'"));
+    ASSERT_FALSE(runner, t.parse("left"));
+    ASSERT_FALSE(runner, t.parse("left '+' |"));
+    ASSERT_FALSE(runner, t.parse("left '+' | right '+'"));
+    ASSERT_FALSE(runner, t.parse("left '+' <x>"));
+
+    // A rule with an invalid table is not added
+    Grammar g;
+    g.addOperatorRule("<e> ::= 'x'", "left");
+    g.addOperatorRule("<f> ::= 'x'", "right '@'");
+    ASSERT_NULL(runner, g.getRule("<e>"));
+    ASSERT_NOT_NULL(runner, g.getRule("<f>"));
+    ASSERT_TRUE(runner, g.hasOperatorRules());
+    ASSERT_NOT_NULL(runner, g.getRule("<f>")->operators);
+}
+
+void test_tree_shape(TestRunner& runner) {
+    Grammar g;
+    buildExpr(g);
+    BNFParser p(g.finalize());
+
+    // Left-associative, '*' binds tighter: ((1 + (2 * 3)) - 4)
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<expr>", "1+2*3-4", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 7u);
+    ASSERT_EQ(runner, ast->symbol, "<infix>");
+    ASSERT_EQ(runner, ast->matched, "1+2*3-4");
+    ASSERT_EQ(runner, ast->children.size(), 3u);
+    ASSERT_EQ(runner, ast->children[1]->symbol, "-");
+    ASSERT_EQ(runner, ast->children[2]->symbol, "<unary>");
+    ASSERT_EQ(runner, ast->children[2]->matched, "4");
+    const ASTNode* sum = ast->children[0];
+    ASSERT_EQ(runner, sum->symbol, "<infix>");
+    ASSERT_EQ(runner, sum->matched, "1+2*3");
+    ASSERT_EQ(runner, sum->children[1]->symbol, "+");
+    ASSERT_EQ(runner, sum->children[2]->symbol, "<infix>");
+    ASSERT_EQ(runner, sum->children[2]->matched, "2*3");
+    ASSERT_EQ(runner, sum->children[2]->begin, 2u);
+    delete ast;
+
+    // Right-associative: 2 ^ (3 ^ 4)
+    ast = p.parse("<expr>", "2^3^4", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, ast->children[0]->matched, "2");
+    ASSERT_EQ(runner, ast->children[2]->symbol, "<infix>");
+    ASSERT_EQ(runner, ast->children[2]->matched, "3^4");
+    delete ast;
+
+    // An operand alone is the tree; nested rules get their own tree
+    ast = p.parse("<expr>", "7", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, ast->symbol, "<unary>");
+    delete ast;
+    ast = p.parse("<expr>", "(1-2)*3", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, ast->children[1]->symbol, "*");
+    const ASTNode* paren = ast->children[0]->children[0]->children[0];
+    ASSERT_EQ(runner, paren->children[1]->symbol, "<expr>");
+    ASSERT_EQ(runner, paren->children[1]->children[0]->symbol, "<infix>");
+    delete ast;
+
+    // A trailing operator is left unconsumed
+    ast = p.parse("<expr>", "1+2*", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 3u);
+    delete ast;
+}
+
+void test_engines(TestRunner& runner) {
+    Grammar lazy;
+    buildExpr(lazy);
+    Grammar linked;
+    buildExpr(linked);
+    const CompiledGrammar& cg = linked.finalize();
+
+    BNFParser lazyRec(lazy), lazyIt(lazy), linkedRec(cg), linkedIt(cg), earley(cg), lalr(cg),
+              memo(cg), predictive(cg);
+    lazyIt.setEngine(BNFParser::ENGINE_ITERATIVE);
+    linkedIt.setEngine(BNFParser::ENGINE_ITERATIVE);
+    earley.setEngine(BNFParser::ENGINE_EARLEY);
+    lalr.setEngine(BNFParser::ENGINE_LALR);
+    memo.setMemoization(true);
+    // Prediction matches the chain and folds it
+    predictive.setPredictive(true);
+    BNFParser* parsers[] = { &lazyIt, &linkedRec, &linkedIt, &earley, &lalr, &memo, &predictive };
+    VMParser vm(lazy);
+
+    for (size_t i = 0; i < sizeof(exprInputs) / sizeof(exprInputs[0]); ++i) {
+        size_t c0 = 0;
+        ASTNode* expected = lazyRec.parse("<expr>", exprInputs[i], c0);
+        for (size_t k = 0; k < sizeof(parsers) / sizeof(parsers[0]); ++k) {
+            // LALR(1) and prediction commit to a trailing operator
+            bool prefix = c0 != std::string(exprInputs[i]).size();
+            if (prefix && (parsers[k] == &lalr || parsers[k] == &predictive)) continue;
+            size_t c = 0;
+            ASTNode* ast = parsers[k]->parse("<expr>", exprInputs[i], c);
+            ASSERT_EQ(runner, c, c0);
+            ASSERT_TRUE(runner, sameTree(ast, expected));
+            delete ast;
+            bool ok = parsers[k]->recognize("<expr>", exprInputs[i], c);
+            ASSERT_EQ(runner, ok, expected != 0);
+            ASSERT_EQ(runner, c, c0);
+        }
+        size_t c = 0;
+        ASTNode* ast = vm.parse("<expr>", exprInputs[i], c);
+        ASSERT_EQ(runner, c, c0);
+        ASSERT_TRUE(runner, sameTree(ast, expected));
+        delete ast;
+        delete expected;
+    }
+
+    // Only precedence climbing counts operators
+    linkedRec.resetStats();
+    size_t consumed = 0;
+    ASSERT_TRUE(runner, linkedRec.recognize("<expr>", "1+2*(3-4)^5", consumed));
+    ASSERT_EQ(runner, linkedRec.getStats().climbs, 4u);
+    delete linkedRec.parse("<expr>", "1||2", consumed);
+    ASSERT_EQ(runner, linkedRec.getStats().climbs, 5u);
+    ASSERT_EQ(runner, earley.getStats().climbs, 0u);
+    ASSERT_EQ(runner, predictive.getStats().climbs, 0u);
+}
+
+void test_node_storage(TestRunner& runner) {
+    Grammar g;
+    buildExpr(g);
+    g.addRule("<line> ::= <expr> ';'");
+    const CompiledGrammar& cg = g.finalize();
+    BNFParser heap(cg), arenaParser(cg), arenaEarley(cg), zero(cg), batch(cg);
+    arenaEarley.setEngine(BNFParser::ENGINE_EARLEY);
+    zero.setZeroCopy(true);
+    std::string input = "1+2*(3-4)^2^3||5*6/7-8";
+
+    size_t c0 = 0, c1 = 0, c2 = 0;
+    ASTNode* expected = heap.parse("<expr>", input, c0);
+    ASSERT_NOT_NULL(runner, expected);
+    ASSERT_EQ(runner, c0, input.size());
+
+    Arena arena(4096);
+    ASTNode* pooled = arenaParser.parse("<expr>", input, c1, arena);
+    ASSERT_EQ(runner, c1, c0);
+    ASSERT_TRUE(runner, sameTree(pooled, expected));
+    ASTNode* earley = arenaEarley.parse("<expr>", input, c1, arena);
+    ASSERT_TRUE(runner, sameTree(earley, expected));
+    ASTNode* spans = zero.parse("<expr>", input, c2);
+    ASSERT_EQ(runner, c2, c0);
+    ASSERT_TRUE(runner, sameTree(spans, expected));
+    ASSERT_TRUE(runner, spans->matched.empty());
+    delete spans;
+
+    std::vector<std::string> inputs;
+    inputs.push_back(input);
+    inputs.push_back("9-");
+    inputs.push_back("*");
+    BatchResult out;
+    ASSERT_EQ(runner, batch.parseBatch("<expr>", inputs, out), 2u);
+    ASSERT_EQ(runner, out.entries[0].consumed, input.size());
+    ASSERT_EQ(runner, out.entries[1].consumed, 1u);
+    ASTNode* flat = out.toAST(out.entries[0].root, input);
+    ASSERT_TRUE(runner, sameTree(flat, expected));
+    delete flat;
+    delete expected;
+
+    // Streaming folds the chain as each operator rule completes
+    std::string text = "12+3*45^2;";
+    size_t consumed = 0;
+    expected = heap.parse("<line>", text, consumed);
+    ASSERT_NOT_NULL(runner, expected);
+    ParseSession session(heap, "<line>");
+    ParseSession::Status st = ParseSession::NEED_MORE;
+    for (size_t i = 0; i < text.size(); ++i) {
+        st = session.feed(text.substr(i, 1));
+        if (i + 1 < text.size()) ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+    }
+    ASSERT_EQ(runner, st, ParseSession::COMPLETE);
+    ASTNode* ast = session.takeResult();
+    ASSERT_TRUE(runner, sameTree(ast, expected));
+    delete ast;
+    delete expected;
+}
+
+void test_choice(TestRunner& runner) {
+    // '<' and '<=' share a prefix; an operand may start with '='
+    Grammar g;
+    g.addOperatorRule("<cmp> ::= <atom>", "left '<' '<=' | left '+'");
+    g.addRule("<atom> ::= 'x' | '='");
+    const CompiledGrammar& cg = g.finalize();
+    BNFParser longest(cg), ordered(cg), orderedIt(cg), earley(cg);
+    ordered.setOrderedChoice(true);
+    orderedIt.setOrderedChoice(true);
+    orderedIt.setEngine(BNFParser::ENGINE_ITERATIVE);
+    earley.setEngine(BNFParser::ENGINE_EARLEY);
+
+    // Longest match takes '<=' with the operand 'x'
+    size_t c0 = 0, c1 = 0;
+    ASTNode* a = longest.parse("<cmp>", "x<=x+x", c0);
+    ASTNode* b = earley.parse("<cmp>", "x<=x+x", c1);
+    ASSERT_EQ(runner, c0, 6u);
+    ASSERT_EQ(runner, c1, 6u);
+    ASSERT_TRUE(runner, sameTree(a, b));
+    ASSERT_EQ(runner, a->children[1]->symbol, "<=");
+    ASSERT_EQ(runner, a->children[2]->matched, "x+x");
+    delete a;
+    delete b;
+
+    // Ordered choice takes '<' with the operand '=' and stops at 'x'
+    a = ordered.parse("<cmp>", "x<=x+x", c0);
+    b = orderedIt.parse("<cmp>", "x<=x+x", c1);
+    ASSERT_EQ(runner, c0, 3u);
+    ASSERT_EQ(runner, c1, 3u);
+    ASSERT_TRUE(runner, sameTree(a, b));
+    ASSERT_EQ(runner, a->children[1]->symbol, "<");
+    ASSERT_EQ(runner, a->children[2]->matched, "=");
+    delete a;
+    delete b;
+}
+
+void test_levels_grammar(TestRunner& runner) {
+    Grammar ops, levels;
+    buildExpr(ops);
+    buildLevels(levels);
+    BNFParser table(ops.finalize()), chain(levels.finalize());
+
+    // Same language, fewer calls: one rule call per operand
+    for (size_t i = 0; i < sizeof(exprInputs) / sizeof(exprInputs[0]); ++i) {
+        size_t c0 = 0, c1 = 0;
+        bool ok0 = table.recognize("<expr>", exprInputs[i], c0);
+        bool ok1 = chain.recognize("<expr>", exprInputs[i], c1);
+        ASSERT_EQ(runner, ok0, ok1);
+        ASSERT_EQ(runner, c0, c1);
+    }
+
+    // An optimizer never inlines the operator rule or rewrites its chain
+    Grammar optimized;
+    GrammarOptimizer opt;
+    opt.setAllPasses(true);
+    optimized.setOptimizer(&opt);
+    buildExpr(optimized);
+    optimized.addRule("<top> ::= <expr>");
+    BNFParser p(optimized.finalize());
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<top>", "1-2-3", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, ast->symbol, "<expr>");
+    ASSERT_EQ(runner, ast->children[0]->symbol, "<infix>");
+    ASSERT_EQ(runner, ast->children[0]->children[0]->matched, "1-2");
+    delete ast;
+}
+
+int main() {
+    TestSuite suite("Operator Table Test Suite");
+    suite.addTest("Table", test_table);
+    suite.addTest("Tree Shape", test_tree_shape);
+    suite.addTest("Engines", test_engines);
+    suite.addTest("Node Storage", test_node_storage);
+    suite.addTest("Choice", test_choice);
+    suite.addTest("Levels Grammar", test_levels_grammar);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
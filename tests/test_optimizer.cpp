@@ -0,0 +1,429 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/GrammarOptimizer.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/VMParser.hpp"
+#include "../include/DataExtractor.hpp"
+#include "../include/ExpressionInterner.hpp"
+#include "../include/Arena.hpp"
+#include "TestHelpers.hpp"
+#include <string>
+#include <vector>
+
+static void buildProtocol(Grammar& g) {
+    g.addRule("<letter> ::= 'a' ... 'z' | 'A' ... 'Z'");
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<special> ::= '_' | '-' | '[' | ']' | ( '{' '}' )");
+    g.addRule("<nick-char> ::= <letter> | <digit> | <special> | '|' | '^'");
+    g.addRule("<nickname> ::= <letter> { <nick-char> }");
+    g.addRule("<space> ::= ' ' { ' ' }");
+    g.addRule("<text> ::= ( 0x21 ... 0x7E ) { ( 0x21 ... 0x7E ) | ' ' }");
+    g.addRule("<crlf> ::= '\r' '\n'");
+    g.addRule("<hex> ::= '0' 'x' ( '0' ... '9' 'a' ... 'f' ) { ( '0' ... '9' 'a' ... 'f' ) }");
+    g.addRule("<message> ::= 'M' 'S' 'G' <space> <nickname> <space> ':' <text> <crlf> | 'P' \"ING\" <crlf>");
+}
+
+static const Expression* root(const Grammar& g, const std::string& name) {
+    const Rule* r = g.getRule(name);
+    return r ? r->rootExpr : 0;
+}
+
+void test_fuse_whole_alternative(TestRunner& runner) {
+    GrammarOptimizer opt;
+    Grammar g;
+    g.setOptimizer(&opt);
+    buildProtocol(g);
+
+    const Expression* letter = root(g, "<letter>");
+    ASSERT_NOT_NULL(runner, letter);
+    ASSERT_EQ(runner, letter->type, Expression::EXPR_CHAR_CLASS);
+    ASSERT_EQ(runner, letter->charBitmap.count(), 52u);
+    ASSERT_TRUE(runner, letter->classMatches('q') && letter->classMatches('Q'));
+
+    // Ranges, one-byte literals and classes all fuse
+    const Expression* special = root(g, "<special>");
+    ASSERT_EQ(runner, special->type, Expression::EXPR_CHAR_CLASS);
+    ASSERT_EQ(runner, special->charBitmap.count(), 6u);
+
+    BNFParser p(g);
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<letter>", "Q", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, ast->symbol, "<char-class>");
+    ASSERT_EQ(runner, ast->matched, "Q");
+    delete ast;
+}
+
+void test_fuse_partial_alternative(TestRunner& runner) {
+    GrammarOptimizer opt;
+    Grammar g;
+    g.setOptimizer(&opt);
+    buildProtocol(g);
+
+    // Symbol branches stay, the two literal branches become one class
+    const Expression* nc = root(g, "<nick-char>");
+    ASSERT_EQ(runner, nc->type, Expression::EXPR_ALTERNATIVE);
+    ASSERT_EQ(runner, nc->children.size(), 4u);
+    ASSERT_EQ(runner, nc->children[3]->type, Expression::EXPR_CHAR_CLASS);
+    ASSERT_EQ(runner, nc->children[3]->charBitmap.count(), 2u);
+
+    // The repeated body of <text> is a fused class of 95 bytes
+    const Expression* text = root(g, "<text>");
+    ASSERT_EQ(runner, text->children[1]->children[0]->type, Expression::EXPR_CHAR_CLASS);
+    ASSERT_EQ(runner, text->children[1]->children[0]->charBitmap.count(), 95u);
+}
+
+void test_merge_literals(TestRunner& runner) {
+    GrammarOptimizer opt;
+    Grammar g;
+    g.setOptimizer(&opt);
+    buildProtocol(g);
+    g.addRule("<quotes> ::= \"'\" 'a' '\"'");
+
+    const Expression* crlf = root(g, "<crlf>");
+    ASSERT_EQ(runner, crlf->type, Expression::EXPR_TERMINAL);
+    ASSERT_EQ(runner, crlf->terminalText(), "\r\n");
+
+    const Expression* hex = root(g, "<hex>");
+    ASSERT_EQ(runner, hex->type, Expression::EXPR_SEQUENCE);
+    ASSERT_EQ(runner, hex->children.size(), 3u);
+    ASSERT_EQ(runner, hex->children[0]->terminalText(), "0x");
+
+    const Expression* msg = root(g, "<message>");
+    ASSERT_EQ(runner, msg->children[0]->children[0]->terminalText(), "MSG");
+    ASSERT_EQ(runner, msg->children[1]->children[0]->terminalText(), "PING");
+
+    // Quote characters inside the literals survive the merge
+    ASSERT_EQ(runner, root(g, "<quotes>")->terminalText(), "'a\"");
+    BNFParser p(g);
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<quotes>", "'a\"", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 3u);
+    delete ast;
+
+    // An empty literal never matches, so it is not merged away
+    Grammar plain, merged;
+    merged.setOptimizer(&opt);
+    plain.addRule("<e> ::= '' 'a'");
+    plain.addRule("<f> ::= 'a' 'b' '' 'c' 'd'");
+    merged.addRule("<e> ::= '' 'a'");
+    merged.addRule("<f> ::= 'a' 'b' '' 'c' 'd'");
+    ASSERT_EQ(runner, root(merged, "<e>")->type, Expression::EXPR_SEQUENCE);
+    ASSERT_EQ(runner, root(merged, "<e>")->children.size(), 2u);
+    ASSERT_EQ(runner, root(merged, "<f>")->children.size(), 3u);
+    ASSERT_EQ(runner, root(merged, "<f>")->children[0]->terminalText(), "ab");
+    BNFParser a(plain), b(merged);
+    const char* rules[] = { "<e>", "<f>" };
+    const char* inputs[] = { "a", "abcd" };
+    for (size_t i = 0; i < 2; ++i) {
+        size_t c1 = 0, c2 = 0;
+        ASSERT_EQ(runner, a.recognize(rules[i], inputs[i], c1), b.recognize(rules[i], inputs[i], c2));
+        ASSERT_EQ(runner, c1, c2);
+        ASSERT_FALSE(runner, b.recognize(rules[i], inputs[i], c2));
+    }
+}
+
+void test_passes_switchable(TestRunner& runner) {
+    GrammarOptimizer opt;
+    opt.setPass(GrammarOptimizer::PASS_FUSE_CHAR_CLASSES, false);
+    ASSERT_FALSE(runner, opt.isEnabled(GrammarOptimizer::PASS_FUSE_CHAR_CLASSES));
+    ASSERT_TRUE(runner, opt.isEnabled(GrammarOptimizer::PASS_MERGE_LITERALS));
+
+    Grammar g;
+    g.setOptimizer(&opt);
+    buildProtocol(g);
+    ASSERT_EQ(runner, root(g, "<letter>")->type, Expression::EXPR_ALTERNATIVE);
+    ASSERT_EQ(runner, root(g, "<crlf>")->type, Expression::EXPR_TERMINAL);
+    ASSERT_EQ(runner, opt.getStats().rules, 10u);
+    ASSERT_EQ(runner, opt.getStats().rewrites[GrammarOptimizer::PASS_FUSE_CHAR_CLASSES], 0u);
+    ASSERT_EQ(runner, opt.getStats().rewrites[GrammarOptimizer::PASS_MERGE_LITERALS], 4u);
+
+    GrammarOptimizer fuseOnly;
+    fuseOnly.setAllPasses(false);
+    fuseOnly.setPass(GrammarOptimizer::PASS_FUSE_CHAR_CLASSES, true);
+    Grammar g2;
+    g2.setOptimizer(&fuseOnly);
+    buildProtocol(g2);
+    ASSERT_EQ(runner, root(g2, "<letter>")->type, Expression::EXPR_CHAR_CLASS);
+    ASSERT_EQ(runner, root(g2, "<crlf>")->type, Expression::EXPR_SEQUENCE);
+    ASSERT_EQ(runner, fuseOnly.getStats().rewrites[GrammarOptimizer::PASS_MERGE_LITERALS], 0u);
+
+    ASSERT_EQ(runner, std::string(GrammarOptimizer::passName(GrammarOptimizer::PASS_MERGE_LITERALS)),
+              "merge-literals");
+}
+
+static ExtractedData extractNamed(ASTNode* ast) {
+    DataExtractor extractor;
+    std::vector<std::string> symbols;
+    symbols.push_back("<nickname>");
+    symbols.push_back("<text>");
+    symbols.push_back("<nick-char>");
+    symbols.push_back("<letter>");
+    extractor.setSymbols(symbols);
+    return extractor.extract(ast);
+}
+
+void test_same_language_and_extraction(TestRunner& runner) {
+    Grammar plain;
+    buildProtocol(plain);
+    GrammarOptimizer opt;
+    Grammar optimized;
+    optimized.setOptimizer(&opt);
+    buildProtocol(optimized);
+
+    BNFParser a(plain);
+    BNFParser b(optimized);
+    BNFParser it(optimized);
+    it.setEngine(BNFParser::ENGINE_ITERATIVE);
+    VMParser vm(optimized);
+
+    const char* inputs[] = {
+        "MSG alice :Hello there!\r\n", "MSG x|y^[z] :a b c\r\n", "PING\r\n",
+        "MSG 9bad :x\r\n", "MSG bob :unterminated", "PIN\r\n", "MS", ""
+    };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+        size_t c1 = 0, c2 = 0, c3 = 0, c4 = 0, c5 = 0;
+        ASTNode* ta = a.parse("<message>", inputs[i], c1);
+        ASTNode* tb = b.parse("<message>", inputs[i], c2);
+        ASTNode* tc = it.parse("<message>", inputs[i], c3);
+        ASTNode* td = vm.parse("<message>", inputs[i], c4);
+        bool ok = b.recognize("<message>", inputs[i], c5);
+        ASSERT_EQ(runner, ta != 0, tb != 0);
+        ASSERT_EQ(runner, tb != 0, tc != 0);
+        ASSERT_EQ(runner, tb != 0, td != 0);
+        ASSERT_EQ(runner, tb != 0, ok);
+        ASSERT_EQ(runner, c1, c2);
+        ASSERT_EQ(runner, c1, c3);
+        ASSERT_EQ(runner, c1, c4);
+        ASSERT_EQ(runner, c1, c5);
+        if (ta && tb) {
+            ExtractedData da = extractNamed(ta);
+            ExtractedData db = extractNamed(tb);
+            ASSERT_EQ(runner, da.count("<nick-char>"), db.count("<nick-char>"));
+            ASSERT_EQ(runner, da.count("<letter>"), db.count("<letter>"));
+            ASSERT_EQ(runner, da.first("<nickname>"), db.first("<nickname>"));
+            ASSERT_EQ(runner, da.first("<text>"), db.first("<text>"));
+        }
+        delete ta;
+        delete tb;
+        delete tc;
+        delete td;
+    }
+}
+
+void test_arena_and_interner(TestRunner& runner) {
+    Arena arena;
+    GrammarOptimizer opt;
+    Grammar ga;
+    ga.setArena(&arena);
+    ga.setOptimizer(&opt);
+    buildProtocol(ga);
+
+    ExpressionInterner interner;
+    Grammar gi;
+    gi.setInterner(&interner);
+    gi.setOptimizer(&opt);
+    buildProtocol(gi);
+
+    ASSERT_EQ(runner, root(gi, "<letter>")->type, Expression::EXPR_CHAR_CLASS);
+
+    BNFParser pa(ga);
+    BNFParser pi(gi);
+    std::string input = "MSG nick_1 :interned and arena grammars\r\n";
+    size_t c1 = 0, c2 = 0;
+    ASTNode* a = pa.parse("<message>", input, c1);
+    ASTNode* b = pi.parse("<message>", input, c2);
+    ASSERT_NOT_NULL(runner, a);
+    ASSERT_NOT_NULL(runner, b);
+    ASSERT_EQ(runner, c1, input.size());
+    ASSERT_EQ(runner, c2, input.size());
+    delete a;
+    delete b;
+}
+
+void test_inline_small_rules(TestRunner& runner) {
+    Grammar plain;
+    buildProtocol(plain);
+    GrammarOptimizer opt;
+    std::vector<std::string> captures;
+    captures.push_back("<nickname>");
+    captures.push_back("<text>");
+    opt.setCaptureSymbols(captures);
+    Grammar g;
+    g.setOptimizer(&opt);
+    buildProtocol(g);
+    const CompiledGrammar& cg = g.finalize();
+
+    // <letter>, <digit> and <special> are inlined, then fused with '|' '^'
+    const Expression* nc = root(g, "<nick-char>");
+    ASSERT_EQ(runner, nc->type, Expression::EXPR_CHAR_CLASS);
+    ASSERT_EQ(runner, nc->charBitmap.count(), 70u);
+    ASSERT_EQ(runner, root(g, "<nickname>")->children[0]->type, Expression::EXPR_CHAR_CLASS);
+    ASSERT_TRUE(runner, opt.getStats().rewrites[GrammarOptimizer::PASS_INLINE_RULES] > 0);
+
+    // Captured rules keep their symbol references
+    const Expression* msg = root(g, "<message>")->children[0];
+    ASSERT_EQ(runner, msg->children[2]->type, Expression::EXPR_SYMBOL);
+    ASSERT_EQ(runner, msg->children[2]->value, "<nickname>");
+    ASSERT_EQ(runner, msg->children[5]->value, "<text>");
+
+    BNFParser a(plain);
+    BNFParser b(cg);
+    BNFParser it(cg);
+    it.setEngine(BNFParser::ENGINE_ITERATIVE);
+    VMParser vm(g);
+    const char* inputs[] = { "MSG alice :Hello there!\r\n", "MSG x|y^[z] :a b c\r\n",
+                             "PING\r\n", "MSG 9bad :x\r\n", "MSG bob :unterminated" };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+        size_t c1 = 0, c2 = 0, c3 = 0, c4 = 0;
+        ASTNode* ta = a.parse("<message>", inputs[i], c1);
+        ASTNode* tb = b.parse("<message>", inputs[i], c2);
+        ASTNode* tc = it.parse("<message>", inputs[i], c3);
+        ASTNode* td = vm.parse("<message>", inputs[i], c4);
+        ASSERT_EQ(runner, ta != 0, tb != 0);
+        ASSERT_EQ(runner, tb != 0, tc != 0);
+        ASSERT_EQ(runner, tb != 0, td != 0);
+        ASSERT_EQ(runner, c1, c2);
+        ASSERT_EQ(runner, c1, c3);
+        ASSERT_EQ(runner, c1, c4);
+        if (ta && tb) {
+            ExtractedData da = extractNamed(ta);
+            ExtractedData db = extractNamed(tb);
+            ASSERT_EQ(runner, da.first("<nickname>"), db.first("<nickname>"));
+            ASSERT_EQ(runner, da.first("<text>"), db.first("<text>"));
+            ASSERT_EQ(runner, db.count("<letter>"), 0u);
+        }
+        delete ta;
+        delete tb;
+        delete tc;
+        delete td;
+    }
+}
+
+void test_inline_limits(TestRunner& runner) {
+    GrammarOptimizer opt;
+    opt.setInlineBudget(4);
+    Grammar g;
+    g.setOptimizer(&opt);
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<item> ::= <digit> { <digit> }");
+    g.addRule("<list> ::= <item> [ ',' <list> ]");
+    g.addRule("<pair> ::= <list> ';' <list> | <missing>");
+    g.addRule("<wide> ::= <pair> ':' <pair> ':' <pair> ':' <pair>");
+    g.addRule("<start> ::= <wide> | <item>");
+    g.finalize();
+
+    // <item> is inlined (4 nodes once <digit> is); <list> is recursive,
+    // <pair> is over budget and <missing> is undefined
+    const Expression* list = root(g, "<list>");
+    ASSERT_EQ(runner, list->children[0]->type, Expression::EXPR_SEQUENCE);
+    ASSERT_EQ(runner, list->children[1]->children[0]->children[1]->value, "<list>");
+    const Expression* pair = root(g, "<pair>");
+    ASSERT_EQ(runner, pair->children[0]->children[0]->value, "<list>");
+    ASSERT_EQ(runner, pair->children[1]->value, "<missing>");
+    ASSERT_EQ(runner, root(g, "<wide>")->children[0]->value, "<pair>");
+    ASSERT_EQ(runner, root(g, "<start>")->children[0]->value, "<wide>");
+
+    BNFParser p(g.finalize());
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<start>", "1,22;333,4:5;6:7;8:9;0", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 22u);
+    delete ast;
+
+    // Disabled: finalize() leaves every reference alone
+    GrammarOptimizer off;
+    off.setPass(GrammarOptimizer::PASS_INLINE_RULES, false);
+    Grammar g2;
+    g2.setOptimizer(&off);
+    g2.addRule("<digit> ::= '0' ... '9'");
+    g2.addRule("<item> ::= <digit> { <digit> }");
+    g2.finalize();
+    ASSERT_EQ(runner, root(g2, "<item>")->children[0]->type, Expression::EXPR_SYMBOL);
+    ASSERT_EQ(runner, off.getStats().rewrites[GrammarOptimizer::PASS_INLINE_RULES], 0u);
+}
+
+static void buildCommands(Grammar& g) {
+    g.addRule("<space> ::= ' ' { ' ' }");
+    g.addRule("<word> ::= ( 'a' ... 'z' ) { ( 'a' ... 'z' ) }");
+    g.addRule("<cmd> ::= 'PRIVMSG' <space> <word> <space> ':' <word> | 'PRIVMSG' <space> <word> | 'PRIVMSG' <space>");
+    g.addRule("<tail> ::= <word> | <word> ':' <word>");
+    g.addRule("<empties> ::= [ 'x' ] | [ 'x' ] [ 'y' ]");
+}
+
+void test_factor_prefixes(TestRunner& runner) {
+    Grammar plain;
+    buildCommands(plain);
+    GrammarOptimizer opt;
+    opt.setAllPasses(false);
+    opt.setPass(GrammarOptimizer::PASS_FACTOR_PREFIXES, true);
+    Grammar g;
+    g.setOptimizer(&opt);
+    buildCommands(g);
+    ASSERT_EQ(runner, root(g, "<cmd>")->factorPrefix, 2u);
+    ASSERT_EQ(runner, root(g, "<tail>")->factorPrefix, 1u);
+    ASSERT_EQ(runner, root(g, "<empties>")->factorPrefix, 1u);
+    ASSERT_EQ(runner, opt.getStats().rewrites[GrammarOptimizer::PASS_FACTOR_PREFIXES], 3u);
+
+    BNFParser a(plain);
+    BNFParser b(g);
+    BNFParser memo(g);
+    memo.setMemoization(true);
+    BNFParser it(g);
+    it.setEngine(BNFParser::ENGINE_ITERATIVE);
+
+    const char* rules[] = { "<cmd>", "<tail>", "<empties>" };
+    const char* inputs[] = { "PRIVMSG bob :hi", "PRIVMSG bob", "PRIVMSG  ", "PRIV",
+                             "abc:def", "abc:", "", "x", "y", "xy", "z" };
+    for (size_t r = 0; r < 3; ++r) {
+        for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+            size_t c1 = 0, c2 = 0, c3 = 0, c4 = 0, c5 = 0, c6 = 0;
+            ASTNode* ta = a.parse(rules[r], inputs[i], c1);
+            ASTNode* tb = b.parse(rules[r], inputs[i], c2);
+            ASTNode* tc = memo.parse(rules[r], inputs[i], c3);
+            ASTNode* td = it.parse(rules[r], inputs[i], c4);
+            bool ok = b.recognize(rules[r], inputs[i], c5);
+            bool okPlain = a.recognize(rules[r], inputs[i], c6);
+            ASSERT_TRUE(runner, sameSpans(ta, tb));
+            ASSERT_TRUE(runner, sameSpans(ta, tc));
+            ASSERT_TRUE(runner, sameSpans(ta, td));
+            ASSERT_EQ(runner, c1, c2);
+            ASSERT_EQ(runner, c1, c3);
+            ASSERT_EQ(runner, c1, c4);
+            ASSERT_EQ(runner, c1, c5);
+            ASSERT_EQ(runner, ok, okPlain);
+            ASSERT_EQ(runner, c5, c6);
+            delete ta;
+            delete tb;
+            delete tc;
+            delete td;
+        }
+    }
+
+    // Arena trees are built the same way
+    Arena arena;
+    size_t c1 = 0, c2 = 0;
+    std::string input = "PRIVMSG alice :hello";
+    ASTNode* ta = a.parse("<cmd>", input, c1);
+    ASTNode* tb = b.parse("<cmd>", input, c2, arena);
+    ASSERT_EQ(runner, c2, input.size());
+    ASSERT_TRUE(runner, sameSpans(ta, tb));
+    delete ta;
+}
+
+int main() {
+    TestSuite suite("Grammar Optimizer Test Suite");
+    suite.addTest("Fuse Whole Alternative", test_fuse_whole_alternative);
+    suite.addTest("Fuse Partial Alternative", test_fuse_partial_alternative);
+    suite.addTest("Merge Literals", test_merge_literals);
+    suite.addTest("Passes Switchable", test_passes_switchable);
+    suite.addTest("Same Language And Extraction", test_same_language_and_extraction);
+    suite.addTest("Arena And Interner", test_arena_and_interner);
+    suite.addTest("Factor Prefixes", test_factor_prefixes);
+    suite.addTest("Inline Small Rules", test_inline_small_rules);
+    suite.addTest("Inline Limits", test_inline_limits);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
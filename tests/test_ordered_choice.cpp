@@ -0,0 +1,183 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/GrammarOptimizer.hpp"
+#include <string>
+
+static void buildChoices(Grammar& g) {
+    g.addRule("<short-first> ::= 'a' | 'a' 'b'");
+    g.addRule("<command> ::= 'PRIV' | 'PRIVMSG' | 'NICK' | 'JOIN' | 'PART'");
+    g.addRule("<line> ::= <command> [ ' ' <short-first> ]");
+    // Left-recursive: under ordered choice the first branch wins every
+    // round of seed growing, so the match never gets past "a"
+    g.addRule("<loop> ::= 'a' | <loop> 'b'");
+}
+
+void test_first_match_wins(TestRunner& runner) {
+    Grammar g;
+    buildChoices(g);
+    const CompiledGrammar& cg = g.finalize();
+
+    for (int e = 0; e < 2; ++e) {
+        BNFParser longest(cg), ordered(cg);
+        BNFParser::Engine engine = e ? BNFParser::ENGINE_ITERATIVE : BNFParser::ENGINE_RECURSIVE;
+        longest.setEngine(engine);
+        ordered.setEngine(engine);
+        ordered.setOrderedChoice(true);
+
+        size_t c1 = 0, c2 = 0;
+        ASTNode* a = longest.parse("<short-first>", "ab", c1);
+        ASTNode* b = ordered.parse("<short-first>", "ab", c2);
+        ASSERT_EQ(runner, c1, 2u);
+        ASSERT_EQ(runner, c2, 1u);
+        ASSERT_NOT_NULL(runner, b);
+        ASSERT_EQ(runner, b->matched, "a");
+        delete a;
+        delete b;
+
+        // Keyword tries pick the lowest branch instead of the longest literal
+        ASSERT_TRUE(runner, longest.recognize("<command>", "PRIVMSG", c1));
+        ASSERT_TRUE(runner, ordered.recognize("<command>", "PRIVMSG", c2));
+        ASSERT_EQ(runner, c1, 7u);
+        ASSERT_EQ(runner, c2, 4u);
+        ASSERT_TRUE(runner, ordered.recognize("<command>", "JOIN", c2));
+        ASSERT_EQ(runner, c2, 4u);
+        ASSERT_FALSE(runner, ordered.recognize("<command>", "PRI", c2));
+    }
+}
+
+void test_later_branches_skipped(TestRunner& runner) {
+    Grammar g;
+    buildChoices(g);
+    const CompiledGrammar& cg = g.finalize();
+
+    BNFParser ordered(cg);
+    ordered.setOrderedChoice(true);
+    size_t consumed = 0;
+    ASSERT_TRUE(runner, ordered.recognize("<loop>", "abb", consumed));
+    ASSERT_EQ(runner, consumed, 1u);
+
+    BNFParser orderedIt(cg), longestIt(cg);
+    orderedIt.setEngine(BNFParser::ENGINE_ITERATIVE);
+    longestIt.setEngine(BNFParser::ENGINE_ITERATIVE);
+    orderedIt.setOrderedChoice(true);
+    orderedIt.setMaxDepth(64);
+    longestIt.setMaxDepth(64);
+
+    ASSERT_TRUE(runner, orderedIt.recognize("<loop>", "abb", consumed));
+    ASSERT_EQ(runner, consumed, 1u);
+    ASSERT_EQ(runner, orderedIt.getStats().depthAborts, 0u);
+    // Longest match grows the left-recursive branch over every 'b'
+    ASSERT_TRUE(runner, longestIt.recognize("<loop>", "abb", consumed));
+    ASSERT_EQ(runner, consumed, 3u);
+    ASSERT_EQ(runner, longestIt.getStats().depthAborts, 0u);
+}
+
+void test_rule_overrides(TestRunner& runner) {
+    Grammar g;
+    buildChoices(g);
+    BNFParser p(g);
+    p.setRuleOrderedChoice("<command>", true);
+
+    // <command> is ordered, the <short-first> it leads to is not
+    size_t consumed = 0;
+    ASSERT_TRUE(runner, p.recognize("<line>", "PRIVMSG ab", consumed));
+    ASSERT_EQ(runner, consumed, 4u);
+    ASSERT_TRUE(runner, p.recognize("<line>", "PRIV ab", consumed));
+    ASSERT_EQ(runner, consumed, 7u);
+
+    // Global ordered choice with one rule opted back out
+    p.setOrderedChoice(true);
+    p.setRuleOrderedChoice("<command>", false);
+    ASSERT_TRUE(runner, p.recognize("<line>", "PRIVMSG ab", consumed));
+    ASSERT_EQ(runner, consumed, 9u);
+    ASSERT_TRUE(runner, p.recognize("<short-first>", "ab", consumed));
+    ASSERT_EQ(runner, consumed, 1u);
+}
+
+void test_factored_alternative(TestRunner& runner) {
+    GrammarOptimizer opt;
+    opt.setAllPasses(false);
+    opt.setPass(GrammarOptimizer::PASS_FACTOR_PREFIXES, true);
+    Grammar g;
+    g.setOptimizer(&opt);
+    g.addRule("<k> ::= 'k'");
+    g.addRule("<a> ::= 'a'");
+    g.addRule("<b> ::= 'b'");
+    g.addRule("<f> ::= <k> <a> | <k> <a> <b>");
+    const CompiledGrammar& cg = g.finalize();
+    ASSERT_EQ(runner, g.getRule("<f>")->rootExpr->factorPrefix, 2u);
+
+    BNFParser rec(cg), it(cg);
+    rec.setOrderedChoice(true);
+    it.setOrderedChoice(true);
+    it.setEngine(BNFParser::ENGINE_ITERATIVE);
+    size_t c1 = 0, c2 = 0;
+    ASTNode* a = rec.parse("<f>", "kab", c1);
+    ASTNode* b = it.parse("<f>", "kab", c2);
+    ASSERT_EQ(runner, c1, 2u);
+    ASSERT_EQ(runner, c2, 2u);
+    ASSERT_NOT_NULL(runner, a);
+    ASSERT_NOT_NULL(runner, b);
+    ASSERT_EQ(runner, a->children[0]->children.size(), 2u);
+    ASSERT_EQ(runner, b->children[0]->children.size(), 2u);
+    delete a;
+    delete b;
+}
+
+void test_optimized_grammar(TestRunner& runner) {
+    // Fusing 'a' with 'x' would move 'x' ahead of 'x' 'y'
+    Grammar plain, optimized;
+    GrammarOptimizer opt;
+    optimized.setOptimizer(&opt);
+    plain.addRule("<r> ::= 'a' | 'x' 'y' | 'x'");
+    plain.addRule("<s> ::= 'a' | 'b' | 'x' 'y' | 'x' | 'z'");
+    optimized.addRule("<r> ::= 'a' | 'x' 'y' | 'x'");
+    optimized.addRule("<s> ::= 'a' | 'b' | 'x' 'y' | 'x' | 'z'");
+    const CompiledGrammar& cg = optimized.finalize();
+
+    // Only adjacent single-byte branches are fused, in place
+    const Expression* r = optimized.getRule("<r>")->rootExpr;
+    ASSERT_EQ(runner, r->children.size(), 3u);
+    const Expression* s = optimized.getRule("<s>")->rootExpr;
+    ASSERT_EQ(runner, s->children.size(), 3u);
+    ASSERT_EQ(runner, s->children[0]->type, Expression::EXPR_CHAR_CLASS);
+    ASSERT_EQ(runner, s->children[2]->type, Expression::EXPR_CHAR_CLASS);
+
+    const char* rules[] = { "<r>", "<s>" };
+    const char* inputs[] = { "xy", "x", "a", "b", "z", "q" };
+    for (int e = 0; e < 2; ++e) {
+        BNFParser a(plain), b(cg);
+        BNFParser::Engine engine = e ? BNFParser::ENGINE_ITERATIVE : BNFParser::ENGINE_RECURSIVE;
+        a.setEngine(engine);
+        b.setEngine(engine);
+        a.setOrderedChoice(true);
+        b.setOrderedChoice(true);
+        for (size_t k = 0; k < 2; ++k) {
+            for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+                size_t c1 = 0, c2 = 0;
+                bool ok1 = a.recognize(rules[k], inputs[i], c1);
+                bool ok2 = b.recognize(rules[k], inputs[i], c2);
+                ASSERT_EQ(runner, ok1, ok2);
+                ASSERT_EQ(runner, c1, c2);
+            }
+        }
+    }
+    size_t consumed = 0;
+    BNFParser ordered(cg);
+    ordered.setOrderedChoice(true);
+    ASSERT_TRUE(runner, ordered.recognize("<r>", "xy", consumed));
+    ASSERT_EQ(runner, consumed, 2u);
+}
+
+int main() {
+    TestSuite suite("Ordered Choice Test Suite");
+    suite.addTest("First Match Wins", test_first_match_wins);
+    suite.addTest("Later Branches Skipped", test_later_branches_skipped);
+    suite.addTest("Rule Overrides", test_rule_overrides);
+    suite.addTest("Factored Alternative", test_factored_alternative);
+    suite.addTest("Optimized Grammar", test_optimized_grammar);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
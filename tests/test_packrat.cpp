@@ -0,0 +1,175 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "TestHelpers.hpp"
+#include <string>
+
+// Grammar where every alternative re-parses <word> at the same offset
+static void buildBacktrackingGrammar(Grammar& g) {
+    g.addRule("<letter> ::= 'a' ... 'z'");
+    g.addRule("<word> ::= <letter> { <letter> }");
+    g.addRule("<cmd> ::= <word> ':' | <word> ';' | <word> '!' | <word>");
+}
+
+void test_packrat_same_ast(TestRunner& runner) {
+    Grammar g;
+    buildBacktrackingGrammar(g);
+
+    BNFParser plain(g);
+    BNFParser packrat(g);
+    packrat.setMemoization(true);
+
+    const char* inputs[] = { "hello!", "abc;", "xyz", "q:", "" };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+        size_t c1 = 0, c2 = 0;
+        ASTNode* a = plain.parse("<cmd>", inputs[i], c1);
+        ASTNode* b = packrat.parse("<cmd>", inputs[i], c2);
+        ASSERT_EQ(runner, c1, c2);
+        ASSERT_TRUE(runner, sameTree(a, b));
+        delete a;
+        delete b;
+    }
+}
+
+void test_packrat_hits(TestRunner& runner) {
+    Grammar g;
+    buildBacktrackingGrammar(g);
+
+    BNFParser p(g);
+    p.setMemoization(true);
+
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<cmd>", "hello!", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 6u);
+    // <word> at offset 0 is parsed once and then served to the other branches
+    ASSERT_GE(runner, p.getStats().memoHits, 2u);
+    ASSERT_GT(runner, p.getStats().memoStores, 0u);
+    delete ast;
+
+    p.resetStats();
+    ASSERT_EQ(runner, p.getStats().memoHits, 0u);
+}
+
+void test_packrat_rule_opt_out(TestRunner& runner) {
+    Grammar g;
+    buildBacktrackingGrammar(g);
+
+    BNFParser p(g);
+    p.setMemoization(true);
+    p.setRuleMemoization("<word>", false);
+    p.setRuleMemoization("<letter>", false);
+
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<cmd>", "abc;", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 4u);
+    ASSERT_EQ(runner, p.getStats().memoHits, 0u);
+    delete ast;
+}
+
+void test_packrat_rule_opt_in(TestRunner& runner) {
+    Grammar g;
+    buildBacktrackingGrammar(g);
+
+    BNFParser p(g);
+    p.setRuleMemoization("<word>", true);
+
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<cmd>", "abc", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, ast->matched, "abc");
+    ASSERT_GE(runner, p.getStats().memoHits, 2u);
+    delete ast;
+}
+
+void test_packrat_memory_cap(TestRunner& runner) {
+    Grammar g;
+    buildBacktrackingGrammar(g);
+
+    BNFParser p(g);
+    p.setMemoization(true);
+    p.setMemoLimit(0);
+
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<cmd>", "hello!", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 6u);
+    ASSERT_EQ(runner, p.getStats().memoStores, 0u);
+    ASSERT_GT(runner, p.getStats().memoRejected, 0u);
+    ASSERT_EQ(runner, p.getStats().memoHits, 0u);
+    delete ast;
+}
+
+// Every <e> parses its nested <p>, fails on the missing suffix and gets
+// the same <p> from the memo for the other two branches
+static void buildNestedGrammar(Grammar& g) {
+    g.addRule("<e> ::= <p> '+' | <p> '-' | <p>");
+    g.addRule("<p> ::= '(' <e> ')' | 'a'");
+}
+
+static std::string nested(size_t depth) {
+    return std::string(depth, '(') + "a" + std::string(depth, ')');
+}
+
+void test_packrat_linear_work(TestRunner& runner) {
+    Grammar g;
+    buildNestedGrammar(g);
+
+    for (int e = 0; e < 2; ++e) {
+        BNFParser p(g);
+        p.setMemoization(true);
+        p.setEngine(e ? BNFParser::ENGINE_ITERATIVE : BNFParser::ENGINE_RECURSIVE);
+
+        size_t previous = 0;
+        for (size_t depth = 64; depth <= 512; depth *= 2) {
+            std::string input = nested(depth);
+            p.resetStats();
+            size_t consumed = 0;
+            ASTNode* ast = p.parse("<e>", input, consumed);
+            ASSERT_NOT_NULL(runner, ast);
+            ASSERT_EQ(runner, consumed, input.size());
+            delete ast;
+            // Hits hand out the stored subtree, so the nodes built double
+            // with the input instead of growing with depth times hits
+            size_t built = p.getStats().nodesBuilt;
+            if (previous) ASSERT_LE(runner, built, 2 * previous);
+            previous = built;
+        }
+    }
+}
+
+void test_packrat_shared_nodes(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<y> ::= [ 'a' ]");
+    g.addRule("<x> ::= <y> <y> 'b' | <y> <y> 'c'");
+
+    BNFParser plain(g);
+    BNFParser packrat(g);
+    packrat.setMemoization(true);
+
+    // <y> matches empty at offset 0 twice in one tree
+    size_t c1 = 0, c2 = 0;
+    ASTNode* a = plain.parse("<x>", "c", c1);
+    ASTNode* b = packrat.parse("<x>", "c", c2);
+    ASSERT_EQ(runner, c1, 1u);
+    ASSERT_EQ(runner, c2, 1u);
+    ASSERT_TRUE(runner, sameTree(a, b));
+    ASSERT_GT(runner, packrat.getStats().memoHits, 0u);
+    delete a;
+    delete b;
+}
+
+int main() {
+    TestSuite suite("Packrat Memoization Test Suite");
+    suite.addTest("Same AST With And Without Memo", test_packrat_same_ast);
+    suite.addTest("Memo Hits", test_packrat_hits);
+    suite.addTest("Per-Rule Opt-Out", test_packrat_rule_opt_out);
+    suite.addTest("Per-Rule Opt-In", test_packrat_rule_opt_in);
+    suite.addTest("Memory Cap", test_packrat_memory_cap);
+    suite.addTest("Linear Work As Input Doubles", test_packrat_linear_work);
+    suite.addTest("Shared Subtrees", test_packrat_shared_nodes);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/ParallelParser.hpp"
+#include "TestHelpers.hpp"
+#include <sstream>
+#include <string>
+#include <vector>
+
+static void buildGrammar(Grammar& g) {
+    buildWords(g);
+    g.addRule("<list> ::= <word> [ ',' <list> ]");
+}
+
+// Inputs of varying length and outcome, so chunks take uneven time
+static std::vector<std::string> makeInputs(size_t count) {
+    std::vector<std::string> inputs;
+    for (size_t i = 0; i < count; ++i) {
+        std::ostringstream oss;
+        if (i % 7 == 3) oss << i << "bad";
+        for (size_t k = 0; k <= i % 13; ++k) {
+            if (k) oss << ',';
+            oss << "w" << i << "x" << k;
+        }
+        inputs.push_back(oss.str());
+    }
+    return inputs;
+}
+
+// Compare every result of the last parseAll() with a sequential parse()
+static bool matchesSequential(const ParallelParser& pp, const BNFParser& p,
+                              const std::vector<std::string>& inputs, size_t& accepted) {
+    accepted = 0;
+    if (pp.size() != inputs.size()) return false;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        size_t consumed = 0;
+        ASTNode* expected = p.parse("<list>", inputs[i], consumed);
+        ASTNode* got = pp.toAST(i, inputs[i]);
+        bool same = sameTree(expected, got) && pp.entry(i).consumed == consumed;
+        if (expected) ++accepted;
+        delete expected;
+        delete got;
+        if (!same) return false;
+    }
+    return true;
+}
+
+void test_results_in_input_order(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    const CompiledGrammar& cg = g.finalize();
+    BNFParser p(cg);
+    std::vector<std::string> inputs = makeInputs(500);
+
+    for (size_t threads = 1; threads <= 4; ++threads) {
+        ParallelParser pp(cg, threads);
+        pp.setChunkSize(7);
+        ASSERT_EQ(runner, pp.getThreadCount(), threads);
+        size_t accepted = pp.parseAll("<list>", inputs);
+        size_t expected = 0;
+        ASSERT_TRUE(runner, matchesSequential(pp, p, inputs, expected));
+        ASSERT_EQ(runner, accepted, expected);
+    }
+}
+
+void test_repeated_jobs(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    const CompiledGrammar& cg = g.finalize();
+    BNFParser p(cg);
+    ParallelParser pp(cg, 3);
+    pp.setEngine(BNFParser::ENGINE_ITERATIVE);
+    pp.setMemoization(true);
+
+    size_t sizes[] = { 1000, 10, 0, 257 };
+    for (size_t r = 0; r < sizeof(sizes) / sizeof(sizes[0]); ++r) {
+        std::vector<std::string> inputs = makeInputs(sizes[r]);
+        pp.setChunkSize(r + 1);
+        size_t accepted = pp.parseAll("<list>", inputs);
+        size_t expected = 0;
+        ASSERT_TRUE(runner, matchesSequential(pp, p, inputs, expected));
+        ASSERT_EQ(runner, accepted, expected);
+    }
+}
+
+void test_chunk_lookup(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    ParallelParser pp(g.finalize(), 2);
+    pp.setChunkSize(4);
+
+    std::vector<std::string> inputs = makeInputs(10);
+    pp.parseAll("<list>", inputs);
+    size_t local = 0;
+    const BatchResult& r = pp.resultOf(9, local);
+    ASSERT_EQ(runner, local, 1u);
+    ASSERT_EQ(runner, r.size(), 2u);
+    ASSERT_TRUE(runner, r.entries[local].ok);
+    const FlatNode& root = r.nodes[r.entries[local].root];
+    ASSERT_EQ(runner, r.text(root, inputs[9]), inputs[9]);
+}
+
+void test_unknown_rule(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    ParallelParser pp(g.finalize(), 2);
+    std::vector<std::string> inputs = makeInputs(20);
+    size_t accepted = pp.parseAll("<missing>", inputs);
+    ASSERT_EQ(runner, accepted, 0u);
+    ASSERT_EQ(runner, pp.size(), inputs.size());
+    ASSERT_FALSE(runner, pp.entry(5).ok);
+}
+
+int main() {
+    TestSuite suite("Parallel Parser Test Suite");
+    suite.addTest("Results In Input Order", test_results_in_input_order);
+    suite.addTest("Repeated Jobs", test_repeated_jobs);
+    suite.addTest("Chunk Lookup", test_chunk_lookup);
+    suite.addTest("Unknown Rule", test_unknown_rule);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
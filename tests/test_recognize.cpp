@@ -0,0 +1,107 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include <cstdlib>
+#include <new>
+#include <string>
+
+// Count global allocations to check that recognize() stays off the heap
+static size_t allocations = 0;
+
+void* operator new(std::size_t size) throw(std::bad_alloc) {
+    ++allocations;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) throw() {
+    std::free(p);
+}
+
+static void buildNickname(Grammar& g) {
+    g.addRule("<letter> ::= 'a' ... 'z' | 'A' ... 'Z'");
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<special> ::= '_' | '-' | '[' | ']' | '\\\\'");
+    g.addRule("<nick-char> ::= <letter> | <digit> | <special>");
+    g.addRule("<nickname> ::= <letter> { <nick-char> }");
+    g.addRule("<maybe> ::= 'x' | ");
+    g.addRule("<list> ::= <maybe> { <maybe> ',' } [ \"end-of-list\" ]");
+}
+
+void test_recognize_agrees_with_parse(TestRunner& runner) {
+    Grammar g;
+    buildNickname(g);
+    BNFParser rec(g);
+    BNFParser it(g);
+    it.setEngine(BNFParser::ENGINE_ITERATIVE);
+
+    const char* rules[] = { "<nickname>", "<list>" };
+    const char* inputs[] = { "alice", "Bob_42", "user[away]", "9lives", "", "x,,x,end-of-list", ",,", "-" };
+    for (size_t r = 0; r < 2; ++r) {
+        for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+            size_t c1 = 0, c2 = 0, c3 = 0;
+            ASTNode* ast = rec.parse(rules[r], inputs[i], c1);
+            bool ok2 = rec.recognize(rules[r], inputs[i], c2);
+            bool ok3 = it.recognize(rules[r], inputs[i], c3);
+            ASSERT_EQ(runner, ast != 0, ok2);
+            ASSERT_EQ(runner, ok2, ok3);
+            ASSERT_EQ(runner, c1, c2);
+            ASSERT_EQ(runner, c1, c3);
+            delete ast;
+        }
+    }
+}
+
+void test_recognize_no_allocations(TestRunner& runner) {
+    Grammar g;
+    buildNickname(g);
+    const CompiledGrammar& cg = g.finalize();
+    BNFParser rec(cg);
+    BNFParser it(cg);
+    it.setEngine(BNFParser::ENGINE_ITERATIVE);
+
+    std::string input = "a-very-long-nickname-with-digits-0123456789";
+    size_t consumed = 0;
+
+    // Warm up the iterative engine's frame stack
+    ASSERT_TRUE(runner, it.recognize("<nickname>", input, consumed));
+
+    size_t before = allocations;
+    for (int i = 0; i < 100; ++i) {
+        rec.recognize("<nickname>", input, consumed);
+        it.recognize("<nickname>", input, consumed);
+    }
+    size_t used = allocations - before;
+    ASSERT_EQ(runner, used, 0u);
+    ASSERT_EQ(runner, consumed, input.size());
+}
+
+void test_recognize_then_parse(TestRunner& runner) {
+    Grammar g;
+    buildNickname(g);
+    BNFParser p(g);
+    p.setMemoization(true);
+
+    size_t consumed = 0;
+    ASSERT_TRUE(runner, p.recognize("<nickname>", "nick", consumed));
+    ASSERT_EQ(runner, consumed, 4u);
+    ASSERT_FALSE(runner, p.recognize("<nickname>", "1nick", consumed));
+    ASSERT_EQ(runner, consumed, 0u);
+
+    // The parser builds trees again afterwards
+    ASTNode* ast = p.parse("<nickname>", "nick", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, ast->matched, "nick");
+    delete ast;
+}
+
+int main() {
+    TestSuite suite("Recognizer Test Suite");
+    suite.addTest("Agrees With Parse", test_recognize_agrees_with_parse);
+    suite.addTest("No Heap Allocations", test_recognize_no_allocations);
+    suite.addTest("Recognize Then Parse", test_recognize_then_parse);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
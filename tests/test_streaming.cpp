@@ -0,0 +1,181 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/ParseSession.hpp"
+#include "TestHelpers.hpp"
+#include <string>
+
+static void buildProtocol(Grammar& g) {
+    g.addRule("<letter> ::= 'A' ... 'Z' | 'a' ... 'z'");
+    g.addRule("<digit> ::= '0' ... '9'");
+    g.addRule("<word> ::= <letter> { <letter> | <digit> }");
+    g.addRule("<command> ::= \"PING\" | \"PRIVMSG\" | \"PASS\" | <word>");
+    g.addRule("<params> ::= { ' ' <word> }");
+    g.addRule("<message> ::= <command> <params> '\r' '\n'");
+    g.addRule("<number> ::= <digit> { <digit> }");
+}
+
+// Session calls have side effects, so their status is stored before
+// checking it (ASSERT_EQ evaluates its arguments more than once)
+void test_byte_by_byte_matches_parse(TestRunner& runner) {
+    Grammar g;
+    buildProtocol(g);
+    BNFParser p(g.finalize());
+
+    const char* inputs[] = { "PING srv1\r\n", "PRIVMSG bob hi\r\n", "PASS\r\n", "NICK alice\r\n" };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+        std::string input = inputs[i];
+        size_t consumed = 0;
+        ASTNode* expected = p.parse("<message>", input, consumed);
+        ASSERT_NOT_NULL(runner, expected);
+
+        ParseSession session(p, "<message>");
+        ParseSession::Status st;
+        for (size_t k = 0; k + 1 < input.size(); ++k) {
+            st = session.feed(&input[k], 1);
+            ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+        }
+        // The result is available as soon as the final byte arrives
+        st = session.feed(&input[input.size() - 1], 1);
+        ASSERT_EQ(runner, st, ParseSession::COMPLETE);
+        ASSERT_EQ(runner, session.consumed(), consumed);
+        ASTNode* ast = session.takeResult();
+        ASSERT_TRUE(runner, sameSpans(expected, ast));
+        delete ast;
+        delete expected;
+    }
+}
+
+void test_several_messages_per_chunk(TestRunner& runner) {
+    Grammar g;
+    buildProtocol(g);
+    BNFParser p(g);
+    ParseSession session(p, "<message>");
+    ParseSession::Status st;
+
+    std::string stream = "PING a\r\nPASS b\r\nPRIV";
+    st = session.feed(stream);
+    ASSERT_EQ(runner, st, ParseSession::COMPLETE);
+    ASTNode* first = session.takeResult();
+    ASSERT_NOT_NULL(runner, first);
+    ASSERT_EQ(runner, first->matched, "PING a\r\n");
+    delete first;
+
+    st = session.poll();
+
+    ASSERT_EQ(runner, st, ParseSession::COMPLETE);
+    ASTNode* second = session.takeResult();
+    ASSERT_EQ(runner, second->matched, "PASS b\r\n");
+    delete second;
+
+    st = session.poll();
+
+    ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+    st = session.feed("MSG x y\r");
+    ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+    st = session.feed("\n");
+    ASSERT_EQ(runner, st, ParseSession::COMPLETE);
+    ASTNode* third = session.takeResult();
+    ASSERT_EQ(runner, third->matched, "PRIVMSG x y\r\n");
+    delete third;
+
+    st = session.poll();
+
+    ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+    st = session.finish();
+    ASSERT_EQ(runner, st, ParseSession::END_OF_STREAM);
+    ASSERT_EQ(runner, session.buffered(), 0u);
+}
+
+void test_trailing_repetition_needs_finish(TestRunner& runner) {
+    Grammar g;
+    buildProtocol(g);
+    BNFParser p(g);
+
+    ParseSession session(p, "<number>");
+    ParseSession::Status st;
+    st = session.feed("12");
+    ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+    st = session.feed("34");
+    ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+    st = session.finish();
+    ASSERT_EQ(runner, st, ParseSession::COMPLETE);
+    ASSERT_EQ(runner, session.consumed(), 4u);
+    ASTNode* ast = session.takeResult();
+    ASSERT_EQ(runner, ast->matched, "1234");
+    delete ast;
+    st = session.poll();
+    ASSERT_EQ(runner, st, ParseSession::END_OF_STREAM);
+
+    // A byte that cannot continue the repetition ends the message too
+    ParseSession delimited(p, "<number>");
+    st = delimited.feed("56;");
+    ASSERT_EQ(runner, st, ParseSession::COMPLETE);
+    ASSERT_EQ(runner, delimited.consumed(), 2u);
+    delete delimited.takeResult();
+    ASSERT_EQ(runner, delimited.buffered(), 1u);
+}
+
+void test_failure_and_reset(TestRunner& runner) {
+    Grammar g;
+    buildProtocol(g);
+    BNFParser p(g);
+
+    ParseSession session(p, "<message>");
+    ParseSession::Status st;
+    st = session.feed("PING");
+    ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+    st = session.feed(" 9x");
+    ASSERT_EQ(runner, st, ParseSession::FAILED);
+    ASSERT_NULL(runner, session.takeResult());
+    st = session.feed("more");
+    ASSERT_EQ(runner, st, ParseSession::FAILED);
+
+    session.reset();
+    st = session.feed("PING ok\r\n");
+    ASSERT_EQ(runner, st, ParseSession::COMPLETE);
+    delete session.takeResult();
+
+    // Abandoning a suspended message frees its partial tree
+    st = session.feed("PRIVMSG a b c");
+    ASSERT_EQ(runner, st, ParseSession::NEED_MORE);
+    session.reset();
+    ASSERT_EQ(runner, session.buffered(), 0u);
+
+    ParseSession unknown(p, "<missing>");
+    st = unknown.feed("x");
+    ASSERT_EQ(runner, st, ParseSession::FAILED);
+}
+
+void test_idle_session_is_small(TestRunner& runner) {
+    Grammar g;
+    buildProtocol(g);
+    BNFParser p(g);
+
+    ParseSession session(p, "<message>");
+    ParseSession::Status st;
+    st = session.feed("PING a\r\n");
+    ASSERT_EQ(runner, st, ParseSession::COMPLETE);
+    delete session.takeResult();
+    session.shrink();
+    ASSERT_EQ(runner, session.buffered(), 0u);
+    ASSERT_TRUE(runner, sizeof(ParseSession) <= 128);
+
+    // The parser is still usable for ordinary parses
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<message>", "PASS x\r\n", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    delete ast;
+}
+
+int main() {
+    TestSuite suite("Streaming Session Test Suite");
+    suite.addTest("Byte-By-Byte Matches Parse", test_byte_by_byte_matches_parse);
+    suite.addTest("Several Messages Per Chunk", test_several_messages_per_chunk);
+    suite.addTest("Trailing Repetition Needs Finish", test_trailing_repetition_needs_finish);
+    suite.addTest("Failure And Reset", test_failure_and_reset);
+    suite.addTest("Idle Session Is Small", test_idle_session_is_small);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
@@ -0,0 +1,328 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/BatchResult.hpp"
+#include "../include/GrammarOptimizer.hpp"
+#include "TestHelpers.hpp"
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+// Count the bytes allocated, to check that no log outlives its parse
+static size_t allocatedBytes = 0;
+
+void* operator new(std::size_t size) throw(std::bad_alloc) {
+    allocatedBytes += size;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) throw() {
+    std::free(p);
+}
+
+static size_t countNodes(const ASTNode* n) {
+    if (!n) return 0;
+    size_t count = 1;
+    for (size_t i = 0; i < n->children.size(); ++i)
+        count += countNodes(n->children[i]);
+    return count;
+}
+
+// Alternatives that share long prefixes, so most branches fail late
+static void buildCalls(Grammar& g) {
+    g.addRule("<prog> ::= <stmt> { <stmt> }");
+    g.addRule("<stmt> ::= <call> '=' <call> ';' | <call> '(' ')' ';' | <call> ';' | <empty> '.'");
+    g.addRule("<call> ::= <name> '(' <args> ')' | <name> '[' <args> ']' | <name> [ '?' ]");
+    g.addRule("<args> ::= [ <call> { ',' <call> } ]");
+    g.addRule("<name> ::= ( 'a' ... 'z' ) { ( 'a' ... 'z' '0' ... '9' ) }");
+    // Only empty matches: the alternative builds no node
+    g.addRule("<empty> ::= [ 'x' ] | { 'y' }");
+}
+
+static const char* const callInputs[] = {
+    "f(a,b[c]);", "x=g(h(i),j?);", "k();.", "a;b(c);d=e;", "f(a,b[c]", "f((", "", ".",
+    "xy;", "p(q[r(s,t)],u)=v[w];f();"
+};
+
+static void buildArithmetic(Grammar& g) {
+    g.addRule("<expr> ::= <expr> '+' <term> | <expr> '-' <term> | <term>");
+    g.addRule("<term> ::= <term> '*' <factor> | <factor>");
+    g.addRule("<factor> ::= '0' ... '9' | '(' <expr> ')'");
+    g.addRule("<list> ::= <list> ',' <expr> | <expr>");
+    g.addRule("<start> ::= <list>");
+}
+
+static const char* const arithmeticInputs[] = {
+    "1+2*3-4", "7", "(1-2)*3", "1,2*(3+4),5", "1+", "*", "((2))", "9-8-7*6*5,4"
+};
+
+static void buildOperators(Grammar& g) {
+    g.addOperatorRule("<expr> ::= <unary>", "left '||' | left '+' '-' | left '*' '/' | right '^'");
+    g.addRule("<unary> ::= <num> | '(' <expr> ')' | '-' <unary>");
+    g.addRule("<num> ::= ( '0' ... '9' ) { ( '0' ... '9' ) }");
+    g.addRule("<start> ::= <expr>");
+}
+
+static const char* const operatorInputs[] = {
+    "1+2*3-4", "2^3^4", "1||2+3*4^5^6/7-8", "(1+2)*-3", "1+", "-", "10/5/2", ""
+};
+
+// Parses every input with a direct and a two-phase parser of the same
+// configuration and checks that results and trees agree
+static void compareAll(TestRunner& runner, BNFParser& direct, BNFParser& twoPhase,
+                       const std::string& rule, const char* const* inputs, size_t count,
+                       size_t entryCall, bool exact) {
+    for (size_t i = 0; i < count; ++i) {
+        size_t c0 = 0, c1 = 0;
+        direct.resetStats();
+        ASTNode* expected = direct.parse(rule, inputs[i], c0);
+        twoPhase.resetStats();
+        ASTNode* ast = twoPhase.parse(rule, inputs[i], c1);
+        ASSERT_EQ(runner, c1, c0);
+        ASSERT_EQ(runner, ast != 0, expected != 0);
+        ASSERT_TRUE(runner, sameTree(ast, expected));
+        // Only the final tree is built, and the symbol node of the entry
+        // call a left-recursive or operator start rule drops
+        ASSERT_TRUE(runner, twoPhase.getStats().nodesBuilt <= direct.getStats().nodesBuilt);
+        if (exact)
+            ASSERT_EQ(runner, twoPhase.getStats().nodesBuilt, countNodes(ast) + (ast ? entryCall : 0));
+        bool matched = expected != 0;
+        delete ast;
+        delete expected;
+
+        bool ok = twoPhase.recognize(rule, inputs[i], c1);
+        ASSERT_EQ(runner, ok, matched);
+        ASSERT_EQ(runner, c1, c0);
+    }
+}
+
+#define COMPARE(runner, a, b, rule, inputs) \
+    compareAll(runner, a, b, rule, inputs, sizeof(inputs) / sizeof(inputs[0]), 0, true)
+#define COMPARE_ENTRY(runner, a, b, rule, inputs) \
+    compareAll(runner, a, b, rule, inputs, sizeof(inputs) / sizeof(inputs[0]), 1, true)
+// A chain that prediction matches is folded, which drops its structural nodes
+#define COMPARE_FOLDED(runner, a, b, rule, inputs) \
+    compareAll(runner, a, b, rule, inputs, sizeof(inputs) / sizeof(inputs[0]), 0, false)
+
+void test_same_tree(TestRunner& runner) {
+    Grammar lazyCalls, lazyArith, lazyOps, calls, arith, ops;
+    buildCalls(lazyCalls);
+    buildArithmetic(lazyArith);
+    buildOperators(lazyOps);
+    buildCalls(calls);
+    buildArithmetic(arith);
+    buildOperators(ops);
+    const CompiledGrammar& cgCalls = calls.finalize();
+    const CompiledGrammar& cgArith = arith.finalize();
+    const CompiledGrammar& cgOps = ops.finalize();
+
+    // Unlinked and linked grammars
+    BNFParser a(lazyCalls), b(lazyCalls), c(cgCalls), d(cgCalls);
+    b.setTwoPhase(true);
+    d.setTwoPhase(true);
+    COMPARE(runner, a, b, "<prog>", callInputs);
+    COMPARE(runner, c, d, "<prog>", callInputs);
+
+    // Left recursion replays its growth rounds
+    BNFParser e(lazyArith), f(lazyArith), g(cgArith), h(cgArith);
+    f.setTwoPhase(true);
+    h.setTwoPhase(true);
+    COMPARE_ENTRY(runner, e, f, "<list>", arithmeticInputs);
+    COMPARE_ENTRY(runner, g, h, "<list>", arithmeticInputs);
+    COMPARE(runner, g, h, "<start>", arithmeticInputs);
+
+    // Precedence climbing replays the operator of each step
+    BNFParser i(lazyOps), j(lazyOps), k(cgOps), l(cgOps);
+    j.setTwoPhase(true);
+    l.setTwoPhase(true);
+    COMPARE_ENTRY(runner, i, j, "<expr>", operatorInputs);
+    COMPARE_ENTRY(runner, k, l, "<expr>", operatorInputs);
+    COMPARE(runner, k, l, "<start>", operatorInputs);
+}
+
+void test_options(TestRunner& runner) {
+    Grammar calls, arith, ops;
+    buildCalls(calls);
+    buildArithmetic(arith);
+    buildOperators(ops);
+    // A regular rule that a DFA may match, and runs of one byte class
+    calls.addRule("<ident> ::= ( 'a' ... 'z' '_' ) { ( 'a' ... 'z' '_' '0' ... '9' ) }");
+    calls.addRule("<decl> ::= <ident> ':' <ident> [ '=' <call> ] ';' | <ident> ';'");
+    const CompiledGrammar& cgCalls = calls.finalize();
+    const CompiledGrammar& cgArith = arith.finalize();
+    const CompiledGrammar& cgOps = ops.finalize();
+    static const char* const declInputs[] = {
+        "ab_1:int=f(x);", "ab:int;", "q;", "x:y=;", "x:y=z[a,b]?;"
+    };
+
+    for (int option = 0; option < 6; ++option) {
+        BNFParser d0(cgCalls), d1(cgArith), d2(cgOps), t0(cgCalls), t1(cgArith), t2(cgOps);
+        BNFParser* all[] = { &d0, &d1, &d2, &t0, &t1, &t2 };
+        for (int n = 0; n < 6; ++n) {
+            BNFParser& p = *all[n];
+            p.setTwoPhase(n >= 3);
+            switch (option) {
+                case 0: p.setMemoization(true); break;
+                case 1: p.setOrderedChoice(true); break;
+                case 2: p.setPredictive(true); break;
+                case 3: p.setCollapseRuns(true); break;
+                case 4: p.setCollapseRegular(true); break;
+                default:
+                    p.setDispatch(false);
+                    p.setKeywordTries(false);
+                    p.setFirstPairs(false);
+                    break;
+            }
+        }
+        COMPARE(runner, d0, t0, "<prog>", callInputs);
+        COMPARE(runner, d0, t0, "<decl>", declInputs);
+        COMPARE(runner, d1, t1, "<start>", arithmeticInputs);
+        if (option == 2) COMPARE_FOLDED(runner, d2, t2, "<start>", operatorInputs);
+        else COMPARE(runner, d2, t2, "<start>", operatorInputs);
+    }
+
+    // A factored grammar replays the winning branch as a whole
+    Grammar optimized;
+    GrammarOptimizer opt;
+    opt.setAllPasses(true);
+    optimized.setOptimizer(&opt);
+    buildCalls(optimized);
+    BNFParser direct(optimized.finalize()), twoPhase(optimized.finalize());
+    twoPhase.setTwoPhase(true);
+    COMPARE(runner, direct, twoPhase, "<prog>", callInputs);
+}
+
+void test_node_storage(TestRunner& runner) {
+    Grammar g;
+    buildCalls(g);
+    const CompiledGrammar& cg = g.finalize();
+    BNFParser heap(cg), arenaParser(cg), zero(cg), batch(cg);
+    arenaParser.setTwoPhase(true);
+    zero.setTwoPhase(true);
+    zero.setZeroCopy(true);
+    batch.setTwoPhase(true);
+    std::string input = "p(q[r(s,t)],u)=v[w];f();k;";
+
+    size_t c0 = 0, c1 = 0;
+    ASTNode* expected = heap.parse("<prog>", input, c0);
+    ASSERT_NOT_NULL(runner, expected);
+    ASSERT_EQ(runner, c0, input.size());
+
+    Arena arena(4096);
+    ASTNode* pooled = arenaParser.parse("<prog>", input, c1, arena);
+    ASSERT_EQ(runner, c1, c0);
+    ASSERT_TRUE(runner, sameTree(pooled, expected));
+    ASTNode* spans = zero.parse("<prog>", input, c1);
+    ASSERT_EQ(runner, c1, c0);
+    ASSERT_TRUE(runner, sameTree(spans, expected));
+    ASSERT_TRUE(runner, spans->matched.empty());
+    delete spans;
+
+    std::vector<std::string> inputs;
+    inputs.push_back(input);
+    inputs.push_back("f(");
+    inputs.push_back("a;b");
+    BatchResult out;
+    ASSERT_EQ(runner, batch.parseBatch("<prog>", inputs, out), 2u);
+    ASSERT_EQ(runner, out.entries[0].consumed, input.size());
+    ASSERT_EQ(runner, out.entries[2].consumed, 2u);
+    ASTNode* flat = out.toAST(out.entries[0].root, input);
+    ASSERT_TRUE(runner, sameTree(flat, expected));
+    delete flat;
+    delete expected;
+
+    // The iterative engine builds its tree directly
+    BNFParser iterative(cg);
+    iterative.setEngine(BNFParser::ENGINE_ITERATIVE);
+    iterative.setTwoPhase(true);
+    expected = heap.parse("<prog>", input, c0);
+    ASTNode* ast = iterative.parse("<prog>", input, c1);
+    ASSERT_TRUE(runner, sameTree(ast, expected));
+    ASSERT_EQ(runner, iterative.getStats().decisions, 0u);
+    delete ast;
+    delete expected;
+}
+
+void test_stats(TestRunner& runner) {
+    Grammar g;
+    buildCalls(g);
+    const CompiledGrammar& cg = g.finalize();
+    BNFParser direct(cg), twoPhase(cg);
+    twoPhase.setTwoPhase(true);
+    std::string input = "p(q[r(s,t)],u)=v[w];f();k;";
+
+    // Backtracking builds and discards the subtrees of losing branches
+    size_t consumed = 0;
+    ASTNode* a = direct.parse("<prog>", input, consumed);
+    ASTNode* b = twoPhase.parse("<prog>", input, consumed);
+    ASSERT_TRUE(runner, sameTree(a, b));
+    ASSERT_EQ(runner, twoPhase.getStats().nodesBuilt, countNodes(b));
+    ASSERT_TRUE(runner, direct.getStats().nodesBuilt > 2 * countNodes(a));
+    ASSERT_TRUE(runner, twoPhase.getStats().decisions > 0u);
+    ASSERT_EQ(runner, direct.getStats().decisions, 0u);
+    delete a;
+    delete b;
+
+    // Recognizing creates no nodes and replays nothing
+    twoPhase.resetStats();
+    ASSERT_TRUE(runner, twoPhase.recognize("<prog>", input, consumed));
+    ASSERT_EQ(runner, consumed, input.size());
+    ASSERT_EQ(runner, twoPhase.getStats().nodesBuilt, 0u);
+    ASSERT_EQ(runner, twoPhase.getStats().decisions, 0u);
+
+    // A failed first pass builds nothing either
+    ASSERT_NULL(runner, twoPhase.parse("<prog>", "f(", consumed));
+    ASSERT_EQ(runner, twoPhase.getStats().nodesBuilt, 0u);
+
+    // Switching back parses directly
+    twoPhase.setTwoPhase(false);
+    twoPhase.resetStats();
+    delete twoPhase.parse("<prog>", input, consumed);
+    ASSERT_EQ(runner, twoPhase.getStats().decisions, 0u);
+    ASSERT_EQ(runner, twoPhase.getStats().nodesBuilt, direct.getStats().nodesBuilt);
+}
+
+// Bytes a memoized iterative parse allocates on `p`
+static size_t iterativeBytes(BNFParser& p, const std::string& input) {
+    p.setEngine(BNFParser::ENGINE_ITERATIVE);
+    size_t consumed = 0;
+    size_t before = allocatedBytes;
+    delete p.parse("<prog>", input, consumed);
+    return allocatedBytes - before;
+}
+
+void test_log_released(TestRunner& runner) {
+    Grammar g;
+    buildCalls(g);
+    const CompiledGrammar& cg = g.finalize();
+    std::string input;
+    for (int i = 0; i < 200; ++i) input += "p(q[r(s,t)],u)=v[w];";
+
+    // The same memoized parses, one of them in two phases first
+    BNFParser twoPhase(cg), direct(cg);
+    twoPhase.setMemoization(true);
+    direct.setMemoization(true);
+    twoPhase.setTwoPhase(true);
+    size_t consumed = 0;
+    delete twoPhase.parse("<prog>", input, consumed);
+    ASSERT_EQ(runner, consumed, input.size());
+    delete direct.parse("<prog>", input, consumed);
+
+    // Memo entries of other parses copy no choices
+    ASSERT_TRUE(runner, iterativeBytes(twoPhase, input) <= iterativeBytes(direct, input));
+}
+
+int main() {
+    TestSuite suite("Two-Phase Parsing Test Suite");
+    suite.addTest("Same Tree", test_same_tree);
+    suite.addTest("Options", test_options);
+    suite.addTest("Node Storage", test_node_storage);
+    suite.addTest("Stats", test_stats);
+    suite.addTest("Log Released", test_log_released);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/VMParser.hpp"
+#include "TestHelpers.hpp"
+#include <string>
+#include <sstream>
+
+// Parse with both engines and require identical outcome and tree
+static void checkSame(TestRunner& runner, const Grammar& g, const std::string& rule,
+                      const std::string& input) {
+    BNFParser tree(g);
+    VMParser vm(g);
+    size_t c1 = 0, c2 = 0;
+    ASTNode* a = tree.parse(rule, input, c1);
+    ASTNode* b = vm.parse(rule, input, c2);
+    ASSERT_EQ(runner, c1, c2);
+    ASSERT_TRUE(runner, sameTree(a, b));
+    delete a;
+    delete b;
+}
+
+void test_vm_terminals_and_sequences(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<A> ::= 'HELLO'");
+    g.addRule("<seq> ::= 'A' 'B' 'C'");
+    checkSame(runner, g, "<A>", "HELLO");
+    checkSame(runner, g, "<A>", "HALLO");
+    checkSame(runner, g, "<seq>", "ABC");
+    checkSame(runner, g, "<seq>", "ABX");
+}
+
+void test_vm_longest_alternative(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<alt> ::= 'A' | 'AB' | 'ABC'");
+    g.addRule("<pick> ::= 'x' 'y' | 'x' | 'x' 'y' 'z'");
+    checkSame(runner, g, "<alt>", "ABC");
+    checkSame(runner, g, "<alt>", "AB");
+    checkSame(runner, g, "<alt>", "C");
+    checkSame(runner, g, "<pick>", "xyz");
+    checkSame(runner, g, "<pick>", "xy");
+}
+
+void test_vm_optional_and_repeat(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<opt> ::= 'A' [ 'B' ] 'C'");
+    g.addRule("<rep> ::= 'A' { 'B' }");
+    g.addRule("<nested> ::= { [ 'a' ] 'b' }");
+    checkSame(runner, g, "<opt>", "ABC");
+    checkSame(runner, g, "<opt>", "AC");
+    checkSame(runner, g, "<opt>", "AXC");
+    checkSame(runner, g, "<rep>", "ABBB");
+    checkSame(runner, g, "<rep>", "A");
+    checkSame(runner, g, "<nested>", "abbab");
+}
+
+void test_vm_empty_alternative(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<s> ::= [ 'a' ] | 'b'");
+    g.addRule("<t> ::= 'x' <s> 'y'");
+    checkSame(runner, g, "<s>", "c");
+    checkSame(runner, g, "<t>", "xy");
+    checkSame(runner, g, "<t>", "xay");
+    checkSame(runner, g, "<t>", "xby");
+}
+
+void test_vm_protocol_grammar(TestRunner& runner) {
+    Grammar g;
+    buildMiniProtocol(g);
+
+    checkSame(runner, g, "<message>", "MSG alice :Hello there!\r\n");
+    checkSame(runner, g, "<message>", "MSG  bob_1 :x\r\n");
+    checkSame(runner, g, "<message>", "MSG 9bob :x\r\n");
+    checkSame(runner, g, "<message>", "MSG bob :no crlf");
+}
+
+void test_vm_unknown_rule(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<a> ::= <missing> | 'x'");
+    VMParser vm(g);
+    size_t consumed = 0;
+    ASTNode* ast = vm.parse("<nope>", "x", consumed);
+    ASSERT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, 0u);
+    checkSame(runner, g, "<a>", "x");
+    ASSERT_GE(runner, vm.getProgram().entryPoint("<a>"), 1);
+}
+
+void test_vm_left_recursion(TestRunner& runner) {
+    Grammar g;
+    g.addRule("<loop> ::= 'a' | <loop> 'b'");
+    g.addRule("<top> ::= 'x' | <loop>");
+    g.addRule("<plain> ::= 'a' { 'b' }");
+    VMParser vm(g);
+
+    // Rejected when compiled, so calls fail instead of looping
+    ASSERT_EQ(runner, vm.getProgram().unsupported.size(), 1u);
+    ASSERT_EQ(runner, vm.getProgram().unsupported[0], "<loop>");
+    size_t consumed = 0;
+    ASSERT_NULL(runner, vm.parse("<loop>", "abb", consumed));
+    ASSERT_EQ(runner, consumed, 0u);
+    ASTNode* ast = vm.parse("<top>", "x", consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    delete ast;
+    ASSERT_NULL(runner, vm.parse("<top>", "abb", consumed));
+    checkSame(runner, g, "<plain>", "abb");
+}
+
+int main() {
+    TestSuite suite("Bytecode VM Test Suite");
+    suite.addTest("Terminals And Sequences", test_vm_terminals_and_sequences);
+    suite.addTest("Longest Alternative", test_vm_longest_alternative);
+    suite.addTest("Optional And Repeat", test_vm_optional_and_repeat);
+    suite.addTest("Empty Alternative", test_vm_empty_alternative);
+    suite.addTest("Protocol Grammar", test_vm_protocol_grammar);
+    suite.addTest("Unknown Rule", test_vm_unknown_rule);
+    suite.addTest("Left Recursion", test_vm_left_recursion);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}
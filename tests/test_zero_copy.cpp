@@ -0,0 +1,124 @@
+#include "../include/TestFramework.hpp"
+#include "../include/Grammar.hpp"
+#include "../include/BNFParser.hpp"
+#include "../include/DataExtractor.hpp"
+#include <string>
+
+static void buildGrammar(Grammar& g) {
+    g.addRule("<letter> ::= 'a' ... 'z'");
+    g.addRule("<digit> ::= ( '0' ... '9' )");
+    g.addRule("<word> ::= <letter> { <letter> | <digit> }");
+    g.addRule("<list> ::= <word> [ ',' <list> ] | ");
+}
+
+// In copy mode every node's span covers exactly its matched text
+static bool spansMatch(const ASTNode* n, const std::string& input) {
+    if (!n) return true;
+    if (n->source) return false;
+    if (input.substr(n->begin, n->end - n->begin) != n->matched) return false;
+    for (size_t i = 0; i < n->children.size(); ++i) {
+        if (!spansMatch(n->children[i], input)) return false;
+    }
+    return true;
+}
+
+// Zero-copy tree has the same shape and spans, with text() standing in for matched
+static bool sameText(const ASTNode* copy, const ASTNode* zc) {
+    if (!copy || !zc) return copy == zc;
+    if (copy->symbol != zc->symbol || !zc->matched.empty()) return false;
+    if (copy->matched != zc->text()) return false;
+    if (copy->children.size() != zc->children.size()) return false;
+    for (size_t i = 0; i < copy->children.size(); ++i) {
+        if (!sameText(copy->children[i], zc->children[i])) return false;
+    }
+    return true;
+}
+
+void test_spans_in_copy_mode(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    BNFParser p(g);
+
+    std::string input = "abc,d4,efg";
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<list>", input, consumed);
+    ASSERT_NOT_NULL(runner, ast);
+    ASSERT_EQ(runner, consumed, input.size());
+    ASSERT_EQ(runner, ast->begin, 0u);
+    ASSERT_EQ(runner, ast->end, input.size());
+    ASSERT_TRUE(runner, spansMatch(ast, input));
+    ASSERT_EQ(runner, ast->text(), input);
+    delete ast;
+}
+
+void test_zero_copy_same_text(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    BNFParser copying(g);
+    BNFParser zc(g);
+    zc.setZeroCopy(true);
+
+    const char* inputs[] = { "abc,d4,efg", "x", "", "a,", "9" };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+        std::string input = inputs[i];
+        size_t c1 = 0, c2 = 0;
+        ASTNode* a = copying.parse("<list>", input, c1);
+        ASTNode* b = zc.parse("<list>", input, c2);
+        ASSERT_EQ(runner, c1, c2);
+        ASSERT_TRUE(runner, sameText(a, b));
+        if (b) ASSERT_TRUE(runner, b->source == &input);
+        delete a;
+        delete b;
+    }
+}
+
+void test_zero_copy_engines_memo_arena(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    BNFParser copying(g);
+    BNFParser zc(g.finalize());
+    zc.setZeroCopy(true);
+    zc.setEngine(BNFParser::ENGINE_ITERATIVE);
+    zc.setMemoization(true);
+    Arena arena;
+
+    std::string input = "one,two2,three3";
+    size_t c1 = 0, c2 = 0;
+    ASTNode* a = copying.parse("<list>", input, c1);
+    ASTNode* b = zc.parse("<list>", input, c2, arena);
+    ASSERT_EQ(runner, c1, c2);
+    ASSERT_TRUE(runner, sameText(a, b));
+    delete a;
+}
+
+void test_zero_copy_extraction(TestRunner& runner) {
+    Grammar g;
+    buildGrammar(g);
+    BNFParser p(g);
+    p.setZeroCopy(true);
+
+    std::string input = "alpha,beta,gamma";
+    size_t consumed = 0;
+    ASTNode* ast = p.parse("<list>", input, consumed);
+    ASSERT_NOT_NULL(runner, ast);
+
+    DataExtractor extractor;
+    std::vector<std::string> symbols;
+    symbols.push_back("<word>");
+    extractor.setSymbols(symbols);
+    ExtractedData data = extractor.extract(ast);
+    ASSERT_EQ(runner, data.count("<word>"), 3u);
+    ASSERT_EQ(runner, data.first("<word>"), "alpha");
+    delete ast;
+}
+
+int main() {
+    TestSuite suite("Zero-Copy AST Test Suite");
+    suite.addTest("Spans In Copy Mode", test_spans_in_copy_mode);
+    suite.addTest("Zero-Copy Same Text", test_zero_copy_same_text);
+    suite.addTest("Engines, Memo And Arena", test_zero_copy_engines_memo_arena);
+    suite.addTest("Extraction From Zero-Copy Tree", test_zero_copy_extraction);
+    TestRunner results = suite.run();
+    results.printSummary();
+    return results.allPassed() ? 0 : 1;
+}